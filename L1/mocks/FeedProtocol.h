@@ -0,0 +1,261 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Binary protocol spoken by dummy_market_server.py and the C++ feed readers.
+//
+// A packet is a PacketHeader followed by `count` messages, numbered
+// sequence, sequence + 1, ... Each message starts with a MessageHeader whose
+// length covers the whole message, so a reader skips types it doesn't know
+// and ignores fields appended by a newer minor revision. A different
+// kVersion is a breaking change and the packet is rejected. All fields are
+// little-endian and packed; the static_asserts below pin every offset, and
+// dummy_market_server.py packs the same layouts ('<HBBHHQ', '<BBHIQq').
+//
+// Prices are fixed point with four implied decimals (as in ITCH), so
+// 101.2500 travels as 1012500.
+namespace feed {
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "fields are read in place as little-endian");
+
+constexpr uint16_t kMagic = 0x464D;   // "MF"
+constexpr uint8_t kVersion = 1;
+constexpr int64_t kPriceScale = 10000;
+constexpr size_t kMaxPacket = 1472;   // One Ethernet frame of UDP payload
+
+enum MessageType : uint8_t {
+    kTrade = 'T',
+    kQuote = 'Q',
+};
+
+#pragma pack(push, 1)
+struct PacketHeader {
+    uint16_t magic;
+    uint8_t version;
+    uint8_t flags;
+    uint16_t length;     // Whole packet, header included
+    uint16_t count;      // Messages that follow
+    uint64_t sequence;   // Of the first message
+};
+
+struct MessageHeader {
+    uint8_t type;
+    uint8_t flags;
+    uint16_t length;     // Whole message, header included
+};
+
+struct Trade {
+    MessageHeader header;
+    uint32_t volume;
+    uint64_t timestamp;  // ns since the epoch
+    int64_t price;
+};
+
+struct Quote {
+    MessageHeader header;
+    uint32_t bidSize;
+    int64_t bidPrice;
+    int64_t askPrice;
+    uint32_t askSize;
+    uint32_t reserved;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(PacketHeader) == 16, "PacketHeader layout");
+static_assert(offsetof(PacketHeader, length) == 4 && offsetof(PacketHeader, count) == 6 &&
+              offsetof(PacketHeader, sequence) == 8, "PacketHeader offsets");
+static_assert(sizeof(MessageHeader) == 4 && offsetof(MessageHeader, length) == 2, "MessageHeader layout");
+static_assert(sizeof(Trade) == 24, "Trade layout");
+static_assert(offsetof(Trade, volume) == 4 && offsetof(Trade, timestamp) == 8 && offsetof(Trade, price) == 16,
+              "Trade offsets");
+static_assert(sizeof(Quote) == 32, "Quote layout");
+static_assert(offsetof(Quote, bidPrice) == 8 && offsetof(Quote, askPrice) == 16 && offsetof(Quote, askSize) == 24,
+              "Quote offsets");
+
+// Unaligned field loads and stores; each compiles to one mov on x86-64
+template <typename T>
+inline T load(const char* p) {
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+template <typename T>
+inline void store(char* p, T value) {
+    std::memcpy(p, &value, sizeof(T));
+}
+
+#define FEED_FIELD(Layout, type, name) \
+    type name() const { return load<type>(p + offsetof(Layout, name)); }
+
+// Views read fields straight out of the receive buffer; nothing is copied
+// until a field is asked for
+class TradeView {
+public:
+    explicit TradeView(const char* p) : p(p) {}
+    FEED_FIELD(Trade, uint32_t, volume)
+    FEED_FIELD(Trade, uint64_t, timestamp)
+    FEED_FIELD(Trade, int64_t, price)
+
+private:
+    const char* p;
+};
+
+class QuoteView {
+public:
+    explicit QuoteView(const char* p) : p(p) {}
+    FEED_FIELD(Quote, uint32_t, bidSize)
+    FEED_FIELD(Quote, int64_t, bidPrice)
+    FEED_FIELD(Quote, int64_t, askPrice)
+    FEED_FIELD(Quote, uint32_t, askSize)
+
+private:
+    const char* p;
+};
+
+#undef FEED_FIELD
+
+class MessageView {
+public:
+    explicit MessageView(const char* p) : p(p) {}
+    uint8_t type() const { return load<uint8_t>(p); }
+    uint16_t length() const { return load<uint16_t>(p + offsetof(MessageHeader, length)); }
+    TradeView trade() const { return TradeView(p); }
+    QuoteView quote() const { return QuoteView(p); }
+
+private:
+    const char* p;
+};
+
+enum class Status {
+    Ok,
+    Truncated,    // Fewer bytes than the header says
+    BadMagic,     // Not this protocol, or the stream is out of frame
+    BadVersion,
+    BadLength,    // A message overruns the packet or is shorter than its type
+};
+
+inline const char* to_string(Status status) {
+    switch (status) {
+        case Status::Ok: return "ok";
+        case Status::Truncated: return "truncated";
+        case Status::BadMagic: return "bad magic";
+        case Status::BadVersion: return "bad version";
+        case Status::BadLength: return "bad length";
+    }
+    return "?";
+}
+
+inline uint16_t packet_length(const char* packet) { return load<uint16_t>(packet + offsetof(PacketHeader, length)); }
+inline uint16_t packet_count(const char* packet) { return load<uint16_t>(packet + offsetof(PacketHeader, count)); }
+inline uint64_t packet_sequence(const char* packet) {
+    return load<uint64_t>(packet + offsetof(PacketHeader, sequence));
+}
+
+// Validate the header of a packet of `size` bytes
+inline Status check(const char* packet, size_t size) {
+    if (size < sizeof(PacketHeader)) return Status::Truncated;
+    if (load<uint16_t>(packet) != kMagic) return Status::BadMagic;
+    if (load<uint8_t>(packet + offsetof(PacketHeader, version)) != kVersion) return Status::BadVersion;
+    size_t length = packet_length(packet);
+    if (length < sizeof(PacketHeader)) return Status::BadLength;
+    if (length > size) return Status::Truncated;
+    return Status::Ok;
+}
+
+// Smallest valid length of a message of each type; just the header for unknown ones
+inline size_t min_length(uint8_t type) {
+    switch (type) {
+        case kTrade: return sizeof(Trade);
+        case kQuote: return sizeof(Quote);
+        default: return sizeof(MessageHeader);
+    }
+}
+
+// Call handler(sequence, MessageView) for every message of a packet, in
+// order. Messages handed out before an error stay valid.
+template <typename Handler>
+Status decode(const char* packet, size_t size, Handler&& handler) {
+    Status status = check(packet, size);
+    if (status != Status::Ok) return status;
+    const char* end = packet + packet_length(packet);
+    const char* p = packet + sizeof(PacketHeader);
+    uint64_t sequence = packet_sequence(packet);
+    for (uint16_t i = 0, count = packet_count(packet); i < count; i++) {
+        if (end - p < static_cast<ptrdiff_t>(sizeof(MessageHeader))) return Status::BadLength;
+        MessageView message(p);
+        size_t length = message.length();
+        if (length < min_length(message.type()) || length > static_cast<size_t>(end - p)) {
+            return Status::BadLength;
+        }
+        handler(sequence + i, message);
+        p += length;
+    }
+    return Status::Ok;
+}
+
+// Fills one packet in a caller's buffer; the packet is ready after finish()
+class PacketBuilder {
+public:
+    PacketBuilder(char* buffer, size_t capacity) : buffer(buffer), capacity(capacity) {}
+
+    void begin(uint64_t sequence) {
+        store<uint16_t>(buffer, kMagic);
+        store<uint8_t>(buffer + offsetof(PacketHeader, version), kVersion);
+        store<uint8_t>(buffer + offsetof(PacketHeader, flags), 0);
+        store<uint64_t>(buffer + offsetof(PacketHeader, sequence), sequence);
+        used = sizeof(PacketHeader);
+        count = 0;
+    }
+
+    // False when the message doesn't fit; the packet is unchanged
+    bool add_trade(uint64_t timestamp, int64_t price, uint32_t volume) {
+        char* p = reserve(sizeof(Trade), kTrade);
+        if (!p) return false;
+        store(p + offsetof(Trade, volume), volume);
+        store(p + offsetof(Trade, timestamp), timestamp);
+        store(p + offsetof(Trade, price), price);
+        return true;
+    }
+
+    bool add_quote(int64_t bidPrice, uint32_t bidSize, int64_t askPrice, uint32_t askSize) {
+        char* p = reserve(sizeof(Quote), kQuote);
+        if (!p) return false;
+        store(p + offsetof(Quote, bidSize), bidSize);
+        store(p + offsetof(Quote, bidPrice), bidPrice);
+        store(p + offsetof(Quote, askPrice), askPrice);
+        store(p + offsetof(Quote, askSize), askSize);
+        store<uint32_t>(p + offsetof(Quote, reserved), 0);
+        return true;
+    }
+
+    // Writes length and count; returns the packet's size
+    size_t finish() {
+        store<uint16_t>(buffer + offsetof(PacketHeader, length), static_cast<uint16_t>(used));
+        store<uint16_t>(buffer + offsetof(PacketHeader, count), count);
+        return used;
+    }
+
+    uint16_t messages() const { return count; }
+
+private:
+    char* reserve(size_t length, uint8_t type) {
+        if (used + length > capacity || used + length > UINT16_MAX || count == UINT16_MAX) return nullptr;
+        char* p = buffer + used;
+        store<uint8_t>(p, type);
+        store<uint8_t>(p + offsetof(MessageHeader, flags), 0);
+        store<uint16_t>(p + offsetof(MessageHeader, length), static_cast<uint16_t>(length));
+        used += length;
+        count++;
+        return p;
+    }
+
+    char* buffer;
+    size_t capacity;
+    size_t used = 0;
+    uint16_t count = 0;
+};
+
+}  // namespace feed
@@ -0,0 +1,164 @@
+// FeedProtocol round-trip checks and decode throughput: packets decoded from
+// memory, and from a socket through FeedReader with a writer thread.
+//
+//   g++ -std=c++17 -O2 -pthread FeedProtocolBenchmark.cpp -o feedProtocolBenchmark
+//   ./feedProtocolBenchmark [--messages <n>]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+
+#include "FeedReader.h"
+
+namespace {
+
+int failures = 0;
+
+void expect(bool ok, const char* what) {
+    if (!ok) {
+        std::printf("FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+// Packets of full-frame trade batches with a quote every 8 messages
+std::vector<char> makeStream(uint64_t messages) {
+    std::vector<char> stream;
+    char packet[feed::kMaxPacket];
+    feed::PacketBuilder builder(packet, sizeof(packet));
+    uint64_t sequence = 1;
+    while (sequence <= messages) {
+        builder.begin(sequence);
+        while (sequence + builder.messages() <= messages) {
+            uint64_t n = sequence + builder.messages();
+            bool added = n % 8 == 0 ? builder.add_quote(1000000, 5, 1000100, 7)
+                                    : builder.add_trade(n, 1000000 + static_cast<int64_t>(n % 500), 100);
+            if (!added) break;
+        }
+        sequence += builder.messages();
+        size_t length = builder.finish();
+        stream.insert(stream.end(), packet, packet + length);
+    }
+    return stream;
+}
+
+void selfCheck() {
+    char packet[feed::kMaxPacket];
+    feed::PacketBuilder builder(packet, sizeof(packet));
+    builder.begin(41);
+    builder.add_trade(123456789, 1012500, 300);
+    builder.add_quote(1012400, 10, 1012600, 20);
+    size_t length = builder.finish();
+    expect(length == sizeof(feed::PacketHeader) + sizeof(feed::Trade) + sizeof(feed::Quote), "packet length");
+
+    int seen = 0;
+    feed::Status status = feed::decode(packet, length, [&](uint64_t sequence, feed::MessageView m) {
+        if (seen == 0) {
+            expect(sequence == 41 && m.type() == feed::kTrade, "trade first");
+            expect(m.trade().timestamp() == 123456789 && m.trade().price() == 1012500 && m.trade().volume() == 300,
+                   "trade fields");
+        } else {
+            expect(sequence == 42 && m.type() == feed::kQuote, "quote second");
+            expect(m.quote().bidPrice() == 1012400 && m.quote().askSize() == 20, "quote fields");
+        }
+        seen++;
+    });
+    expect(status == feed::Status::Ok && seen == 2, "decode both");
+
+    // Unknown types and longer messages (a newer minor revision) are skipped by length
+    char future[64] = {};
+    builder = feed::PacketBuilder(future, sizeof(future));
+    builder.begin(1);
+    builder.add_trade(1, 2, 3);
+    length = builder.finish();
+    feed::store<uint8_t>(future + sizeof(feed::PacketHeader), 'Z');
+    seen = 0;
+    status = feed::decode(future, length, [&](uint64_t, feed::MessageView m) { seen += m.type() == 'Z'; });
+    expect(status == feed::Status::Ok && seen == 1, "unknown type passed through");
+
+    feed::store<uint8_t>(packet + offsetof(feed::PacketHeader, version), feed::kVersion + 1);
+    expect(feed::check(packet, sizeof(packet)) == feed::Status::BadVersion, "version rejected");
+    feed::store<uint8_t>(packet + offsetof(feed::PacketHeader, version), feed::kVersion);
+    expect(feed::check(packet, 20) == feed::Status::Truncated, "short packet");
+    feed::store<uint16_t>(packet + sizeof(feed::PacketHeader) + offsetof(feed::MessageHeader, length), 8);
+    expect(feed::decode(packet, sizeof(packet), [](uint64_t, feed::MessageView) {}) == feed::Status::BadLength,
+           "short trade rejected");
+    expect(feed::check("XX", 2) == feed::Status::Truncated && feed::check("0123456789abcdef", 16) ==
+           feed::Status::BadMagic, "framing");
+}
+
+struct Totals {
+    uint64_t trades = 0;
+    uint64_t quotes = 0;
+    uint64_t last = 0;
+    int64_t checksum = 0;
+
+    void operator()(uint64_t sequence, feed::MessageView m) {
+        if (m.type() == feed::kTrade) {
+            feed::TradeView t = m.trade();
+            checksum += t.price() * t.volume();
+            trades++;
+        } else {
+            quotes++;
+        }
+        last = sequence;
+    }
+};
+
+double seconds(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - since).count();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    uint64_t messages = 20000000;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (std::string(argv[i]) == "--messages") messages = std::strtoull(argv[++i], nullptr, 10);
+    }
+
+    selfCheck();
+    std::vector<char> stream = makeStream(messages);
+    std::printf("%llu messages in %zu bytes\n", static_cast<unsigned long long>(messages), stream.size());
+
+    // From memory: the decoder alone
+    Totals memory;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t offset = 0; offset < stream.size(); offset += feed::packet_length(stream.data() + offset)) {
+        feed::decode(stream.data() + offset, stream.size() - offset, memory);
+    }
+    double elapsed = seconds(start);
+    expect(memory.last == messages && memory.trades + memory.quotes == messages, "memory decode count");
+    std::printf("%-24s %8.1fM msg/s %8.2f GB/s\n", "decode from memory", messages / elapsed / 1e6,
+                stream.size() / elapsed / 1e9);
+
+    // Through a socket: FeedReader framing, with ring wraps
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    std::thread writer([&]() {
+        for (size_t offset = 0; offset < stream.size();) {
+            ssize_t sent = ::write(fds[1], stream.data() + offset, std::min<size_t>(stream.size() - offset, 1 << 20));
+            if (sent <= 0) break;
+            offset += static_cast<size_t>(sent);
+        }
+        ::close(fds[1]);
+    });
+    static FeedReader<> reader(fds[0]);
+    Totals socket;
+    start = std::chrono::steady_clock::now();
+    while (const char* packet = reader.next_packet()) {
+        feed::decode(packet, feed::packet_length(packet), socket);
+    }
+    elapsed = seconds(start);
+    writer.join();
+    ::close(fds[0]);
+    expect(socket.last == messages && socket.checksum == memory.checksum, "socket decode matches memory");
+    std::printf("%-24s %8.1fM msg/s %8.2f GB/s  (%llu reads, %llu packets)\n", "decode through FeedReader",
+                messages / elapsed / 1e6, stream.size() / elapsed / 1e9,
+                static_cast<unsigned long long>(reader.reads()), static_cast<unsigned long long>(reader.packets()));
+
+    std::printf(failures ? "%d checks failed\n" : "all checks passed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "FeedProtocol.h"
+
+// Buffered reader for a stream of FeedProtocol packets.
+//
+// Each refill is one readv() into all the free space of a ring buffer
+// (both ends of it after a wrap), so a 64 KB ring takes about a hundred
+// packets per system call instead of one. Short reads are normal: whole
+// packets are handed out as they complete, and one split across reads
+// stays buffered until the rest arrives. Packets are framed by the length
+// in their header and handed out in place, except one that wraps around
+// the end of the ring, which is first copied out.
+template <size_t Capacity = 1 << 16>
+class FeedReader {
+    static_assert((Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+    static_assert(Capacity >= 65536, "ring must hold the largest packet");
+
+public:
+    explicit FeedReader(int fd) : fd(fd) {}
+
+    // The next whole packet, valid until the next call, reading only when
+    // none is buffered. Blocks like read() on a blocking socket. Returns
+    // nullptr only at end of stream; throws on a read error or a header
+    // that doesn't check out (the stream would be out of frame).
+    const char* next_packet() {
+        if (!fill(sizeof(feed::PacketHeader))) return nullptr;
+        const char* header = contiguous(sizeof(feed::PacketHeader));
+        feed::Status status = feed::check(header, sizeof(feed::PacketHeader));
+        size_t length = feed::packet_length(header);
+        if (status != feed::Status::Ok && status != feed::Status::Truncated) {
+            throw std::runtime_error(std::string("feed packet: ") + feed::to_string(status));
+        }
+        if (!fill(length)) return nullptr;
+        const char* packet = contiguous(length);
+        head += length;
+        ++packetCount;
+        return packet;
+    }
+
+    // System calls made so far, the bytes they returned, and packets handed out
+    uint64_t reads() const { return readCalls; }
+    uint64_t bytes() const { return tail; }
+    uint64_t packets() const { return packetCount; }
+
+private:
+    size_t buffered() const { return static_cast<size_t>(tail - head); }
+
+    bool fill(size_t bytes) {
+        while (buffered() < bytes) {
+            if (!refill()) return false;
+        }
+        return true;
+    }
+
+    // The next `length` buffered bytes in one piece
+    const char* contiguous(size_t length) {
+        size_t offset = head & (Capacity - 1);
+        if (offset + length <= Capacity) return ring + offset;
+        size_t first = Capacity - offset;
+        std::memcpy(wrapped, ring + offset, first);
+        std::memcpy(wrapped + first, ring, length - first);
+        return wrapped;
+    }
+
+    // One readv() into the free space; false at end of stream
+    bool refill() {
+        size_t free = Capacity - buffered();
+        size_t offset = tail & (Capacity - 1);
+        size_t first = free < Capacity - offset ? free : Capacity - offset;
+        iovec spans[2] = {{ring + offset, first}, {ring, free - first}};
+        while (true) {
+            ssize_t got = ::readv(fd, spans, free == first ? 1 : 2);
+            ++readCalls;
+            if (got > 0) {
+                tail += static_cast<uint64_t>(got);
+                return true;
+            }
+            if (got == 0) return false;
+            if (errno != EINTR) throw std::runtime_error(std::string("feed read: ") + std::strerror(errno));
+        }
+    }
+
+    int fd;
+    uint64_t head = 0;   // Consumed bytes
+    uint64_t tail = 0;   // Received bytes
+    uint64_t readCalls = 0;
+    uint64_t packetCount = 0;
+    alignas(64) char ring[Capacity];
+    char wrapped[65536];   // A packet that wraps the ring, made contiguous
+};
@@ -2,41 +2,52 @@
 #include <chrono>
 #include <vector>
 #include <cstring>
+#include <arpa/inet.h>
+#include <netinet/in.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
-struct MarketData {
-    uint64_t timestamp;
-    double price;
-    uint32_t volume;
-};
-
-// Parsing function (works on raw bytes, no extra allocations)
-inline MarketData parse(const char* buffer) {
-    MarketData data;
-    std::memcpy(&data, buffer, sizeof(MarketData));
-    return data;
-}
+#include "FeedReader.h"
 
+// Reads trades from dummy_market_server.py (localhost:5555): one readv()
+// per ring refill, many packets per refill, many trades per packet.
 int main() {
-    char buffer[sizeof(MarketData)];
     int sock = socket(AF_INET, SOCK_STREAM, 0);
-    // Assume already connected...
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(5555);
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    if (connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        std::cerr << "connect: " << std::strerror(errno) << "\n";
+        return 1;
+    }
+
+    static FeedReader<> reader(sock);   // 64 KB ring; static keeps it off the stack
+    uint64_t received = 0;
+    int64_t checksum = 0;
 
     auto start = std::chrono::high_resolution_clock::now();
 
-    for (int i = 0; i < 1000000; i++) {
-        read(sock, buffer, sizeof(buffer));
-        MarketData md = parse(buffer);
-        // Decision logic here (fast math, no heap allocation)
+    while (received < 1000000) {
+        const char* packet = reader.next_packet();
+        if (!packet) break;   // Server went away
+        feed::decode(packet, feed::packet_length(packet), [&](uint64_t, feed::MessageView message) {
+            if (message.type() != feed::kTrade) return;
+            feed::TradeView trade = message.trade();
+            // Decision logic here (fixed-point math, no heap allocation)
+            checksum += trade.price() * trade.volume();
+            received++;
+        });
     }
 
     auto end = std::chrono::high_resolution_clock::now();
-    std::cout << "Elapsed: "
-              << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()
-              << " us\n";
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    std::cout << "Elapsed: " << us << " us for " << received << " trades ("
+              << (us ? static_cast<double>(received) / static_cast<double>(us) : 0) << "M/s) in " << reader.packets()
+              << " packets, " << reader.reads() << " reads ("
+              << (reader.reads() ? reader.bytes() / reader.reads() : 0) << " bytes each)\n";
+    std::cout << "Checksum: " << checksum << "\n";   // Keeps the loop from being optimized out
 
     close(sock);
     return 0;
 }
-
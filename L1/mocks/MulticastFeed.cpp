@@ -0,0 +1,156 @@
+// Multicast feed handler demo: receives A/B lines, arbitrates them, and hands
+// ticks to a consumer thread through a Fifo3.
+//
+//   g++ -std=c++17 -O2 -pthread MulticastFeed.cpp -o multicastFeed
+//   ./multicastFeed --send [--loss <percent per line>]   # publisher on both lines
+//   ./multicastFeed [--seconds <n>] [--iface <addr>] [--nic <name>]
+//   ./multicastFeed --loopback [--loss <percent>]        # both, in one process
+//
+// Lines A and B are 239.1.1.1:5556 and 239.1.1.2:5556. The publisher drops
+// each copy of a packet with the given probability, independently per line,
+// so a tick is lost only when both copies are.
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <thread>
+
+#include "MulticastFeed.h"
+
+namespace {
+
+constexpr uint16_t kPort = 5556;
+constexpr uint16_t kTicksPerPacket = 32;
+
+MulticastConfig defaultConfig() {
+    MulticastConfig config;
+    config.a = {"239.1.1.1", kPort};
+    config.b = {"239.1.1.2", kPort};
+    return config;
+}
+
+// Publishes batches of ticks on both lines until `stop`
+void publish(const MulticastConfig& config, int lossPercent, long packets, const std::atomic<bool>& stop) {
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    in_addr iface{};
+    inet_pton(AF_INET, config.interfaceAddress.c_str(), &iface);
+    setsockopt(sock, IPPROTO_IP, IP_MULTICAST_IF, &iface, sizeof(iface));
+    unsigned char loop = 1;
+    setsockopt(sock, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+
+    sockaddr_in lines[2]{};
+    const FeedLine* feedLines[2] = {&config.a, &config.b};
+    for (int i = 0; i < 2; i++) {
+        lines[i].sin_family = AF_INET;
+        lines[i].sin_port = htons(feedLines[i]->port);
+        inet_pton(AF_INET, feedLines[i]->group.c_str(), &lines[i].sin_addr);
+    }
+
+    std::mt19937 rng(42);
+    char packet[feed::kMaxPacket];
+    feed::PacketBuilder builder(packet, sizeof(packet));
+    uint64_t sequence = 1;
+    for (long n = 0; n < packets && !stop.load(std::memory_order_relaxed); n++) {
+        timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        uint64_t timestamp = static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+        builder.begin(sequence);
+        for (uint16_t i = 0; i < kTicksPerPacket; i++) {
+            builder.add_trade(timestamp, 1000000 + static_cast<int64_t>((sequence + i) % 1000) * 100, 100);
+        }
+        size_t length = builder.finish();
+        for (auto& line : lines) {
+            if (static_cast<int>(rng() % 100) < lossPercent) continue;
+            sendto(sock, packet, length, 0, reinterpret_cast<sockaddr*>(&line), sizeof(line));
+        }
+        sequence += kTicksPerPacket;
+        if (n % 16 == 15) std::this_thread::sleep_for(std::chrono::microseconds(50));   // ~10M ticks/s cap
+    }
+    close(sock);
+}
+
+// Runs the handler for `seconds`, or until `packets` arrive, on this thread;
+// a consumer thread drains and checks the queue
+int receive(const MulticastConfig& config, double seconds) {
+    static Fifo3<FeedTick> queue(1 << 16);
+    static MulticastFeed feed(config, queue);   // Static: the batch buffers are large
+
+    std::atomic<bool> done{false};
+    uint64_t consumed = 0;
+    uint64_t outOfOrder = 0;
+    std::thread consumer([&]() {
+        FeedTick tick;
+        uint64_t last = 0;
+        while (true) {
+            if (!queue.pop(tick)) {
+                if (done.load(std::memory_order_acquire) && queue.empty()) break;
+                continue;
+            }
+            if (tick.sequence <= last) outOfOrder++;
+            last = tick.sequence;
+            consumed++;
+        }
+    });
+
+    auto end = std::chrono::steady_clock::now() + std::chrono::duration<double>(seconds);
+    while (std::chrono::steady_clock::now() < end) {
+        feed.poll();
+    }
+    done.store(true, std::memory_order_release);
+    consumer.join();
+
+    const FeedStats& s = feed.stats();
+    std::cout << "packets " << s.packets << ", ticks " << s.ticks << ", duplicates " << s.duplicates
+              << ", recovered " << s.recovered << ", gaps " << s.gaps << " (" << s.lost
+              << " ticks lost), overruns " << s.overruns << ", malformed " << s.malformed << "\n";
+    std::cout << "busy poll " << (s.busyPoll ? "on" : "off") << ", timestamps "
+              << (s.hardwareTimestamps ? "hardware" : s.softwareTimestamps ? "kernel" : "user space") << "\n";
+    std::cout << "consumed " << consumed << ", out of order " << outOfOrder << "\n";
+    feed.latency().print(std::cout, "packet to queue");
+    return outOfOrder == 0 && consumed == s.ticks ? 0 : 1;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    MulticastConfig config = defaultConfig();
+    bool send = false;
+    bool loopback = false;
+    int lossPercent = 0;
+    double seconds = 5;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--send") send = true;
+        else if (arg == "--loopback") loopback = true;
+        else if (arg == "--loss" && i + 1 < argc) lossPercent = std::atoi(argv[++i]);
+        else if (arg == "--seconds" && i + 1 < argc) seconds = std::atof(argv[++i]);
+        else if (arg == "--iface" && i + 1 < argc) config.interfaceAddress = argv[++i];
+        else if (arg == "--nic" && i + 1 < argc) config.interfaceName = argv[++i];
+    }
+
+    try {
+        std::atomic<bool> stop{false};
+        if (send) {
+            publish(config, lossPercent, 1L << 40, stop);
+            return 0;
+        }
+        if (!loopback) return receive(config, seconds);
+
+        // Publisher on a second thread; the receiver joins first so nothing is missed
+        int result = 0;
+        std::thread publisher;
+        std::thread timer([&]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            publisher = std::thread(publish, std::cref(config), lossPercent, 20000L, std::cref(stop));
+        });
+        result = receive(config, seconds);
+        stop.store(true);
+        timer.join();
+        publisher.join();
+        return result;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,332 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+#include <string>
+#include <arpa/inet.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#include <linux/sockios.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "FeedProtocol.h"
+#include "../../SPSC_QUEUES/spsc_q3.cpp"
+#include "../../orderbook/latency_histogram.h"
+
+// A decoded trade as it leaves the handler
+struct FeedTick {
+    uint64_t sequence;
+    uint64_t timestamp;
+    int64_t price;   // feed::kPriceScale units
+    uint32_t volume;
+    uint64_t rxNs;   // Receive timestamp, CLOCK_REALTIME ns
+};
+
+struct FeedLine {
+    std::string group;   // e.g. "239.1.1.1"
+    uint16_t port = 0;
+};
+
+struct MulticastConfig {
+    FeedLine a;
+    FeedLine b;                           // Port 0: single line, no arbitration
+    std::string interfaceAddress = "0.0.0.0";
+    std::string interfaceName;            // For hardware timestamps, e.g. "eth0"
+    int busyPollUs = 50;                  // SO_BUSY_POLL; 0 leaves it off
+    uint64_t gapTimeoutNs = 100000;       // How long the other line may fill a hole
+};
+
+struct FeedStats {
+    uint64_t packets = 0;
+    uint64_t ticks = 0;          // Delivered to the queue, in sequence
+    uint64_t duplicates = 0;     // Packets the other line had already delivered
+    uint64_t recovered = 0;      // Held packets released once the hole was filled
+    uint64_t gaps = 0;           // Holes neither line filled in time
+    uint64_t lost = 0;           // Ticks in those holes
+    uint64_t overruns = 0;       // Ticks dropped because the queue was full
+    uint64_t malformed = 0;
+    bool busyPoll = false;
+    bool softwareTimestamps = false;
+    bool hardwareTimestamps = false;
+};
+
+// UDP multicast feed handler with A/B line arbitration.
+//
+// Both lines carry the same FeedProtocol packets. Each poll() drains whatever is queued on
+// either socket with one recvmmsg() per line (non-blocking; SO_BUSY_POLL
+// lets the kernel spin on the NIC queue instead of waiting for an
+// interrupt). Whichever copy of a sequence number arrives first is
+// delivered and the other is dropped as a duplicate. A packet that arrives
+// ahead of the next expected sequence is held: on one lossy line the other
+// usually fills the hole within microseconds. After gapTimeoutNs, or when
+// the hold buffer is full, the hole is declared a gap and delivery moves on.
+//
+// Delivered trades go into a Fifo3 in sequence order (other message types
+// only advance the sequence). Packet-to-queue
+// latency, from the RX timestamp (hardware if the NIC provides one,
+// otherwise the kernel's) to the push, goes into a LatencyHistogram.
+class MulticastFeed {
+public:
+    static constexpr size_t kBatch = 64;         // Datagrams per recvmmsg()
+    static constexpr size_t kMaxPacket = 2048;   // Above feed::kMaxPacket: jumbo frames are cut short
+    static constexpr size_t kMaxHeld = 64;
+
+    MulticastFeed(const MulticastConfig& config, Fifo3<FeedTick>& out) : config(config), out(out) {
+        lines[0] = openLine(config.a);
+        lineCount = 1;
+        if (config.b.port != 0) {
+            lines[1] = openLine(config.b);
+            lineCount = 2;
+        }
+        for (size_t i = 0; i < kBatch; i++) {
+            iov[i] = {packets[i], kMaxPacket};
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+    }
+
+    ~MulticastFeed() {
+        for (size_t i = 0; i < lineCount; i++) ::close(lines[i]);
+    }
+
+    MulticastFeed(const MulticastFeed&) = delete;
+    MulticastFeed& operator=(const MulticastFeed&) = delete;
+
+    // Drain both lines once; returns the number of packets received
+    size_t poll() {
+        size_t received = 0;
+        for (size_t line = 0; line < lineCount; line++) {
+            for (size_t i = 0; i < kBatch; i++) {
+                msgs[i].msg_hdr.msg_control = control[i];
+                msgs[i].msg_hdr.msg_controllen = sizeof(control[i]);
+            }
+            int got = ::recvmmsg(lines[line], msgs, kBatch, MSG_DONTWAIT, nullptr);
+            if (got <= 0) continue;
+            uint64_t now = realtimeNs();
+            for (int i = 0; i < got; i++) {
+                onPacket(packets[i], msgs[i].msg_len, rxTimestamp(msgs[i].msg_hdr, now));
+            }
+            received += static_cast<size_t>(got);
+        }
+        expireHeld();
+        return received;
+    }
+
+    uint64_t nextSequence() const { return expected; }
+    const FeedStats& stats() const { return counters; }
+    const LatencyHistogram& latency() const { return packetToQueue; }
+
+private:
+    struct Held {
+        uint64_t sequence;
+        uint64_t rxNs;
+        uint64_t heldAtNs;
+        size_t length;
+        char bytes[kMaxPacket];
+    };
+
+    static uint64_t realtimeNs() {
+        timespec ts;
+        ::clock_gettime(CLOCK_REALTIME, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+    }
+
+    int openLine(const FeedLine& line) {
+        int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd < 0) throw std::runtime_error("multicast: socket failed");
+        int one = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        int rcvbuf = 8 << 20;
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+        // Binding to the group address keeps other groups on the port out
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(line.port);
+        if (::inet_pton(AF_INET, line.group.c_str(), &addr.sin_addr) != 1 ||
+            ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            ::close(fd);
+            throw std::runtime_error("multicast: cannot bind " + line.group);
+        }
+        ip_mreq membership{};
+        membership.imr_multiaddr = addr.sin_addr;
+        ::inet_pton(AF_INET, config.interfaceAddress.c_str(), &membership.imr_interface);
+        if (::setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) != 0) {
+            ::close(fd);
+            throw std::runtime_error("multicast: cannot join " + line.group + ": " + std::strerror(errno));
+        }
+
+        // Optional: each is recorded in stats() and skipped if refused
+        if (config.busyPollUs > 0) {
+            counters.busyPoll = ::setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &config.busyPollUs,
+                                             sizeof(config.busyPollUs)) == 0;
+        }
+        if (!config.interfaceName.empty()) {
+            enableHardwareTimestamps(fd);
+        }
+        int flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE |
+                    SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE;
+        counters.softwareTimestamps =
+            ::setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) == 0;
+        return fd;
+    }
+
+    // Ask the NIC to stamp every received packet; needs CAP_NET_ADMIN. The
+    // stamps are in the NIC's clock, which phc2sys must keep on CLOCK_REALTIME
+    // for the latency figures to mean anything.
+    void enableHardwareTimestamps(int fd) {
+        hwtstamp_config hw{};
+        hw.tx_type = HWTSTAMP_TX_OFF;
+        hw.rx_filter = HWTSTAMP_FILTER_ALL;
+        ifreq request{};
+        std::strncpy(request.ifr_name, config.interfaceName.c_str(), IFNAMSIZ - 1);
+        request.ifr_data = reinterpret_cast<char*>(&hw);
+        counters.hardwareTimestamps = ::ioctl(fd, SIOCSHWTSTAMP, &request) == 0;
+    }
+
+    // Hardware stamp if there is one, else the kernel's, else `fallback`
+    static uint64_t rxTimestamp(msghdr& header, uint64_t fallback) {
+        for (cmsghdr* c = CMSG_FIRSTHDR(&header); c; c = CMSG_NXTHDR(&header, c)) {
+            if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPING) {
+                scm_timestamping stamps;
+                std::memcpy(&stamps, CMSG_DATA(c), sizeof(stamps));
+                const timespec& ts = stamps.ts[2].tv_sec || stamps.ts[2].tv_nsec ? stamps.ts[2] : stamps.ts[0];
+                if (ts.tv_sec || ts.tv_nsec) {
+                    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+                }
+            }
+        }
+        return fallback;
+    }
+
+    void onPacket(const char* bytes, size_t length, uint64_t rxNs) {
+        counters.packets++;
+        if (feed::check(bytes, length) != feed::Status::Ok) {
+            counters.malformed++;
+            return;
+        }
+        uint64_t sequence = feed::packet_sequence(bytes);
+        uint16_t count = feed::packet_count(bytes);
+        if (sequence + count <= expected) {
+            counters.duplicates++;
+            return;
+        }
+        if (sequence > expected && started) {
+            hold(bytes, length, sequence, rxNs);
+            return;
+        }
+        deliver(bytes, rxNs);
+        releaseHeld();
+    }
+
+    // Messages [expected, sequence + count) of one packet go to the queue
+    void deliver(const char* bytes, uint64_t rxNs) {
+        started = true;
+        uint64_t from = expected;
+        auto onMessage = [&](uint64_t sequence, feed::MessageView message) {
+            if (sequence < from || message.type() != feed::kTrade) return;
+            feed::TradeView trade = message.trade();
+            if (out.push(FeedTick{sequence, trade.timestamp(), trade.price(), trade.volume(), rxNs})) {
+                counters.ticks++;
+            } else {
+                counters.overruns++;
+            }
+        };
+        feed::Status status = feed::decode(bytes, feed::packet_length(bytes), onMessage);
+        if (status != feed::Status::Ok) counters.malformed++;   // Its sequence numbers are spent anyway
+        expected = feed::packet_sequence(bytes) + feed::packet_count(bytes);
+        packetToQueue.record(realtimeNs() - rxNs);
+    }
+
+    void hold(const char* bytes, size_t length, uint64_t sequence, uint64_t rxNs) {
+        for (size_t i = 0; i < heldCount; i++) {
+            if (held[i].sequence == sequence) {
+                counters.duplicates++;
+                return;
+            }
+        }
+        if (heldCount == kMaxHeld) {
+            skipToHeld();   // Out of room: give up on the hole
+        }
+        Held& slot = held[heldCount++];
+        slot.sequence = sequence;
+        slot.rxNs = rxNs;
+        slot.heldAtNs = realtimeNs();
+        slot.length = length;
+        std::memcpy(slot.bytes, bytes, length);
+        releaseHeld();
+    }
+
+    // Deliver held packets that now continue the sequence, in order
+    void releaseHeld() {
+        bool progress = true;
+        while (progress) {
+            progress = false;
+            for (size_t i = 0; i < heldCount; i++) {
+                Held& slot = held[i];
+                uint16_t count = feed::packet_count(slot.bytes);
+                if (slot.sequence + count <= expected) {
+                    counters.duplicates++;
+                } else if (slot.sequence <= expected) {
+                    deliver(slot.bytes, slot.rxNs);
+                    counters.recovered++;
+                } else {
+                    continue;
+                }
+                held[i] = held[--heldCount];
+                progress = true;
+                break;
+            }
+        }
+    }
+
+    // Declare the hole before the oldest held packet lost
+    void skipToHeld() {
+        uint64_t lowest = held[0].sequence;
+        for (size_t i = 1; i < heldCount; i++) {
+            if (held[i].sequence < lowest) lowest = held[i].sequence;
+        }
+        counters.gaps++;
+        counters.lost += lowest - expected;
+        expected = lowest;
+        releaseHeld();
+    }
+
+    void expireHeld() {
+        if (heldCount == 0) return;
+        uint64_t now = realtimeNs();
+        for (size_t i = 0; i < heldCount; i++) {
+            if (now - held[i].heldAtNs >= config.gapTimeoutNs) {
+                skipToHeld();
+                return;
+            }
+        }
+    }
+
+    MulticastConfig config;
+    Fifo3<FeedTick>& out;
+    int lines[2] = {-1, -1};
+    size_t lineCount = 0;
+
+    uint64_t expected = 0;   // Next sequence to deliver
+    bool started = false;    // The first packet seen sets the sequence
+
+    mmsghdr msgs[kBatch]{};
+    iovec iov[kBatch];
+    char packets[kBatch][kMaxPacket];
+    alignas(cmsghdr) char control[kBatch][256];
+
+    Held held[kMaxHeld];
+    size_t heldCount = 0;
+
+    FeedStats counters;
+    LatencyHistogram packetToQueue;
+};
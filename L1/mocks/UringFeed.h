@@ -0,0 +1,290 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <linux/io_uring.h>
+#include <linux/time_types.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+struct UringConfig {
+    unsigned entries = 64;          // Submission queue; one multishot recv per socket
+    unsigned completions = 4096;    // Completion queue
+    unsigned buffers = 1024;        // Provided receive buffers, a power of two
+    unsigned bufferSize = 2048;     // One datagram each
+    bool sqpoll = false;            // Kernel thread polls the submission queue
+    int sqpollCpu = -1;             // Pin that thread; -1 leaves it to the scheduler
+    unsigned sqpollIdleMs = 1000;   // Before the poller sleeps
+};
+
+// io_uring ingestion for many datagram sockets on one thread.
+//
+// Each socket gets one multishot IORING_OP_RECV: armed once, it posts a
+// completion for every datagram until it runs out of buffers or fails,
+// with no further submissions. Datagrams land in a ring of buffers
+// provided to the kernel up front (IORING_REGISTER_PBUF_RING); each
+// completion names the buffer it filled, which goes back to the ring as
+// soon as the handler returns.
+//
+// Without sqpoll the ring runs with DEFER_TASKRUN: the kernel only queues a
+// note when a datagram arrives, and the receives themselves happen in the
+// next io_uring_enter(), on this thread, all pending ones in one call. So
+// one system call per poll covers every socket and however many datagrams
+// are waiting, and no work is done behind the caller's back. The ring is
+// single-issuer: construct and poll it on the same thread. With sqpoll a
+// kernel thread does the receives, completions are read straight from the
+// shared ring, and a busy loop makes no system calls at all (at the cost
+// of a second, spinning core).
+//
+// Talks to the kernel through the raw system calls; there is no liburing
+// here. Stream sockets would work the same way but hand out arbitrary
+// byte ranges, which the caller has to reassemble into packets.
+class UringFeed {
+public:
+    explicit UringFeed(const UringConfig& config) : config(config) {
+        if (config.buffers == 0 || (config.buffers & (config.buffers - 1)) != 0 || config.buffers > 32768) {
+            throw std::invalid_argument("uring: buffers must be a power of two up to 32768");
+        }
+        io_uring_params params{};
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = config.completions;
+        if (!config.sqpoll) {
+            params.flags |= IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+        } else {
+            params.flags |= IORING_SETUP_SQPOLL;
+            params.sq_thread_idle = config.sqpollIdleMs;
+            if (config.sqpollCpu >= 0) {
+                params.flags |= IORING_SETUP_SQ_AFF;
+                params.sq_thread_cpu = static_cast<unsigned>(config.sqpollCpu);
+            }
+        }
+        ringFd = static_cast<int>(::syscall(__NR_io_uring_setup, config.entries, &params));
+        if (ringFd < 0) throw std::runtime_error(std::string("uring: setup failed: ") + std::strerror(errno));
+        if (!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+            ::close(ringFd);
+            throw std::runtime_error("uring: kernel too old");
+        }
+        try {
+            mapRings(params);
+            provideBuffers();
+        } catch (...) {
+            release();
+            throw;
+        }
+    }
+
+    ~UringFeed() { release(); }
+
+    UringFeed(const UringFeed&) = delete;
+    UringFeed& operator=(const UringFeed&) = delete;
+
+    // Start receiving on a datagram socket; returns the index the handler sees
+    size_t add(int fd) {
+        sockets.push_back(fd);
+        arm(sockets.size() - 1);
+        submit();
+        return sockets.size() - 1;
+    }
+
+    // Hand every completed datagram to handler(socket index, data, length)
+    // and return how many there were. When none is ready, waits up to
+    // waitNs for one (0: return at once). Throws if a receive fails.
+    template <typename Handler>
+    size_t poll(Handler&& handler, uint64_t waitNs = 0) {
+        unsigned head = *cqHead;
+        unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        if (head == tail) {
+            if (config.sqpoll && waitNs == 0) return 0;
+            wait(waitNs);   // Without sqpoll this is where the receives run
+            tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        }
+        size_t datagrams = 0;
+        for (; head != tail; head++) {
+            const io_uring_cqe& cqe = cqes[head & cqMask];
+            size_t socket = static_cast<size_t>(cqe.user_data);
+            if (cqe.flags & IORING_CQE_F_BUFFER) {
+                unsigned short id = static_cast<unsigned short>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+                if (cqe.res > 0) {
+                    handler(socket, buffers.data() + static_cast<size_t>(id) * config.bufferSize,
+                            static_cast<size_t>(cqe.res));
+                    datagrams++;
+                }
+                recycle(id);
+            } else if (cqe.res < 0 && cqe.res != -ENOBUFS) {
+                __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+                throw std::runtime_error(std::string("uring: recv failed: ") + std::strerror(-cqe.res));
+            }
+            if (!(cqe.flags & IORING_CQE_F_MORE) && cqe.res != 0) {
+                arm(socket);   // Ran out of buffers; it restarts once this batch's are back
+                rearmPending = true;
+            }
+        }
+        __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+        publishBuffers();
+        if (rearmPending) submit();
+        return datagrams;
+    }
+
+    // io_uring_enter() calls so far, empty polls included
+    uint64_t enters() const { return enterCalls; }
+    size_t socketCount() const { return sockets.size(); }
+
+private:
+    static constexpr uint16_t kBufferGroup = 0;
+
+    void release() {
+        if (bufferRing) ::munmap(bufferRing, bufferRingBytes);
+        if (sqes) ::munmap(sqes, sqeBytes);
+        if (rings) ::munmap(rings, ringBytes);
+        ::close(ringFd);
+    }
+
+    void mapRings(const io_uring_params& params) {
+        size_t sqBytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        size_t cqBytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        ringBytes = sqBytes > cqBytes ? sqBytes : cqBytes;
+        rings = mapRing(ringBytes, IORING_OFF_SQ_RING);
+        sqeBytes = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe*>(mapRing(sqeBytes, IORING_OFF_SQES));
+
+        char* base = static_cast<char*>(rings);
+        sqHead = reinterpret_cast<unsigned*>(base + params.sq_off.head);
+        sqTail = reinterpret_cast<unsigned*>(base + params.sq_off.tail);
+        sqFlags = reinterpret_cast<unsigned*>(base + params.sq_off.flags);
+        sqMask = *reinterpret_cast<unsigned*>(base + params.sq_off.ring_mask);
+        sqEntries = params.sq_entries;
+        unsigned* array = reinterpret_cast<unsigned*>(base + params.sq_off.array);
+        for (unsigned i = 0; i < sqEntries; i++) array[i] = i;   // Slot i is always sqe i
+        cqHead = reinterpret_cast<unsigned*>(base + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(base + params.cq_off.tail);
+        cqMask = *reinterpret_cast<unsigned*>(base + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(base + params.cq_off.cqes);
+    }
+
+    void* mapRing(size_t bytes, off_t offset) {
+        void* p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, offset);
+        if (p == MAP_FAILED) throw std::runtime_error(std::string("uring: mmap failed: ") + std::strerror(errno));
+        return p;
+    }
+
+    // The buffer ring is shared memory: the kernel takes buffers from the
+    // head, we add them back at the tail
+    void provideBuffers() {
+        buffers.resize(static_cast<size_t>(config.buffers) * config.bufferSize);
+        bufferRingBytes = config.buffers * sizeof(io_uring_buf);
+        void* p = ::mmap(nullptr, bufferRingBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) throw std::runtime_error("uring: cannot map the buffer ring");
+        bufferRing = static_cast<io_uring_buf*>(p);
+
+        io_uring_buf_reg reg{};
+        reg.ring_addr = reinterpret_cast<uint64_t>(bufferRing);
+        reg.ring_entries = config.buffers;
+        reg.bgid = kBufferGroup;
+        if (::syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+            throw std::runtime_error(std::string("uring: cannot register buffers: ") + std::strerror(errno));
+        }
+        for (unsigned i = 0; i < config.buffers; i++) recycle(static_cast<unsigned short>(i));
+        publishBuffers();
+    }
+
+    // The ring's tail overlays the reserved field of its first entry
+    uint16_t* bufferTail() {
+        return reinterpret_cast<uint16_t*>(reinterpret_cast<char*>(bufferRing) + offsetof(io_uring_buf_ring, tail));
+    }
+
+    void recycle(unsigned short id) {
+        io_uring_buf& slot = bufferRing[bufferTailLocal & (config.buffers - 1)];
+        slot.addr = reinterpret_cast<uint64_t>(buffers.data() + static_cast<size_t>(id) * config.bufferSize);
+        slot.len = config.bufferSize;
+        slot.bid = id;
+        bufferTailLocal++;
+    }
+
+    void publishBuffers() { __atomic_store_n(bufferTail(), bufferTailLocal, __ATOMIC_RELEASE); }
+
+    void arm(size_t socket) {
+        unsigned tail = *sqTail;
+        if (tail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) == sqEntries) {
+            submit();   // Full; the kernel consumes entries on submit (or soon, with sqpoll)
+            while (tail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) == sqEntries) {}
+        }
+        io_uring_sqe& sqe = sqes[tail & sqMask];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_RECV;
+        sqe.fd = sockets[socket];
+        sqe.ioprio = IORING_RECV_MULTISHOT;
+        sqe.flags = IOSQE_BUFFER_SELECT;
+        sqe.buf_group = kBufferGroup;
+        sqe.user_data = socket;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+        unsubmitted++;
+    }
+
+    void submit() {
+        rearmPending = false;
+        if (unsubmitted == 0) return;
+        if (config.sqpoll) {
+            unsubmitted = 0;
+            if (__atomic_load_n(sqFlags, __ATOMIC_ACQUIRE) & IORING_SQ_NEED_WAKEUP) {
+                enter(0, 0, IORING_ENTER_SQ_WAKEUP, nullptr);
+            }
+            return;
+        }
+        enter(unsubmitted, 0, 0, nullptr);
+        unsubmitted = 0;
+    }
+
+    // Run deferred receives, then block up to waitNs if none completed
+    void wait(uint64_t waitNs) {
+        __kernel_timespec timeout{static_cast<long long>(waitNs / 1000000000ull),
+                                  static_cast<long long>(waitNs % 1000000000ull)};
+        io_uring_getevents_arg arg{};
+        arg.ts = reinterpret_cast<uint64_t>(&timeout);
+        unsigned toSubmit = config.sqpoll ? 0 : unsubmitted;
+        enter(toSubmit, waitNs ? 1 : 0, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg);
+        unsubmitted = 0;
+        rearmPending = false;
+    }
+
+    void enter(unsigned toSubmit, unsigned minComplete, unsigned flags, io_uring_getevents_arg* arg) {
+        enterCalls++;
+        long rc = ::syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, arg,
+                            arg ? sizeof(*arg) : 0);
+        if (rc < 0 && errno != ETIME && errno != EINTR && errno != EBUSY) {
+            throw std::runtime_error(std::string("uring: enter failed: ") + std::strerror(errno));
+        }
+    }
+
+    UringConfig config;
+    int ringFd = -1;
+    std::vector<int> sockets;
+
+    void* rings = nullptr;
+    size_t ringBytes = 0;
+    io_uring_sqe* sqes = nullptr;
+    size_t sqeBytes = 0;
+    unsigned* sqHead = nullptr;
+    unsigned* sqTail = nullptr;
+    unsigned* sqFlags = nullptr;
+    unsigned sqMask = 0;
+    unsigned sqEntries = 0;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned cqMask = 0;
+    io_uring_cqe* cqes = nullptr;
+    unsigned unsubmitted = 0;
+    bool rearmPending = false;
+
+    io_uring_buf* bufferRing = nullptr;
+    size_t bufferRingBytes = 0;
+    uint16_t bufferTailLocal = 0;
+    std::vector<char> buffers;
+
+    uint64_t enterCalls = 0;
+};
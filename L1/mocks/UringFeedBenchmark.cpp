@@ -0,0 +1,220 @@
+// One thread draining many UDP feed sockets three ways: a read() per
+// datagram, recvmmsg() batches, and UringFeed. Every round replays the same
+// FeedProtocol packets into the sockets' receive queues, then times only
+// the drain, so each path sees identical traffic.
+//
+//   g++ -std=c++17 -O2 UringFeedBenchmark.cpp -o uringFeedBenchmark
+//   ./uringFeedBenchmark [--sockets <n>] [--packets <per socket per round>]
+//                        [--rounds <n>] [--cpu <core>] [--sqpoll]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <sys/socket.h>
+
+#include "FeedProtocol.h"
+#include "UringFeed.h"
+
+namespace {
+
+struct Options {
+    int sockets = 8;
+    int packets = 1000;
+    int rounds = 20;
+    int cpu = -1;
+    bool sqpoll = false;
+};
+
+struct Result {
+    uint64_t messages = 0;
+    uint64_t datagrams = 0;
+    uint64_t syscalls = 0;
+    double seconds = 0;
+};
+
+struct Counter {
+    uint64_t messages = 0;
+    int64_t checksum = 0;
+
+    void packet(const char* data, size_t length) {
+        feed::decode(data, length, [&](uint64_t, feed::MessageView m) {
+            if (m.type() == feed::kTrade) checksum += m.trade().price();
+            messages++;
+        });
+    }
+};
+
+class Replay {
+public:
+    explicit Replay(const Options& options) : options(options) {
+        for (int i = 0; i < options.sockets; i++) {
+            int fd = socket(AF_INET, SOCK_DGRAM, 0);
+            int bytes = 64 << 20;
+            if (setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &bytes, sizeof(bytes)) != 0) {
+                setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes));
+            }
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+            socklen_t length = sizeof(addr);
+            getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &length);
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            receivers.push_back(fd);
+            addresses.push_back(addr);
+        }
+        sender = socket(AF_INET, SOCK_DGRAM, 0);
+
+        // Full frames of 60 trades
+        char packet[feed::kMaxPacket];
+        feed::PacketBuilder builder(packet, sizeof(packet));
+        uint64_t sequence = 1;
+        for (int i = 0; i < options.sockets * options.packets; i++) {
+            builder.begin(sequence);
+            while (builder.add_trade(sequence + builder.messages(), 1000000 + i % 100, 100)) {}
+            sequence += builder.messages();
+            size_t length = builder.finish();
+            packets.emplace_back(packet, packet + length);
+        }
+        messagesPerRound = sequence - 1;
+    }
+
+    ~Replay() {
+        for (int fd : receivers) close(fd);
+        close(sender);
+    }
+
+    void fill() {
+        for (size_t i = 0; i < packets.size(); i++) {
+            const sockaddr_in& to = addresses[i % addresses.size()];
+            sendto(sender, packets[i].data(), packets[i].size(), 0, reinterpret_cast<const sockaddr*>(&to),
+                   sizeof(to));
+        }
+    }
+
+    const Options& options;
+    std::vector<int> receivers;
+    std::vector<sockaddr_in> addresses;
+    int sender;
+    std::vector<std::string> packets;
+    uint64_t messagesPerRound = 0;
+};
+
+template <typename Drain>
+Result run(Replay& replay, Drain&& drain) {
+    Result result;
+    Counter counter;
+    for (int round = 0; round < replay.options.rounds; round++) {
+        replay.fill();
+        auto start = std::chrono::steady_clock::now();
+        drain(counter, result);
+        result.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    result.messages = counter.messages;
+    return result;
+}
+
+// Status quo: one read() per datagram (and one more to find each queue empty)
+void drainRead(Replay& replay, Counter& counter, Result& result) {
+    char buffer[2048];
+    for (int fd : replay.receivers) {
+        while (true) {
+            ssize_t got = read(fd, buffer, sizeof(buffer));
+            result.syscalls++;
+            if (got <= 0) break;
+            counter.packet(buffer, static_cast<size_t>(got));
+            result.datagrams++;
+        }
+    }
+}
+
+void drainRecvmmsg(Replay& replay, Counter& counter, Result& result) {
+    constexpr unsigned kBatch = 64;
+    static char buffers[kBatch][2048];
+    mmsghdr msgs[kBatch]{};
+    iovec iov[kBatch];
+    for (unsigned i = 0; i < kBatch; i++) {
+        iov[i] = {buffers[i], sizeof(buffers[i])};
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    for (int fd : replay.receivers) {
+        while (true) {
+            int got = recvmmsg(fd, msgs, kBatch, MSG_DONTWAIT, nullptr);
+            result.syscalls++;
+            if (got <= 0) break;
+            for (int i = 0; i < got; i++) counter.packet(buffers[i], msgs[i].msg_len);
+            result.datagrams += static_cast<uint64_t>(got);
+            if (static_cast<unsigned>(got) < kBatch) break;
+        }
+    }
+}
+
+void pin(int cpu) {
+    if (cpu < 0) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+void report(const char* name, const Result& r, uint64_t expected) {
+    std::printf("%-22s %8.2fM msg/s %9.1f syscalls/1k msg %8.2f datagrams/syscall%s\n", name,
+                static_cast<double>(r.messages) / r.seconds / 1e6,
+                1000.0 * static_cast<double>(r.syscalls) / static_cast<double>(r.messages),
+                static_cast<double>(r.datagrams) / static_cast<double>(r.syscalls),
+                r.messages == expected ? "" : "  (datagrams dropped)");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--sqpoll") options.sqpoll = true;
+        else if (i + 1 < argc && arg == "--sockets") options.sockets = std::atoi(argv[++i]);
+        else if (i + 1 < argc && arg == "--packets") options.packets = std::atoi(argv[++i]);
+        else if (i + 1 < argc && arg == "--rounds") options.rounds = std::atoi(argv[++i]);
+        else if (i + 1 < argc && arg == "--cpu") options.cpu = std::atoi(argv[++i]);
+    }
+    pin(options.cpu);
+
+    Replay replay(options);
+    uint64_t expected = replay.messagesPerRound * static_cast<uint64_t>(options.rounds);
+    std::printf("%d sockets, %d rounds of %zu packets (%llu messages each)\n", options.sockets, options.rounds,
+                replay.packets.size(), static_cast<unsigned long long>(replay.messagesPerRound));
+
+    report("read()", run(replay, [&](Counter& c, Result& r) { drainRead(replay, c, r); }), expected);
+    report("recvmmsg(64)", run(replay, [&](Counter& c, Result& r) { drainRecvmmsg(replay, c, r); }), expected);
+
+    try {
+        UringConfig config;
+        config.sqpoll = options.sqpoll;
+        config.sqpollCpu = options.sqpoll && options.cpu >= 0 ? options.cpu + 1 : -1;
+        UringFeed uring(config);
+        for (int fd : replay.receivers) uring.add(fd);
+        uint64_t packetsPerRound = replay.packets.size();
+        Result result = run(replay, [&](Counter& c, Result& r) {
+            uint64_t enters = uring.enters();
+            uint64_t got = 0;
+            while (got < packetsPerRound) {
+                size_t n = uring.poll([&](size_t, const char* data, size_t length) { c.packet(data, length); },
+                                      10000000);
+                if (n == 0) break;   // Nothing within 10 ms: the rest were dropped
+                got += n;
+            }
+            r.datagrams += got;
+            r.syscalls += uring.enters() - enters;
+        });
+        if (result.syscalls == 0) result.syscalls = 1;   // sqpoll: keep the ratios finite
+        report(options.sqpoll ? "io_uring (sqpoll)" : "io_uring multishot", result, expected);
+    } catch (const std::exception& e) {
+        std::printf("io_uring unavailable: %s\n", e.what());
+    }
+}
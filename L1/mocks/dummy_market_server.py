@@ -6,26 +6,44 @@ import time
 HOST = 'localhost'
 PORT = 5555
 
-def generate_market_data():
-    """Generates infinite market data packets"""
+# Wire format, see FeedProtocol.h: little-endian, packed, no alignment
+MAGIC = 0x464D            # "MF"
+VERSION = 1
+PRICE_SCALE = 10000       # Four implied decimals
+PACKET_HEADER = struct.Struct('<HBBHHQ')   # magic, version, flags, length, count, sequence
+TRADE = struct.Struct('<BBHIQq')           # type, flags, length, volume, timestamp, price
+TRADE_TYPE = ord('T')
+TRADES_PER_PACKET = 60    # 16 + 60 * 24 = 1456 bytes, one Ethernet frame
+
+assert PACKET_HEADER.size == 16 and TRADE.size == 24
+
+def generate_market_data(sequence):
+    """Packs one packet of TRADES_PER_PACKET trades, numbered from sequence"""
     timestamp = int(time.time() * 1e9)  # nanosecond precision
-    price = 100.0 + (time.time() % 10)  # oscillating price
     volume = 100
-    return struct.pack('QdI', timestamp, price, volume)  # 8+8+4 = 20 bytes
+    body = bytearray()
+    for i in range(TRADES_PER_PACKET):
+        price = 100.0 + ((timestamp + i) % 10_000_000_000) / 1e9  # oscillating price
+        body += TRADE.pack(TRADE_TYPE, 0, TRADE.size, volume, timestamp, round(price * PRICE_SCALE))
+    header = PACKET_HEADER.pack(MAGIC, VERSION, 0, PACKET_HEADER.size + len(body),
+                                TRADES_PER_PACKET, sequence)
+    return header + body
 
 def main():
     with socket.socket(socket.AF_INET, socket.SOCK_STREAM) as s:
         s.bind((HOST, PORT))
         s.listen()
         print(f"Python Market Data Server running on {HOST}:{PORT}")
-        
+
         conn, addr = s.accept()
         with conn:
             print(f"Connected by {addr}")
+            sequence = 1
             try:
                 while True:
-                    data = generate_market_data()
+                    data = generate_market_data(sequence)
                     conn.sendall(data)
+                    sequence += TRADES_PER_PACKET
             except (ConnectionResetError, BrokenPipeError):
                 print("Client disconnected")
 
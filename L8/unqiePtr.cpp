@@ -1,17 +1,73 @@
+#include <cstddef>
 #include <iostream>
+#include <new>
+#include <type_traits>
+#include <utility>
 
-// A very simple unique_ptr
+// What UniquePtr does with the object it owns: plain `delete` by default
 template <typename T>
+struct DefaultDelete {
+    DefaultDelete() = default;
+    // Lets UniquePtr<Derived> convert to UniquePtr<Base>
+    template <typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    DefaultDelete(const DefaultDelete<U>&) {}
+
+    void operator()(T* p) const { delete p; }
+};
+
+// Hands the object back to the pool it came from (anything with
+// construct(args...) and destroy(T*), like the order book's MemoryPool).
+// Stateful: it remembers which pool.
+template <typename Pool>
+struct PoolDeleter {
+    Pool* pool = nullptr;
+
+    template <typename T>
+    void operator()(T* p) const { pool->destroy(p); }
+};
+
+// Stateless version for a pool reachable without a pointer (a global or
+// thread_local one returned by Instance), so the UniquePtr stays one pointer
+template <typename Pool, Pool& (*Instance)()>
+struct StaticPoolDeleter {
+    template <typename T>
+    void operator()(T* p) const { Instance().destroy(p); }
+};
+
+// A very simple unique_ptr, with the deleter as a template parameter. An
+// empty deleter (DefaultDelete, StaticPoolDeleter) is stored as a base
+// class, so it takes no space (empty base optimisation) and UniquePtr is
+// exactly one pointer, like a raw one.
+template <typename T, typename Deleter = DefaultDelete<T>>
 class UniquePtr {
-    T* ptr;
+    // Pointer plus deleter; the deleter is a base when possible
+    struct EmptyDeleterStorage : private Deleter {
+        T* ptr;
+        EmptyDeleterStorage(T* p, Deleter d) : Deleter(std::move(d)), ptr(p) {}
+        Deleter& deleter() { return *this; }
+        const Deleter& deleter() const { return *this; }
+    };
+    struct DeleterStorage {
+        T* ptr;
+        Deleter del;
+        DeleterStorage(T* p, Deleter d) : ptr(p), del(std::move(d)) {}
+        Deleter& deleter() { return del; }
+        const Deleter& deleter() const { return del; }
+    };
+    using Storage = std::conditional_t<std::is_empty_v<Deleter> && !std::is_final_v<Deleter>,
+                                       EmptyDeleterStorage, DeleterStorage>;
+    Storage storage;
+
+    template <typename U, typename E>
+    friend class UniquePtr;
 
 public:
     // Constructor
-    explicit UniquePtr(T* p = nullptr) : ptr(p) {}
+    explicit UniquePtr(T* p = nullptr, Deleter d = Deleter()) : storage(p, std::move(d)) {}
 
     // Destructor
     ~UniquePtr() {
-        delete ptr;
+        if (storage.ptr) storage.deleter()(storage.ptr);
     }
 
     // Disable copy (unique ownership)
@@ -19,43 +75,120 @@ public:
     UniquePtr& operator=(const UniquePtr&) = delete;
 
     // Enable move
-    UniquePtr(UniquePtr&& other) noexcept : ptr(other.ptr) {
-        other.ptr = nullptr;
+    UniquePtr(UniquePtr&& other) noexcept : storage(other.storage.ptr, std::move(other.storage.deleter())) {
+        other.storage.ptr = nullptr;
+    }
+
+    // Move from a UniquePtr of a derived type
+    template <typename U, typename E,
+              typename = std::enable_if_t<std::is_convertible_v<U*, T*> && std::is_constructible_v<Deleter, E&&>>>
+    UniquePtr(UniquePtr<U, E>&& other) noexcept : storage(other.storage.ptr, std::move(other.storage.deleter())) {
+        other.storage.ptr = nullptr;
     }
 
     UniquePtr& operator=(UniquePtr&& other) noexcept {
         if (this != &other) {
-            delete ptr;         // delete old resource
-            ptr = other.ptr;    // take ownership
-            other.ptr = nullptr;
+            reset(other.release());                                 // delete old resource, take ownership
+            storage.deleter() = std::move(other.storage.deleter()); // and the way to delete it
         }
         return *this;
     }
 
     // Operators to access the object
-    T& operator*() const { return *ptr; }
-    T* operator->() const { return ptr; }
-    T* get() const { return ptr; }
+    T& operator*() const { return *storage.ptr; }
+    T* operator->() const { return storage.ptr; }
+    T* get() const { return storage.ptr; }
+    explicit operator bool() const { return storage.ptr != nullptr; }
+
+    Deleter& get_deleter() { return storage.deleter(); }
+    const Deleter& get_deleter() const { return storage.deleter(); }
 
     // Release ownership
     T* release() {
-        T* tmp = ptr;
-        ptr = nullptr;
+        T* tmp = storage.ptr;
+        storage.ptr = nullptr;
         return tmp;
     }
 
     // Reset with a new pointer
     void reset(T* p = nullptr) {
-        delete ptr;
-        ptr = p;
+        T* old = storage.ptr;
+        storage.ptr = p;
+        if (old) storage.deleter()(old);
     }
 };
 
+// Build a T in `pool` and own it; when the UniquePtr goes away the object is
+// destroyed and its slot goes back to the same pool
+template <typename T, typename Pool, typename... Args>
+UniquePtr<T, PoolDeleter<Pool>> make_pooled(Pool& pool, Args&&... args) {
+    return UniquePtr<T, PoolDeleter<Pool>>(pool.construct(std::forward<Args>(args)...), PoolDeleter<Pool>{&pool});
+}
+
+// Same, for a pool found through Instance (pointer-sized result)
+template <typename T, typename Pool, Pool& (*Instance)(), typename... Args>
+UniquePtr<T, StaticPoolDeleter<Pool, Instance>> make_pooled(Args&&... args) {
+    return UniquePtr<T, StaticPoolDeleter<Pool, Instance>>(Instance().construct(std::forward<Args>(args)...));
+}
+
 // Example usage
 struct Test {
     void hello() { std::cout << "Hello from Test!\n"; }
 };
 
+// A tiny fixed-size pool with a free list, standing in for MemoryPool
+template <typename T, size_t Capacity>
+class FixedPool {
+    union Slot {
+        Slot* next;
+        alignas(T) unsigned char bytes[sizeof(T)];
+    };
+    Slot slots[Capacity];
+    Slot* freeList = nullptr;
+    size_t used = 0;
+
+public:
+    size_t live = 0;
+
+    template <typename... Args>
+    T* construct(Args&&... args) {
+        Slot* slot = freeList;
+        if (slot) {
+            freeList = slot->next;
+        } else if (used < Capacity) {
+            slot = &slots[used++];
+        } else {
+            throw std::bad_alloc();
+        }
+        live++;
+        return new (slot->bytes) T(std::forward<Args>(args)...);
+    }
+
+    void destroy(T* p) {
+        p->~T();
+        Slot* slot = reinterpret_cast<Slot*>(p);
+        slot->next = freeList;
+        freeList = slot;
+        live--;
+    }
+};
+
+struct Order {
+    unsigned long id;
+    long price;
+    Order(unsigned long i, long p) : id(i), price(p) {}
+};
+
+FixedPool<Order, 64>& orderPool() {
+    static FixedPool<Order, 64> pool;
+    return pool;
+}
+
+// No overhead over a raw pointer unless the deleter has state
+static_assert(sizeof(UniquePtr<Test>) == sizeof(Test*));
+static_assert(sizeof(UniquePtr<Order, StaticPoolDeleter<FixedPool<Order, 64>, orderPool>>) == sizeof(Order*));
+static_assert(sizeof(UniquePtr<Order, PoolDeleter<FixedPool<Order, 64>>>) == 2 * sizeof(Order*));
+
 int main() {
     UniquePtr<Test> up1(new Test());   // create unique_ptr
     up1->hello();
@@ -71,6 +204,23 @@ int main() {
     up2.reset(new Test());
     up2->hello();
 
+    // Pooled objects go back to their pool, not to delete
+    FixedPool<Order, 64> pool;
+    {
+        auto order = make_pooled<Order>(pool, 1ul, 100500l);
+        auto other = make_pooled<Order>(pool, 2ul, 100400l);
+        std::cout << "order " << order->id << " @ " << order->price << ", pool live: " << pool.live << "\n";
+        order = std::move(other);   // order 1 goes back to the pool here
+        std::cout << "after move-assign, pool live: " << pool.live << "\n";
+    }
+    std::cout << "after scope, pool live: " << pool.live << "\n";
+
+    // Pointer-sized version against a pool found by function
+    {
+        auto order = make_pooled<Order, FixedPool<Order, 64>, orderPool>(3ul, 100600l);
+        std::cout << "static pool live: " << orderPool().live << " (UniquePtr is " << sizeof(order) << " bytes)\n";
+    }
+    std::cout << "static pool live after scope: " << orderPool().live << "\n";
+
     return 0;
 }
-
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <vector>
+
+
+/// Single-producer ring that every reader sees in full (disruptor-style)
+///
+/// Each event is written once, whatever the fan-out. The producer still
+/// keeps Fifo3's push cursor. Instead of one pop cursor there is one per
+/// Reader, and a Reader may also wait on other Readers. A recorder that
+/// depends on risk only sees an event after risk is done with it. The
+/// producer gates on the readers at the ends of those chains, which are
+/// the slowest by construction. Like Fifo4, both sides cache the cursors
+/// they gate on and only reload them when the cached view says stop.
+///
+/// Slots hold default-constructed T for the ring's lifetime; push()
+/// assigns over the oldest and readers copy out or read in place.
+///
+/// With `PowerOfTwo` the capacity is rounded up to a power of two and slots
+/// are found with a mask instead of an integer division.
+template<typename T, typename Alloc = std::allocator<T>, bool PowerOfTwo = false>
+class BroadcastRing : private Alloc
+{
+public:
+    using value_type = T;
+    using allocator_traits = std::allocator_traits<Alloc>;
+    using size_type = typename allocator_traits::size_type;
+
+private:
+    using CursorType = std::atomic<size_type>;
+    static_assert(CursorType::is_always_lock_free);
+
+    // See Fifo3 for why std::hardware_destructive_interference_size is not used
+    static constexpr auto hardware_destructive_interference_size = size_type{64};
+
+public:
+    /// One consumer's view of the ring; used from that consumer's thread
+    class Reader
+    {
+    public:
+        Reader(Reader const&) = delete;
+        Reader& operator=(Reader const&) = delete;
+
+        /// Returns the number of events this reader may consume now
+        auto available() noexcept {
+            limit_ = limit();
+            return limit_ - cursor_.load(std::memory_order_relaxed);
+        }
+
+        /// Pop one event.
+        /// @return `true` if the pop operation is successful; `false` if
+        /// nothing is ready for this reader.
+        auto pop(T& value) {
+            auto const* next = front();
+            if (next == nullptr) {
+                return false;
+            }
+            value = *next;
+            pop();
+            return true;
+        }
+
+        /// The next event, to read in place; valid until pop().
+        /// @return its address; `nullptr` if nothing is ready for this reader.
+        T const* front() noexcept {
+            auto cursor = cursor_.load(std::memory_order_relaxed);
+            if (cursor == limit_) {
+                limit_ = limit();
+                if (cursor == limit_) {
+                    return nullptr;
+                }
+            }
+            return ring_.element(cursor);
+        }
+
+        /// Release the event returned by front() to the producer and to
+        /// readers that depend on this one
+        void pop() noexcept {
+            auto cursor = cursor_.load(std::memory_order_relaxed);
+            assert(cursor != limit_);
+            cursor_.store(cursor + 1, std::memory_order_release);
+        }
+
+    private:
+        friend class BroadcastRing;
+
+        Reader(BroadcastRing& ring, std::initializer_list<Reader const*> dependsOn)
+            : ring_{ring}
+            , dependsOn_{dependsOn}
+        {}
+
+        /// Events published and passed by every reader this one depends on
+        size_type limit() const noexcept {
+            auto limit = ring_.pushCursor_.load(std::memory_order_acquire);
+            for (auto const* other : dependsOn_) {
+                auto cursor = other->cursor_.load(std::memory_order_acquire);
+                limit = cursor < limit ? cursor : limit;
+            }
+            return limit;
+        }
+
+        BroadcastRing& ring_;
+        std::vector<Reader const*> dependsOn_;
+
+        /// Exclusive to this reader's thread
+        size_type limit_{};
+
+        /// Loaded and stored by this reader; loaded by the producer and
+        /// by dependent readers
+        alignas(hardware_destructive_interference_size) CursorType cursor_{};
+
+        // Padding to avoid false sharing with the next reader
+        char padding_[hardware_destructive_interference_size - sizeof(size_type)];
+    };
+
+    explicit BroadcastRing(size_type capacity, Alloc const& alloc = Alloc{})
+        : Alloc{alloc}
+        , capacity_{ringCapacity(capacity)}
+        , ring_{allocator_traits::allocate(*this, capacity_)}
+    {
+        for (size_type i = 0; i < capacity_; ++i) {
+            allocator_traits::construct(*this, ring_ + i);
+        }
+    }
+
+    BroadcastRing(BroadcastRing const&) = delete;
+    BroadcastRing& operator=(BroadcastRing const&) = delete;
+    BroadcastRing(BroadcastRing&&) = delete;
+    BroadcastRing& operator=(BroadcastRing&&) = delete;
+
+    ~BroadcastRing() {
+        for (size_type i = 0; i < capacity_; ++i) {
+            allocator_traits::destroy(*this, ring_ + i);
+        }
+        allocator_traits::deallocate(*this, ring_, capacity_);
+    }
+
+    /// Register a reader that sees events only after every reader in
+    /// `dependsOn`. All readers must be added before the first push().
+    Reader& addReader(std::initializer_list<Reader const*> dependsOn = {}) {
+        assert(pushCursor_.load(std::memory_order_relaxed) == 0);
+        readers_.emplace_back(new Reader(*this, dependsOn));
+        Reader* reader = readers_.back().get();
+
+        // The producer gates on readers nobody waits behind
+        for (auto const* dependency : dependsOn) {
+            for (size_type i = 0; i < gating_.size(); ++i) {
+                if (gating_[i] == dependency) {
+                    gating_.erase(gating_.begin() + static_cast<std::ptrdiff_t>(i));
+                    break;
+                }
+            }
+        }
+        gating_.push_back(reader);
+        return *reader;
+    }
+
+    /// Returns the number of events not yet consumed by the slowest reader
+    auto size() const noexcept {
+        return pushCursor_.load(std::memory_order_relaxed) - slowest();
+    }
+
+    /// Returns whether every reader has consumed everything
+    auto empty() const noexcept { return size() == 0; }
+
+    /// Returns whether the producer must wait for the slowest reader
+    auto full() const noexcept { return size() == capacity(); }
+
+    /// Returns the number of events that can be held in the ring
+    auto capacity() const noexcept { return capacity_; }
+
+
+    /// Publish one event to every reader; from the single producer thread.
+    /// @return `true` if the operation is successful; `false` if the slowest
+    /// reader is a full ring behind.
+    auto push(T const& value) {
+        auto pushCursor = pushCursor_.load(std::memory_order_relaxed);
+        if (pushCursor - gateCached_ == capacity_) {
+            gateCached_ = slowest();
+            if (pushCursor - gateCached_ == capacity_) {
+                return false;
+            }
+        }
+        *element(pushCursor) = value;
+        pushCursor_.store(pushCursor + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    /// Lowest cursor among the gating readers; the push cursor if none
+    size_type slowest() const noexcept {
+        auto slowest = pushCursor_.load(std::memory_order_relaxed);
+        for (auto const* reader : gating_) {
+            auto cursor = reader->cursor_.load(std::memory_order_acquire);
+            slowest = cursor < slowest ? cursor : slowest;
+        }
+        return slowest;
+    }
+
+    auto element(size_type cursor) noexcept {
+        if constexpr (PowerOfTwo) {
+            return &ring_[cursor & (capacity_ - 1)];
+        } else {
+            return &ring_[cursor % capacity_];
+        }
+    }
+
+    /// Capacity actually allocated: rounded up to a power of two in masked mode
+    static constexpr size_type ringCapacity(size_type capacity) noexcept {
+        if constexpr (PowerOfTwo) {
+            size_type rounded = 1;
+            while (rounded < capacity) {
+                rounded <<= 1;
+            }
+            return rounded;
+        } else {
+            return capacity;
+        }
+    }
+
+private:
+    size_type capacity_;
+    T* ring_;
+    std::vector<std::unique_ptr<Reader>> readers_;
+    std::vector<Reader const*> gating_;
+
+    /// Exclusive to the push thread
+    size_type gateCached_{};
+
+    /// Loaded and stored by the push thread; loaded by every reader
+    alignas(hardware_destructive_interference_size) CursorType pushCursor_{};
+
+    // Padding to avoid false sharing with adjacent objects
+    char padding_[hardware_destructive_interference_size - sizeof(size_type)];
+};
@@ -0,0 +1,154 @@
+// Many-producer contention benchmark: 2-16 gateway threads funnel 64-byte
+// messages into one consumer (and, for the MPMC rows, two). Each queue is
+// compared with the mutex-guarded Fifo3 it replaces.
+//
+//   g++ -std=c++17 -O3 -march=native -pthread contention_benchmark.cpp -o contention_benchmark
+//   ./contention_benchmark [--messages <count>] [--capacity <slots>]
+#include "spsc_q3.cpp"
+#include "mpsc_q.cpp"
+#include "mpmc_q.cpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Message {
+    uint64_t producer;
+    uint64_t sequence;
+    char payload[48];
+};
+static_assert(sizeof(Message) == 64);
+
+// Spin briefly on a full or empty queue, then yield so oversubscribed
+// machines still make progress
+class Backoff {
+public:
+    void pause() {
+        if (++spins_ < 64) {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    void reset() { spins_ = 0; }
+
+private:
+    unsigned spins_ = 0;
+};
+
+// Today's setup: producers serialize on a mutex in front of an SPSC ring.
+// With several consumers they share a second mutex on the pop side.
+class LockedFifo3 {
+public:
+    explicit LockedFifo3(size_t capacity) : queue_(capacity) {}
+
+    bool push(Message const& message) {
+        std::lock_guard<std::mutex> lock(push_mutex_);
+        return queue_.push(message);
+    }
+    bool pop(Message& message) {
+        std::lock_guard<std::mutex> lock(pop_mutex_);
+        return queue_.pop(message);
+    }
+
+private:
+    Fifo3<Message> queue_;
+    std::mutex push_mutex_;
+    std::mutex pop_mutex_;
+};
+
+template<typename Queue>
+double run(size_t producers, size_t consumers, size_t messages, size_t capacity) {
+    Queue queue(capacity);
+    size_t per_producer = messages / producers;
+    size_t total = per_producer * producers;
+    std::atomic<size_t> consumed{0};
+    std::atomic<bool> go{false};
+
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p] {
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            Message message{};
+            message.producer = p;
+            Backoff backoff;
+            for (size_t i = 0; i < per_producer; ++i) {
+                message.sequence = i;
+                while (!queue.push(message)) {
+                    backoff.pause();
+                }
+                backoff.reset();
+            }
+        });
+    }
+    for (size_t c = 0; c < consumers; ++c) {
+        threads.emplace_back([&] {
+            // With one consumer every producer's messages must arrive in order
+            std::vector<uint64_t> next(producers, 0);
+            Message message;
+            Backoff backoff;
+            while (consumed.load(std::memory_order_relaxed) < total) {
+                if (!queue.pop(message)) {
+                    backoff.pause();
+                    continue;
+                }
+                backoff.reset();
+                if (consumers == 1 && message.sequence != next[message.producer]++) {
+                    std::fprintf(stderr, "out of order from producer %llu\n",
+                                 static_cast<unsigned long long>(message.producer));
+                    std::abort();
+                }
+                consumed.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return static_cast<double>(total) / seconds;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t messages = 4000000;
+    size_t capacity = 4096;
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], "--messages") == 0) {
+            messages = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--capacity") == 0) {
+            capacity = std::strtoull(argv[++i], nullptr, 10);
+        }
+    }
+
+    std::printf("=== Contention (%zu messages of %zu bytes, capacity %zu, %u hardware threads) ===\n",
+                messages, sizeof(Message), capacity, std::thread::hardware_concurrency());
+    std::printf("%-10s %-10s %14s %14s %14s\n", "producers", "consumers", "mutex+Fifo3",
+                "MpscFifo", "MpmcFifo");
+    using Mpsc = MpscFifo<Message, std::allocator<Message>, true>;
+    using Mpmc = MpmcFifo<Message, std::allocator<Message>, true>;
+    for (size_t producers : {2, 4, 8, 16}) {
+        std::printf("%-10zu %-10d %12.2fM %12.2fM %12.2fM\n", producers, 1,
+                    run<LockedFifo3>(producers, 1, messages, capacity) / 1e6,
+                    run<Mpsc>(producers, 1, messages, capacity) / 1e6,
+                    run<Mpmc>(producers, 1, messages, capacity) / 1e6);
+        std::printf("%-10zu %-10d %12.2fM %14s %12.2fM\n", producers, 2,
+                    run<LockedFifo3>(producers, 2, messages, capacity) / 1e6, "-",
+                    run<Mpmc>(producers, 2, messages, capacity) / 1e6);
+    }
+    return 0;
+}
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+
+
+/// Threadsafe bounded FIFO for many producers and many consumers
+///
+/// Each slot carries a sequence number that says whose turn it is: a slot
+/// at cursor c is free for the producer holding ticket c while its sequence
+/// is c, and full for the consumer holding ticket c once it is c + 1. After
+/// the pop it becomes c + capacity, the producer ticket one lap later.
+/// Producers claim tickets by CAS on pushCursor_, consumers on popCursor_;
+/// the slot sequence, not the cursors, carries the data between threads.
+///
+/// With `PowerOfTwo` the capacity is rounded up to a power of two and slots
+/// are found with a mask instead of an integer division.
+///
+/// The capacity is at least 2: with one slot, a popped-and-refilled slot's
+/// sequence (c + 1) would equal the next push ticket, so a second push
+/// would overwrite a live element. Smaller requests are raised to 2.
+template<typename T, typename Alloc = std::allocator<T>, bool PowerOfTwo = false>
+class MpmcFifo : private Alloc
+{
+public:
+    using value_type = T;
+    using allocator_traits = std::allocator_traits<Alloc>;
+    using size_type = typename allocator_traits::size_type;
+
+    explicit MpmcFifo(size_type capacity, Alloc const& alloc = Alloc{})
+        : Alloc{alloc}
+        , capacity_{ringCapacity(capacity)}
+    {
+        auto slots = slotAlloc();
+        ring_ = slotTraits::allocate(slots, capacity_);
+        for (size_type i = 0; i < capacity_; ++i) {
+            new (&ring_[i]) Slot{};
+            ring_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // For consistency with other fifos
+    MpmcFifo(MpmcFifo const&) = delete;
+    MpmcFifo& operator=(MpmcFifo const&) = delete;
+    MpmcFifo(MpmcFifo&&) = delete;
+    MpmcFifo& operator=(MpmcFifo&&) = delete;
+
+    ~MpmcFifo() {
+        auto pushCursor = pushCursor_.load(std::memory_order_relaxed);
+        for (auto cursor = popCursor_.load(std::memory_order_relaxed); cursor != pushCursor; ++cursor) {
+            element(cursor)->~T();
+        }
+        for (size_type i = 0; i < capacity_; ++i) {
+            ring_[i].~Slot();
+        }
+        auto slots = slotAlloc();
+        slotTraits::deallocate(slots, ring_, capacity_);
+    }
+
+
+    /// Returns the number of elements in the fifo; approximate while
+    /// producers or consumers are active
+    auto size() const noexcept {
+        // Pop first: the push cursor read after it can only be further on
+        auto popCursor = popCursor_.load(std::memory_order_relaxed);
+        auto pushCursor = pushCursor_.load(std::memory_order_relaxed);
+
+        assert(popCursor <= pushCursor);
+        auto size = pushCursor - popCursor;
+        return size < capacity_ ? size : capacity_;
+    }
+
+    /// Returns whether the container has no elements
+    auto empty() const noexcept { return size() == 0; }
+
+    /// Returns whether the container has capacity_() elements
+    auto full() const noexcept { return size() == capacity(); }
+
+    /// Returns the number of elements that can be held in the fifo
+    auto capacity() const noexcept { return capacity_; }
+
+
+    /// Push one object onto the fifo; callable from any thread.
+    /// @return `true` if the operation is successful; `false` if fifo is full.
+    auto push(T const& value) {
+        auto pushCursor = pushCursor_.load(std::memory_order_relaxed);
+        Slot* slot;
+        while (true) {
+            slot = &ring_[index(pushCursor)];
+            auto sequence = slot->sequence.load(std::memory_order_acquire);
+            auto lag = distance(sequence, pushCursor);
+            if (lag == 0) {
+                if (pushCursor_.compare_exchange_weak(pushCursor, pushCursor + 1,
+                                                      std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (lag < 0) {
+                // Still holds the element from one lap ago
+                return false;
+            } else {
+                pushCursor = pushCursor_.load(std::memory_order_relaxed);
+            }
+        }
+        new (slot->storage) T(value);
+        slot->sequence.store(pushCursor + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Pop one object from the fifo; callable from any thread.
+    /// @return `true` if the pop operation is successful; `false` if fifo is empty.
+    auto pop(T& value) {
+        auto popCursor = popCursor_.load(std::memory_order_relaxed);
+        Slot* slot;
+        while (true) {
+            slot = &ring_[index(popCursor)];
+            auto sequence = slot->sequence.load(std::memory_order_acquire);
+            auto lag = distance(sequence, popCursor + 1);
+            if (lag == 0) {
+                if (popCursor_.compare_exchange_weak(popCursor, popCursor + 1,
+                                                     std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (lag < 0) {
+                // Not written yet
+                return false;
+            } else {
+                popCursor = popCursor_.load(std::memory_order_relaxed);
+            }
+        }
+        auto element = std::launder(reinterpret_cast<T*>(slot->storage));
+        value = *element;
+        element->~T();
+        slot->sequence.store(popCursor + capacity_, std::memory_order_release);
+        return true;
+    }
+
+private:
+    using CursorType = std::atomic<size_type>;
+    static_assert(CursorType::is_always_lock_free);
+
+    struct Slot {
+        CursorType sequence;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+    using SlotAlloc = typename allocator_traits::template rebind_alloc<Slot>;
+    using slotTraits = std::allocator_traits<SlotAlloc>;
+
+    SlotAlloc slotAlloc() const noexcept { return SlotAlloc{static_cast<Alloc const&>(*this)}; }
+
+    static auto distance(size_type sequence, size_type cursor) noexcept {
+        return static_cast<std::ptrdiff_t>(sequence - cursor);
+    }
+    auto index(size_type cursor) const noexcept {
+        if constexpr (PowerOfTwo) {
+            return cursor & (capacity_ - 1);
+        } else {
+            return cursor % capacity_;
+        }
+    }
+    auto element(size_type cursor) noexcept {
+        return std::launder(reinterpret_cast<T*>(ring_[index(cursor)].storage));
+    }
+
+    /// Capacity actually allocated: rounded up to a power of two in masked mode
+    static constexpr size_type ringCapacity(size_type capacity) noexcept {
+        capacity = capacity < 2 ? 2 : capacity;
+        if constexpr (PowerOfTwo) {
+            size_type rounded = 1;
+            while (rounded < capacity) {
+                rounded <<= 1;
+            }
+            return rounded;
+        } else {
+            return capacity;
+        }
+    }
+
+private:
+    size_type capacity_;
+    Slot* ring_{};
+
+    // See Fifo3 for why std::hardware_destructive_interference_size is not used
+    static constexpr auto hardware_destructive_interference_size = size_type{64};
+
+    /// Claimed by CAS from every push thread
+    alignas(hardware_destructive_interference_size) CursorType pushCursor_{};
+
+    /// Claimed by CAS from every pop thread
+    alignas(hardware_destructive_interference_size) CursorType popCursor_{};
+
+    // Padding to avoid false sharing with adjacent objects
+    char padding_[hardware_destructive_interference_size - sizeof(size_type)];
+};
@@ -0,0 +1,250 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+/// Fifo3 in a named POSIX shared-memory object, for a producer process and
+/// a consumer process
+///
+/// The object starts with a header (magic, version, element size, capacity,
+/// then the two padded cursors) followed by the ring. One process create()s
+/// it; the other attach()es by the same name and the header is checked
+/// against its own element type. Push and pop are Fifo3's, with the same
+/// memory ordering: the cursors are lock-free atomics, which are
+/// address-free and so work across mappings. Elements are copied in and
+/// out as bytes, so T must be trivially copyable and must not hold pointers.
+///
+/// With `PowerOfTwo` the capacity must be a power of two (create() rounds
+/// up) and slots are found with a mask instead of an integer division.
+template<typename T, bool PowerOfTwo = false>
+class ShmFifo
+{
+public:
+    using value_type = T;
+    using size_type = std::uint64_t;
+
+    static_assert(std::is_trivially_copyable_v<T>, "shared elements are copied as bytes");
+
+    /// Create and initialize the named ring (e.g. "/feed.book"); fails if
+    /// it already exists. The object stays until unlink().
+    static ShmFifo create(std::string const& name, size_type capacity) {
+        capacity = ringCapacity(capacity);
+        if (capacity == 0) {
+            throw std::invalid_argument("ShmFifo: zero capacity");
+        }
+        int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0) {
+            throw std::runtime_error("ShmFifo: cannot create " + name);
+        }
+        auto bytes = mappingSize(capacity);
+        if (::ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+            ::close(fd);
+            ::shm_unlink(name.c_str());
+            throw std::runtime_error("ShmFifo: cannot size " + name);
+        }
+        void* map = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (map == MAP_FAILED) {
+            ::shm_unlink(name.c_str());
+            throw std::runtime_error("ShmFifo: cannot map " + name);
+        }
+
+        // ftruncate zero-fills, so the cursors start at 0. The magic goes
+        // last: an attach that sees it sees the rest of the header too.
+        auto header = new (map) Header{};
+        header->version = kVersion;
+        header->elementSize = sizeof(T);
+        header->elementAlign = alignof(T);
+        header->capacity = capacity;
+        header->magic.store(kMagic, std::memory_order_release);
+        return ShmFifo{header, bytes};
+    }
+
+    /// Map a ring made by create(), checking it was made for this T
+    static ShmFifo attach(std::string const& name) {
+        int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+        if (fd < 0) {
+            throw std::runtime_error("ShmFifo: cannot open " + name);
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || static_cast<size_type>(st.st_size) < sizeof(Header)) {
+            ::close(fd);
+            throw std::runtime_error("ShmFifo: " + name + " is not initialized");
+        }
+        auto bytes = static_cast<size_type>(st.st_size);
+        void* map = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (map == MAP_FAILED) {
+            throw std::runtime_error("ShmFifo: cannot map " + name);
+        }
+
+        auto header = static_cast<Header*>(map);
+        char const* problem = nullptr;
+        if (header->magic.load(std::memory_order_acquire) != kMagic) {
+            problem = " is not initialized";
+        } else if (header->version != kVersion) {
+            problem = " has another layout version";
+        } else if (header->elementSize != sizeof(T) || header->elementAlign != alignof(T)) {
+            problem = " holds another element type";
+        } else if (header->capacity == 0 || mappingSize(header->capacity) > bytes ||
+                   ringCapacity(header->capacity) != header->capacity) {
+            problem = " has a bad capacity";
+        }
+        if (problem) {
+            ::munmap(map, bytes);
+            throw std::runtime_error("ShmFifo: " + name + problem);
+        }
+        return ShmFifo{header, bytes};
+    }
+
+    /// Remove the name; mappings already made stay valid
+    static void unlink(std::string const& name) { ::shm_unlink(name.c_str()); }
+
+    ShmFifo(ShmFifo const&) = delete;
+    ShmFifo& operator=(ShmFifo const&) = delete;
+
+    ShmFifo(ShmFifo&& other) noexcept
+        : header_{other.header_}, ring_{other.ring_}, capacity_{other.capacity_}, bytes_{other.bytes_} {
+        other.header_ = nullptr;
+    }
+    ShmFifo& operator=(ShmFifo&&) = delete;
+
+    /// Unmaps; the elements and the object itself belong to the ring
+    ~ShmFifo() {
+        if (header_) {
+            ::munmap(header_, bytes_);
+        }
+    }
+
+
+    /// Returns the number of elements in the fifo
+    auto size() const noexcept {
+        auto pushCursor = header_->pushCursor.load(std::memory_order_relaxed);
+        auto popCursor = header_->popCursor.load(std::memory_order_relaxed);
+
+        assert(popCursor <= pushCursor);
+        return pushCursor - popCursor;
+    }
+
+    /// Returns whether the container has no elements
+    auto empty() const noexcept { return size() == 0; }
+
+    /// Returns whether the container has capacity_() elements
+    auto full() const noexcept { return size() == capacity(); }
+
+    /// Returns the number of elements that can be held in the fifo
+    auto capacity() const noexcept { return capacity_; }
+
+
+    /// Push one object onto the fifo; from the single producer process.
+    /// @return `true` if the operation is successful; `false` if fifo is full.
+    auto push(T const& value) {
+        auto pushCursor = header_->pushCursor.load(std::memory_order_relaxed);
+        auto popCursor = header_->popCursor.load(std::memory_order_acquire);
+        if (full(pushCursor, popCursor)) {
+            return false;
+        }
+        std::memcpy(element(pushCursor), &value, sizeof(T));
+        header_->pushCursor.store(pushCursor + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Pop one object from the fifo; from the single consumer process.
+    /// @return `true` if the pop operation is successful; `false` if fifo is empty.
+    auto pop(T& value) {
+        auto pushCursor = header_->pushCursor.load(std::memory_order_acquire);
+        auto popCursor = header_->popCursor.load(std::memory_order_relaxed);
+        if (empty(pushCursor, popCursor)) {
+            return false;
+        }
+        std::memcpy(&value, element(popCursor), sizeof(T));
+        header_->popCursor.store(popCursor + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    using CursorType = std::atomic<size_type>;
+    static_assert(CursorType::is_always_lock_free, "cursors must be address-free");
+
+    // See Fifo3 for why std::hardware_destructive_interference_size is not used
+    static constexpr auto hardware_destructive_interference_size = std::size_t{64};
+
+    static constexpr std::uint64_t kMagic = 0x4f46494633534d48;   // "HMS3FIFO"
+    static constexpr std::uint32_t kVersion = 1;
+
+    /// Layout shared by both processes; changes bump kVersion
+    struct Header {
+        std::atomic<std::uint64_t> magic;
+        std::uint32_t version;
+        std::uint32_t elementSize;
+        std::uint32_t elementAlign;
+        std::uint64_t capacity;
+
+        /// Stored by the producer process; loaded by the consumer process
+        alignas(hardware_destructive_interference_size) CursorType pushCursor;
+
+        /// Stored by the consumer process; loaded by the producer process
+        alignas(hardware_destructive_interference_size) CursorType popCursor;
+    };
+
+    /// The ring starts on the first cache line after the header
+    static constexpr auto ringOffset() noexcept {
+        constexpr auto line = hardware_destructive_interference_size;
+        constexpr auto align = alignof(T) > line ? alignof(T) : line;
+        return (sizeof(Header) + align - 1) / align * align;
+    }
+    static auto mappingSize(size_type capacity) noexcept {
+        return ringOffset() + capacity * sizeof(T);
+    }
+
+    ShmFifo(Header* header, size_type bytes) noexcept
+        : header_{header}
+        , ring_{reinterpret_cast<unsigned char*>(header) + ringOffset()}
+        , capacity_{header->capacity}
+        , bytes_{bytes}
+    {}
+
+    auto full(size_type pushCursor, size_type popCursor) const noexcept {
+        return (pushCursor - popCursor) == capacity_;
+    }
+    static auto empty(size_type pushCursor, size_type popCursor) noexcept {
+        return pushCursor == popCursor;
+    }
+    auto element(size_type cursor) noexcept {
+        if constexpr (PowerOfTwo) {
+            return ring_ + (cursor & (capacity_ - 1)) * sizeof(T);
+        } else {
+            return ring_ + (cursor % capacity_) * sizeof(T);
+        }
+    }
+
+    /// Capacity actually allocated: rounded up to a power of two in masked mode
+    static constexpr size_type ringCapacity(size_type capacity) noexcept {
+        if constexpr (PowerOfTwo) {
+            size_type rounded = 1;
+            while (rounded < capacity) {
+                rounded <<= 1;
+            }
+            return rounded;
+        } else {
+            return capacity;
+        }
+    }
+
+private:
+    Header* header_;
+    unsigned char* ring_;
+    size_type capacity_;    // Checked at attach, then never re-read from the header
+    size_type bytes_;
+};
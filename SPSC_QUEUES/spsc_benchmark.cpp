@@ -0,0 +1,325 @@
+// SPSC queue benchmark suite: sustained throughput and ping-pong round-trip
+// latency for every fifo in this directory, over element sizes, capacities
+// and producer/consumer core placements (SMT siblings, two cores of one
+// socket, two sockets), read from /sys/devices/system/cpu.
+//
+//   g++ -std=c++17 -O3 -march=native -pthread spsc_benchmark.cpp -o spsc_benchmark
+//   ./spsc_benchmark [--ops <count>] [--pings <count>] [--capacities 1024,65536]
+//                    [--cpus <producer>,<consumer>]
+//
+// Fifo1 is not threadsafe, so it is only timed on one thread (push then
+// pop), next to the same single-thread figure for the others. A new fifo
+// is added with one line in run_size().
+#include "spsc_q1.cpp"
+#include "spsc_q2.cpp"
+#include "spsc_q3.cpp"
+#include "spsc_q4.cpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+template<size_t Bytes>
+struct Element {
+    uint64_t sequence;
+    char payload[Bytes - sizeof(uint64_t)];
+};
+
+struct Settings {
+    uint64_t ops = 10000000;
+    uint64_t pings = 200000;
+    std::vector<size_t> capacities{1024, 65536};
+};
+
+struct Placement {
+    std::string name;
+    int producer;
+    int consumer;
+};
+
+void pin_to(int cpu) {
+#ifdef __linux__
+    if (cpu < 0) {
+        return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)cpu;
+#endif
+}
+
+// Spin on an empty or full fifo; yield only after a long stall so an
+// oversubscribed machine still finishes
+class Backoff {
+public:
+    void pause() {
+        if (++spins_ < 256) {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    void reset() { spins_ = 0; }
+
+private:
+    unsigned spins_ = 0;
+};
+
+int read_topology(int cpu, const char* field) {
+    std::ifstream in("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/" + field);
+    int value = -1;
+    in >> value;
+    return in ? value : -1;
+}
+
+// One pair of CPUs per placement class the machine has
+std::vector<Placement> find_placements() {
+    struct Cpu {
+        int id;
+        int package;
+        int core;
+    };
+    std::vector<Cpu> cpus;
+    unsigned count = std::thread::hardware_concurrency();
+    for (unsigned id = 0; id < count; ++id) {
+        int package = read_topology(static_cast<int>(id), "physical_package_id");
+        int core = read_topology(static_cast<int>(id), "core_id");
+        if (package >= 0 && core >= 0) {
+            cpus.push_back(Cpu{static_cast<int>(id), package, core});
+        }
+    }
+
+    std::vector<Placement> placements;
+    auto add_first = [&](const char* name, auto&& matches) {
+        for (size_t a = 0; a < cpus.size(); ++a) {
+            for (size_t b = a + 1; b < cpus.size(); ++b) {
+                if (matches(cpus[a], cpus[b])) {
+                    placements.push_back(Placement{name, cpus[a].id, cpus[b].id});
+                    return;
+                }
+            }
+        }
+    };
+    add_first("SMT siblings", [](const Cpu& a, const Cpu& b) {
+        return a.package == b.package && a.core == b.core;
+    });
+    add_first("same socket", [](const Cpu& a, const Cpu& b) {
+        return a.package == b.package && a.core != b.core;
+    });
+    add_first("cross socket", [](const Cpu& a, const Cpu& b) { return a.package != b.package; });
+    return placements;
+}
+
+template<typename Queue, typename T>
+double single_thread_ns(size_t capacity, uint64_t ops) {
+    Queue queue(capacity);
+    T value{};
+    uint64_t sum = 0;
+    size_t burst = std::min<size_t>(capacity, 64);
+    auto start = Clock::now();
+    for (uint64_t done = 0; done < ops; done += burst) {
+        for (size_t i = 0; i < burst; ++i) {
+            value.sequence = done + i;
+            queue.push(value);
+        }
+        for (size_t i = 0; i < burst; ++i) {
+            queue.pop(value);
+            sum += value.sequence;
+        }
+    }
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    if (sum == 0 && ops > 1) {
+        std::abort();   // Keeps the loop from being optimized out
+    }
+    return ns / static_cast<double>(ops);
+}
+
+// Producer streams `ops` elements as fast as the consumer takes them
+template<typename Queue, typename T>
+double throughput(size_t capacity, uint64_t ops, const Placement& placement) {
+    Queue queue(capacity);
+    std::thread consumer([&] {
+        pin_to(placement.consumer);
+        T value;
+        Backoff backoff;
+        for (uint64_t expected = 0; expected < ops;) {
+            if (queue.pop(value)) {
+                if (value.sequence != expected) {
+                    std::fprintf(stderr, "out of order\n");
+                    std::abort();
+                }
+                ++expected;
+                backoff.reset();
+            } else {
+                backoff.pause();
+            }
+        }
+    });
+    pin_to(placement.producer);
+    T value{};
+    Backoff backoff;
+    auto start = Clock::now();
+    for (uint64_t i = 0; i < ops; ++i) {
+        value.sequence = i;
+        while (!queue.push(value)) {
+            backoff.pause();
+        }
+        backoff.reset();
+    }
+    consumer.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return static_cast<double>(ops) / seconds;
+}
+
+struct Percentiles {
+    double p50, p90, p99, p999, max;
+};
+
+// One element bounces through a queue each way; each sample is a full RTT
+template<typename Queue, typename T>
+Percentiles ping_pong(size_t capacity, uint64_t pings, const Placement& placement) {
+    Queue ping(capacity);
+    Queue pong(capacity);
+    std::thread echo([&] {
+        pin_to(placement.consumer);
+        T value;
+        Backoff backoff;
+        for (uint64_t i = 0; i < pings; ++i) {
+            while (!ping.pop(value)) {
+                backoff.pause();
+            }
+            backoff.reset();
+            while (!pong.push(value)) {
+                backoff.pause();
+            }
+            backoff.reset();
+        }
+    });
+    pin_to(placement.producer);
+    std::vector<double> samples(pings);
+    T value{};
+    Backoff backoff;
+    for (uint64_t i = 0; i < pings; ++i) {
+        value.sequence = i;
+        auto start = Clock::now();
+        while (!ping.push(value)) {
+            backoff.pause();
+        }
+        backoff.reset();
+        while (!pong.pop(value)) {
+            backoff.pause();
+        }
+        backoff.reset();
+        samples[i] = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    }
+    echo.join();
+
+    std::sort(samples.begin(), samples.end());
+    auto at = [&](double q) {
+        return samples[std::min(samples.size() - 1, static_cast<size_t>(q * samples.size()))];
+    };
+    return Percentiles{at(0.50), at(0.90), at(0.99), at(0.999), samples.back()};
+}
+
+template<typename Queue, typename T>
+void run_queue(const char* name, const Settings& settings,
+               const std::vector<Placement>& placements) {
+    for (size_t capacity : settings.capacities) {
+        std::printf("  %-14s cap %-7zu single-thread %6.2f ns/op\n", name, capacity,
+                    single_thread_ns<Queue, T>(capacity, settings.ops));
+        for (const Placement& placement : placements) {
+            double rate = throughput<Queue, T>(capacity, settings.ops, placement);
+            Percentiles rtt = ping_pong<Queue, T>(capacity, settings.pings, placement);
+            std::printf("  %-14s cap %-7zu %-13s %8.2fM ops/s  RTT p50 %6.0f p90 %6.0f "
+                        "p99 %6.0f p99.9 %7.0f max %8.0f ns\n",
+                        name, capacity, placement.name.c_str(), rate / 1e6, rtt.p50, rtt.p90,
+                        rtt.p99, rtt.p999, rtt.max);
+        }
+    }
+}
+
+template<size_t Bytes>
+void run_size(const Settings& settings, const std::vector<Placement>& placements) {
+    using T = Element<Bytes>;
+    std::printf("=== %zu-byte elements ===\n", Bytes);
+    for (size_t capacity : settings.capacities) {
+        std::printf("  %-14s cap %-7zu single-thread %6.2f ns/op\n", "Fifo1", capacity,
+                    single_thread_ns<Fifo1<T>, T>(capacity, settings.ops));
+    }
+    run_queue<Fifo2<T>, T>("Fifo2", settings, placements);
+    run_queue<Fifo3<T>, T>("Fifo3", settings, placements);
+    run_queue<Fifo3<T, std::allocator<T>, true>, T>("Fifo3 masked", settings, placements);
+    run_queue<Fifo4<T>, T>("Fifo4", settings, placements);
+    run_queue<Fifo4<T, std::allocator<T>, true>, T>("Fifo4 masked", settings, placements);
+}
+
+std::vector<size_t> parse_list(const char* text) {
+    std::vector<size_t> values;
+    for (char* end = nullptr;; text = end + 1) {
+        values.push_back(std::strtoull(text, &end, 10));
+        if (*end != ',') {
+            break;
+        }
+    }
+    return values;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Settings settings;
+    std::vector<Placement> placements;
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], "--ops") == 0) {
+            settings.ops = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--pings") == 0) {
+            settings.pings = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--capacities") == 0) {
+            settings.capacities = parse_list(argv[++i]);
+        } else if (std::strcmp(argv[i], "--cpus") == 0) {
+            std::vector<size_t> cpus = parse_list(argv[++i]);
+            if (cpus.size() == 2) {
+                placements.push_back(Placement{"cpus " + std::to_string(cpus[0]) + "," +
+                                                   std::to_string(cpus[1]),
+                                               static_cast<int>(cpus[0]), static_cast<int>(cpus[1])});
+            }
+        }
+    }
+    if (placements.empty()) {
+        placements = find_placements();
+    }
+    if (placements.empty()) {
+        // Single CPU, or no topology: the scheduler decides, and the
+        // numbers mostly measure context switches
+        placements.push_back(Placement{"unpinned", -1, -1});
+    }
+
+    std::printf("Placements:");
+    for (const Placement& placement : placements) {
+        std::printf("  %s (%d -> %d)", placement.name.c_str(), placement.producer, placement.consumer);
+    }
+    std::printf("\n");
+    run_size<8>(settings, placements);
+    run_size<64>(settings, placements);
+    run_size<256>(settings, placements);
+    return 0;
+}
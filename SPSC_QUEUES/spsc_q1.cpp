@@ -6,7 +6,10 @@
 
 
 /// Non-threadsafe circular FIFO; has data races
-template<typename T, typename Alloc = std::allocator<T>>
+///
+/// With `PowerOfTwo` the capacity is rounded up to a power of two and slots
+/// are found with a mask instead of an integer division.
+template<typename T, typename Alloc = std::allocator<T>, bool PowerOfTwo = false>
 class Fifo1 : private Alloc
 {
 public:
@@ -16,8 +19,8 @@ public:
 
     explicit Fifo1(size_type capacity, Alloc const& alloc = Alloc{})
         : Alloc{alloc}
-        , capacity_{capacity}
-        , ring_{allocator_traits::allocate(*this, capacity)}
+        , capacity_{ringCapacity(capacity)}
+        , ring_{allocator_traits::allocate(*this, capacity_)}
     {}
 
     // For consistency with other fifos
@@ -28,7 +31,7 @@ public:
 
     ~Fifo1() {
         while(not empty()) {
-            ring_[popCursor_ % capacity_].~T();
+            element(popCursor_)->~T();
             ++popCursor_;
         }
         allocator_traits::deallocate(*this, ring_, capacity_);
@@ -57,7 +60,7 @@ public:
         if (full()) {
             return false;
         }
-        new (&ring_[pushCursor_ % capacity_]) T(value);
+        new (element(pushCursor_)) T(value);
         ++pushCursor_;
         return true;
     }
@@ -68,12 +71,34 @@ public:
         if (empty()) {
             return false;
         }
-        value = ring_[popCursor_ % capacity_];
-        ring_[popCursor_ % capacity_].~T();
+        value = *element(popCursor_);
+        element(popCursor_)->~T();
         ++popCursor_;
         return true;
     }
 
+private:
+    auto element(size_type cursor) noexcept {
+        if constexpr (PowerOfTwo) {
+            return &ring_[cursor & (capacity_ - 1)];
+        } else {
+            return &ring_[cursor % capacity_];
+        }
+    }
+
+    /// Capacity actually allocated: rounded up to a power of two in masked mode
+    static constexpr size_type ringCapacity(size_type capacity) noexcept {
+        if constexpr (PowerOfTwo) {
+            size_type rounded = 1;
+            while (rounded < capacity) {
+                rounded <<= 1;
+            }
+            return rounded;
+        } else {
+            return capacity;
+        }
+    }
+
 private:
     size_type capacity_;
     T* ring_;
@@ -6,7 +6,10 @@
 
 
 /// Threadsafe but flawed circular FIFO
-template<typename T, typename Alloc = std::allocator<T>>
+///
+/// With `PowerOfTwo` the capacity is rounded up to a power of two and slots
+/// are found with a mask instead of an integer division.
+template<typename T, typename Alloc = std::allocator<T>, bool PowerOfTwo = false>
 class Fifo2 : private Alloc
 {
 public:
@@ -16,13 +19,13 @@ public:
 
     explicit Fifo2(size_type capacity, Alloc const& alloc = Alloc{})
         : Alloc{alloc}
-        , capacity_{capacity}
-        , ring_{allocator_traits::allocate(*this, capacity)}
+        , capacity_{ringCapacity(capacity)}
+        , ring_{allocator_traits::allocate(*this, capacity_)}
     {}
 
     ~Fifo2() {
         while(not empty()) {
-            ring_[popCursor_ % capacity_].~T();
+            element(popCursor_)->~T();
             ++popCursor_;
         }
         allocator_traits::deallocate(*this, ring_, capacity_);
@@ -51,7 +54,7 @@ public:
         if (full()) {
             return false;
         }
-        new (&ring_[pushCursor_ % capacity_]) T(value);
+        new (element(pushCursor_)) T(value);
         ++pushCursor_;
         return true;
     }
@@ -62,12 +65,34 @@ public:
         if (empty()) {
             return false;
         }
-        value = ring_[popCursor_ % capacity_];
-        ring_[popCursor_ % capacity_].~T();
+        value = *element(popCursor_);
+        element(popCursor_)->~T();
         ++popCursor_;
         return true;
     }
 
+private:
+    auto element(size_type cursor) noexcept {
+        if constexpr (PowerOfTwo) {
+            return &ring_[cursor & (capacity_ - 1)];
+        } else {
+            return &ring_[cursor % capacity_];
+        }
+    }
+
+    /// Capacity actually allocated: rounded up to a power of two in masked mode
+    static constexpr size_type ringCapacity(size_type capacity) noexcept {
+        if constexpr (PowerOfTwo) {
+            size_type rounded = 1;
+            while (rounded < capacity) {
+                rounded <<= 1;
+            }
+            return rounded;
+        } else {
+            return capacity;
+        }
+    }
+
 private:
     size_type capacity_;
     T* ring_;
@@ -76,8 +101,8 @@ private:
     static_assert(CursorType::is_always_lock_free);
 
     /// Loaded and stored by the push thread; loaded by the pop thread
-    CursorType pushCursor_;
+    CursorType pushCursor_{};
 
     /// Loaded and stored by the pop thread; loaded by the push thread
-    CursorType popCursor_;
+    CursorType popCursor_{};
 };
@@ -4,10 +4,14 @@
 #include <cassert>
 #include <memory>
 #include <new>
+#include <utility>
 
 
 /// Threadsafe, efficient circular FIFO
-template<typename T, typename Alloc = std::allocator<T>>
+///
+/// With `PowerOfTwo` the capacity is rounded up to a power of two and slots
+/// are found with a mask instead of an integer division.
+template<typename T, typename Alloc = std::allocator<T>, bool PowerOfTwo = false>
 class Fifo3 : private Alloc
 {
 public:
@@ -17,8 +21,8 @@ public:
 
     explicit Fifo3(size_type capacity, Alloc const& alloc = Alloc{})
         : Alloc{alloc}
-        , capacity_{capacity}
-        , ring_{allocator_traits::allocate(*this, capacity)}
+        , capacity_{ringCapacity(capacity)}
+        , ring_{allocator_traits::allocate(*this, capacity_)}
     {}
 
     ~Fifo3() {
@@ -76,6 +80,91 @@ public:
         return true;
     }
 
+    /// Construct one object in place at the back of the fifo.
+    /// @return `true` if the operation is successful; `false` if fifo is full.
+    template<typename... Args>
+    auto emplace(Args&&... args) {
+        auto pushCursor = pushCursor_.load(std::memory_order_relaxed);
+        auto popCursor = popCursor_.load(std::memory_order_acquire);
+        if (full(pushCursor, popCursor)) {
+            return false;
+        }
+        new (element(pushCursor)) T(std::forward<Args>(args)...);
+        pushCursor_.store(pushCursor + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Reserve the back slot so the push thread can construct a T there.
+    /// The object is not visible to the pop thread until commit().
+    /// @return the slot's (uninitialized) storage; `nullptr` if fifo is full.
+    T* try_reserve() {
+        auto pushCursor = pushCursor_.load(std::memory_order_relaxed);
+        auto popCursor = popCursor_.load(std::memory_order_acquire);
+        if (full(pushCursor, popCursor)) {
+            return nullptr;
+        }
+        return element(pushCursor);
+    }
+
+    /// Publish the object constructed in the slot from try_reserve()
+    void commit() {
+        auto pushCursor = pushCursor_.load(std::memory_order_relaxed);
+        assert(not full(pushCursor, popCursor_.load(std::memory_order_relaxed)));
+        pushCursor_.store(pushCursor + 1, std::memory_order_release);
+    }
+
+    /// The oldest object, for the pop thread to read in place.
+    /// @return its address; `nullptr` if fifo is empty.
+    T* front() {
+        auto pushCursor = pushCursor_.load(std::memory_order_acquire);
+        auto popCursor = popCursor_.load(std::memory_order_relaxed);
+        if (empty(pushCursor, popCursor)) {
+            return nullptr;
+        }
+        return element(popCursor);
+    }
+
+    /// Destroy the object returned by front() and release its slot
+    void pop() {
+        auto popCursor = popCursor_.load(std::memory_order_relaxed);
+        assert(not empty(pushCursor_.load(std::memory_order_relaxed), popCursor));
+        element(popCursor)->~T();
+        popCursor_.store(popCursor + 1, std::memory_order_release);
+    }
+
+    /// Push up to `count` objects from `values`, published with one store.
+    /// @return the number pushed; less than `count` if the fifo fills up.
+    auto push_n(T const* values, size_type count) {
+        auto pushCursor = pushCursor_.load(std::memory_order_relaxed);
+        auto popCursor = popCursor_.load(std::memory_order_acquire);
+        auto free = capacity_ - (pushCursor - popCursor);
+        auto n = count < free ? count : free;
+        for (size_type i = 0; i < n; ++i) {
+            new (element(pushCursor + i)) T(values[i]);
+        }
+        if (n != 0) {
+            pushCursor_.store(pushCursor + n, std::memory_order_release);
+        }
+        return n;
+    }
+
+    /// Pop up to `count` objects into `values`, released with one store.
+    /// @return the number popped; less than `count` if the fifo runs empty.
+    auto pop_n(T* values, size_type count) {
+        auto pushCursor = pushCursor_.load(std::memory_order_acquire);
+        auto popCursor = popCursor_.load(std::memory_order_relaxed);
+        auto available = pushCursor - popCursor;
+        auto n = count < available ? count : available;
+        for (size_type i = 0; i < n; ++i) {
+            values[i] = *element(popCursor + i);
+            element(popCursor + i)->~T();
+        }
+        if (n != 0) {
+            popCursor_.store(popCursor + n, std::memory_order_release);
+        }
+        return n;
+    }
+
 private:
     auto full(size_type pushCursor, size_type popCursor) const noexcept {
         return (pushCursor - popCursor) == capacity_;
@@ -84,7 +173,24 @@ private:
         return pushCursor == popCursor;
     }
     auto element(size_type cursor) noexcept {
-        return &ring_[cursor % capacity_];
+        if constexpr (PowerOfTwo) {
+            return &ring_[cursor & (capacity_ - 1)];
+        } else {
+            return &ring_[cursor % capacity_];
+        }
+    }
+
+    /// Capacity actually allocated: rounded up to a power of two in masked mode
+    static constexpr size_type ringCapacity(size_type capacity) noexcept {
+        if constexpr (PowerOfTwo) {
+            size_type rounded = 1;
+            while (rounded < capacity) {
+                rounded <<= 1;
+            }
+            return rounded;
+        } else {
+            return capacity;
+        }
     }
 
 private:
@@ -103,10 +209,10 @@ private:
     static constexpr auto hardware_destructive_interference_size = size_type{64};
 
     /// Loaded and stored by the push thread; loaded by the pop thread
-    alignas(hardware_destructive_interference_size) CursorType pushCursor_;
+    alignas(hardware_destructive_interference_size) CursorType pushCursor_{};
 
     /// Loaded and stored by the pop thread; loaded by the push thread
-    alignas(hardware_destructive_interference_size) CursorType popCursor_;
+    alignas(hardware_destructive_interference_size) CursorType popCursor_{};
 
     // Padding to avoid false sharing with adjacent objects
     char padding_[hardware_destructive_interference_size - sizeof(size_type)];
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <new>
+
+
+/// Threadsafe, efficient circular FIFO with cached cursors
+///
+/// Fifo3 loads the other thread's cursor on every push and pop, pulling its
+/// cache line across cores even when the fifo is far from full or empty.
+/// Here each side keeps a private copy of the other side's cursor and only
+/// reloads it when that copy says the fifo is full (push) or empty (pop).
+///
+/// With `PowerOfTwo` the capacity is rounded up to a power of two and slots
+/// are found with a mask instead of an integer division.
+template<typename T, typename Alloc = std::allocator<T>, bool PowerOfTwo = false>
+class Fifo4 : private Alloc
+{
+public:
+    using value_type = T;
+    using allocator_traits = std::allocator_traits<Alloc>;
+    using size_type = typename allocator_traits::size_type;
+
+    explicit Fifo4(size_type capacity, Alloc const& alloc = Alloc{})
+        : Alloc{alloc}
+        , capacity_{ringCapacity(capacity)}
+        , ring_{allocator_traits::allocate(*this, capacity_)}
+    {}
+
+    // For consistency with other fifos
+    Fifo4(Fifo4 const&) = delete;
+    Fifo4& operator=(Fifo4 const&) = delete;
+    Fifo4(Fifo4&&) = delete;
+    Fifo4& operator=(Fifo4&&) = delete;
+
+    ~Fifo4() {
+        while(not empty()) {
+            element(popCursor_)->~T();
+            ++popCursor_;
+        }
+        allocator_traits::deallocate(*this, ring_, capacity_);
+    }
+
+
+    /// Returns the number of elements in the fifo
+    auto size() const noexcept {
+        auto pushCursor = pushCursor_.load(std::memory_order_relaxed);
+        auto popCursor = popCursor_.load(std::memory_order_relaxed);
+
+        assert(popCursor <= pushCursor);
+        return pushCursor - popCursor;
+    }
+
+    /// Returns whether the container has no elements
+    auto empty() const noexcept { return size() == 0; }
+
+    /// Returns whether the container has capacity_() elements
+    auto full() const noexcept { return size() == capacity(); }
+
+    /// Returns the number of elements that can be held in the fifo
+    auto capacity() const noexcept { return capacity_; }
+
+
+    /// Push one object onto the fifo.
+    /// @return `true` if the operation is successful; `false` if fifo is full.
+    auto push(T const& value) {
+        auto pushCursor = pushCursor_.load(std::memory_order_relaxed);
+        if (full(pushCursor, popCursorCached_)) {
+            // Looks full: refresh the consumer's position, then decide
+            popCursorCached_ = popCursor_.load(std::memory_order_acquire);
+            if (full(pushCursor, popCursorCached_)) {
+                return false;
+            }
+        }
+        new (element(pushCursor)) T(value);
+        pushCursor_.store(pushCursor + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Pop one object from the fifo.
+    /// @return `true` if the pop operation is successful; `false` if fifo is empty.
+    auto pop(T& value) {
+        auto popCursor = popCursor_.load(std::memory_order_relaxed);
+        if (empty(pushCursorCached_, popCursor)) {
+            // Looks empty: refresh the producer's position, then decide
+            pushCursorCached_ = pushCursor_.load(std::memory_order_acquire);
+            if (empty(pushCursorCached_, popCursor)) {
+                return false;
+            }
+        }
+        value = *element(popCursor);
+        element(popCursor)->~T();
+        popCursor_.store(popCursor + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Push up to `count` objects from `values`, published with one store.
+    /// @return the number pushed; less than `count` if the fifo fills up.
+    auto push_n(T const* values, size_type count) {
+        auto pushCursor = pushCursor_.load(std::memory_order_relaxed);
+        auto free = capacity_ - (pushCursor - popCursorCached_);
+        if (free < count) {
+            popCursorCached_ = popCursor_.load(std::memory_order_acquire);
+            free = capacity_ - (pushCursor - popCursorCached_);
+        }
+        auto n = count < free ? count : free;
+        for (size_type i = 0; i < n; ++i) {
+            new (element(pushCursor + i)) T(values[i]);
+        }
+        if (n != 0) {
+            pushCursor_.store(pushCursor + n, std::memory_order_release);
+        }
+        return n;
+    }
+
+    /// Pop up to `count` objects into `values`, released with one store.
+    /// @return the number popped; less than `count` if the fifo runs empty.
+    auto pop_n(T* values, size_type count) {
+        auto popCursor = popCursor_.load(std::memory_order_relaxed);
+        auto available = pushCursorCached_ - popCursor;
+        if (available < count) {
+            pushCursorCached_ = pushCursor_.load(std::memory_order_acquire);
+            available = pushCursorCached_ - popCursor;
+        }
+        auto n = count < available ? count : available;
+        for (size_type i = 0; i < n; ++i) {
+            values[i] = *element(popCursor + i);
+            element(popCursor + i)->~T();
+        }
+        if (n != 0) {
+            popCursor_.store(popCursor + n, std::memory_order_release);
+        }
+        return n;
+    }
+
+private:
+    auto full(size_type pushCursor, size_type popCursor) const noexcept {
+        return (pushCursor - popCursor) == capacity_;
+    }
+    static auto empty(size_type pushCursor, size_type popCursor) noexcept {
+        return pushCursor == popCursor;
+    }
+    auto element(size_type cursor) noexcept {
+        if constexpr (PowerOfTwo) {
+            return &ring_[cursor & (capacity_ - 1)];
+        } else {
+            return &ring_[cursor % capacity_];
+        }
+    }
+
+    /// Capacity actually allocated: rounded up to a power of two in masked mode
+    static constexpr size_type ringCapacity(size_type capacity) noexcept {
+        if constexpr (PowerOfTwo) {
+            size_type rounded = 1;
+            while (rounded < capacity) {
+                rounded <<= 1;
+            }
+            return rounded;
+        } else {
+            return capacity;
+        }
+    }
+
+private:
+    size_type capacity_;
+    T* ring_;
+
+    using CursorType = std::atomic<size_type>;
+    static_assert(CursorType::is_always_lock_free);
+
+    // See Fifo3 for why std::hardware_destructive_interference_size is not used
+    static constexpr auto hardware_destructive_interference_size = size_type{64};
+
+    /// Loaded and stored by the push thread; loaded by the pop thread
+    alignas(hardware_destructive_interference_size) CursorType pushCursor_{};
+
+    /// Exclusive to the push thread
+    alignas(hardware_destructive_interference_size) size_type popCursorCached_{};
+
+    /// Loaded and stored by the pop thread; loaded by the push thread
+    alignas(hardware_destructive_interference_size) CursorType popCursor_{};
+
+    /// Exclusive to the pop thread
+    alignas(hardware_destructive_interference_size) size_type pushCursorCached_{};
+
+    // Padding to avoid false sharing with adjacent objects
+    char padding_[hardware_destructive_interference_size - sizeof(size_type)];
+};
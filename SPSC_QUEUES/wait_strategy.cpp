@@ -0,0 +1,181 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+/// What a consumer does while its fifo is empty
+///
+/// Every strategy has the same three calls:
+///  - `idle(ready)` after a pop found nothing. `ready()` says whether there
+///    is anything to do now, e.g. `not fifo.empty() or stopping`. Only
+///    ParkWait calls it, as a last check before sleeping.
+///  - `reset()` after a pop succeeded.
+///  - `notify()` from the producer after every push, and after anything
+///    else that makes `ready()` true. It does nothing except for ParkWait.
+///
+/// The consumer loop is the same for all four; see pop_wait() and
+/// push_notify() below.
+
+
+/// Busy-spin: lowest latency, burns the whole core
+struct SpinWait
+{
+    template<typename Ready>
+    void idle(Ready&&) noexcept {}
+    void reset() noexcept {}
+    void notify() noexcept {}
+};
+
+
+inline void cpuPause() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+/// Spin with pause instructions, doubling the pauses each idle round up to
+/// `maxPauses`. The core stays busy but uses less power, and an SMT sibling
+/// gets more of the pipeline.
+class PauseWait
+{
+public:
+    explicit PauseWait(unsigned maxPauses = 64) noexcept : maxPauses_{maxPauses} {}
+
+    template<typename Ready>
+    void idle(Ready&&) noexcept {
+        for (unsigned i = 0; i < pauses_; ++i) {
+            cpuPause();
+        }
+        if (pauses_ < maxPauses_) {
+            pauses_ *= 2;
+        }
+    }
+    void reset() noexcept { pauses_ = 1; }
+    void notify() noexcept {}
+
+private:
+    unsigned maxPauses_;
+    unsigned pauses_ = 1;
+};
+
+
+/// Give the core to the scheduler on each idle round. Wakes as soon as the
+/// thread is rescheduled; latency depends on what else is runnable.
+struct YieldWait
+{
+    template<typename Ready>
+    void idle(Ready&&) noexcept { std::this_thread::yield(); }
+    void reset() noexcept {}
+    void notify() noexcept {}
+};
+
+
+/// Spin for `spinRounds` idle rounds, then sleep in the kernel (a futex on
+/// Linux, yield elsewhere) until the producer notifies. The producer only
+/// makes a system call when the consumer is actually parked; otherwise
+/// notify() is a fence and a load.
+///
+/// Lost wakeups are prevented Dekker-style. The consumer publishes `parked_`
+/// and then re-checks `ready()`. The producer publishes its push and then
+/// checks `parked_`. A seq_cst fence on each side makes sure at least one
+/// of them sees the other.
+class ParkWait
+{
+public:
+    explicit ParkWait(unsigned spinRounds = 1024) noexcept : spinRounds_{spinRounds} {}
+
+    template<typename Ready>
+    void idle(Ready&& ready) {
+        if (++rounds_ < spinRounds_) {
+            cpuPause();
+            return;
+        }
+        ++parks_;
+        parked_.store(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (not ready()) {
+            sleep();
+        }
+        parked_.store(0, std::memory_order_relaxed);
+    }
+
+    void reset() noexcept { rounds_ = 0; }
+
+    void notify() noexcept {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        // Clearing the flag first also covers a consumer that has checked
+        // ready() but not yet entered the kernel: its wait sees 0 and returns
+        if (parked_.load(std::memory_order_relaxed) != 0 &&
+            parked_.exchange(0, std::memory_order_relaxed) != 0) {
+            wakes_.fetch_add(1, std::memory_order_relaxed);
+            wake();
+        }
+    }
+
+    /// Times the consumer raised its parked flag (and then slept unless the
+    /// last ready() check said otherwise); read by the consumer thread
+    std::uint64_t parks() const noexcept { return parks_; }
+
+    /// Times a notify() made a wake-up call
+    std::uint64_t wakes() const noexcept { return wakes_.load(std::memory_order_relaxed); }
+
+private:
+    void sleep() noexcept {
+#ifdef __linux__
+        // Returns at once if the producer has already cleared parked_
+        ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&parked_), FUTEX_WAIT_PRIVATE,
+                  1u, nullptr, nullptr, 0);
+#else
+        std::this_thread::yield();
+#endif
+    }
+    void wake() noexcept {
+#ifdef __linux__
+        ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&parked_), FUTEX_WAKE_PRIVATE,
+                  1, nullptr, nullptr, 0);
+#endif
+    }
+
+    static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t));
+
+    // See Fifo3 for why std::hardware_destructive_interference_size is not used
+    static constexpr auto hardware_destructive_interference_size = std::size_t{64};
+
+    /// Written by the consumer, read by the producer on every notify()
+    alignas(hardware_destructive_interference_size) std::atomic<std::uint32_t> parked_{0};
+    std::atomic<std::uint64_t> wakes_{0};
+
+    /// Consumer-only state
+    alignas(hardware_destructive_interference_size) unsigned spinRounds_;
+    unsigned rounds_ = 0;
+    std::uint64_t parks_ = 0;
+};
+
+
+/// Pop one object, waiting with `wait` while the fifo is empty
+template<typename Fifo, typename Wait>
+void pop_wait(Fifo& fifo, typename Fifo::value_type& value, Wait& wait) {
+    while (not fifo.pop(value)) {
+        wait.idle([&] { return not fifo.empty(); });
+    }
+    wait.reset();
+}
+
+/// Push one object and wake the consumer if it is parked.
+/// @return `true` if the operation is successful; `false` if fifo is full.
+template<typename Fifo, typename Wait>
+bool push_notify(Fifo& fifo, typename Fifo::value_type const& value, Wait& wait) {
+    if (not fifo.push(value)) {
+        return false;
+    }
+    wait.notify();
+    return true;
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+// Epoch-based reclamation for lock-free structures.
+//
+// A thread reads shared nodes only inside an EpochGuard, which announces
+// the global epoch it started in. A node that has been unlinked is
+// retire()d with the epoch current at that time. The global epoch moves
+// on only once every thread inside a guard has announced it, so when it
+// is two ahead of a node's epoch no guard can still be holding that node
+// and it is reclaimed.
+//
+// Reads cost one store and a fence per outermost guard, nothing per node.
+// The price is that one thread stalled inside a guard holds back all
+// reclamation; hazard pointers bound that, at a fence per node visited.
+namespace ebr {
+
+using Reclaim = void (*)(void*);
+
+class Domain {
+public:
+    static constexpr std::size_t kMaxThreads = 256;
+    static constexpr std::size_t kScanEvery = 64;
+
+    static Domain& instance() {
+        static Domain domain;
+        return domain;
+    }
+
+    void enter() {
+        ThreadState& self = local();
+        if (self.depth++ == 0) {
+            uint64_t epoch = epoch_.load(std::memory_order_acquire);
+            self.record->state.store(epoch << 1 | 1, std::memory_order_relaxed);
+            // Pairs with the fence in try_advance(): either the advancing
+            // thread sees this announcement, or this thread sees its epoch
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+    }
+
+    void exit() {
+        ThreadState& self = local();
+        if (--self.depth == 0) {
+            self.record->state.store(0, std::memory_order_release);
+        }
+    }
+
+    // Hand over a node that is no longer reachable from the structure
+    void retire(void* node, Reclaim reclaim) {
+        ThreadState& self = local();
+        self.retired.push_back(Retired{node, reclaim, epoch_.load(std::memory_order_acquire)});
+        if (++self.since_scan >= kScanEvery) {
+            self.since_scan = 0;
+            collect(self);
+        }
+    }
+
+    uint64_t epoch() const { return epoch_.load(std::memory_order_relaxed); }
+
+    ~Domain() {
+        // Only exited threads are left; nobody can be inside a guard
+        for (const Retired& retired : orphans_) {
+            retired.reclaim(retired.node);
+        }
+    }
+
+private:
+    struct alignas(64) Record {
+        std::atomic<uint64_t> state{0};   // epoch << 1 | inside-a-guard
+        std::atomic<bool> in_use{false};
+    };
+
+    struct Retired {
+        void* node;
+        Reclaim reclaim;
+        uint64_t epoch;
+    };
+
+    struct ThreadState {
+        Domain& domain;
+        Record* record;
+        unsigned depth = 0;
+        std::size_t since_scan = 0;
+        std::vector<Retired> retired;   // Nondecreasing epochs
+
+        explicit ThreadState(Domain& d) : domain(d), record(d.acquire_record()) {}
+        ~ThreadState() {
+            // Whatever is still pending is finished by other threads
+            if (!retired.empty()) {
+                std::lock_guard<std::mutex> lock(domain.orphans_mutex_);
+                domain.orphans_.insert(domain.orphans_.end(), retired.begin(), retired.end());
+            }
+            record->state.store(0, std::memory_order_relaxed);
+            record->in_use.store(false, std::memory_order_release);
+        }
+    };
+
+    Domain() = default;
+
+    ThreadState& local() {
+        thread_local ThreadState state(*this);
+        return state;
+    }
+
+    Record* acquire_record() {
+        for (Record& record : records_) {
+            bool expected = false;
+            if (!record.in_use.load(std::memory_order_relaxed) &&
+                record.in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                return &record;
+            }
+        }
+        throw std::runtime_error("ebr: more than kMaxThreads threads");
+    }
+
+    // Move the global epoch on if every active thread has seen it
+    void try_advance() {
+        uint64_t epoch = epoch_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        for (const Record& record : records_) {
+            if (!record.in_use.load(std::memory_order_acquire)) {
+                continue;
+            }
+            uint64_t state = record.state.load(std::memory_order_acquire);
+            if ((state & 1) && (state >> 1) != epoch) {
+                return;
+            }
+        }
+        epoch_.compare_exchange_strong(epoch, epoch + 1, std::memory_order_acq_rel);
+    }
+
+    void collect(ThreadState& self) {
+        try_advance();
+        uint64_t epoch = epoch_.load(std::memory_order_acquire);
+        std::size_t done = 0;
+        while (done < self.retired.size() && self.retired[done].epoch + 2 <= epoch) {
+            self.retired[done].reclaim(self.retired[done].node);
+            ++done;
+        }
+        self.retired.erase(self.retired.begin(), self.retired.begin() + done);
+
+        // Exited threads' leftovers; skipped if another thread has them
+        std::unique_lock<std::mutex> lock(orphans_mutex_, std::try_to_lock);
+        if (lock.owns_lock() && !orphans_.empty()) {
+            std::vector<Retired> kept;
+            for (const Retired& retired : orphans_) {
+                if (retired.epoch + 2 <= epoch) {
+                    retired.reclaim(retired.node);
+                } else {
+                    kept.push_back(retired);
+                }
+            }
+            orphans_.swap(kept);
+        }
+    }
+
+    std::atomic<uint64_t> epoch_{0};
+    Record records_[kMaxThreads];
+
+    std::mutex orphans_mutex_;
+    std::vector<Retired> orphans_;
+};
+
+// Marks the calling thread as reading shared nodes; nests
+class EpochGuard {
+public:
+    EpochGuard() { Domain::instance().enter(); }
+    ~EpochGuard() { Domain::instance().exit(); }
+    EpochGuard(const EpochGuard&) = delete;
+    EpochGuard& operator=(const EpochGuard&) = delete;
+};
+
+template <typename T, void (*Release)(T*)>
+void retire(T* node) {
+    Domain::instance().retire(node, [](void* p) { Release(static_cast<T*>(p)); });
+}
+
+}  // namespace ebr
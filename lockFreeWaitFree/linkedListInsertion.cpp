@@ -1,41 +1,144 @@
-#include <atomic>
-#include <iostream>
-#include <thread>
+// LockFreeList demo, a concurrent self-check, and a benchmark against a
+// mutex-protected std::list for read-heavy and write-heavy mixes.
+//
+//   g++ -std=c++17 -O2 -pthread linkedListInsertion.cpp -o linkedListInsertion
+//   ./linkedListInsertion [--ops <per thread>] [--keys <range>]
+#include "lockFreeList.h"
 
-struct Node {
-    int value;
-    Node* next; // raw pointer is fine here
-    Node(int v) : value(v), next(nullptr) {}
-};
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
 
-class LockFreeList {
-    std::atomic<Node*> head;
+// The baseline: same sorted-set semantics under one lock
+class LockedList {
+    std::list<int> items;
+    mutable std::mutex mutex;
 
 public:
-    LockFreeList() : head(nullptr) {}
+    bool insert(int val) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = std::lower_bound(items.begin(), items.end(), val);
+        if (it != items.end() && *it == val) return false;
+        items.insert(it, val);
+        return true;
+    }
 
-    void insert(int val) {
-        Node* newNode = new Node(val);
-        Node* oldHead;
+    bool remove(int val) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = std::lower_bound(items.begin(), items.end(), val);
+        if (it == items.end() || *it != val) return false;
+        items.erase(it);
+        return true;
+    }
 
-        // try until CAS succeeds
-        do {
-            oldHead = head.load();
-            newNode->next = oldHead;
-        } while (!head.compare_exchange_strong(oldHead, newNode));
+    bool contains(int val) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = std::lower_bound(items.begin(), items.end(), val);
+        return it != items.end() && *it == val;
     }
+};
 
-    void print() {
-        Node* curr = head.load();
-        while (curr) {
-            std::cout << curr->value << " ";
-            curr = curr->next;
+// Threads insert and remove disjoint ranges while others read; every key a
+// thread inserted and did not remove must be there at the end
+void selfCheck() {
+    // Not assert(): the calls under test must run with NDEBUG too
+    auto expect = [](bool ok) {
+        if (!ok) {
+            std::fprintf(stderr, "self-check failed\n");
+            std::abort();
         }
-        std::cout << "\n";
+    };
+    LockFreeList list;
+    const int threads = 4;
+    const int perThread = 2000;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+            for (int round = 0; round < 5; round++) {
+                for (int i = 0; i < perThread; i++) expect(list.insert(t + i * threads));
+                for (int i = 0; i < perThread; i++) expect(!list.insert(t + i * threads));
+                for (int i = 0; i < perThread; i += 2) expect(list.remove(t + i * threads));
+                for (int i = 0; i < perThread; i++) expect(list.contains(t + i * threads) == (i % 2 == 1));
+                if (round < 4) {
+                    for (int i = 1; i < perThread; i += 2) expect(list.remove(t + i * threads));
+                }
+            }
+        });
+    }
+    std::thread reader([&]() {
+        for (int i = 0; i < 20000; i++) list.contains(i % (threads * perThread));
+    });
+    for (auto& w : workers) w.join();
+    reader.join();
+    expect(list.size() == static_cast<size_t>(threads * perThread / 2));
+    std::cout << "self-check ok, " << list.size() << " keys, epoch "
+              << ebr::Domain::instance().epoch() << "\n";
+}
+
+// Each thread does `ops` operations on random keys in [0, keys):
+// `readPercent` contains, the rest split evenly between insert and remove
+template <typename Set>
+double run(int threads, int readPercent, long ops, int keys) {
+    Set set;
+    for (int k = 0; k < keys; k += 2) set.insert(k);   // Start half full
+
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+            std::mt19937 rng(12345u + static_cast<unsigned>(t));
+            long hits = 0;
+            for (long i = 0; i < ops; i++) {
+                int key = static_cast<int>(rng() % static_cast<unsigned>(keys));
+                int pick = static_cast<int>(rng() % 100);
+                if (pick < readPercent) {
+                    hits += set.contains(key);
+                } else if (pick % 2 == 0) {
+                    hits += set.insert(key);
+                } else {
+                    hits += set.remove(key);
+                }
+            }
+            if (hits < 0) std::abort();   // Keeps the loop from being optimized out
+        });
+    }
+    for (auto& w : workers) w.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return static_cast<double>(threads) * static_cast<double>(ops) / seconds;
+}
+
+void benchmark(long ops, int keys) {
+    std::printf("%ld ops per thread, keys in [0, %d)\n", ops, keys);
+    std::printf("%-12s %8s %16s %16s\n", "mix", "threads", "LockFreeList", "mutex std::list");
+    struct Mix {
+        const char* name;
+        int readPercent;
+    };
+    for (Mix mix : {Mix{"read-heavy", 90}, Mix{"write-heavy", 10}}) {
+        for (int threads : {1, 2, 4, 8}) {
+            double lockFree = run<LockFreeList>(threads, mix.readPercent, ops, keys);
+            double locked = run<LockedList>(threads, mix.readPercent, ops, keys);
+            std::printf("%-12s %8d %13.2fM/s %13.2fM/s\n", mix.name, threads, lockFree / 1e6,
+                        locked / 1e6);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    long ops = 200000;
+    int keys = 1024;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (std::strcmp(argv[i], "--ops") == 0) ops = std::atol(argv[++i]);
+        else if (std::strcmp(argv[i], "--keys") == 0) keys = std::atoi(argv[++i]);
     }
-};
 
-int main() {
     LockFreeList list;
 
     std::thread t1([&]() {
@@ -50,5 +153,7 @@ int main() {
     t2.join();
 
     list.print();
-}
 
+    selfCheck();
+    benchmark(ops, keys);
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include "epochReclamation.h"
+#include "nodePool.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+// Sorted lock-free set of ints (Harris's list, with Michael's unlinking).
+//
+// remove() is two steps. It first sets the low bit of the victim's next
+// pointer, which marks the node deleted and stops any insert after it, and
+// then CASes it out of its predecessor. Any thread whose search walks
+// over a marked node does that second step itself, so a remover that is
+// preempted never blocks the others. The thread whose unlink CAS succeeds
+// retires the node to the epoch domain; nodes come from and go back to the
+// calling thread's NodePool.
+//
+// insert() and remove() are lock-free; contains() only reads and is
+// wait-free apart from the list length.
+class LockFreeList {
+public:
+    LockFreeList() : head(nullptr) {}
+    LockFreeList(const LockFreeList&) = delete;
+    LockFreeList& operator=(const LockFreeList&) = delete;
+
+    // Not concurrent with anything else
+    ~LockFreeList() {
+        Node* curr = head.load(std::memory_order_relaxed);
+        while (curr) {
+            Node* next = unmarked(curr->next.load(std::memory_order_relaxed));
+            NodePool<Node>::release(curr);
+            curr = next;
+        }
+    }
+
+    // Returns false if val was already in the set
+    bool insert(int val) {
+        ebr::EpochGuard guard;
+        // Allocated once, outside the contended loop
+        Node* newNode = nullptr;
+        while (true) {
+            Position pos = find(val);
+            if (pos.found) {
+                if (newNode) {
+                    NodePool<Node>::release(newNode);
+                }
+                return false;
+            }
+            if (!newNode) {
+                newNode = NodePool<Node>::make(val);
+            }
+            newNode->next.store(pos.curr, std::memory_order_relaxed);
+            Node* expected = pos.curr;
+            if (pos.prev->compare_exchange_strong(expected, newNode, std::memory_order_release,
+                                                  std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+    }
+
+    // Returns false if val was not in the set
+    bool remove(int val) {
+        ebr::EpochGuard guard;
+        while (true) {
+            Position pos = find(val);
+            if (!pos.found) {
+                return false;
+            }
+            Node* next = pos.curr->next.load(std::memory_order_acquire);
+            if (isMarked(next)) {
+                continue;   // Another remover got there first
+            }
+            // Logical delete: from here on the node is out of the set
+            if (!pos.curr->next.compare_exchange_strong(next, marked(next), std::memory_order_acq_rel,
+                                                       std::memory_order_relaxed)) {
+                continue;
+            }
+            Node* expected = pos.curr;
+            if (pos.prev->compare_exchange_strong(expected, next, std::memory_order_acq_rel,
+                                                  std::memory_order_relaxed)) {
+                retire(pos.curr);
+            } else {
+                find(val);   // Leaves the unlink to whoever walks over it
+            }
+            return true;
+        }
+    }
+
+    bool contains(int val) const {
+        ebr::EpochGuard guard;
+        Node* curr = head.load(std::memory_order_acquire);
+        while (curr && curr->value < val) {
+            curr = unmarked(curr->next.load(std::memory_order_acquire));
+        }
+        return curr && curr->value == val && !isMarked(curr->next.load(std::memory_order_acquire));
+    }
+
+    // Only meaningful while no other thread is writing
+    std::size_t size() const {
+        ebr::EpochGuard guard;
+        std::size_t count = 0;
+        for (Node* curr = head.load(std::memory_order_acquire); curr;
+             curr = unmarked(curr->next.load(std::memory_order_acquire))) {
+            count += !isMarked(curr->next.load(std::memory_order_relaxed));
+        }
+        return count;
+    }
+
+    void print() const {
+        ebr::EpochGuard guard;
+        for (Node* curr = head.load(std::memory_order_acquire); curr;
+             curr = unmarked(curr->next.load(std::memory_order_acquire))) {
+            if (!isMarked(curr->next.load(std::memory_order_relaxed))) {
+                std::cout << curr->value << " ";
+            }
+        }
+        std::cout << "\n";
+    }
+
+private:
+    struct Node {
+        int value;
+        std::atomic<Node*> next;   // Low bit set: this node is deleted
+        explicit Node(int v) : value(v), next(nullptr) {}
+    };
+    static_assert(alignof(Node) >= 2, "the low pointer bit is the mark");
+
+    // Where val is, or would go: *prev == curr and prev's node is unmarked
+    struct Position {
+        std::atomic<Node*>* prev;
+        Node* curr;
+        bool found;
+    };
+
+    static bool isMarked(Node* p) { return reinterpret_cast<std::uintptr_t>(p) & 1; }
+    static Node* marked(Node* p) {
+        return reinterpret_cast<Node*>(reinterpret_cast<std::uintptr_t>(p) | 1);
+    }
+    static Node* unmarked(Node* p) {
+        return reinterpret_cast<Node*>(reinterpret_cast<std::uintptr_t>(p) & ~std::uintptr_t{1});
+    }
+
+    static void retire(Node* node) { ebr::retire<Node, &NodePool<Node>::release>(node); }
+
+    // Walk to the first node >= val, unlinking marked nodes on the way.
+    // Caller holds an EpochGuard.
+    Position find(int val) {
+    retry:
+        std::atomic<Node*>* prev = &head;
+        Node* curr = prev->load(std::memory_order_acquire);
+        while (curr) {
+            Node* next = curr->next.load(std::memory_order_acquire);
+            if (isMarked(next)) {
+                Node* expected = curr;
+                if (!prev->compare_exchange_strong(expected, unmarked(next), std::memory_order_acq_rel,
+                                                   std::memory_order_relaxed)) {
+                    goto retry;   // prev changed or was itself marked
+                }
+                retire(curr);
+                curr = unmarked(next);
+                continue;
+            }
+            if (curr->value >= val) {
+                return Position{prev, curr, curr->value == val};
+            }
+            prev = &curr->next;
+            curr = next;
+        }
+        return Position{prev, nullptr, false};
+    }
+
+    std::atomic<Node*> head;
+};
@@ -0,0 +1,367 @@
+#pragma once
+
+#include "epochReclamation.h"
+#include "nodePool.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <tuple>
+#include <utility>
+
+// Lock-free ordered map (Fraser's skiplist, as in Herlihy & Shavit), with
+// the subset of std::map's interface that BookSide uses, so it can stand
+// in for the tree of price levels.
+//
+// Each level is a LockFreeList: a node is removed by marking its next
+// pointers top-down, and the level-0 mark is what takes it out of the map.
+// Searches unlink marked nodes they walk over. Inserts link level 0 first
+// and the upper levels afterwards, so a node can be marked while its
+// inserter is still linking it; each node therefore counts two owners,
+// the inserter and the map, and whichever lets go last makes sure the node
+// is off every level and retires it to the epoch domain.
+//
+// try_emplace, erase and for_each may run on any number of threads.
+// Iterators, find and the bounds only read; with more than one writer the
+// caller holds an ebr::EpochGuard for as long as it uses what they return.
+// With a single writer (as in BookSide) only that thread retires nodes, so
+// it needs no guard of its own.
+template <typename Key, typename Value, typename Compare = std::less<Key>>
+class LockFreeSkipList {
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using value_type = std::pair<const Key, Value>;
+    using size_type = std::size_t;
+
+    static constexpr int kMaxHeight = 16;
+
+private:
+    struct Node {
+        value_type entry;
+        int height;
+        std::atomic<uint32_t> owners{2};    // The inserter and the map
+        std::atomic<Node*> next[kMaxHeight];  // Low bit set: deleted at that level
+
+        template <typename... Args>
+        Node(int h, const Key& key, Args&&... args)
+            : entry(std::piecewise_construct, std::forward_as_tuple(key),
+                    std::forward_as_tuple(std::forward<Args>(args)...)),
+              height(h) {
+            for (auto& link : next) link.store(nullptr, std::memory_order_relaxed);
+        }
+    };
+    static_assert(alignof(Node) >= 2, "the low pointer bit is the mark");
+
+public:
+    template <bool IsConst>
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = LockFreeSkipList::value_type;
+        using difference_type = std::ptrdiff_t;
+        using reference = std::conditional_t<IsConst, const value_type&, value_type&>;
+        using pointer = std::conditional_t<IsConst, const value_type*, value_type*>;
+
+        Iterator() = default;
+        template <bool C = IsConst, typename = std::enable_if_t<C>>
+        Iterator(const Iterator<false>& other) : node(other.node) {}
+
+        reference operator*() const { return node->entry; }
+        pointer operator->() const { return &node->entry; }
+        Iterator& operator++() {
+            node = liveFrom(unmarked(node->next[0].load(std::memory_order_acquire)));
+            return *this;
+        }
+        bool operator==(const Iterator& other) const { return node == other.node; }
+        bool operator!=(const Iterator& other) const { return node != other.node; }
+
+    private:
+        friend class LockFreeSkipList;
+        explicit Iterator(Node* n) : node(n) {}
+        Node* node = nullptr;
+    };
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    LockFreeSkipList() {
+        for (auto& link : head) link.store(nullptr, std::memory_order_relaxed);
+    }
+    LockFreeSkipList(const LockFreeSkipList&) = delete;
+    LockFreeSkipList& operator=(const LockFreeSkipList&) = delete;
+
+    // Not concurrent with anything else. Nodes still on level 0 were never
+    // erased; erased ones are off every level and belong to the epoch domain.
+    ~LockFreeSkipList() {
+        Node* curr = unmarked(head[0].load(std::memory_order_relaxed));
+        while (curr) {
+            Node* next = unmarked(curr->next[0].load(std::memory_order_relaxed));
+            NodePool<Node>::release(curr);
+            curr = next;
+        }
+    }
+
+    // Best (first in Compare order) live entry first
+    iterator begin() { return iterator(nextLive(nullptr)); }
+    const_iterator begin() const { return const_iterator(nextLive(nullptr)); }
+    iterator end() { return iterator(); }
+    const_iterator end() const { return const_iterator(); }
+    bool empty() const { return nextLive(nullptr) == nullptr; }
+
+    // Walks level 0; exact only while nobody is writing
+    size_type size() const {
+        size_type count = 0;
+        for (Node* n = nextLive(nullptr); n; n = nextLive(n)) ++count;
+        return count;
+    }
+
+    iterator find(const Key& key) { return iterator(findNode(key)); }
+    const_iterator find(const Key& key) const { return const_iterator(findNode(key)); }
+    iterator lower_bound(const Key& key) { return iterator(seek(key, true)); }
+    const_iterator lower_bound(const Key& key) const { return const_iterator(seek(key, true)); }
+    iterator upper_bound(const Key& key) { return iterator(seek(key, false)); }
+    const_iterator upper_bound(const Key& key) const { return const_iterator(seek(key, false)); }
+
+    // Value is built from args only if key is absent
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args) {
+        ebr::EpochGuard guard;
+        Node* preds[kMaxHeight];
+        Node* succs[kMaxHeight];
+        Node* node = nullptr;
+        while (true) {
+            if (locate(key, preds, succs)) {
+                if (node) NodePool<Node>::release(node);   // Never published
+                return {iterator(succs[0]), false};
+            }
+            if (!node) node = NodePool<Node>::make(randomHeight(), key, std::forward<Args>(args)...);
+            for (int l = 0; l < node->height; ++l) {
+                node->next[l].store(succs[l], std::memory_order_relaxed);
+            }
+            Node* expected = succs[0];
+            if (link(preds[0], 0).compare_exchange_strong(expected, node, std::memory_order_acq_rel,
+                                                          std::memory_order_relaxed)) {
+                break;
+            }
+        }
+
+        // In the map from here; the upper levels only speed up searches
+        for (int l = 1; l < node->height; ++l) {
+            while (true) {
+                Node* expected = succs[l];
+                if (link(preds[l], l).compare_exchange_strong(expected, node, std::memory_order_acq_rel,
+                                                              std::memory_order_relaxed)) {
+                    break;
+                }
+                locate(key, preds, succs);
+                if (succs[0] != node) goto linked;   // Erased meanwhile
+                Node* old = node->next[l].load(std::memory_order_acquire);
+                if (isMarked(old) ||
+                    (old != succs[l] &&
+                     !node->next[l].compare_exchange_strong(old, succs[l], std::memory_order_acq_rel,
+                                                            std::memory_order_relaxed))) {
+                    goto linked;
+                }
+            }
+        }
+    linked:
+        iterator result(node);
+        letGo(node);
+        return {result, true};
+    }
+
+    template <typename V>
+    std::pair<iterator, bool> emplace(const Key& key, V&& value) {
+        return try_emplace(key, std::forward<V>(value));
+    }
+
+    // No use for the hint: every insert searches from the top
+    template <typename V>
+    iterator emplace_hint(const_iterator, const Key& key, V&& value) {
+        return try_emplace(key, std::forward<V>(value)).first;
+    }
+
+    size_type erase(const Key& key) {
+        ebr::EpochGuard guard;
+        Node* preds[kMaxHeight];
+        Node* succs[kMaxHeight];
+        if (!locate(key, preds, succs)) {
+            return 0;
+        }
+        Node* victim = succs[0];
+        for (int l = victim->height - 1; l >= 1; --l) {
+            Node* succ = victim->next[l].load(std::memory_order_acquire);
+            while (!isMarked(succ) &&
+                   !victim->next[l].compare_exchange_weak(succ, marked(succ), std::memory_order_acq_rel,
+                                                          std::memory_order_acquire)) {
+            }
+        }
+        Node* succ = victim->next[0].load(std::memory_order_acquire);
+        while (true) {
+            if (isMarked(succ)) {
+                return 0;   // Another eraser took it out first
+            }
+            if (victim->next[0].compare_exchange_weak(succ, marked(succ), std::memory_order_acq_rel,
+                                                      std::memory_order_acquire)) {
+                break;
+            }
+        }
+        letGo(victim);   // Unlinks it, or leaves that to a still-linking inserter
+        return 1;
+    }
+
+    // Returns the entry after it
+    iterator erase(iterator it) {
+        iterator next = it;
+        ++next;
+        erase(it->first);
+        return next;
+    }
+
+    // Visit live entries best-first inside a guard; f(key, value) returns
+    // false to stop. Entries inserted or erased meanwhile may or may not
+    // be seen.
+    template <typename F>
+    void for_each(F&& f) const {
+        ebr::EpochGuard guard;
+        for (Node* n = nextLive(nullptr); n; n = nextLive(n)) {
+            if (!f(n->entry.first, n->entry.second)) return;
+        }
+    }
+
+private:
+    static bool isMarked(Node* p) { return reinterpret_cast<std::uintptr_t>(p) & 1; }
+    static Node* marked(Node* p) {
+        return reinterpret_cast<Node*>(reinterpret_cast<std::uintptr_t>(p) | 1);
+    }
+    static Node* unmarked(Node* p) {
+        return reinterpret_cast<Node*>(reinterpret_cast<std::uintptr_t>(p) & ~std::uintptr_t{1});
+    }
+
+    static bool less(const Key& a, const Key& b) { return Compare{}(a, b); }
+
+    // Next pointer at level l of pred, where nullptr is the head
+    std::atomic<Node*>& link(Node* pred, int l) const { return pred ? pred->next[l] : head[l]; }
+
+    // First node after pred (nullptr: the head) not deleted at level 0
+    Node* nextLive(Node* pred) const {
+        return liveFrom(unmarked(link(pred, 0).load(std::memory_order_acquire)));
+    }
+
+    static Node* liveFrom(Node* curr) {
+        while (curr) {
+            Node* succ = curr->next[0].load(std::memory_order_acquire);
+            if (!isMarked(succ)) return curr;
+            curr = unmarked(succ);
+        }
+        return nullptr;
+    }
+
+    // Read-only descent to the first live node at or after key (inclusive)
+    // or after it; deleted nodes are stepped over, not unlinked
+    Node* seek(const Key& key, bool inclusive) const {
+        Node* pred = nullptr;
+        Node* curr = nullptr;
+        for (int l = kMaxHeight - 1; l >= 0; --l) {
+            curr = unmarked(link(pred, l).load(std::memory_order_acquire));
+            while (curr) {
+                Node* succ = curr->next[l].load(std::memory_order_acquire);
+                if (isMarked(succ)) {
+                    curr = unmarked(succ);
+                } else if (inclusive ? less(curr->entry.first, key) : !less(key, curr->entry.first)) {
+                    pred = curr;
+                    curr = succ;
+                } else {
+                    break;
+                }
+            }
+        }
+        return curr;
+    }
+
+    Node* findNode(const Key& key) const {
+        Node* node = seek(key, true);
+        return node && !less(key, node->entry.first) ? node : nullptr;
+    }
+
+    // Fill preds/succs around key on every level, unlinking deleted nodes
+    // on the way. Returns whether succs[0] is a live node holding key.
+    bool locate(const Key& key, Node** preds, Node** succs) {
+    retry:
+        Node* pred = nullptr;
+        for (int l = kMaxHeight - 1; l >= 0; --l) {
+            Node* curr = unmarked(link(pred, l).load(std::memory_order_acquire));
+            while (curr) {
+                Node* succ = curr->next[l].load(std::memory_order_acquire);
+                if (isMarked(succ)) {
+                    Node* expected = curr;
+                    if (!link(pred, l).compare_exchange_strong(expected, unmarked(succ),
+                                                               std::memory_order_acq_rel,
+                                                               std::memory_order_relaxed)) {
+                        goto retry;   // pred changed or was itself deleted
+                    }
+                    curr = unmarked(succ);
+                } else if (less(curr->entry.first, key)) {
+                    pred = curr;
+                    curr = succ;
+                } else {
+                    break;
+                }
+            }
+            preds[l] = pred;
+            succs[l] = curr;
+        }
+        return succs[0] && !less(key, succs[0]->entry.first);
+    }
+
+    // Like locate(), but walks past nodes equal to key as well, so a
+    // deleted node that a newer one with the same key sits in front of is
+    // still unlinked. Only called for a node both owners are done with:
+    // it is marked on every level and nobody links it any more.
+    void unlinkAll(const Key& key) {
+    retry:
+        Node* below = nullptr;   // Last node before key on the level above
+        for (int l = kMaxHeight - 1; l >= 0; --l) {
+            Node* pred = below;
+            Node* curr = unmarked(link(pred, l).load(std::memory_order_acquire));
+            while (curr) {
+                Node* succ = curr->next[l].load(std::memory_order_acquire);
+                if (isMarked(succ)) {
+                    Node* expected = curr;
+                    if (!link(pred, l).compare_exchange_strong(expected, unmarked(succ),
+                                                               std::memory_order_acq_rel,
+                                                               std::memory_order_relaxed)) {
+                        goto retry;
+                    }
+                    curr = unmarked(succ);
+                } else if (!less(key, curr->entry.first)) {
+                    if (less(curr->entry.first, key)) below = curr;
+                    pred = curr;
+                    curr = succ;
+                } else {
+                    break;
+                }
+            }
+        }
+    }
+
+    void letGo(Node* node) {
+        if (node->owners.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            unlinkAll(node->entry.first);
+            ebr::retire<Node, &NodePool<Node>::release>(node);
+        }
+    }
+
+    // Geometric with p = 1/4: one in 4^k nodes reaches level k
+    static int randomHeight() {
+        thread_local uint64_t state = 0x9E3779B97F4A7C15ull ^ reinterpret_cast<std::uintptr_t>(&state);
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return 1 + __builtin_ctzll(state | (uint64_t{1} << (2 * kMaxHeight - 2))) / 2;
+    }
+
+    mutable std::atomic<Node*> head[kMaxHeight];
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Per-thread cache of node-sized blocks, so the hot path of a lock-free
+// structure never goes to the global allocator once it is warm.
+//
+// A node is released to the pool of whichever thread frees it, which under
+// epoch reclamation is often not the thread that made it; each cache is
+// capped so a thread that only frees does not hoard memory. Blocks over
+// the cap, and everything released after the thread's pool is torn down,
+// go straight back to operator delete.
+template <typename T>
+class NodePool {
+public:
+    static constexpr std::size_t kMaxCached = 4096;
+
+    template <typename... Args>
+    static T* make(Args&&... args) {
+        Cache& cache = local();
+        void* block;
+        if (!cache.blocks.empty()) {
+            block = cache.blocks.back();
+            cache.blocks.pop_back();
+        } else {
+            block = ::operator new(sizeof(T), std::align_val_t{alignof(T)});
+        }
+        return new (block) T(std::forward<Args>(args)...);
+    }
+
+    static void release(T* node) {
+        node->~T();
+        if (!torn_down) {
+            Cache& cache = local();
+            if (cache.blocks.size() < kMaxCached) {
+                cache.blocks.push_back(node);
+                return;
+            }
+        }
+        ::operator delete(node, std::align_val_t{alignof(T)});
+    }
+
+    // Blocks cached by the calling thread
+    static std::size_t cached() { return torn_down ? 0 : local().blocks.size(); }
+
+private:
+    struct Cache {
+        std::vector<void*> blocks;
+
+        Cache() { blocks.reserve(kMaxCached); }
+        ~Cache() {
+            torn_down = true;
+            for (void* block : blocks) {
+                ::operator delete(block, std::align_val_t{alignof(T)});
+            }
+        }
+    };
+
+    static Cache& local() {
+        thread_local Cache cache;
+        return cache;
+    }
+
+    // Trivially destructible, so still readable while the thread's other
+    // thread_locals are being destroyed
+    static inline thread_local bool torn_down = false;
+};
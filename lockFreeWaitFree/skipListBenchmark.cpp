@@ -0,0 +1,119 @@
+// LockFreeSkipList as a shared price-level index, against std::map behind
+// a mutex. Each thread inserts and removes levels at random tick prices and
+// routes against the index: a route walks the best five levels.
+//
+//   g++ -std=c++17 -O2 -pthread skipListBenchmark.cpp -o skipListBenchmark
+//   ./skipListBenchmark [--ops <per thread>] [--levels <price range>]
+#include "lockFreeSkipList.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+using Price = int64_t;
+
+// The baseline: the book's own level container under one lock
+class LockedMap {
+    std::map<Price, uint64_t, std::greater<Price>> levels;
+    mutable std::mutex mutex;
+
+public:
+    void insert(Price px, uint64_t qty) {
+        std::lock_guard<std::mutex> lock(mutex);
+        levels.try_emplace(px, qty);
+    }
+
+    void remove(Price px) {
+        std::lock_guard<std::mutex> lock(mutex);
+        levels.erase(px);
+    }
+
+    uint64_t route(int depth) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        uint64_t total = 0;
+        for (auto it = levels.begin(); it != levels.end() && depth-- > 0; ++it) total += it->second;
+        return total;
+    }
+};
+
+class SkipListIndex {
+    LockFreeSkipList<Price, std::atomic<uint64_t>, std::greater<Price>> levels;
+
+public:
+    void insert(Price px, uint64_t qty) { levels.try_emplace(px, qty); }
+    void remove(Price px) { levels.erase(px); }
+
+    uint64_t route(int depth) const {
+        uint64_t total = 0;
+        levels.for_each([&](Price, const std::atomic<uint64_t>& qty) {
+            total += qty.load(std::memory_order_relaxed);
+            return --depth > 0;
+        });
+        return total;
+    }
+};
+
+// `routePercent` of operations walk the top five levels; the rest insert
+// or remove a level, half each
+template <typename Index>
+double run(int threads, int routePercent, long ops, int levels) {
+    Index index;
+    for (int i = 0; i < levels; i += 2) index.insert(100000 + i, 100);   // Start half full
+
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+            std::mt19937 rng(777u + static_cast<unsigned>(t));
+            uint64_t sum = 0;
+            for (long i = 0; i < ops; i++) {
+                Price px = 100000 + static_cast<Price>(rng() % static_cast<unsigned>(levels));
+                int pick = static_cast<int>(rng() % 100);
+                if (pick < routePercent) {
+                    sum += index.route(5);
+                } else if (pick % 2 == 0) {
+                    index.insert(px, 100);
+                } else {
+                    index.remove(px);
+                }
+            }
+            if (sum == 1) std::abort();   // Keeps the loop from being optimized out
+        });
+    }
+    for (auto& w : workers) w.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return static_cast<double>(threads) * static_cast<double>(ops) / seconds;
+}
+
+int main(int argc, char** argv) {
+    long ops = 500000;
+    int levels = 2000;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (std::strcmp(argv[i], "--ops") == 0) ops = std::atol(argv[++i]);
+        else if (std::strcmp(argv[i], "--levels") == 0) levels = std::atoi(argv[++i]);
+    }
+
+    std::printf("%ld ops per thread, prices in [100000, %d)\n", ops, 100000 + levels);
+    std::printf("%-13s %8s %16s %16s\n", "mix", "threads", "LockFreeSkipList", "mutex std::map");
+    struct Mix {
+        const char* name;
+        int routePercent;
+    };
+    for (Mix mix : {Mix{"route-heavy", 90}, Mix{"update-heavy", 10}}) {
+        for (int threads : {1, 2, 4, 8}) {
+            double lockFree = run<SkipListIndex>(threads, mix.routePercent, ops, levels);
+            double locked = run<LockedMap>(threads, mix.routePercent, ops, levels);
+            std::printf("%-13s %8d %13.2fM/s %13.2fM/s\n", mix.name, threads, lockFree / 1e6,
+                        locked / 1e6);
+        }
+    }
+}
@@ -0,0 +1,237 @@
+// Allocator benchmark: the thread-local slab allocator against malloc and
+// the standard pmr pool resources under the book's allocation patterns:
+// level-map churn, a live set of mixed node sizes, blocks handed to another
+// thread to free, and whole order-book sessions. Run it under
+// LD_PRELOAD=<libjemalloc.so / libtcmalloc.so> to make the malloc rows that
+// allocator instead.
+//
+//   allocator_benchmark [--ops <count>] [--cpus <producer>,<consumer>]
+#include "latency_histogram.h"
+#include "slab_allocator.h"
+#include "tsc_clock.h"
+#include "workload.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <pthread.h>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+void pin_to(int cpu) {
+    if (cpu < 0) {
+        return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void report(const char* label, size_t ops, double seconds) {
+    std::cout << "  " << label << ": " << seconds * 1e9 / static_cast<double>(ops)
+              << " ns/op (" << static_cast<double>(ops) / seconds / 1e6 << " M ops/s)\n";
+}
+
+struct MallocBackend {
+    static constexpr const char* kName = "malloc";
+    void* allocate(size_t bytes, size_t) { return std::malloc(bytes); }
+    void deallocate(void* p, size_t, size_t) { std::free(p); }
+};
+
+struct SlabBackend {
+    static constexpr const char* kName = "slab";
+    void* allocate(size_t bytes, size_t alignment) {
+        return SlabHeap::local().allocate(bytes, alignment);
+    }
+    void deallocate(void* p, size_t bytes, size_t alignment) {
+        SlabHeap::deallocate(p, bytes, alignment);
+    }
+};
+
+// Size-class pools in the standard library (single-threaded variant)
+struct PoolBackend {
+    static constexpr const char* kName = "pmr pool";
+    std::pmr::unsynchronized_pool_resource pool;
+    void* allocate(size_t bytes, size_t alignment) { return pool.allocate(bytes, alignment); }
+    void deallocate(void* p, size_t bytes, size_t alignment) {
+        pool.deallocate(p, bytes, alignment);
+    }
+};
+
+// A price level's worth of payload, the size of a std::map node's value
+struct LevelPayload {
+    uint64_t total_quantity;
+    uint64_t order_count;
+    void* head;
+    void* tail;
+};
+
+// Insert/erase around a drifting mid, as levels appear and empty out
+template<typename Map>
+void level_churn(const char* label, Map& levels, size_t ops) {
+    std::mt19937_64 rng(7);
+    Price mid = 100000;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < ops; ++i) {
+        if (rng() % 16 == 0) {
+            mid += static_cast<Price>(rng() % 5) - 2;
+        }
+        Price price = mid + static_cast<Price>(rng() % 512) - 256;
+        auto it = levels.find(price);
+        if (it == levels.end()) {
+            levels.emplace(price, LevelPayload{1, 1, nullptr, nullptr});
+        } else {
+            levels.erase(it);
+        }
+    }
+    report(label, ops, seconds_since(start));
+}
+
+// Random frees from a live set of node-sized blocks; every allocation timed
+template<typename Backend>
+void mixed_sizes(Backend& backend, size_t ops) {
+    static constexpr size_t kSizes[] = {24, 32, 48, 48, 64, 64, 64, 96, 128, 256};
+    constexpr size_t kLive = 1 << 16;
+    std::mt19937_64 rng(11);
+    std::vector<std::pair<void*, size_t>> live(kLive);
+    for (auto& [p, bytes] : live) {
+        bytes = kSizes[rng() % std::size(kSizes)];
+        p = backend.allocate(bytes, 8);
+    }
+    const TscClock& clock = TscClock::instance();
+    LatencyHistogram latency;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < ops; ++i) {
+        auto& [p, bytes] = live[rng() % kLive];
+        backend.deallocate(p, bytes, 8);
+        bytes = kSizes[rng() % std::size(kSizes)];
+        uint64_t t0 = tsc::now();
+        p = backend.allocate(bytes, 8);
+        latency.record(clock.to_ns(tsc::now() - t0));
+        std::memset(p, 0, 8);
+    }
+    double seconds = seconds_since(start);
+    for (auto& [p, bytes] : live) {
+        backend.deallocate(p, bytes, 8);
+    }
+    std::string label = std::string(Backend::kName) + " free+alloc";
+    report(label.c_str(), ops, seconds);
+    latency.print(std::cout, (std::string("  ") + Backend::kName + " alloc").c_str());
+}
+
+// Producer allocates, consumer frees: the feed-to-book message pattern
+template<typename Backend>
+void cross_thread(Backend& backend, size_t ops, int producer_cpu, int consumer_cpu) {
+    Fifo3<void*, std::allocator<void*>, true> queue(4096);
+    auto start = std::chrono::steady_clock::now();
+    std::thread consumer([&] {
+        pin_to(consumer_cpu);
+        void* p = nullptr;
+        for (size_t i = 0; i < ops; ++i) {
+            while (!queue.pop(p)) {}
+            backend.deallocate(p, 64, 8);
+        }
+    });
+    pin_to(producer_cpu);
+    for (size_t i = 0; i < ops; ++i) {
+        void* p = backend.allocate(64, 8);
+        std::memset(p, 1, 64);
+        while (!queue.push(p)) {}
+    }
+    consumer.join();
+    std::string label = std::string(Backend::kName) + " alloc -> other thread frees";
+    report(label.c_str(), ops, seconds_since(start));
+}
+
+// Whole sessions: build a book, run the flow, destroy it
+void book_sessions(const char* label, std::pmr::memory_resource* resource,
+                   const std::vector<Command>& flow, int sessions) {
+    auto start = std::chrono::steady_clock::now();
+    for (int s = 0; s < sessions; ++s) {
+        OrderBookConfig config{TickSize{}, 0};
+        config.expected_orders = 1024;   // Let the index and pool grow during the session
+        config.far_band_ticks = 32;      // Far levels allocate per level and per arrival
+        config.memory_resource = resource;
+        OrderBook book(config);
+        book.apply_batch(flow.data(), flow.size());
+    }
+    report(label, flow.size() * static_cast<size_t>(sessions), seconds_since(start));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t ops = 5000000;
+    int producer_cpu = -1, consumer_cpu = -1;
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], "--ops") == 0) {
+            ops = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--cpus") == 0) {
+            char* end = nullptr;
+            producer_cpu = static_cast<int>(std::strtol(argv[++i], &end, 10));
+            if (*end == ',') {
+                consumer_cpu = static_cast<int>(std::strtol(end + 1, &end, 10));
+            }
+        }
+    }
+
+    std::cout << "=== Level map churn (" << ops << " insert/erase) ===\n";
+    {
+        std::map<Price, LevelPayload> heap;
+        level_churn("std::allocator", heap, ops);
+        std::map<Price, LevelPayload, std::less<Price>,
+                 SlabAllocator<std::pair<const Price, LevelPayload>>> slab;
+        level_churn("SlabAllocator", slab, ops);
+        std::pmr::unsynchronized_pool_resource pool;
+        std::pmr::map<Price, LevelPayload> pooled(&pool);
+        level_churn("pmr pool", pooled, ops);
+    }
+
+    std::cout << "\n=== Mixed node sizes, 64K live ===\n";
+    {
+        MallocBackend malloc_backend;
+        mixed_sizes(malloc_backend, ops);
+        SlabBackend slab_backend;
+        mixed_sizes(slab_backend, ops);
+        PoolBackend pool_backend;
+        mixed_sizes(pool_backend, ops);
+    }
+
+    std::cout << "\n=== Cross-thread free (64-byte blocks) ===\n";
+    {
+        MallocBackend malloc_backend;
+        cross_thread(malloc_backend, ops, producer_cpu, consumer_cpu);
+        SlabBackend slab_backend;
+        cross_thread(slab_backend, ops, producer_cpu, consumer_cpu);
+    }
+
+    std::cout << "\n=== Order book sessions (depth-limited, growing index) ===\n";
+    {
+        WorkloadConfig workload;
+        workload.max_offset = 200;
+        workload.mid_step_probability = 0.1;
+        WorkloadGenerator generator(workload);
+        std::vector<Command> flow;
+        generator.prefill(5000, flow);
+        generator.generate(ops / 10, flow);
+        book_sessions("new/delete", std::pmr::new_delete_resource(), flow, 5);
+        book_sessions("SlabResource", SlabResource::instance(), flow, 5);
+        std::pmr::unsynchronized_pool_resource pool;
+        book_sessions("pmr pool", &pool, flow, 5);
+    }
+
+    SlabHeap::Stats stats = SlabHeap::local().stats();
+    std::cout << "\nslab heap: " << stats.mapped_bytes / (1 << 20) << " MiB mapped, "
+              << stats.live_blocks() << " live blocks, NUMA node " << stats.numa_node << "\n";
+    return 0;
+}
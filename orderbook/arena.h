@@ -0,0 +1,205 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <utility>
+
+// Bump allocator over a chain of chunks, for memory that dies together
+// (one session's book, one request's scratch). allocate() rounds the
+// cursor up to the requested alignment and advances it; nothing is freed
+// individually. mark() / rewind() (or an ArenaScope) drop everything
+// allocated since a point, and reset() drops everything, both in O(1):
+// the chunks stay chained and are reused by the next allocations. Chunks
+// come from `upstream`, growing geometrically from chunk_bytes; a request
+// larger than the next chunk gets a chunk of its own. Objects are not
+// destroyed, so only trivially destructible ones (or ones whose
+// destructors only free arena memory) belong here. Not thread-safe.
+class Arena {
+    struct Chunk {
+        Chunk* next;
+        size_t size;   // Usable bytes after the header
+        size_t used;
+        bool owned;    // From upstream; false for the caller's initial buffer
+
+        unsigned char* data() { return reinterpret_cast<unsigned char*>(this + 1); }
+    };
+
+public:
+    // Position to rewind to; only valid for the arena that made it
+    struct Marker {
+        Chunk* chunk;
+        size_t used;
+    };
+
+    explicit Arena(size_t chunk_bytes = 64 * 1024,
+                   std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        : upstream_(upstream), next_chunk_bytes_(std::max<size_t>(chunk_bytes, 256)) {}
+
+    // Serve from `buffer` first (e.g. a stack array or a MemoryRegion
+    // slice); it is never returned to upstream
+    Arena(void* buffer, size_t bytes, size_t chunk_bytes = 64 * 1024,
+          std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        : Arena(chunk_bytes, upstream) {
+        size_t skew = (alignof(Chunk) - reinterpret_cast<uintptr_t>(buffer) % alignof(Chunk)) %
+                      alignof(Chunk);
+        if (bytes > skew + sizeof(Chunk)) {
+            auto* chunk = reinterpret_cast<Chunk*>(static_cast<unsigned char*>(buffer) + skew);
+            *chunk = Chunk{nullptr, bytes - skew - sizeof(Chunk), 0, false};
+            first_ = current_ = last_ = chunk;
+        }
+    }
+
+    ~Arena() { release(); }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // Never null: throws std::bad_alloc if upstream does. alignment must be
+    // a power of two.
+    void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t)) {
+        if (current_) {
+            if (void* p = bump(current_, bytes, alignment)) {
+                return p;
+            }
+        }
+        return allocate_slow(bytes, alignment);
+    }
+
+    // Uninitialised storage for n objects of type T
+    template<typename T>
+    T* allocate_array(size_t n) {
+        return static_cast<T*>(allocate(n * sizeof(T), alignof(T)));
+    }
+
+    template<typename T, typename... Args>
+    T* create(Args&&... args) {
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    Marker mark() const { return Marker{current_, current_ ? current_->used : 0}; }
+
+    // Drop everything allocated after `marker`; later chunks are kept for reuse
+    void rewind(Marker marker) {
+        current_ = marker.chunk ? marker.chunk : first_;
+        if (current_) {
+            current_->used = marker.chunk ? marker.used : 0;
+        }
+    }
+
+    void reset() { rewind(Marker{nullptr, 0}); }
+
+    // Return every upstream chunk; the arena is empty (the initial buffer stays)
+    void release() {
+        Chunk* keep = nullptr;
+        for (Chunk* chunk = first_; chunk;) {
+            Chunk* next = chunk->next;
+            if (chunk->owned) {
+                upstream_->deallocate(chunk, sizeof(Chunk) + chunk->size, alignof(Chunk));
+            } else {
+                keep = chunk;
+                keep->next = nullptr;
+                keep->used = 0;
+            }
+            chunk = next;
+        }
+        first_ = current_ = last_ = keep;
+        reserved_ = 0;
+    }
+
+    // Bytes handed out (alignment padding included) up to the current chunk
+    size_t used() const {
+        size_t total = 0;
+        for (Chunk* chunk = first_; chunk; chunk = chunk->next) {
+            total += chunk->used;
+            if (chunk == current_) {
+                break;
+            }
+        }
+        return current_ ? total : 0;
+    }
+
+    size_t reserved() const { return reserved_; }   // Bytes obtained from upstream
+    size_t chunk_count() const {
+        size_t count = 0;
+        for (Chunk* chunk = first_; chunk; chunk = chunk->next) {
+            ++count;
+        }
+        return count;
+    }
+
+private:
+    static void* bump(Chunk* chunk, size_t bytes, size_t alignment) {
+        uintptr_t base = reinterpret_cast<uintptr_t>(chunk->data());
+        uintptr_t start = (base + chunk->used + alignment - 1) & ~(uintptr_t(alignment) - 1);
+        size_t offset = start - base;
+        if (offset > chunk->size || chunk->size - offset < bytes) {
+            return nullptr;
+        }
+        chunk->used = offset + bytes;
+        return reinterpret_cast<void*>(start);
+    }
+
+    // Move on to the next chained chunk that fits, or add one at the end
+    void* allocate_slow(size_t bytes, size_t alignment) {
+        for (Chunk* chunk = current_ ? current_->next : first_; chunk; chunk = chunk->next) {
+            chunk->used = 0;
+            current_ = chunk;
+            if (void* p = bump(chunk, bytes, alignment)) {
+                return p;
+            }
+        }
+        size_t size = std::max(next_chunk_bytes_, bytes + alignment);
+        void* memory = upstream_->allocate(sizeof(Chunk) + size, alignof(Chunk));
+        auto* chunk = new (memory) Chunk{nullptr, size, 0, true};
+        (last_ ? last_->next : first_) = chunk;
+        last_ = current_ = chunk;
+        reserved_ += sizeof(Chunk) + size;
+        next_chunk_bytes_ = std::min<size_t>(next_chunk_bytes_ * 2, kMaxChunkBytes);
+        return bump(chunk, bytes, alignment);
+    }
+
+    static constexpr size_t kMaxChunkBytes = size_t{64} << 20;
+
+    std::pmr::memory_resource* upstream_;
+    size_t next_chunk_bytes_;
+    Chunk* first_ = nullptr;
+    Chunk* current_ = nullptr;   // Allocations come from here
+    Chunk* last_ = nullptr;      // End of the chain
+    size_t reserved_ = 0;
+};
+
+// Rewinds its arena to where it was at construction
+class ArenaScope {
+public:
+    explicit ArenaScope(Arena& arena) : arena_(arena), marker_(arena.mark()) {}
+    ~ArenaScope() { arena_.rewind(marker_); }
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+private:
+    Arena& arena_;
+    Arena::Marker marker_;
+};
+
+// std::pmr adapter: pmr containers allocate from the arena, and their
+// deallocations are no-ops until the arena is reset or released
+class ArenaResource : public std::pmr::memory_resource {
+public:
+    explicit ArenaResource(Arena& arena) : arena_(arena) {}
+
+    Arena& arena() const { return arena_; }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        return arena_.allocate(bytes, alignment);
+    }
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    Arena& arena_;
+};
@@ -0,0 +1,123 @@
+// Scenario benchmark: synthetic flow from WorkloadGenerator against books
+// prefilled to increasing resting depth
+//
+//   benchmark [--max-depth <orders>] [--ops <count>] [--ladder <levels>] [--far-band <ticks>]
+//             [--pinned <0|1>]
+#include "workload.h"
+#include "latency_histogram.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+struct Scenario {
+    const char* name;
+    WorkloadMix mix;
+};
+
+// Cancel-dominated passive flow, add-heavy book building, and a taker-heavy tape
+const Scenario kScenarios[] = {
+    {"cancel-heavy", WorkloadMix{0.45, 0.45, 0.08, 0.02}},
+    {"balanced",     WorkloadMix{0.42, 0.38, 0.14, 0.06}},
+    {"aggressive",   WorkloadMix{0.30, 0.30, 0.15, 0.25}},
+};
+
+const size_t kDepths[] = {1000, 10000, 100000, 1000000, 10000000};
+
+void run_scenario(const Scenario& scenario, size_t depth, size_t ops, size_t ladder_levels,
+                  size_t far_band, bool pinned) {
+    WorkloadConfig workload;
+    workload.mix = scenario.mix;
+    // Long lifetimes scale with depth so the prefilled book does not drain
+    workload.long_lifetime = static_cast<double>(depth + ops);
+    WorkloadGenerator generator(workload);
+
+    std::vector<Command> prefill;
+    generator.prefill(depth, prefill);
+    std::vector<Command> commands;
+    generator.generate(ops, commands);
+
+    OrderBookConfig config;
+    config.tick_size = TickSize{0.01};
+    config.ladder_levels = ladder_levels;
+    config.far_band_ticks = far_band;
+    config.expected_orders = depth + ops;
+    config.pinned_memory = pinned;
+    OrderBook book(config);
+    book.apply_batch(prefill.data(), prefill.size());
+    std::vector<Command>().swap(prefill);
+    size_t resting_before = book.get_order_count();
+
+    LatencyHistogram latency[4];   // Indexed by CommandType
+    size_t succeeded = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const Command& command : commands) {
+        ScopedLatency scope(latency[static_cast<size_t>(command.type)]);
+        bool ok = false;
+        switch (command.type) {
+            case CommandType::Add:
+                ok = book.add_order(command.order);
+                break;
+            case CommandType::Cancel:
+                ok = book.cancel_order(command.order.order_id);
+                break;
+            case CommandType::Amend:
+                ok = book.amend_order(command.order.order_id, command.order.price,
+                                      command.order.quantity);
+                break;
+            case CommandType::Reduce:
+                ok = book.reduce_order(command.order.order_id, command.order.quantity);
+                break;
+        }
+        succeeded += ok;
+    }
+    double elapsed_s = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "--- " << scenario.name << ", depth " << depth << " ---\n";
+    std::cout << "  Throughput: " << static_cast<uint64_t>(ops / elapsed_s)
+              << " ops/sec (" << succeeded << "/" << ops << " applied, "
+              << "resting " << resting_before << " -> " << book.get_order_count() << ")\n";
+    latency[static_cast<size_t>(CommandType::Add)].print(std::cout, "add");
+    latency[static_cast<size_t>(CommandType::Cancel)].print(std::cout, "cancel");
+    latency[static_cast<size_t>(CommandType::Amend)].print(std::cout, "amend");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    // 10M resting orders needs several GB; opt in with --max-depth 10000000
+    size_t max_depth = 1000000;
+    size_t ops = 1000000;
+    size_t ladder_levels = 4096;
+    size_t far_band = 0;
+    bool pinned = false;
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], "--max-depth") == 0) {
+            max_depth = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--ops") == 0) {
+            ops = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--ladder") == 0) {
+            ladder_levels = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--far-band") == 0) {
+            far_band = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--pinned") == 0) {
+            pinned = std::strtoull(argv[++i], nullptr, 10) != 0;
+        }
+    }
+
+    std::cout << "=== Workload Benchmark (" << ops << " ops per scenario, ladder "
+              << ladder_levels << ", far band " << far_band
+              << (pinned ? ", pinned memory" : "") << ") ===\n";
+    for (size_t depth : kDepths) {
+        if (depth > max_depth) {
+            break;
+        }
+        for (const Scenario& scenario : kScenarios) {
+            run_scenario(scenario, depth, ops, ladder_levels, far_band, pinned);
+        }
+    }
+    return 0;
+}
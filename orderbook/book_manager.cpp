@@ -0,0 +1,206 @@
+#include "book_manager.h"
+#include <new>
+#include <stdexcept>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+// Commands popped and applied per worker iteration
+constexpr size_t kWorkerBurst = 64;
+
+// Empty polls before an idle worker starts yielding its core
+constexpr unsigned kSpinsBeforeYield = 1024;
+
+void pin_current_thread(int cpu) {
+#ifdef __linux__
+    if (cpu < 0) {
+        return;
+    }
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu, &cpuset);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+#else
+    (void)cpu;
+#endif
+}
+
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+} // namespace
+
+BookManager::BookManager(size_t max_instruments, const OrderBookConfig& book_config,
+                         size_t queue_capacity)
+    : book_config_(book_config),
+      books_(static_cast<BookSlot*>(::operator new(
+          max_instruments * sizeof(BookSlot), std::align_val_t{alignof(BookSlot)}))),
+      max_instruments_(max_instruments),
+      slots_(max_instruments),
+      owner_(max_instruments, 0),
+      queue_capacity_(queue_capacity) {}
+
+BookManager::~BookManager() {
+    stop_workers();
+    for (size_t i = 0; i < count_; ++i) {
+        books_[i].book()->~OrderBook();
+    }
+    ::operator delete(books_, std::align_val_t{alignof(BookSlot)});
+}
+
+bool BookManager::add_instrument(uint32_t instrument_id) {
+    if (running_.load(std::memory_order_relaxed)) {
+        throw std::logic_error("BookManager: add_instrument while workers run");
+    }
+    if (count_ == max_instruments_ || slots_.contains(instrument_id)) {
+        return false;
+    }
+    new (books_[count_].storage) OrderBook(book_config_);
+    slots_.insert(instrument_id, count_);
+    ++count_;
+    return true;
+}
+
+size_t BookManager::slot_of(uint32_t instrument_id) const {
+    const size_t* slot = slots_.find(instrument_id);
+    return slot ? *slot : kNoSlot;
+}
+
+OrderBook* BookManager::book(uint32_t instrument_id) {
+    size_t slot = slot_of(instrument_id);
+    return slot == kNoSlot ? nullptr : books_[slot].book();
+}
+
+bool BookManager::apply(const RoutedCommand& routed) {
+    OrderBook* target = book(routed.instrument_id);
+    return target && target->apply_batch(&routed.command, 1) == 1;
+}
+
+size_t BookManager::apply_batch(const RoutedCommand* commands, size_t count, bool* results) {
+    // Hand each run of same-instrument commands to the book as one batch
+    Command run[kWorkerBurst];
+    size_t succeeded = 0;
+    size_t i = 0;
+    while (i < count) {
+        uint32_t instrument_id = commands[i].instrument_id;
+        size_t n = 0;
+        while (i + n < count && n < kWorkerBurst && commands[i + n].instrument_id == instrument_id) {
+            run[n] = commands[i + n].command;
+            ++n;
+        }
+        OrderBook* target = book(instrument_id);
+        if (target) {
+            succeeded += target->apply_batch(run, n, results ? results + i : nullptr);
+        } else if (results) {
+            std::fill(results + i, results + i + n, false);
+        }
+        i += n;
+    }
+    return succeeded;
+}
+
+void BookManager::start_workers(const std::vector<WorkerConfig>& workers) {
+    if (running_.load(std::memory_order_relaxed) || workers.empty()) {
+        return;
+    }
+    for (size_t slot = 0; slot < count_; ++slot) {
+        owner_[slot] = static_cast<uint16_t>(slot % workers.size());
+    }
+    
+    running_.store(true, std::memory_order_release);
+    workers_.clear();
+    for (size_t w = 0; w < workers.size(); ++w) {
+        workers_.push_back(std::make_unique<Worker>(queue_capacity_));
+        workers_.back()->wait = workers[w].wait;
+    }
+    for (size_t w = 0; w < workers.size(); ++w) {
+        Worker& worker = *workers_[w];
+        int cpu = workers[w].cpu;
+        worker.thread = std::thread([this, &worker, cpu] { run_worker(worker, cpu); });
+    }
+}
+
+bool BookManager::submit(const RoutedCommand& command) {
+    // After stop_workers() the rings are kept but nobody drains them
+    if (!running_.load(std::memory_order_acquire)) {
+        return false;
+    }
+    size_t slot = slot_of(command.instrument_id);
+    if (slot == kNoSlot) {
+        return false;
+    }
+    Worker& worker = *workers_[owner_[slot]];
+    if (!worker.queue.push(command)) {
+        return false;
+    }
+    if (worker.wait == WorkerWait::Park) {
+        worker.park.notify();
+    }
+    return true;
+}
+
+void BookManager::stop_workers() {
+    if (!running_.exchange(false, std::memory_order_acq_rel)) {
+        return;
+    }
+    for (auto& worker : workers_) {
+        worker->park.notify();
+        worker->thread.join();
+    }
+}
+
+uint64_t BookManager::worker_processed(size_t worker) const {
+    return workers_[worker]->processed.load(std::memory_order_relaxed);
+}
+
+void BookManager::run_worker(Worker& worker, int cpu) {
+    pin_current_thread(cpu);
+    
+    RoutedCommand burst[kWorkerBurst];
+    unsigned idle_spins = 0;
+    while (true) {
+        size_t n = worker.queue.pop_n(burst, kWorkerBurst);
+        if (n == 0) {
+            // Exit only once stopped and fully drained
+            if (!running_.load(std::memory_order_acquire) && worker.queue.empty()) {
+                break;
+            }
+            idle(worker, idle_spins);
+            continue;
+        }
+        idle_spins = 0;
+        worker.park.reset();
+        apply_batch(burst, n);
+        worker.processed.store(worker.processed.load(std::memory_order_relaxed) + n,
+                               std::memory_order_relaxed);
+    }
+}
+
+void BookManager::idle(Worker& worker, unsigned& idle_spins) {
+    switch (worker.wait) {
+        case WorkerWait::Backoff:
+            // Spin briefly, then give the core back if it is oversubscribed
+            if (++idle_spins < kSpinsBeforeYield) {
+                cpu_relax();
+            } else {
+                std::this_thread::yield();
+            }
+            break;
+        case WorkerWait::Spin:
+            break;
+        case WorkerWait::Yield:
+            std::this_thread::yield();
+            break;
+        case WorkerWait::Park:
+            worker.park.idle([&] {
+                return !worker.queue.empty() || !running_.load(std::memory_order_relaxed);
+            });
+            break;
+    }
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include "order_book.h"
+#include "../SPSC_QUEUES/spsc_q3.cpp"
+#include "../SPSC_QUEUES/wait_strategy.cpp"
+#include <atomic>
+#include <new>
+#include <thread>
+
+// Command addressed to one instrument
+struct RoutedCommand {
+    uint32_t instrument_id = 0;
+    Command command{};
+};
+
+// How an idle worker waits on its empty ring
+enum class WorkerWait : uint8_t {
+    Backoff,   // Pause, then yield once idle for a while
+    Spin,      // Poll without pausing; keeps the core
+    Yield,     // Yield on every empty poll
+    Park,      // Sleep on a futex until submit() wakes it
+};
+
+// Worker thread placement; cpu < 0 leaves the thread unpinned
+struct WorkerConfig {
+    int cpu = -1;
+    WorkerWait wait = WorkerWait::Backoff;
+};
+
+// Owns many single-instrument books and routes commands by instrument ID.
+//
+// Books live in one pre-sized, cache-line aligned arena reserved when the
+// manager is built, so adding symbols never reallocates or moves a book.
+// Single-threaded callers use apply(); for multi-core operation,
+// start_workers() gives each worker thread a group of instruments and a
+// Fifo3 ring fed by submit(). Every book keeps exactly one writer: the
+// worker that owns it. submit() must be called from a single producer
+// thread (each ring is SPSC).
+class BookManager {
+public:
+    BookManager(size_t max_instruments, const OrderBookConfig& book_config = OrderBookConfig{},
+                size_t queue_capacity = 65536);
+    ~BookManager();
+
+    BookManager(const BookManager&) = delete;
+    BookManager& operator=(const BookManager&) = delete;
+
+    // Register an instrument; returns false if the arena is full or the ID exists
+    bool add_instrument(uint32_t instrument_id);
+    size_t instrument_count() const { return count_; }
+
+    // nullptr if unknown. Only safe to touch while workers are stopped
+    OrderBook* book(uint32_t instrument_id);
+
+    // Route on the calling thread (workers must not be running)
+    bool apply(const RoutedCommand& command);
+    size_t apply_batch(const RoutedCommand* commands, size_t count, bool* results = nullptr);
+
+    // Spread registered instruments round-robin over one thread per config
+    void start_workers(const std::vector<WorkerConfig>& workers);
+
+    // Enqueue for the owning worker; false if the ring is full, the ID is
+    // unknown or no workers are running (before start_workers() or after
+    // stop_workers()). Wakes the worker if it is parked
+    bool submit(const RoutedCommand& command);
+
+    // Drain every ring, then join the workers
+    void stop_workers();
+
+    // Commands applied by each worker so far
+    uint64_t worker_processed(size_t worker) const;
+
+private:
+    struct Worker {
+        explicit Worker(size_t capacity) : queue(capacity) {}
+        // Masked ring; the capacity is rounded up to a power of two
+        Fifo3<RoutedCommand, std::allocator<RoutedCommand>, true> queue;
+        WorkerWait wait = WorkerWait::Backoff;
+        ParkWait park;
+        std::thread thread;
+        alignas(64) std::atomic<uint64_t> processed{0};
+    };
+
+    void run_worker(Worker& worker, int cpu);
+    void idle(Worker& worker, unsigned& idle_spins);
+    size_t slot_of(uint32_t instrument_id) const;
+    static constexpr size_t kNoSlot = ~size_t{0};
+
+    // One book per cache-line multiple, so books owned by different workers
+    // never share a line at their boundary
+    struct alignas(64) BookSlot {
+        alignas(OrderBook) unsigned char storage[sizeof(OrderBook)];
+        OrderBook* book() { return std::launder(reinterpret_cast<OrderBook*>(storage)); }
+    };
+    static_assert(sizeof(BookSlot) % 64 == 0, "book slots must not share cache lines");
+
+    // Arena sized for max_instruments_ books; slots constructed on registration
+    OrderBookConfig book_config_;
+    BookSlot* books_;
+    size_t max_instruments_;
+    size_t count_ = 0;
+
+    // Instrument ID -> arena slot; slot -> owning worker
+    OrderIndex<size_t> slots_;
+    std::vector<uint16_t> owner_;
+
+    size_t queue_capacity_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<bool> running_{false};
+};
@@ -0,0 +1,302 @@
+#pragma once
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+#include "order_book.h"
+
+// MemoryPool for objects made on one thread and destroyed on another (e.g.
+// orders built on a gateway thread and retired by the book thread).
+//
+// Each thread works through its own Cache, which holds up to two
+// magazines: chains of up to MagazineSize free slots. construct() and
+// destroy() only touch the calling thread's cache. Only when a cache runs
+// dry does it take a full magazine from the pool's shared stack, and only
+// when both of its magazines are full does it push one back. So there is
+// one CAS per MagazineSize operations and no lock. The shared stack is a
+// Treiber stack whose top carries a 16-bit tag in the unused upper pointer
+// bits, bumped by every push and pop; a pop that raced with a
+// pop-reuse-push of the same magazine sees a different tag and retries
+// (ABA), without needing a double-width CAS. Fresh slots are carved
+// from blocks under a mutex, which is off the hot path once the pool is
+// warm. Blocks come from `region` while it has room, then from the heap,
+// and are freed only by the pool's destructor.
+template<typename T, size_t BlockSize = 4096, size_t MagazineSize = 64>
+class ConcurrentPool {
+    struct FreeSlot {
+        FreeSlot* next;                           // Within a magazine
+        std::atomic<uintptr_t> next_magazine;     // Within the shared stack
+        size_t count;                             // Slots in this magazine (head only)
+    };
+    static_assert(sizeof(T) >= sizeof(FreeSlot), "slot must fit the magazine links");
+    static_assert(MagazineSize > 0 && MagazineSize <= BlockSize, "magazine must fit a block");
+
+public:
+    // One thread's view of the pool. Not shared between threads; must not
+    // outlive the pool. Its slots go back to the shared stack on destruction.
+    class Cache {
+    public:
+        explicit Cache(ConcurrentPool& pool) : pool_(pool) {}
+        ~Cache() { flush(); }
+
+        Cache(const Cache&) = delete;
+        Cache& operator=(const Cache&) = delete;
+
+        template<typename... Args>
+        T* construct(Args&&... args) {
+            if (loaded_count_ == 0) {
+                refill();
+            }
+            FreeSlot* slot = loaded_;
+            loaded_ = slot->next;
+            --loaded_count_;
+            return new (slot) T(std::forward<Args>(args)...);
+        }
+
+        // ptr may have been made through any cache of the same pool
+        void destroy(T* ptr) {
+            ptr->~T();
+            if (loaded_count_ == MagazineSize) {
+                if (spare_count_ != 0) {
+                    pool_.push_magazine(spare_, spare_count_);
+                }
+                spare_ = loaded_;
+                spare_count_ = loaded_count_;
+                loaded_ = nullptr;
+                loaded_count_ = 0;
+            }
+            FreeSlot* slot = new (static_cast<void*>(ptr)) FreeSlot;
+            slot->next = loaded_;
+            loaded_ = slot;
+            ++loaded_count_;
+        }
+
+        // Hand every cached slot back to the shared stack
+        void flush() {
+            if (loaded_count_ != 0) {
+                pool_.push_magazine(loaded_, loaded_count_);
+            }
+            if (spare_count_ != 0) {
+                pool_.push_magazine(spare_, spare_count_);
+            }
+            loaded_ = spare_ = nullptr;
+            loaded_count_ = spare_count_ = 0;
+        }
+
+        size_t cached() const { return loaded_count_ + spare_count_; }
+
+    private:
+        void refill() {
+            if (spare_count_ != 0) {
+                std::swap(loaded_, spare_);
+                std::swap(loaded_count_, spare_count_);
+                return;
+            }
+            loaded_ = pool_.pop_magazine();
+            if (!loaded_) {
+                loaded_ = pool_.carve_magazine();
+            }
+            loaded_count_ = loaded_->count;
+        }
+
+        ConcurrentPool& pool_;
+        FreeSlot* loaded_ = nullptr;   // Served first
+        size_t loaded_count_ = 0;
+        FreeSlot* spare_ = nullptr;    // Empty, or a full magazine
+        size_t spare_count_ = 0;
+    };
+
+    explicit ConcurrentPool(MemoryRegion* region = nullptr) : region_(region) {}
+
+    // Every Cache must be gone
+    ~ConcurrentPool() {
+        for (auto block : blocks_) {
+            if (!region_ || !region_->owns(block)) {
+                ::operator delete(block);
+            }
+        }
+    }
+
+    ConcurrentPool(const ConcurrentPool&) = delete;
+    ConcurrentPool& operator=(const ConcurrentPool&) = delete;
+
+    // Pre-allocate blocks so at least `count` objects fit without allocating
+    void reserve(size_t count) {
+        std::lock_guard<std::mutex> lock(carve_mutex_);
+        while (blocks_.size() * BlockSize < count) {
+            blocks_.push_back(allocate());
+        }
+    }
+
+    // Bytes reserve(count) allocates, for sizing a MemoryRegion
+    static constexpr size_t bytes_for(size_t count) {
+        return (count + BlockSize - 1) / BlockSize * BlockSize * sizeof(T);
+    }
+
+    // live counts slots held by caches as well as constructed objects, and
+    // high_water is every slot ever carved; both are exact once all caches
+    // are flushed
+    PoolStats stats() const {
+        std::lock_guard<std::mutex> lock(carve_mutex_);
+        size_t carved = carved_.load(std::memory_order_relaxed);
+        return PoolStats{carved - stacked_.load(std::memory_order_relaxed), carved,
+                         blocks_.size() * BlockSize, blocks_.size()};
+    }
+
+private:
+    static constexpr unsigned kTagShift = 48;
+    static constexpr uintptr_t kPointerMask = (uintptr_t{1} << kTagShift) - 1;
+
+    static FreeSlot* pointer_of(uint64_t top) {
+        return reinterpret_cast<FreeSlot*>(static_cast<uintptr_t>(top) & kPointerMask);
+    }
+    static uint64_t tagged(FreeSlot* slot, uint64_t previous_top) {
+        uint64_t tag = (previous_top >> kTagShift) + 1;
+        return tag << kTagShift | reinterpret_cast<uintptr_t>(slot);
+    }
+
+    void push_magazine(FreeSlot* head, size_t count) {
+        assert((reinterpret_cast<uintptr_t>(head) & ~kPointerMask) == 0);
+        head->count = count;
+        stacked_.fetch_add(count, std::memory_order_relaxed);
+        uint64_t top = top_.load(std::memory_order_relaxed);
+        do {
+            head->next_magazine.store(reinterpret_cast<uintptr_t>(pointer_of(top)),
+                                      std::memory_order_relaxed);
+        } while (!top_.compare_exchange_weak(top, tagged(head, top), std::memory_order_release,
+                                             std::memory_order_relaxed));
+    }
+
+    FreeSlot* pop_magazine() {
+        uint64_t top = top_.load(std::memory_order_acquire);
+        while (FreeSlot* head = pointer_of(top)) {
+            // head may be popped and reused meanwhile; then this read is
+            // stale, but blocks are never unmapped and the tag check below fails
+            auto next = reinterpret_cast<FreeSlot*>(head->next_magazine.load(std::memory_order_relaxed));
+            if (top_.compare_exchange_weak(top, tagged(next, top), std::memory_order_acquire,
+                                           std::memory_order_acquire)) {
+                stacked_.fetch_sub(head->count, std::memory_order_relaxed);
+                return head;
+            }
+        }
+        return nullptr;
+    }
+
+    // A magazine of never-used slots; the only path that takes the lock
+    FreeSlot* carve_magazine() {
+        std::lock_guard<std::mutex> lock(carve_mutex_);
+        FreeSlot* head = nullptr;
+        for (size_t i = 0; i < MagazineSize; ++i) {
+            if (current_slot_ == BlockSize || current_block_ == nullptr) {
+                next_block();
+            }
+            FreeSlot* slot = new (static_cast<void*>(&current_block_[current_slot_++])) FreeSlot;
+            slot->next = head;
+            head = slot;
+        }
+        head->count = MagazineSize;
+        carved_.fetch_add(MagazineSize, std::memory_order_relaxed);
+        return head;
+    }
+
+    T* allocate() {
+        if (region_) {
+            if (void* block = region_->allocate(BlockSize * sizeof(T), alignof(T))) {
+                return static_cast<T*>(block);
+            }
+        }
+        return static_cast<T*>(::operator new(BlockSize * sizeof(T)));
+    }
+
+    // Advance to the next reserved block, allocating only when none is left
+    void next_block() {
+        if (current_block_ != nullptr) {
+            ++current_block_index_;
+        }
+        if (current_block_index_ == blocks_.size()) {
+            blocks_.push_back(allocate());
+        }
+        current_block_ = blocks_[current_block_index_];
+        current_slot_ = 0;
+    }
+
+    // Shared stack of full magazines: tag << 48 | head slot
+    std::atomic<uint64_t> top_{0};
+    std::atomic<size_t> stacked_{0};   // Slots in the shared stack
+    std::atomic<size_t> carved_{0};
+
+    // Carving state; only touched under carve_mutex_
+    mutable std::mutex carve_mutex_;
+    MemoryRegion* region_;
+    std::vector<T*> blocks_;
+    T* current_block_ = nullptr;
+    size_t current_block_index_ = 0;
+    size_t current_slot_ = 0;
+};
+
+// MemoryPool whose objects are built on one owner thread but may be
+// destroyed on any: destroy() runs the destructor in place and pushes the
+// slot onto a lock-free return stack, and the owner moves the whole stack
+// back onto the pool's free list when construct() finds it non-empty. Only
+// the owner pops (by taking the stack whole), so the push needs no ABA tag.
+// Suited to objects published by one thread and dropped by readers, like
+// shared book snapshots.
+template<typename T, size_t BlockSize = 4096>
+class SharedReturnPool {
+    struct ReturnedSlot {
+        ReturnedSlot* next;
+    };
+    static_assert(sizeof(T) >= sizeof(ReturnedSlot), "slot must fit the return link");
+
+public:
+    explicit SharedReturnPool(MemoryRegion* region = nullptr) : pool_(region) {}
+
+    // Every object must be back: ~SharedReturnPool takes in the return stack
+    ~SharedReturnPool() { collect(); }
+
+    SharedReturnPool(const SharedReturnPool&) = delete;
+    SharedReturnPool& operator=(const SharedReturnPool&) = delete;
+
+    // Owner thread only
+    template<typename... Args>
+    T* construct(Args&&... args) {
+        if (returned_.load(std::memory_order_relaxed)) {
+            collect();
+        }
+        return pool_.construct(std::forward<Args>(args)...);
+    }
+
+    // Any thread
+    void destroy(T* ptr) {
+        ptr->~T();
+        auto* slot = new (static_cast<void*>(ptr)) ReturnedSlot;
+        ReturnedSlot* head = returned_.load(std::memory_order_relaxed);
+        do {
+            slot->next = head;
+        } while (!returned_.compare_exchange_weak(head, slot, std::memory_order_release,
+                                                  std::memory_order_relaxed));
+    }
+
+    void reserve(size_t count) { pool_.reserve(count); }
+
+    // Owner thread only; live includes slots still on the return stack
+    PoolStats stats() const { return pool_.stats(); }
+
+    // Owner thread only: move returned slots back onto the free list
+    void collect() {
+        ReturnedSlot* slot = returned_.exchange(nullptr, std::memory_order_acquire);
+        while (slot) {
+            ReturnedSlot* next = slot->next;
+            pool_.deallocate(reinterpret_cast<T*>(slot));
+            slot = next;
+        }
+    }
+
+private:
+    MemoryPool<T, BlockSize> pool_;
+    alignas(64) std::atomic<ReturnedSlot*> returned_{nullptr};
+};
@@ -0,0 +1,174 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Tables built by the compiler, so hot paths index or multiply instead of
+// calling std::pow, std::round or dividing by a runtime value:
+//   make_table     - std::array<T, N> with a[i] = f(i), usable in constexpr
+//   kPow10         - 10^0 .. 10^19, for fixed-point scaling
+//   DecimalTick    - a tick size as an integer count of 10^-decimals units
+//   format_fixed / parse_fixed - integer <-> "123.4500" with no doubles
+//   ReciprocalDivider - floor(n / d) as a multiply and a shift
+namespace tables {
+
+template<typename T, size_t N, typename F>
+constexpr std::array<T, N> make_table(F f) {
+    std::array<T, N> table{};
+    for (size_t i = 0; i < N; ++i) {
+        table[i] = f(i);
+    }
+    return table;
+}
+
+constexpr unsigned kMaxDecimals = 19;
+
+constexpr std::array<uint64_t, kMaxDecimals + 1> kPow10 = make_table<uint64_t, kMaxDecimals + 1>(
+    [](size_t i) {
+        uint64_t value = 1;
+        for (size_t k = 0; k < i; ++k) {
+            value *= 10;
+        }
+        return value;
+    });
+
+static_assert(kPow10[0] == 1 && kPow10[4] == 10000, "pow10 table");
+static_assert(kPow10[19] == 10000000000000000000ull, "largest power of ten in uint64_t");
+
+// Writes `units` in 10^-decimals units as a decimal ("-12.3400" for -123400
+// with four decimals) and returns the length; `out` needs 22 bytes
+inline size_t format_fixed(char* out, int64_t units, unsigned decimals) {
+    char digits[24];
+    size_t count = 0;
+    uint64_t magnitude = units < 0 ? 0 - static_cast<uint64_t>(units) : static_cast<uint64_t>(units);
+    do {
+        digits[count++] = static_cast<char>('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+    while (count <= decimals) {
+        digits[count++] = '0';   // At least one digit before the point
+    }
+    size_t length = 0;
+    if (units < 0) {
+        out[length++] = '-';
+    }
+    while (count > 0) {
+        if (count == decimals) {
+            out[length++] = '.';
+        }
+        out[length++] = digits[--count];
+    }
+    return length;
+}
+
+// Parses "[-]digits[.digits]" into 10^-decimals units. Extra fractional
+// digits are truncated; false for an empty, malformed or overflowing value.
+constexpr bool parse_fixed(std::string_view text, unsigned decimals, int64_t& out) {
+    if (decimals > 18) {
+        return false;
+    }
+    size_t i = 0;
+    bool negative = !text.empty() && text[0] == '-';
+    if (negative) {
+        ++i;
+    }
+    uint64_t whole = 0;
+    size_t whole_digits = 0;
+    for (; i < text.size() && text[i] >= '0' && text[i] <= '9'; ++i, ++whole_digits) {
+        if (whole > (uint64_t{INT64_MAX} - 9) / 10) {
+            return false;
+        }
+        whole = whole * 10 + static_cast<uint64_t>(text[i] - '0');
+    }
+    uint64_t fraction = 0;
+    unsigned fraction_digits = 0;
+    if (i < text.size() && text[i] == '.') {
+        for (++i; i < text.size() && text[i] >= '0' && text[i] <= '9'; ++i) {
+            if (fraction_digits < decimals) {
+                fraction = fraction * 10 + static_cast<uint64_t>(text[i] - '0');
+                ++fraction_digits;
+            }
+        }
+    }
+    if (i != text.size() || (whole_digits == 0 && fraction_digits == 0)) {
+        return false;
+    }
+    uint64_t scale = kPow10[decimals];
+    if (whole > static_cast<uint64_t>(INT64_MAX) / scale) {
+        return false;
+    }
+    uint64_t value = whole * scale + fraction * kPow10[decimals - fraction_digits];
+    if (value > static_cast<uint64_t>(INT64_MAX)) {
+        return false;
+    }
+    out = negative ? -static_cast<int64_t>(value) : static_cast<int64_t>(value);
+    return true;
+}
+
+// A tick size written exactly in decimal: units * 10^-decimals. from()
+// finds the fewest decimals that represent a double tick (0.05 -> 5 x
+// 10^-2); prices in ticks then format and rescale with integers only.
+struct DecimalTick {
+    uint64_t units = 1;
+    unsigned decimals = 2;
+
+    // {0, 0} when the tick is not a decimal of at most 9 places
+    static constexpr DecimalTick from(double size) {
+        for (unsigned d = 0; d <= 9; ++d) {
+            double scaled = size * static_cast<double>(kPow10[d]);
+            double nearest = static_cast<double>(static_cast<uint64_t>(scaled + 0.5));
+            double error = scaled > nearest ? scaled - nearest : nearest - scaled;
+            if (nearest >= 1.0 && error < 1e-6) {
+                return DecimalTick{static_cast<uint64_t>(nearest), d};
+            }
+        }
+        return DecimalTick{0, 0};
+    }
+
+    constexpr bool valid() const { return units != 0; }
+
+    // Price in 10^-decimals units
+    constexpr int64_t to_units(int64_t ticks) const { return ticks * static_cast<int64_t>(units); }
+
+    size_t format(char* out, int64_t ticks) const { return format_fixed(out, to_units(ticks), decimals); }
+};
+
+static_assert(DecimalTick::from(0.01).units == 1 && DecimalTick::from(0.01).decimals == 2, "cent tick");
+static_assert(DecimalTick::from(0.05).units == 5 && DecimalTick::from(0.05).decimals == 2, "nickel tick");
+static_assert(DecimalTick::from(0.25).units == 25 && DecimalTick::from(0.25).decimals == 2, "quarter tick");
+static_assert(DecimalTick::from(1.0).units == 1 && DecimalTick::from(1.0).decimals == 0, "whole tick");
+
+// floor(n / d) for a divisor fixed at setup: one 64x64->128 multiply by
+// ceil(2^64 / d) keeping the high half. Exact whenever n * d < 2^64, which
+// covers 32-bit feed prices (plus rounding) against any divisor below 2^31.
+class ReciprocalDivider {
+public:
+    // Unset: divisor() is 0
+    constexpr ReciprocalDivider() = default;
+    constexpr explicit ReciprocalDivider(uint64_t divisor)
+        : divisor_(divisor), magic_(divisor > 1 ? ~uint64_t{0} / divisor + 1 : 0) {}
+
+    constexpr uint64_t divisor() const { return divisor_; }
+
+    constexpr uint64_t divide(uint64_t n) const {
+        if (magic_ == 0) {
+            return n;   // Divisor 1
+        }
+        return static_cast<uint64_t>((static_cast<unsigned __int128>(n) * magic_) >> 64);
+    }
+
+    // n / d rounded half up
+    constexpr uint64_t divide_rounded(uint64_t n) const { return divide(n + divisor_ / 2); }
+
+private:
+    uint64_t divisor_ = 0;
+    uint64_t magic_ = 0;       // 0 for divisor 1 (and unset)
+};
+
+static_assert(ReciprocalDivider(100).divide(4294967295u) == 42949672, "exact for 32-bit inputs");
+static_assert(ReciprocalDivider(7).divide_rounded(10) == 1 && ReciprocalDivider(7).divide_rounded(11) == 2,
+              "rounds half up");
+static_assert(ReciprocalDivider(1).divide(12345) == 12345, "divisor 1");
+
+} // namespace tables
@@ -0,0 +1,181 @@
+// Feed-to-book handoff benchmark: a producer thread pushes generated
+// commands through an SPSC queue to a consumer thread that owns the book.
+// Each queue is run twice, once with the consumer only draining (queue cost
+// alone) and once applying every command to the book, moving one command
+// at a time, in bursts through the masked rings' bulk calls, and in place.
+//
+//   handoff_benchmark [--commands <count>] [--capacity <slots>] [--burst <n>]
+//                     [--cpus <producer>,<consumer>]
+#include "workload.h"
+#include "tsc_clock.h"
+#include "../SPSC_QUEUES/spsc_q4.cpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <pthread.h>
+#include <string>
+#include <thread>
+
+namespace {
+
+void pin_to(int cpu) {
+    if (cpu < 0) {
+        return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+void apply_one(OrderBook& book, const Command& command) {
+    switch (command.type) {
+        case CommandType::Add: book.add_order(command.order); break;
+        case CommandType::Cancel: book.cancel_order(command.order.order_id); break;
+        case CommandType::Amend:
+            book.amend_order(command.order.order_id, command.order.price, command.order.quantity);
+            break;
+        case CommandType::Reduce:
+            book.reduce_order(command.order.order_id, command.order.quantity);
+            break;
+    }
+}
+
+// burst 1 moves one command per push/pop; larger bursts go through
+// push_n/pop_n and reach the book through apply_batch. InPlace builds each
+// command in its slot (try_reserve/commit) and applies it from there
+// (front/pop), with no copy out of the ring.
+template<typename Queue, bool InPlace = false>
+double run(const std::vector<Command>& commands, size_t capacity, size_t burst, bool apply,
+           int producer_cpu, int consumer_cpu) {
+    Queue queue(capacity);
+    OrderBookConfig config;
+    config.ladder_levels = 4096;
+    config.expected_orders = commands.size();
+    OrderBook book(config);
+    std::atomic<bool> ready{false};
+
+    uint64_t start = 0;
+    uint64_t stop = 0;
+    std::thread consumer([&] {
+        pin_to(consumer_cpu);
+        ready.store(true, std::memory_order_release);
+        std::vector<Command> received(burst);
+        for (size_t total = 0; total < commands.size();) {
+            size_t n = 0;
+            if constexpr (InPlace) {
+                if (const Command* next = queue.front()) {
+                    if (apply) {
+                        apply_one(book, *next);
+                    }
+                    queue.pop();
+                    ++total;
+                }
+                continue;
+            }
+            if (burst == 1) {
+                n = queue.pop(received[0]) ? 1 : 0;
+            } else {
+                n = queue.pop_n(received.data(), burst);
+            }
+            if (n == 0) {
+                continue;
+            }
+            total += n;
+            if (!apply) {
+                continue;
+            }
+            if (burst == 1) {
+                apply_one(book, received[0]);
+            } else {
+                book.apply_batch(received.data(), n);
+            }
+        }
+        stop = tsc::stop();
+    });
+
+    pin_to(producer_cpu);
+    while (!ready.load(std::memory_order_acquire)) {
+    }
+    start = tsc::start();
+    if constexpr (InPlace) {
+        for (const Command& command : commands) {
+            Command* slot;
+            while ((slot = queue.try_reserve()) == nullptr) {
+            }
+            new (slot) Command(command);
+            queue.commit();
+        }
+    } else if (burst == 1) {
+        for (const Command& command : commands) {
+            while (!queue.push(command)) {
+            }
+        }
+    } else {
+        for (size_t sent = 0; sent < commands.size();) {
+            size_t n = std::min(burst, commands.size() - sent);
+            sent += queue.push_n(commands.data() + sent, n);
+        }
+    }
+    consumer.join();
+    return static_cast<double>(TscClock::instance().to_ns(stop - start));
+}
+
+template<typename Queue, bool InPlace = false>
+void report(const char* name, const std::vector<Command>& commands, size_t capacity,
+            size_t burst, int producer_cpu, int consumer_cpu) {
+    double drain_ns =
+        run<Queue, InPlace>(commands, capacity, burst, false, producer_cpu, consumer_cpu);
+    double apply_ns =
+        run<Queue, InPlace>(commands, capacity, burst, true, producer_cpu, consumer_cpu);
+    double n = static_cast<double>(commands.size());
+    std::cout << "  " << name << (InPlace ? " in place" : " x" + std::to_string(burst)) << ": drain "
+              << static_cast<uint64_t>(n / (drain_ns / 1e9)) << " msgs/sec ("
+              << drain_ns / n << " ns/msg), into book "
+              << static_cast<uint64_t>(n / (apply_ns / 1e9)) << " msgs/sec ("
+              << apply_ns / n << " ns/msg)\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t count = 2000000;
+    size_t capacity = 4096;
+    size_t burst = 64;
+    int producer_cpu = -1;
+    int consumer_cpu = -1;
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], "--commands") == 0) {
+            count = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--capacity") == 0) {
+            capacity = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--burst") == 0) {
+            burst = std::max<size_t>(2, std::strtoull(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--cpus") == 0) {
+            char* end = nullptr;
+            producer_cpu = static_cast<int>(std::strtol(argv[++i], &end, 10));
+            consumer_cpu = *end == ',' ? static_cast<int>(std::strtol(end + 1, nullptr, 10)) : -1;
+        }
+    }
+
+    WorkloadConfig workload;
+    workload.long_lifetime = static_cast<double>(count);
+    WorkloadGenerator generator(workload);
+    std::vector<Command> commands;
+    generator.prefill(count / 10, commands);
+    generator.generate(count, commands);
+
+    std::cout << "=== Feed-to-book handoff (" << commands.size() << " commands of "
+              << sizeof(Command) << " bytes, capacity " << capacity << ") ===\n";
+    using MaskedFifo3 = Fifo3<Command, std::allocator<Command>, true>;
+    using MaskedFifo4 = Fifo4<Command, std::allocator<Command>, true>;
+    report<Fifo3<Command>>("Fifo3", commands, capacity, 1, producer_cpu, consumer_cpu);
+    report<Fifo4<Command>>("Fifo4", commands, capacity, 1, producer_cpu, consumer_cpu);
+    report<MaskedFifo3>("Fifo3 masked", commands, capacity, 1, producer_cpu, consumer_cpu);
+    report<MaskedFifo4>("Fifo4 masked", commands, capacity, 1, producer_cpu, consumer_cpu);
+    report<MaskedFifo3>("Fifo3 masked", commands, capacity, burst, producer_cpu, consumer_cpu);
+    report<MaskedFifo4>("Fifo4 masked", commands, capacity, burst, producer_cpu, consumer_cpu);
+    report<MaskedFifo3, true>("Fifo3 masked", commands, capacity, 1, producer_cpu, consumer_cpu);
+    return 0;
+}
@@ -0,0 +1,155 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+// Reference-counted pointer whose count lives in the object (no separate
+// control block, no extra allocation, one pointer per IntrusivePtr). The
+// object derives from RefCounted<Self, Count>, where Count picks the cost:
+//   SingleThreadRefCount - plain integer, for objects that never leave a thread
+//   AtomicRefCount       - relaxed increments and acq_rel decrements, for
+//                          sharing across threads
+// A new reference can only be made from an existing one (copying an
+// IntrusivePtr), so a thread must be handed a copy, e.g. through a queue,
+// rather than pick up a raw pointer another thread may be releasing.
+//
+// When the count drops to zero RefCounted calls Self::dispose(self), which
+// deletes by default; PooledRefCounted instead hands the object back to the
+// pool it was built in (see make_pooled_intrusive).
+
+struct SingleThreadRefCount {
+    uint32_t value = 0;
+
+    void add() { ++value; }
+    bool release() { return --value == 0; }   // True for the last reference
+    uint32_t load() const { return value; }
+};
+
+struct AtomicRefCount {
+    std::atomic<uint32_t> value{0};
+
+    // A new reference comes from an existing one, so nothing needs ordering
+    void add() { value.fetch_add(1, std::memory_order_relaxed); }
+    // Every earlier use of the object happens before its disposal. acq_rel
+    // rather than release plus a fence on the last decrement: the same
+    // locked instruction on x86, and visible to ThreadSanitizer.
+    bool release() { return value.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+    uint32_t load() const { return value.load(std::memory_order_relaxed); }
+};
+
+template<typename Self, typename Count = AtomicRefCount>
+class RefCounted {
+public:
+    uint32_t use_count() const { return refs_.load(); }
+
+    // Deletes by default; Self hides this with its own static
+    // dispose(Self*) to recycle instead
+    static void dispose(Self* self) { delete self; }
+
+    friend void intrusive_add_ref(const Self* self) { self->refs_.add(); }
+    friend void intrusive_release(const Self* self) {
+        if (self->refs_.release()) {
+            Self::dispose(const_cast<Self*>(self));
+        }
+    }
+
+protected:
+    RefCounted() = default;
+    // A copy is a new object with no references yet
+    RefCounted(const RefCounted&) {}
+    RefCounted& operator=(const RefCounted&) { return *this; }
+    ~RefCounted() = default;
+
+private:
+    mutable Count refs_;
+};
+
+template<typename T>
+class IntrusivePtr {
+public:
+    IntrusivePtr() = default;
+    // Takes a new reference to `ptr` (which may already have others)
+    explicit IntrusivePtr(T* ptr) : ptr_(ptr) {
+        if (ptr_) {
+            intrusive_add_ref(ptr_);
+        }
+    }
+    IntrusivePtr(const IntrusivePtr& other) : IntrusivePtr(other.ptr_) {}
+    IntrusivePtr(IntrusivePtr&& other) noexcept : ptr_(other.ptr_) { other.ptr_ = nullptr; }
+    // IntrusivePtr<Derived> or <T> to IntrusivePtr<const T>
+    template<typename U>
+    IntrusivePtr(const IntrusivePtr<U>& other) : IntrusivePtr(other.get()) {}
+    template<typename U>
+    IntrusivePtr(IntrusivePtr<U>&& other) noexcept : ptr_(other.detach()) {}
+
+    ~IntrusivePtr() {
+        if (ptr_) {
+            intrusive_release(ptr_);
+        }
+    }
+
+    IntrusivePtr& operator=(IntrusivePtr other) noexcept {
+        std::swap(ptr_, other.ptr_);
+        return *this;
+    }
+
+    void reset() { IntrusivePtr().swap(*this); }
+    void swap(IntrusivePtr& other) noexcept { std::swap(ptr_, other.ptr_); }
+
+    // Give up the reference without releasing it; adopt() takes it back
+    T* detach() {
+        T* ptr = ptr_;
+        ptr_ = nullptr;
+        return ptr;
+    }
+    static IntrusivePtr adopt(T* ptr) {
+        IntrusivePtr out;
+        out.ptr_ = ptr;
+        return out;
+    }
+
+    T* get() const { return ptr_; }
+    T& operator*() const { return *ptr_; }
+    T* operator->() const { return ptr_; }
+    explicit operator bool() const { return ptr_ != nullptr; }
+    uint32_t use_count() const { return ptr_ ? ptr_->use_count() : 0; }
+
+    friend bool operator==(const IntrusivePtr& a, const IntrusivePtr& b) { return a.ptr_ == b.ptr_; }
+    friend bool operator!=(const IntrusivePtr& a, const IntrusivePtr& b) { return a.ptr_ != b.ptr_; }
+
+private:
+    T* ptr_ = nullptr;
+};
+
+template<typename T, typename... Args>
+IntrusivePtr<T> make_intrusive(Args&&... args) {
+    return IntrusivePtr<T>(new T(std::forward<Args>(args)...));
+}
+
+// RefCounted whose last release calls pool->destroy(self). Pool is anything
+// with construct(args...) and destroy(Self*): a MemoryPool when every
+// reference stays on the pool's thread, a SharedReturnPool when the last
+// one may be dropped elsewhere.
+template<typename Self, typename Pool, typename Count = AtomicRefCount>
+class PooledRefCounted : public RefCounted<Self, Count> {
+public:
+    static void dispose(Self* self) { self->pool_->destroy(self); }
+
+protected:
+    PooledRefCounted() = default;
+    PooledRefCounted(const PooledRefCounted&) : RefCounted<Self, Count>() {}
+    PooledRefCounted& operator=(const PooledRefCounted&) { return *this; }
+
+private:
+    template<typename T, typename P, typename... Args>
+    friend IntrusivePtr<T> make_pooled_intrusive(P& pool, Args&&... args);
+
+    Pool* pool_ = nullptr;
+};
+
+template<typename T, typename Pool, typename... Args>
+IntrusivePtr<T> make_pooled_intrusive(Pool& pool, Args&&... args) {
+    T* object = pool.construct(std::forward<Args>(args)...);
+    object->pool_ = &pool;
+    return IntrusivePtr<T>(object);
+}
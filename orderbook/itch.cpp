@@ -0,0 +1,318 @@
+#include "itch.h"
+#include <cmath>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace itch {
+
+namespace {
+
+void store16(unsigned char* p, uint16_t v) {
+    v = __builtin_bswap16(v);
+    std::memcpy(p, &v, sizeof(v));
+}
+void store32(unsigned char* p, uint32_t v) {
+    v = __builtin_bswap32(v);
+    std::memcpy(p, &v, sizeof(v));
+}
+void store64(unsigned char* p, uint64_t v) {
+    v = __builtin_bswap64(v);
+    std::memcpy(p, &v, sizeof(v));
+}
+void store48(unsigned char* p, uint64_t v) {
+    store16(p, static_cast<uint16_t>(v >> 32));
+    store32(p + 2, static_cast<uint32_t>(v));
+}
+
+// Type, stock locate, tracking number (0), timestamp
+void store_prefix(unsigned char* out, char type, uint16_t locate, uint64_t timestamp_ns) {
+    out[0] = static_cast<unsigned char>(type);
+    store16(out + 1, locate);
+    store16(out + 3, 0);
+    store48(out + 5, timestamp_ns);
+}
+
+} // namespace
+
+size_t encode_add(unsigned char* out, uint16_t locate, uint64_t timestamp_ns, uint64_t ref,
+                  bool is_buy, uint32_t shares, uint32_t price) {
+    store_prefix(out, 'A', locate, timestamp_ns);
+    store64(out + 11, ref);
+    out[19] = is_buy ? 'B' : 'S';
+    store32(out + 20, shares);
+    std::memcpy(out + 24, "TEST    ", 8);
+    store32(out + 32, price);
+    return kAddLength;
+}
+
+size_t encode_executed(unsigned char* out, uint16_t locate, uint64_t timestamp_ns, uint64_t ref,
+                       uint32_t shares, uint64_t match_number) {
+    store_prefix(out, 'E', locate, timestamp_ns);
+    store64(out + 11, ref);
+    store32(out + 19, shares);
+    store64(out + 23, match_number);
+    return kExecutedLength;
+}
+
+size_t encode_cancel(unsigned char* out, uint16_t locate, uint64_t timestamp_ns, uint64_t ref,
+                     uint32_t shares) {
+    store_prefix(out, 'X', locate, timestamp_ns);
+    store64(out + 11, ref);
+    store32(out + 19, shares);
+    return kCancelLength;
+}
+
+size_t encode_delete(unsigned char* out, uint16_t locate, uint64_t timestamp_ns, uint64_t ref) {
+    store_prefix(out, 'D', locate, timestamp_ns);
+    store64(out + 11, ref);
+    return kDeleteLength;
+}
+
+size_t encode_replace(unsigned char* out, uint16_t locate, uint64_t timestamp_ns,
+                      uint64_t old_ref, uint64_t new_ref, uint32_t shares, uint32_t price) {
+    store_prefix(out, 'U', locate, timestamp_ns);
+    store64(out + 11, old_ref);
+    store64(out + 19, new_ref);
+    store32(out + 27, shares);
+    store32(out + 31, price);
+    return kReplaceLength;
+}
+
+void append_framed(std::vector<unsigned char>& stream, const unsigned char* message, size_t length) {
+    size_t at = stream.size();
+    stream.resize(at + 2 + length);
+    store16(&stream[at], static_cast<uint16_t>(length));
+    std::memcpy(&stream[at + 2], message, length);
+}
+
+} // namespace itch
+
+// ---------------------------------------------------------------- decoder
+
+ItchDecoder::ItchDecoder(OrderBook& book, uint16_t stock_locate, size_t batch_size)
+    : book_(book), stock_locate_(stock_locate), batch_size_(batch_size ? batch_size : 1),
+      ticks_per_unit_(itch::kPriceScale / book.tick_size().size), live_(1 << 16) {
+    pending_.reserve(batch_size_ + 1);
+    tables::DecimalTick tick = tables::DecimalTick::from(book.tick_size().size);
+    if (tick.valid() && tick.decimals <= itch::kPriceDecimals) {
+        uint64_t units = tick.units * tables::kPow10[itch::kPriceDecimals - tick.decimals];
+        if (units < (uint64_t{1} << 31)) {
+            units_per_tick_ = tables::ReciprocalDivider(units);
+        }
+    }
+}
+
+size_t ItchDecoder::decode(const unsigned char* data, size_t size) {
+    size_t offset = 0;
+    while (size - offset >= 2) {
+        size_t length = itch::load16(data + offset);
+        if (size - offset - 2 < length) {
+            break;
+        }
+        on_message(data + offset + 2, length);
+        offset += 2 + length;
+    }
+    flush();
+    return offset;
+}
+
+void ItchDecoder::on_message(const unsigned char* m, size_t length) {
+    ++stats_.messages;
+    if (length < itch::kDeleteLength) {
+        // Shorter than the smallest order message: system events and the like
+        ++stats_.skipped;
+        return;
+    }
+    if (stock_locate_ != 0 && itch::load16(m + 1) != stock_locate_) {
+        ++stats_.skipped;
+        return;
+    }
+    uint64_t timestamp_ns = itch::load48(m + 5);
+    uint64_t ref = itch::load64(m + 11);
+
+    switch (m[0]) {
+        case 'A':
+        case 'F': {
+            if (length < itch::kAddLength) break;
+            bool is_buy = m[19] == 'B';
+            uint32_t shares = itch::load32(m + 20);
+            live_.insert(ref, LiveOrder{shares, static_cast<uint8_t>(is_buy)});
+            push(Command::add(Order(ref, is_buy, to_ticks(itch::load32(m + 32)), shares,
+                                    timestamp_ns)));
+            ++stats_.adds;
+            return;
+        }
+        case 'E':
+        case 'C':
+            if (length < (m[0] == 'E' ? itch::kExecutedLength : itch::kExecutedPriceLength)) break;
+            // 'C' prints at another price; the resting order just shrinks either way
+            reduce(ref, itch::load32(m + 19), timestamp_ns);
+            ++stats_.executions;
+            return;
+        case 'X':
+            if (length < itch::kCancelLength) break;
+            reduce(ref, itch::load32(m + 19), timestamp_ns);
+            ++stats_.cancels;
+            return;
+        case 'D':
+            live_.erase(ref);
+            push(Command::cancel(ref, timestamp_ns));
+            ++stats_.deletes;
+            return;
+        case 'U': {
+            if (length < itch::kReplaceLength) break;
+            LiveOrder old{};
+            if (!live_.take(ref, old)) {
+                ++stats_.skipped;   // Original never seen (capture started mid-session)
+                return;
+            }
+            uint64_t new_ref = itch::load64(m + 19);
+            uint32_t shares = itch::load32(m + 27);
+            live_.insert(new_ref, LiveOrder{shares, old.is_buy});
+            push(Command::cancel(ref, timestamp_ns));
+            push(Command::add(Order(new_ref, old.is_buy != 0, to_ticks(itch::load32(m + 31)),
+                                    shares, timestamp_ns)));
+            ++stats_.replaces;
+            return;
+        }
+        default:
+            ++stats_.skipped;
+            return;
+    }
+    ++stats_.malformed;
+}
+
+void ItchDecoder::flush() {
+    if (!pending_.empty()) {
+        stats_.applied += book_.apply_batch(pending_.data(), pending_.size());
+        pending_.clear();
+    }
+}
+
+void ItchDecoder::push(const Command& command) {
+    pending_.push_back(command);
+    if (pending_.size() >= batch_size_) {
+        flush();
+    }
+}
+
+// Executions and partial cancels; the last share removes the order
+void ItchDecoder::reduce(uint64_t ref, uint32_t shares, uint64_t timestamp_ns) {
+    if (LiveOrder* live = live_.find(ref)) {
+        if (shares >= live->shares) {
+            live_.erase(ref);
+        } else {
+            live->shares -= shares;
+        }
+    }
+    push(Command::reduce(ref, shares, timestamp_ns));
+}
+
+Price ItchDecoder::to_ticks(uint32_t price) const {
+    if (units_per_tick_.divisor() != 0) {
+        return static_cast<Price>(units_per_tick_.divide_rounded(price));
+    }
+    return static_cast<Price>(std::llround(static_cast<double>(price) * ticks_per_unit_));
+}
+
+// ---------------------------------------------------------------- pcap
+
+namespace {
+
+constexpr uint32_t kPcapMicros = 0xa1b2c3d4;
+constexpr uint32_t kPcapNanos = 0xa1b23c4d;
+constexpr uint32_t kLinkEthernet = 1;
+constexpr size_t kPcapHeader = 24;
+constexpr size_t kPcapRecordHeader = 16;
+constexpr size_t kMoldHeader = 20;   // Session (10), sequence (8), message count (2)
+
+uint32_t load32_host(const unsigned char* p, bool swapped) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return swapped ? __builtin_bswap32(v) : v;
+}
+
+} // namespace
+
+size_t decode_pcap(const unsigned char* data, size_t size, ItchDecoder& decoder) {
+    if (size < kPcapHeader) {
+        throw std::runtime_error("pcap: truncated file header");
+    }
+    uint32_t magic = load32_host(data, false);
+    bool swapped = magic != kPcapMicros && magic != kPcapNanos;
+    if (swapped) {
+        magic = __builtin_bswap32(magic);
+        if (magic != kPcapMicros && magic != kPcapNanos) {
+            throw std::runtime_error("pcap: bad magic");
+        }
+    }
+    if (load32_host(data + 20, swapped) != kLinkEthernet) {
+        throw std::runtime_error("pcap: only Ethernet captures are supported");
+    }
+
+    size_t packets = 0;
+    size_t offset = kPcapHeader;
+    while (size - offset >= kPcapRecordHeader) {
+        size_t captured = load32_host(data + offset + 8, swapped);
+        offset += kPcapRecordHeader;
+        if (size - offset < captured) {
+            break;
+        }
+        const unsigned char* frame = data + offset;
+        offset += captured;
+
+        size_t l3 = 14;
+        if (captured < l3) continue;
+        uint16_t ether_type = itch::load16(frame + 12);
+        if (ether_type == 0x8100 && captured >= 18) {
+            ether_type = itch::load16(frame + 16);
+            l3 = 18;
+        }
+        if (ether_type != 0x0800 || captured < l3 + 20) continue;
+        const unsigned char* ip = frame + l3;
+        size_t ip_header = static_cast<size_t>(ip[0] & 0x0f) * 4;
+        if (ip[9] != 17 || captured < l3 + ip_header + 8) continue;
+        const unsigned char* udp = ip + ip_header;
+        size_t udp_length = itch::load16(udp + 4);
+        size_t available = captured - l3 - ip_header;
+        if (udp_length < 8 + kMoldHeader || udp_length > available) continue;
+
+        decoder.decode(udp + 8 + kMoldHeader, udp_length - 8 - kMoldHeader);
+        ++packets;
+    }
+    return packets;
+}
+
+// ---------------------------------------------------------------- capture
+
+MappedCapture::MappedCapture(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("capture: cannot open " + path);
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw std::runtime_error("capture: cannot stat " + path);
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ > 0) {
+        void* map = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("capture: cannot map " + path);
+        }
+        ::madvise(map, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const unsigned char*>(map);
+    }
+    ::close(fd);
+}
+
+MappedCapture::~MappedCapture() {
+    if (data_) {
+        ::munmap(const_cast<unsigned char*>(data_), size_);
+    }
+}
@@ -0,0 +1,150 @@
+#pragma once
+#include "constexpr_tables.h"
+#include "order_book.h"
+#include <cstring>
+#include <string>
+#include <vector>
+
+// NASDAQ TotalView-ITCH 5.0 order-level decoding. The order messages drive
+// one OrderBook per stock locate:
+//   'A' / 'F'  add (with or without attribution)  -> add
+//   'E' / 'C'  executed (at the order's price or another one) -> reduce
+//   'X'        partial cancel                       -> reduce
+//   'D'        delete                               -> cancel
+//   'U'        replace: new reference, price, size  -> cancel + add
+// Every other message type is skipped by its length. Fields are read in
+// place from the caller's buffer (a mapped capture or a receive buffer);
+// nothing is copied besides the resulting Commands.
+namespace itch {
+
+// Big-endian field loads
+inline uint16_t load16(const unsigned char* p) {
+    uint16_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return __builtin_bswap16(v);
+}
+inline uint32_t load32(const unsigned char* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return __builtin_bswap32(v);
+}
+inline uint64_t load64(const unsigned char* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return __builtin_bswap64(v);
+}
+inline uint64_t load48(const unsigned char* p) {
+    return (uint64_t{load16(p)} << 32) | load32(p + 2);
+}
+
+// Message lengths, type byte included
+constexpr size_t kAddLength = 36;
+constexpr size_t kAddMpidLength = 40;
+constexpr size_t kExecutedLength = 31;
+constexpr size_t kExecutedPriceLength = 36;
+constexpr size_t kCancelLength = 23;
+constexpr size_t kDeleteLength = 19;
+constexpr size_t kReplaceLength = 35;
+
+// ITCH prices carry four implied decimals
+constexpr unsigned kPriceDecimals = 4;
+constexpr double kPriceScale = 1e-4;
+
+// Encoders for tests and synthetic captures; each writes one message
+// (no length prefix) and returns its length
+size_t encode_add(unsigned char* out, uint16_t locate, uint64_t timestamp_ns, uint64_t ref,
+                  bool is_buy, uint32_t shares, uint32_t price);
+size_t encode_executed(unsigned char* out, uint16_t locate, uint64_t timestamp_ns, uint64_t ref,
+                       uint32_t shares, uint64_t match_number);
+size_t encode_cancel(unsigned char* out, uint16_t locate, uint64_t timestamp_ns, uint64_t ref,
+                     uint32_t shares);
+size_t encode_delete(unsigned char* out, uint16_t locate, uint64_t timestamp_ns, uint64_t ref);
+size_t encode_replace(unsigned char* out, uint16_t locate, uint64_t timestamp_ns,
+                      uint64_t old_ref, uint64_t new_ref, uint32_t shares, uint32_t price);
+
+// Append `message` to a BinaryFILE-style stream: 2-byte big-endian length, then the message
+void append_framed(std::vector<unsigned char>& stream, const unsigned char* message, size_t length);
+
+}  // namespace itch
+
+struct ItchStats {
+    uint64_t messages = 0;     // Every framed message seen
+    uint64_t adds = 0;
+    uint64_t executions = 0;
+    uint64_t cancels = 0;      // Partial cancels
+    uint64_t deletes = 0;
+    uint64_t replaces = 0;
+    uint64_t skipped = 0;      // Other types, other stock locates
+    uint64_t malformed = 0;    // Order messages shorter than their type requires
+    uint64_t applied = 0;      // Commands the book accepted
+};
+
+// Decodes order messages for one stock locate (0 = all) into a book.
+// Commands are collected and handed to OrderBook::apply_batch `batch_size`
+// at a time, and at the end of each decode call, so the book's prefetching
+// lookahead applies to feed traffic. The decoder keeps each live order's
+// side and remaining shares, which a replace needs and which tells it when
+// an execution has used an order up.
+class ItchDecoder {
+public:
+    explicit ItchDecoder(OrderBook& book, uint16_t stock_locate = 0, size_t batch_size = 256);
+
+    // Decode length-prefixed messages (ITCH BinaryFILE, or the message
+    // blocks of a MoldUDP64 packet). Returns the bytes consumed; a trailing
+    // partial message is left for the caller to prepend to the next chunk.
+    size_t decode(const unsigned char* data, size_t size);
+
+    // One message without its length prefix; queued, not yet applied
+    void on_message(const unsigned char* message, size_t length);
+
+    // Apply queued commands to the book
+    void flush();
+
+    const ItchStats& stats() const { return stats_; }
+
+private:
+    struct LiveOrder {
+        uint32_t shares;
+        uint8_t is_buy;
+    };
+
+    void push(const Command& command);
+    void reduce(uint64_t ref, uint32_t shares, uint64_t timestamp_ns);
+    Price to_ticks(uint32_t price) const;
+
+    OrderBook& book_;
+    uint16_t stock_locate_;
+    size_t batch_size_;
+    // ITCH price units per book tick when the tick is a whole number of
+    // them (0.01 -> 100), turning to_ticks into a multiply and a shift;
+    // otherwise divisor 0 and the double ratio is used
+    tables::ReciprocalDivider units_per_tick_;
+    double ticks_per_unit_;    // Book ticks per ITCH price unit
+    std::vector<Command> pending_;
+    OrderIndex<LiveOrder> live_;
+    ItchStats stats_;
+};
+
+// Walks a classic libpcap capture (microsecond or nanosecond magic,
+// Ethernet, optional 802.1Q tag, IPv4, UDP) carrying MoldUDP64 and feeds
+// each packet's message blocks to the decoder. Returns the packets decoded;
+// packets that are not UDP or are truncated are skipped. Throws
+// std::runtime_error on a bad file header.
+size_t decode_pcap(const unsigned char* data, size_t size, ItchDecoder& decoder);
+
+// Read-only memory map of a capture file
+class MappedCapture {
+public:
+    explicit MappedCapture(const std::string& path);   // Throws std::runtime_error
+    ~MappedCapture();
+
+    MappedCapture(const MappedCapture&) = delete;
+    MappedCapture& operator=(const MappedCapture&) = delete;
+
+    const unsigned char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const unsigned char* data_ = nullptr;
+    size_t size_ = 0;
+};
@@ -0,0 +1,178 @@
+// ITCH 5.0 decode benchmark: drives an OrderBook from a recorded capture
+// (BinaryFILE-framed ITCH, or a pcap of MoldUDP64 packets), or from a
+// synthetic stream encoded from WorkloadGenerator flow
+//
+//   itch_replay <capture> [--pcap] [--locate <id>] [--tick <size>]
+//   itch_replay --synthetic <messages> [--write <path>]
+#include "itch.h"
+#include "tsc_clock.h"
+#include "workload.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+
+namespace {
+
+// Encode generator flow as ITCH. Price-changing amends become replaces,
+// which issue a new reference, so later commands go through an alias map.
+std::vector<unsigned char> synthesize(size_t messages) {
+    WorkloadConfig workload;
+    workload.long_lifetime = static_cast<double>(messages);
+    workload.mix.aggressive = 0.0;   // A feed only shows orders that rested
+    WorkloadGenerator generator(workload);
+    std::vector<Command> commands;
+    generator.prefill(messages / 10, commands);
+    generator.generate(messages, commands);
+
+    std::unordered_map<uint64_t, uint64_t> alias;
+    std::unordered_map<uint64_t, std::pair<Price, uint64_t>> resting;   // ref -> price, shares
+    auto current = [&](uint64_t id) {
+        auto it = alias.find(id);
+        return it == alias.end() ? id : it->second;
+    };
+
+    std::vector<unsigned char> stream;
+    stream.reserve(messages * 40);
+    unsigned char message[64];
+    uint64_t next_ref = 1ull << 40;
+    uint64_t timestamp = 34200ull * 1000000000ull;   // 09:30
+    for (const Command& command : commands) {
+        timestamp += 500;
+        uint64_t ref = current(command.order.order_id);
+        size_t length = 0;
+        switch (command.type) {
+            case CommandType::Add:
+                // Ticks of 0.01 are 100 ITCH price units
+                length = itch::encode_add(message, 1, timestamp, ref, command.order.is_buy,
+                                          static_cast<uint32_t>(command.order.quantity),
+                                          static_cast<uint32_t>(command.order.price * 100));
+                resting[ref] = {command.order.price, command.order.quantity};
+                break;
+            case CommandType::Cancel:
+                length = itch::encode_delete(message, 1, timestamp, ref);
+                resting.erase(ref);
+                break;
+            case CommandType::Amend: {
+                auto it = resting.find(ref);
+                if (it == resting.end()) {
+                    continue;
+                }
+                if (it->second.first == command.order.price) {
+                    if (command.order.quantity >= it->second.second) {
+                        continue;   // ITCH has no in-place size increase
+                    }
+                    length = itch::encode_cancel(
+                        message, 1, timestamp, ref,
+                        static_cast<uint32_t>(it->second.second - command.order.quantity));
+                    it->second.second = command.order.quantity;
+                } else {
+                    uint64_t new_ref = next_ref++;
+                    length = itch::encode_replace(message, 1, timestamp, ref, new_ref,
+                                                  static_cast<uint32_t>(command.order.quantity),
+                                                  static_cast<uint32_t>(command.order.price * 100));
+                    alias[command.order.order_id] = new_ref;
+                    resting.erase(it);
+                    resting[new_ref] = {command.order.price, command.order.quantity};
+                }
+                break;
+            }
+            case CommandType::Reduce:
+                continue;
+        }
+        itch::append_framed(stream, message, length);
+    }
+    return stream;
+}
+
+void report(const ItchStats& stats, double elapsed_ns, const OrderBook& book) {
+    std::cout << "Decoded " << stats.messages << " messages in " << elapsed_ns / 1e6 << " ms ("
+              << static_cast<uint64_t>(stats.messages / (elapsed_ns / 1e9)) << " msgs/sec, "
+              << elapsed_ns / (stats.messages ? stats.messages : 1) << " ns/msg)\n";
+    std::cout << "  adds " << stats.adds << ", executions " << stats.executions
+              << ", cancels " << stats.cancels << ", deletes " << stats.deletes
+              << ", replaces " << stats.replaces << ", skipped " << stats.skipped
+              << ", malformed " << stats.malformed << "\n";
+    std::cout << "  Commands applied: " << stats.applied
+              << ", resting orders: " << book.get_order_count() << "\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <capture> [--pcap] [--locate <id>] [--tick <size>]\n"
+                  << "       " << argv[0] << " --synthetic <messages> [--write <path>]\n";
+        return 2;
+    }
+
+    bool pcap = false;
+    uint16_t locate = 0;
+    double tick = 0.01;
+    size_t synthetic = 0;
+    const char* write_path = nullptr;
+    const char* path = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--pcap") == 0) {
+            pcap = true;
+        } else if (std::strcmp(argv[i], "--locate") == 0 && i + 1 < argc) {
+            locate = static_cast<uint16_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--tick") == 0 && i + 1 < argc) {
+            tick = std::strtod(argv[++i], nullptr);
+        } else if (std::strcmp(argv[i], "--synthetic") == 0 && i + 1 < argc) {
+            synthetic = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--write") == 0 && i + 1 < argc) {
+            write_path = argv[++i];
+        } else {
+            path = argv[i];
+        }
+    }
+
+    try {
+        OrderBookConfig config;
+        config.tick_size = TickSize{tick};
+        config.expected_orders = 1 << 20;
+        OrderBook book(config);
+        ItchDecoder decoder(book, locate);
+
+        if (synthetic > 0) {
+            std::vector<unsigned char> stream = synthesize(synthetic);
+            if (write_path) {
+                std::FILE* file = std::fopen(write_path, "wb");
+                bool written = file &&
+                               std::fwrite(stream.data(), 1, stream.size(), file) == stream.size();
+                if (file) {
+                    std::fclose(file);
+                }
+                if (!written) {
+                    throw std::runtime_error(std::string("cannot write ") + write_path);
+                }
+            }
+            uint64_t start = tsc::start();
+            decoder.decode(stream.data(), stream.size());
+            double elapsed = static_cast<double>(TscClock::instance().to_ns(tsc::stop() - start));
+            report(decoder.stats(), elapsed, book);
+            return 0;
+        }
+
+        if (!path) {
+            std::cerr << "no capture given\n";
+            return 2;
+        }
+        MappedCapture capture(path);
+        uint64_t start = tsc::start();
+        if (pcap) {
+            decode_pcap(capture.data(), capture.size(), decoder);
+        } else {
+            decoder.decode(capture.data(), capture.size());
+        }
+        double elapsed = static_cast<double>(TscClock::instance().to_ns(tsc::stop() - start));
+        report(decoder.stats(), elapsed, book);
+        book.print_book(5);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
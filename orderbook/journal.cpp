@@ -0,0 +1,243 @@
+#include "journal.h"
+#include "tsc_clock.h"
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char kJournalMagic[8] = {'O', 'B', 'J', 'R', 'N', 'L', 0, 0};
+
+void write_all(int fd, const void* data, size_t bytes) {
+    const char* p = static_cast<const char*>(data);
+    while (bytes > 0) {
+        ssize_t n = ::write(fd, p, bytes);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "journal: write failed");
+        }
+        p += n;
+        bytes -= static_cast<size_t>(n);
+    }
+}
+
+} // namespace
+
+Command JournalRecord::to_command() const {
+    switch (static_cast<CommandType>(type)) {
+        case CommandType::Cancel:
+            return Command::cancel(order_id, timestamp_ns);
+        case CommandType::Amend:
+            return Command::amend(order_id, price, quantity, timestamp_ns);
+        case CommandType::Reduce:
+            return Command::reduce(order_id, quantity, timestamp_ns);
+        case CommandType::Add:
+        default:
+            return Command::add(Order(order_id, is_buy != 0, price, quantity, timestamp_ns));
+    }
+}
+
+JournalRecord JournalRecord::from_command(const Command& command, uint32_t instrument_id,
+                                          uint64_t timestamp_ns) {
+    JournalRecord record{};
+    record.timestamp_ns = timestamp_ns;
+    record.order_id = command.order.order_id;
+    record.price = command.order.price;
+    record.quantity = command.order.quantity;
+    record.instrument_id = instrument_id;
+    record.type = static_cast<uint8_t>(command.type);
+    record.is_buy = command.order.is_buy ? 1 : 0;
+    return record;
+}
+
+// ---------------------------------------------------------------- writer
+
+JournalWriter::JournalWriter(const std::string& path, TickSize tick_size, size_t buffer_records)
+    : fd_(::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)),
+      buffer_records_(buffer_records) {
+    if (fd_ < 0) {
+        throw std::runtime_error("journal: cannot open " + path);
+    }
+    
+    JournalHeader header{};
+    std::memcpy(header.magic, kJournalMagic, sizeof(header.magic));
+    header.version = kJournalVersion;
+    header.record_size = sizeof(JournalRecord);
+    header.tick_size = tick_size.size;
+    write_all(fd_, &header, sizeof(header));
+    
+    buffers_[0].reset(new JournalRecord[buffer_records_]);
+    buffers_[1].reset(new JournalRecord[buffer_records_]);
+    active_ = buffers_[0].get();
+    flusher_ = std::thread([this] { flusher_loop(); });
+}
+
+JournalWriter::~JournalWriter() {
+    try {
+        flush();
+    } catch (const std::exception&) {
+        // Already reported by an earlier flush() / append(), or dropped
+        // with the writer; a destructor cannot rethrow it
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    flusher_.join();
+    ::close(fd_);
+}
+
+void JournalWriter::record(const Command& command, void* tap) {
+    auto* t = static_cast<Tap*>(tap);
+    // Untimed commands get TscClock time: same epoch as the book's own
+    // timestamps, and no clock_gettime() on the book thread
+    uint64_t ts = command.order.timestamp_ns ? command.order.timestamp_ns
+                                             : TscClock::instance().now_ns();
+    t->writer->append(JournalRecord::from_command(command, t->instrument_id, ts));
+}
+
+// Swap the full buffer for the spare one; only blocks if the flusher is
+// still writing the previous buffer (disk slower than the event rate)
+void JournalWriter::hand_off() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return pending_ == nullptr; });
+    if (error_) {
+        active_count_ = 0;   // The file is already incomplete; drop the buffer
+        std::rethrow_exception(error_);
+    }
+    pending_ = active_;
+    pending_count_ = active_count_;
+    records_ += active_count_;
+    active_ = (active_ == buffers_[0].get()) ? buffers_[1].get() : buffers_[0].get();
+    active_count_ = 0;
+    lock.unlock();
+    cv_.notify_all();
+}
+
+void JournalWriter::flush() {
+    if (active_count_ > 0) {
+        hand_off();
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return pending_ == nullptr; });
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+}
+
+void JournalWriter::flusher_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cv_.wait(lock, [this] { return pending_ != nullptr || stopping_; });
+        if (pending_ == nullptr) {
+            return; // Stopping with nothing left to write
+        }
+        JournalRecord* buffer = pending_;
+        size_t count = pending_count_;
+        lock.unlock();
+        std::exception_ptr error;
+        try {
+            write_all(fd_, buffer, count * sizeof(JournalRecord));
+        } catch (const std::exception&) {
+            // Thrown here it would terminate the process; hand it to the
+            // appending thread instead
+            error = std::current_exception();
+        }
+        lock.lock();
+        if (error && !error_) {
+            error_ = error;
+        }
+        pending_ = nullptr;
+        cv_.notify_all();
+    }
+}
+
+// ---------------------------------------------------------------- reader
+
+JournalReader::JournalReader(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("journal: cannot open " + path);
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(JournalHeader)) {
+        ::close(fd);
+        throw std::runtime_error("journal: truncated file " + path);
+    }
+    map_size_ = static_cast<size_t>(st.st_size);
+    map_ = ::mmap(nullptr, map_size_, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    ::close(fd);
+    if (map_ == MAP_FAILED) {
+        map_ = nullptr;
+        throw std::runtime_error("journal: mmap failed for " + path);
+    }
+    ::madvise(map_, map_size_, MADV_SEQUENTIAL);
+    
+    header_ = static_cast<const JournalHeader*>(map_);
+    if (std::memcmp(header_->magic, kJournalMagic, sizeof(kJournalMagic)) != 0 ||
+        header_->version != kJournalVersion ||
+        header_->record_size != sizeof(JournalRecord)) {
+        ::munmap(map_, map_size_);
+        map_ = nullptr;
+        throw std::runtime_error("journal: bad header in " + path);
+    }
+    records_ = reinterpret_cast<const JournalRecord*>(header_ + 1);
+    count_ = (map_size_ - sizeof(JournalHeader)) / sizeof(JournalRecord);
+}
+
+JournalReader::~JournalReader() {
+    if (map_) {
+        ::munmap(map_, map_size_);
+    }
+}
+
+// ---------------------------------------------------------------- replay
+
+ReplayStats replay_journal(const JournalRecord* begin, const JournalRecord* end,
+                           OrderBook& book, ReplayPacing pacing,
+                           const uint32_t* instrument_filter) {
+    constexpr size_t kBatch = 64;
+    Command batch[kBatch];
+    ReplayStats stats;
+    
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+    uint64_t first_ts = begin != end ? begin->timestamp_ns : 0;
+    
+    const JournalRecord* record = begin;
+    while (record != end) {
+        size_t n = 0;
+        while (record != end && n < kBatch) {
+            if (instrument_filter && record->instrument_id != *instrument_filter) {
+                ++record;
+                continue;
+            }
+            if (pacing == ReplayPacing::Original) {
+                // Hold each record until its original offset from the first
+                uint64_t offset = record->timestamp_ns > first_ts ? record->timestamp_ns - first_ts : 0;
+                auto due = start + std::chrono::nanoseconds(offset);
+                if (Clock::now() < due) {
+                    if (n > 0) break;   // Apply what is already due first
+                    while (Clock::now() < due) {
+                    }
+                }
+            }
+            batch[n++] = record->to_command();
+            ++record;
+        }
+        stats.records += n;
+        stats.succeeded += book.apply_batch(batch, n);
+    }
+    
+    stats.elapsed_us = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    return stats;
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include "order_book.h"
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Append-only binary event journal: a fixed header followed by fixed-size
+// little-endian records, one per add/cancel/amend applied to a book.
+//
+//   JournalHeader | JournalRecord | JournalRecord | ...
+
+struct JournalHeader {
+    char magic[8];            // "OBJRNL\0\0"
+    uint32_t version;
+    uint32_t record_size;     // sizeof(JournalRecord)
+    double tick_size;         // Instrument tick size at record time
+    uint64_t reserved;
+};
+static_assert(sizeof(JournalHeader) == 32, "journal header layout is part of the file format");
+
+struct JournalRecord {
+    uint64_t timestamp_ns;    // Order::timestamp_ns, or TscClock::now_ns() if the command had none
+    uint64_t order_id;
+    int64_t price;            // Ticks (add / amend)
+    uint64_t quantity;        // Add / amend
+    uint32_t instrument_id;
+    uint8_t type;             // CommandType
+    uint8_t is_buy;
+    uint16_t reserved;
+
+    Command to_command() const;
+    static JournalRecord from_command(const Command& command, uint32_t instrument_id,
+                                      uint64_t timestamp_ns);
+};
+static_assert(sizeof(JournalRecord) == 40, "journal record layout is part of the file format");
+
+constexpr uint32_t kJournalVersion = 1;
+
+// Buffered journal writer. append() only copies into a preallocated buffer;
+// full buffers are handed to a background thread that issues the write(),
+// so the book thread never enters the kernel. Not thread-safe: one
+// appending thread per writer.
+//
+// A failed write() (other than EINTR, which is retried) is kept by the
+// flusher and rethrown as std::system_error from the next flush() or
+// buffer hand-off in append(). From then on the writer drops records and
+// every flush() / hand-off throws again; the file ends at the last
+// complete write.
+class JournalWriter {
+public:
+    JournalWriter(const std::string& path, TickSize tick_size = TickSize{},
+                  size_t buffer_records = 1 << 16);
+    ~JournalWriter();
+
+    JournalWriter(const JournalWriter&) = delete;
+    JournalWriter& operator=(const JournalWriter&) = delete;
+
+    void append(const JournalRecord& record) {
+        active_[active_count_++] = record;
+        if (active_count_ == buffer_records_) {
+            hand_off();
+        }
+    }
+
+    // Push buffered records to the file and wait for the write to finish;
+    // throws std::system_error if a write has failed
+    void flush();
+
+    uint64_t records_written() const { return records_; }
+
+    // Connects one book to a writer: book.set_command_callback(&JournalWriter::record, &tap)
+    struct Tap {
+        JournalWriter* writer;
+        uint32_t instrument_id;
+    };
+    static void record(const Command& command, void* tap);
+
+private:
+    void hand_off();
+    void flusher_loop();
+
+    int fd_;
+    size_t buffer_records_;
+    std::unique_ptr<JournalRecord[]> buffers_[2];
+    JournalRecord* active_;
+    size_t active_count_ = 0;
+    uint64_t records_ = 0;
+
+    // Buffer owned by the flusher thread while pending_ is set
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    JournalRecord* pending_ = nullptr;
+    size_t pending_count_ = 0;
+    std::exception_ptr error_;   // First failed write, rethrown on the appending thread
+    bool stopping_ = false;
+    std::thread flusher_;
+};
+
+// Memory-mapped read-only view of a journal file
+class JournalReader {
+public:
+    explicit JournalReader(const std::string& path);  // Throws std::runtime_error
+    ~JournalReader();
+
+    JournalReader(const JournalReader&) = delete;
+    JournalReader& operator=(const JournalReader&) = delete;
+
+    const JournalHeader& header() const { return *header_; }
+    const JournalRecord* records() const { return records_; }
+    size_t size() const { return count_; }
+
+private:
+    void* map_ = nullptr;
+    size_t map_size_ = 0;
+    const JournalHeader* header_ = nullptr;
+    const JournalRecord* records_ = nullptr;
+    size_t count_ = 0;
+};
+
+enum class ReplayPacing {
+    FullSpeed,     // Apply records back to back
+    Original       // Reproduce inter-record gaps from timestamp_ns
+};
+
+struct ReplayStats {
+    size_t records = 0;
+    size_t succeeded = 0;
+    double elapsed_us = 0.0;
+};
+
+// Feed journal records [begin, end) into book through apply_batch. With
+// instrument_filter set, records for other instruments are skipped.
+ReplayStats replay_journal(const JournalRecord* begin, const JournalRecord* end,
+                           OrderBook& book, ReplayPacing pacing = ReplayPacing::FullSpeed,
+                           const uint32_t* instrument_filter = nullptr);
@@ -0,0 +1,144 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include "constexpr_tables.h"
+#include "tsc_clock.h"
+
+// HDR-style log-linear latency histogram. Each power of two is split into
+// 2^kSubBucketBits linear sub-buckets, so every recorded value is kept to
+// within ~3% relative error over the full uint64_t range, in a fixed 15 KB
+// table with no allocation. record() is a clz, a shift and an increment;
+// bucket edges come from tables built at compile time.
+// Histograms are per-thread; merge() combines them for reporting.
+class LatencyHistogram {
+public:
+    static constexpr unsigned kSubBucketBits = 5;
+    static constexpr uint64_t kSubBuckets = uint64_t{1} << kSubBucketBits;
+    static constexpr size_t kBucketCount = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+    void record(uint64_t value) {
+        ++counts_[bucket_index(value)];
+        ++total_;
+        sum_ += value;
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < kBucketCount; ++i) {
+            counts_[i] += other.counts_[i];
+        }
+        total_ += other.total_;
+        sum_ += other.sum_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+
+    void reset() { *this = LatencyHistogram{}; }
+
+    uint64_t count() const { return total_; }
+    uint64_t min() const { return total_ ? min_ : 0; }
+    uint64_t max() const { return max_; }
+    double mean() const { return total_ ? static_cast<double>(sum_) / total_ : 0.0; }
+
+    // Smallest recorded bucket value v such that p percent of samples are <= v
+    // (reported as the bucket's upper edge, clamped to the observed max)
+    uint64_t percentile(double p) const {
+        if (total_ == 0) {
+            return 0;
+        }
+        uint64_t rank = static_cast<uint64_t>(p / 100.0 * static_cast<double>(total_) + 0.5);
+        rank = std::max<uint64_t>(1, std::min(rank, total_));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBucketCount; ++i) {
+            seen += counts_[i];
+            if (seen >= rank) {
+                return std::min(bucket_upper(i), max_);
+            }
+        }
+        return max_;
+    }
+
+    // One-line summary, values in the recorded unit (ns)
+    void print(std::ostream& out, const char* label) const {
+        out << "  " << label << " latency (ns): p50=" << percentile(50.0)
+            << " p90=" << percentile(90.0)
+            << " p99=" << percentile(99.0)
+            << " p99.9=" << percentile(99.9)
+            << " max=" << max() << " (n=" << count() << ")\n";
+    }
+
+    static constexpr size_t bucket_index(uint64_t value) {
+        if (value < kSubBuckets) {
+            return static_cast<size_t>(value);
+        }
+        unsigned msb = 63 - static_cast<unsigned>(__builtin_clzll(value));
+        unsigned shift = msb - kSubBucketBits;
+        size_t group = shift + 1;
+        return group * kSubBuckets + static_cast<size_t>((value >> shift) - kSubBuckets);
+    }
+
+    static uint64_t bucket_lower(size_t index) { return kLowerEdges[index]; }
+    static uint64_t bucket_upper(size_t index) { return kUpperEdges[index]; }
+
+private:
+    static constexpr uint64_t lower_edge(size_t index) {
+        if (index < kSubBuckets) {
+            return index;
+        }
+        size_t group = index / kSubBuckets;
+        uint64_t sub = index % kSubBuckets;
+        return (kSubBuckets + sub) << (group - 1);
+    }
+
+    static constexpr uint64_t upper_edge(size_t index) {
+        if (index < kSubBuckets) {
+            return index;
+        }
+        size_t group = index / kSubBuckets;
+        return lower_edge(index) + ((uint64_t{1} << (group - 1)) - 1);
+    }
+
+public:
+    // Bucket edges, built at compile time (defined below the class)
+    static const std::array<uint64_t, kBucketCount> kLowerEdges;
+    static const std::array<uint64_t, kBucketCount> kUpperEdges;
+
+private:
+    std::array<uint64_t, kBucketCount> counts_{};
+    uint64_t total_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t min_ = ~uint64_t{0};
+    uint64_t max_ = 0;
+};
+
+inline constexpr std::array<uint64_t, LatencyHistogram::kBucketCount> LatencyHistogram::kLowerEdges =
+    tables::make_table<uint64_t, LatencyHistogram::kBucketCount>(LatencyHistogram::lower_edge);
+inline constexpr std::array<uint64_t, LatencyHistogram::kBucketCount> LatencyHistogram::kUpperEdges =
+    tables::make_table<uint64_t, LatencyHistogram::kBucketCount>(LatencyHistogram::upper_edge);
+
+static_assert(LatencyHistogram::kUpperEdges[LatencyHistogram::kBucketCount - 1] == ~uint64_t{0},
+              "last bucket ends at the top of the range");
+static_assert(LatencyHistogram::bucket_index(LatencyHistogram::kLowerEdges[1000]) == 1000 &&
+              LatencyHistogram::bucket_index(LatencyHistogram::kUpperEdges[1000]) == 1000,
+              "edges map back to their bucket");
+
+// Times a scope into a histogram (fenced TSC reads, recorded in nanoseconds)
+class ScopedLatency {
+public:
+    explicit ScopedLatency(LatencyHistogram& histogram)
+        : histogram_(histogram), start_(tsc::start()) {}
+
+    ~ScopedLatency() {
+        histogram_.record(TscClock::instance().to_ns(tsc::stop() - start_));
+    }
+
+    ScopedLatency(const ScopedLatency&) = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+private:
+    LatencyHistogram& histogram_;
+    uint64_t start_;
+};
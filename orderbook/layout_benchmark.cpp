@@ -0,0 +1,418 @@
+// Layout benchmark: the multi-core side of the single-threaded padding
+// demos in ../L5. Pinned threads run the same work over different memory
+// layouts, and every configuration reports its throughput:
+// - per-thread counters adjacent in one line vs alignas(64) / alignas(128);
+// - an SPSC ring whose cursors share a line vs Fifo3's padded cursors;
+// - packed (#pragma pack), naturally aligned and line-padded records, by one
+//   thread at random and by threads owning interleaved records;
+// - order records as an array of structs, a struct of arrays, and a hot/cold
+//   split like OrderNode / OrderMeta, scanned and looked up at random.
+//
+//   layout_benchmark [--threads <n>] [--ops <per thread>] [--cpus <c0>,<c1>,...]
+#include "order_book.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <pthread.h>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Options {
+    size_t threads = std::max(2u, std::thread::hardware_concurrency());
+    size_t ops = 20000000;
+    std::vector<int> cpus;   // Thread i runs on cpus[i % size]; empty: CPU i % cores
+
+    int cpu_for(size_t thread) const {
+        if (!cpus.empty()) {
+            return cpus[thread % cpus.size()];
+        }
+        return static_cast<int>(thread % std::max(1u, std::thread::hardware_concurrency()));
+    }
+};
+
+void pin_to(int cpu) {
+    if (cpu < 0) {
+        return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+void report(const std::string& label, double ops, double seconds) {
+    std::cout << "  " << label << ": " << ops / seconds / 1e6 << " M ops/s ("
+              << seconds * 1e9 / ops << " ns/op)\n";
+}
+
+// Run body(thread) on `threads` pinned threads released together; returns
+// the seconds from release until the last one finished
+template<typename Body>
+double run_threads(const Options& options, size_t threads, Body body) {
+    std::atomic<size_t> ready{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            pin_to(options.cpu_for(t));
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire)) {}
+            body(t);
+        });
+    }
+    while (ready.load() != threads) {}
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// --- Counters -------------------------------------------------------------
+
+template<size_t Align>
+struct alignas(Align) Counter {
+    std::atomic<uint64_t> value{0};
+};
+
+// Each thread bumps only its own counter; any slowdown with the threads'
+// counters closer together is false sharing
+template<size_t Align>
+void counters(const Options& options, const char* layout) {
+    auto slots = std::make_unique<Counter<Align>[]>(options.threads);
+    double store_s = run_threads(options, options.threads, [&](size_t t) {
+        auto& value = slots[t].value;
+        for (size_t i = 0; i < options.ops; ++i) {
+            value.store(value.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            asm volatile("" ::: "memory");   // One load and one store per iteration
+        }
+    });
+    double rmw_s = run_threads(options, options.threads, [&](size_t t) {
+        auto& value = slots[t].value;
+        for (size_t i = 0; i < options.ops; ++i) {
+            value.fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+    double total = static_cast<double>(options.ops * options.threads);
+    report(std::string(layout) + ", single-writer store", total, store_s);
+    report(std::string(layout) + ", fetch_add", total, rmw_s);
+}
+
+// --- SPSC cursors ---------------------------------------------------------
+
+// Fifo3's algorithm with the cursor placement as the only variable
+template<bool PaddedCursors>
+class CursorRing {
+public:
+    explicit CursorRing(size_t capacity) : mask_(capacity - 1), ring_(capacity) {}
+
+    bool push(uint64_t value) {
+        uint64_t push = cursors_.push.load(std::memory_order_relaxed);
+        if (push - cursors_.pop.load(std::memory_order_acquire) == ring_.size()) {
+            return false;
+        }
+        ring_[push & mask_] = value;
+        cursors_.push.store(push + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(uint64_t& value) {
+        uint64_t pop = cursors_.pop.load(std::memory_order_relaxed);
+        if (cursors_.push.load(std::memory_order_acquire) == pop) {
+            return false;
+        }
+        value = ring_[pop & mask_];
+        cursors_.pop.store(pop + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    struct Packed {
+        std::atomic<uint64_t> push{0};
+        std::atomic<uint64_t> pop{0};
+    };
+    struct Padded {
+        alignas(64) std::atomic<uint64_t> push{0};
+        alignas(64) std::atomic<uint64_t> pop{0};
+    };
+
+    size_t mask_;
+    std::vector<uint64_t> ring_;
+    alignas(64) std::conditional_t<PaddedCursors, Padded, Packed> cursors_;
+};
+
+template<typename Ring>
+void ring_transfer(const Options& options, const char* label) {
+    Ring ring(4096);
+    uint64_t checksum = 0;
+    double seconds = run_threads(options, 2, [&](size_t t) {
+        if (t == 0) {
+            for (uint64_t i = 0; i < options.ops; ++i) {
+                while (!ring.push(i)) {}
+            }
+        } else {
+            uint64_t value = 0;
+            for (size_t i = 0; i < options.ops; ++i) {
+                while (!ring.pop(value)) {}
+                checksum += value;
+            }
+        }
+    });
+    report(label, static_cast<double>(options.ops), seconds);
+    if (checksum != options.ops * (options.ops - 1) / 2) {
+        std::cout << "  (checksum mismatch)\n";
+    }
+}
+
+// --- Record packing -------------------------------------------------------
+
+// The demo's Box followed by a one-byte tag, three ways
+#pragma pack(push, 1)
+struct PackedBox {
+    uint64_t size;
+    uint64_t length;
+    char tag;
+};
+#pragma pack(pop)
+struct NaturalBox {
+    uint64_t size;
+    uint64_t length;
+    char tag;
+};
+struct alignas(64) PaddedBox {
+    uint64_t size;
+    uint64_t length;
+    char tag;
+};
+static_assert(sizeof(PackedBox) == 17 && sizeof(NaturalBox) == 24 && sizeof(PaddedBox) == 64,
+              "box layouts");
+
+// One thread, random records across a working set of `bytes`
+template<typename Box>
+void random_updates(const Options& options, const char* layout, size_t bytes) {
+    size_t count = bytes / sizeof(Box);
+    std::vector<Box> boxes(count);
+    std::vector<uint32_t> order(1 << 16);   // Stays in L2 beside the records
+    std::mt19937 rng(5);
+    for (auto& index : order) {
+        index = static_cast<uint32_t>(rng() % count);
+    }
+    double seconds = run_threads(options, 1, [&](size_t) {
+        for (size_t i = 0; i < options.ops; ++i) {
+            Box& box = boxes[order[i & (order.size() - 1)]];
+            box.size += box.length + 1;
+        }
+    });
+    report(std::string(layout) + " (" + std::to_string(sizeof(Box)) + " B), " +
+               std::to_string(bytes >> 10) + " KiB set",
+           static_cast<double>(options.ops), seconds);
+}
+
+// Thread t owns records t, t + N, t + 2N ...: neighbours belong to other threads
+template<typename Box>
+void interleaved_updates(const Options& options, const char* layout) {
+    constexpr size_t kRecords = 1024;
+    std::vector<Box> boxes(kRecords);
+    double seconds = run_threads(options, options.threads, [&](size_t t) {
+        size_t owned = kRecords / options.threads;
+        for (size_t i = 0; i < options.ops; ++i) {
+            Box& box = boxes[t + (i % owned) * options.threads];
+            box.size += 1;
+            asm volatile("" ::"r"(&box) : "memory");   // Keep every store
+        }
+    });
+    report(std::string(layout) + ", interleaved owners",
+           static_cast<double>(options.ops * options.threads), seconds);
+}
+
+// --- Order records --------------------------------------------------------
+
+struct OrderRecord {
+    uint64_t order_id;
+    Price price;
+    uint64_t quantity;
+    uint64_t timestamp_ns;
+    PriceLevelQueue* level;
+    OrderRecord* next;
+};
+
+struct OrderColumns {
+    std::vector<uint64_t> order_id;
+    std::vector<Price> price;
+    std::vector<uint64_t> quantity;
+    std::vector<uint64_t> timestamp_ns;
+};
+
+// Per-thread partitions of the same records in each layout
+struct OrderTables {
+    explicit OrderTables(size_t count) : aos(count), hot(count), cold(count) {
+        std::mt19937_64 rng(3);
+        soa.order_id.resize(count);
+        soa.price.resize(count);
+        soa.quantity.resize(count);
+        soa.timestamp_ns.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            Price price = 100000 + static_cast<Price>(rng() % 64);
+            uint64_t quantity = 1 + rng() % 1000;
+            aos[i] = OrderRecord{i, price, quantity, i * 7, nullptr, nullptr};
+            soa.order_id[i] = i;
+            soa.price[i] = price;
+            soa.quantity[i] = quantity;
+            soa.timestamp_ns[i] = i * 7;
+            hot[i] = Hot{price, quantity};
+            cold[i] = Cold{i, i * 7};
+        }
+    }
+
+    // The book keeps price on the level; here it rides with the hot fields
+    struct Hot {
+        Price price;
+        uint64_t quantity;
+    };
+    struct Cold {
+        uint64_t order_id;
+        uint64_t timestamp_ns;
+    };
+
+    std::vector<OrderRecord> aos;
+    OrderColumns soa;
+    std::vector<Hot> hot;
+    std::vector<Cold> cold;
+};
+
+// Depth-style scan: quantity resting at one price (touches price and quantity)
+// and cancel-style lookups: every field of random records
+void order_records(const Options& options) {
+    constexpr size_t kRecords = size_t{1} << 22;
+    OrderTables tables(kRecords);
+    size_t threads = options.threads;
+    size_t part = kRecords / threads;
+    size_t scan_passes = std::max<size_t>(1, options.ops / kRecords);
+    size_t lookups = options.ops / 4;
+    std::vector<uint64_t> sink(threads * 8);
+
+    auto scan = [&](const char* label, auto&& body) {
+        double seconds = run_threads(options, threads, [&](size_t t) {
+            uint64_t total = 0;
+            for (size_t pass = 0; pass < scan_passes; ++pass) {
+                total += body(t * part, (t + 1) * part, static_cast<Price>(100000 + pass % 64));
+            }
+            sink[t * 8] = total;
+        });
+        report(std::string(label) + ", price scan",
+               static_cast<double>(scan_passes * part * threads), seconds);
+    };
+    scan("array of structs (48 B)", [&](size_t begin, size_t end, Price price) {
+        uint64_t total = 0;
+        for (size_t i = begin; i < end; ++i) {
+            total += tables.aos[i].price == price ? tables.aos[i].quantity : 0;
+        }
+        return total;
+    });
+    scan("struct of arrays", [&](size_t begin, size_t end, Price price) {
+        uint64_t total = 0;
+        for (size_t i = begin; i < end; ++i) {
+            total += tables.soa.price[i] == price ? tables.soa.quantity[i] : 0;
+        }
+        return total;
+    });
+    scan("hot/cold split (16 + 16 B)", [&](size_t begin, size_t end, Price price) {
+        uint64_t total = 0;
+        for (size_t i = begin; i < end; ++i) {
+            total += tables.hot[i].price == price ? tables.hot[i].quantity : 0;
+        }
+        return total;
+    });
+
+    auto lookup = [&](const char* label, auto&& body) {
+        double seconds = run_threads(options, threads, [&](size_t t) {
+            std::mt19937_64 rng(t + 1);
+            uint64_t total = 0;
+            for (size_t i = 0; i < lookups; ++i) {
+                total += body(t * part + rng() % part);
+            }
+            sink[t * 8] = total;
+        });
+        report(std::string(label) + ", random full reads",
+               static_cast<double>(lookups * threads), seconds);
+    };
+    lookup("array of structs (48 B)", [&](size_t i) {
+        const OrderRecord& r = tables.aos[i];
+        return r.order_id + static_cast<uint64_t>(r.price) + r.quantity + r.timestamp_ns;
+    });
+    lookup("struct of arrays", [&](size_t i) {
+        return tables.soa.order_id[i] + static_cast<uint64_t>(tables.soa.price[i]) +
+               tables.soa.quantity[i] + tables.soa.timestamp_ns[i];
+    });
+    lookup("hot/cold split (16 + 16 B)", [&](size_t i) {
+        return tables.cold[i].order_id + static_cast<uint64_t>(tables.hot[i].price) +
+               tables.hot[i].quantity + tables.cold[i].timestamp_ns;
+    });
+    uint64_t total = 0;
+    for (uint64_t value : sink) {
+        total += value;
+    }
+    std::cout << "  (checksum " << total << ")\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], "--threads") == 0) {
+            options.threads = std::max<size_t>(1, std::strtoull(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--ops") == 0) {
+            options.ops = std::max<size_t>(2, std::strtoull(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--cpus") == 0) {
+            for (char* p = argv[++i]; *p;) {
+                char* end = nullptr;
+                long cpu = std::strtol(p, &end, 10);
+                if (end == p) {
+                    break;
+                }
+                options.cpus.push_back(static_cast<int>(cpu));
+                p = *end == ',' ? end + 1 : end;
+            }
+        }
+    }
+    std::cout << "=== Layout benchmark: " << options.threads << " threads, " << options.ops
+              << " ops per thread, " << std::thread::hardware_concurrency() << " CPUs ===\n";
+    if (std::thread::hardware_concurrency() < 2) {
+        std::cout << "  (one CPU: threads time-share, so sharing effects do not show)\n";
+    }
+
+    std::cout << "\n--- Per-thread counters ---\n";
+    counters<8>(options, "adjacent (8 B apart)");
+    counters<64>(options, "alignas(64)");
+    counters<128>(options, "alignas(128)");
+
+    std::cout << "\n--- SPSC ring cursors (producer on cpu " << options.cpu_for(0)
+              << ", consumer on cpu " << options.cpu_for(1) << ") ---\n";
+    ring_transfer<CursorRing<false>>(options, "cursors in one line");
+    ring_transfer<CursorRing<true>>(options, "cursors padded (Fifo3 layout)");
+    ring_transfer<Fifo3<uint64_t, std::allocator<uint64_t>, true>>(options, "Fifo3 (masked)");
+
+    std::cout << "\n--- Record packing ---\n";
+    for (size_t bytes : {size_t{32} << 10, size_t{64} << 20}) {
+        random_updates<PackedBox>(options, "packed", bytes);
+        random_updates<NaturalBox>(options, "natural", bytes);
+        random_updates<PaddedBox>(options, "alignas(64)", bytes);
+    }
+    interleaved_updates<PackedBox>(options, "packed");
+    interleaved_updates<NaturalBox>(options, "natural");
+    interleaved_updates<PaddedBox>(options, "alignas(64)");
+
+    std::cout << "\n--- Order records (" << (size_t{1} << 22) << " orders) ---\n";
+    order_records(options);
+    return 0;
+}
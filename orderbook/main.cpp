@@ -1,33 +1,67 @@
 #include "order_book.h"
+#include "concurrent_pool.h"
+#include "book_manager.h"
+#include "journal.h"
+#include "latency_histogram.h"
+#include "workload.h"
+#include "snapshot_seqlock.h"
+#include "tsc_clock.h"
+#include "itch.h"
+#include "arena.h"
+#include "slab_allocator.h"
+#include "pooled_ptr.h"
+#include "shared_snapshot.h"
+#include "perf_counters.h"
+#include "parallel_replay.h"
+#include "../SPSC_QUEUES/spsc_q4.cpp"
+#include "../SPSC_QUEUES/mpsc_q.cpp"
+#include "../SPSC_QUEUES/mpmc_q.cpp"
+#include "../SPSC_QUEUES/shm_q.cpp"
+#include "../lockFreeWaitFree/lockFreeSkipList.h"
+#include <cstdio>
+#include <cstring>
 #include <chrono>
 #include <random>
 #include <algorithm>
 #include <cassert>
 #include <iostream>
+#include <map>
+#include <unordered_map>
+#include <thread>
+#include <csignal>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
-// High-resolution timer
+// Interval timer on fenced TSC reads
 class Timer {
 public:
-    Timer() : start_(std::chrono::high_resolution_clock::now()) {}
+    Timer() : start_(tsc::start()) {}
     
     double elapsed_us() const {
-        auto end = std::chrono::high_resolution_clock::now();
-        return std::chrono::duration<double, std::micro>(end - start_).count();
+        return TscClock::instance().to_ns(tsc::stop() - start_) / 1000.0;
     }
     
     void reset() {
-        start_ = std::chrono::high_resolution_clock::now();
+        start_ = tsc::start();
     }
     
 private:
-    std::chrono::high_resolution_clock::time_point start_;
+    uint64_t start_;
 };
 
 // Get current timestamp in nanoseconds
 uint64_t get_timestamp_ns() {
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(
-        std::chrono::high_resolution_clock::now().time_since_epoch()
-    ).count();
+    return TscClock::instance().now_ns();
+}
+
+// Instrument tick size used by the tests and benchmark
+const TickSize kTickSize{0.01};
+
+Price ticks(double price) {
+    return kTickSize.to_ticks(price);
 }
 
 // Test basic functionality
@@ -37,11 +71,11 @@ void test_basic_operations() {
     OrderBook book;
     
     // Add orders
-    book.add_order(Order(1, true, 100.0, 10, get_timestamp_ns()));
-    book.add_order(Order(2, true, 100.0, 20, get_timestamp_ns()));
-    book.add_order(Order(3, true, 99.5, 15, get_timestamp_ns()));
-    book.add_order(Order(4, false, 101.0, 25, get_timestamp_ns()));
-    book.add_order(Order(5, false, 101.5, 30, get_timestamp_ns()));
+    book.add_order(Order(1, true, ticks(100.0), 10, get_timestamp_ns()));
+    book.add_order(Order(2, true, ticks(100.0), 20, get_timestamp_ns()));
+    book.add_order(Order(3, true, ticks(99.5), 15, get_timestamp_ns()));
+    book.add_order(Order(4, false, ticks(101.0), 25, get_timestamp_ns()));
+    book.add_order(Order(5, false, ticks(101.5), 30, get_timestamp_ns()));
     
     book.print_book(5);
     
@@ -54,9 +88,9 @@ void test_basic_operations() {
     
     assert(bids.size() == 2);
     assert(asks.size() == 2);
-    assert(bids[0].price == 100.0);
+    assert(bids[0].price == ticks(100.0));
     assert(bids[0].total_quantity == 30); // 10 + 20
-    assert(bids[1].price == 99.5);
+    assert(bids[1].price == ticks(99.5));
     assert(bids[1].total_quantity == 15);
     std::cout << "✓ Snapshot test passed\n";
     
@@ -70,7 +104,7 @@ void test_basic_operations() {
     std::cout << "✓ Cancel order test passed\n";
     
     // Amend quantity (same price)
-    bool amended = book.amend_order(1, 100.0, 50);
+    bool amended = book.amend_order(1, ticks(100.0), 50);
     assert(amended);
     
     book.get_snapshot(2, bids, asks);
@@ -78,26 +112,31 @@ void test_basic_operations() {
     std::cout << "✓ Amend quantity test passed\n";
     
     // Amend price (loses time priority)
-    amended = book.amend_order(1, 99.0, 50);
+    amended = book.amend_order(1, ticks(99.0), 50);
     assert(amended);
     
     book.get_snapshot(3, bids, asks);
-    assert(bids[0].price == 99.5);
-    assert(bids[1].price == 99.0);
+    assert(bids[0].price == ticks(99.5));
+    assert(bids[1].price == ticks(99.0));
     std::cout << "✓ Amend price test passed\n";
     
     book.print_book(5);
     
+    // Tick conversion absorbs binary rounding noise at the API edge
+    assert(ticks(0.1 + 0.2) == ticks(0.3));
+    assert(kTickSize.to_ticks(kTickSize.to_price(10050)) == 10050);
+    std::cout << "✓ Tick conversion test passed\n";
+    
     std::cout << "\n✅ All basic tests passed!\n\n";
 }
 
 // Benchmark performance
-void benchmark_performance() {
-    std::cout << "=== Performance Benchmark ===\n";
+void benchmark_performance(const char* label, const OrderBookConfig& config) {
+    std::cout << "=== Performance Benchmark (" << label << ") ===\n";
     
-    OrderBook book;
+    OrderBook book(config);
     std::mt19937_64 rng(42);
-    std::uniform_real_distribution<double> price_dist(90.0, 110.0);
+    std::uniform_int_distribution<Price> price_dist(ticks(90.0), ticks(110.0));
     std::uniform_int_distribution<uint64_t> qty_dist(1, 1000);
     std::uniform_int_distribution<int> side_dist(0, 1);
     
@@ -105,58 +144,110 @@ void benchmark_performance() {
     std::vector<uint64_t> order_ids;
     order_ids.reserve(num_orders);
     
-    // Benchmark: Add orders
+    // Hardware counters around each phase (timing overhead included, like
+    // the totals); whatever the machine does not expose is left out
+    PerfCounters perf;
+    if (!perf.missing().empty()) {
+        std::cout << "  perf counters unavailable: " << perf.missing() << "\n";
+    }
+    
+    // Benchmark: Add orders (each call timed into a histogram; totals
+    // include the per-call timing overhead)
+    LatencyHistogram add_latency;
+    CoarseClock stamp;
     Timer timer;
+    perf.start();
     for (size_t i = 0; i < num_orders; ++i) {
+        if (i % 64 == 0) {
+            stamp.refresh();   // One clock read per 64 orders, like a feed batch
+        }
         Order order(
             i + 1,
             side_dist(rng) == 1,
-            std::round(price_dist(rng) * 100.0) / 100.0, // Round to 2 decimals
+            price_dist(rng),
             qty_dist(rng),
-            get_timestamp_ns()
+            stamp.now_ns()
         );
-        book.add_order(order);
+        {
+            ScopedLatency scope(add_latency);
+            book.add_order(order);
+        }
         order_ids.push_back(order.order_id);
     }
+    PerfSample add_counters = perf.stop();
     double add_time = timer.elapsed_us();
     double avg_add_time = add_time / num_orders;
     
     std::cout << "Added " << num_orders << " orders\n";
     std::cout << "  Total time: " << add_time / 1000.0 << " ms\n";
     std::cout << "  Average: " << avg_add_time << " μs per order\n";
-    std::cout << "  Throughput: " << (num_orders / (add_time / 1e6)) << " orders/sec\n\n";
+    std::cout << "  Throughput: " << (num_orders / (add_time / 1e6)) << " orders/sec\n";
+    add_latency.print(std::cout, "add");
+    add_counters.print(std::cout, "add", num_orders);
+    std::cout << "\n";
     
     // Benchmark: Snapshots
     timer.reset();
     const size_t num_snapshots = 10000;
     std::vector<PriceLevel> bids, asks;
+    LatencyHistogram snapshot_latency;
     
+    perf.start();
     for (size_t i = 0; i < num_snapshots; ++i) {
+        ScopedLatency scope(snapshot_latency);
         book.get_snapshot(10, bids, asks);
     }
+    PerfSample snapshot_counters = perf.stop();
     double snapshot_time = timer.elapsed_us();
     double avg_snapshot_time = snapshot_time / num_snapshots;
     
     std::cout << "Generated " << num_snapshots << " snapshots (depth=10)\n";
     std::cout << "  Total time: " << snapshot_time / 1000.0 << " ms\n";
-    std::cout << "  Average: " << avg_snapshot_time << " μs per snapshot\n\n";
+    std::cout << "  Average: " << avg_snapshot_time << " μs per snapshot\n";
+    snapshot_latency.print(std::cout, "snapshot");
+    snapshot_counters.print(std::cout, "snapshot", num_snapshots);
+    
+    // Fixed-array view with version check (typical polling strategy)
+    BookSnapshot<10> view;
+    timer.reset();
+    for (size_t i = 0; i < num_snapshots; ++i) {
+        book.get_snapshot(view);
+    }
+    double view_time = timer.elapsed_us();
+    std::cout << "  Fixed-array polled view: " << view_time / num_snapshots
+              << " μs per call\n\n";
     
     // Benchmark: Cancellations
     // Shuffle the order IDs to test random cancellations
     std::shuffle(order_ids.begin(), order_ids.end(), rng);
     const size_t num_cancels = std::min(num_orders / 2, (size_t)50000);
     
-    timer.reset();
+    // Cancels arrive in feed-sized bursts through the batch API
+    std::vector<Command> cancels;
+    cancels.reserve(num_cancels);
     for (size_t i = 0; i < num_cancels; ++i) {
-        book.cancel_order(order_ids[i]);
+        cancels.push_back(Command::cancel(order_ids[i]));
+    }
+    const size_t burst = 32;
+    LatencyHistogram cancel_batch_latency;
+    
+    timer.reset();
+    perf.start();
+    for (size_t i = 0; i < num_cancels; i += burst) {
+        ScopedLatency scope(cancel_batch_latency);
+        book.apply_batch(&cancels[i], std::min(burst, num_cancels - i));
     }
+    PerfSample cancel_counters = perf.stop();
     double cancel_time = timer.elapsed_us();
     double avg_cancel_time = cancel_time / num_cancels;
     
-    std::cout << "Cancelled " << num_cancels << " orders\n";
+    std::cout << "Cancelled " << num_cancels << " orders (batches of " << burst << ")\n";
     std::cout << "  Total time: " << cancel_time / 1000.0 << " ms\n";
     std::cout << "  Average: " << avg_cancel_time << " μs per cancel\n";
-    std::cout << "  Throughput: " << (num_cancels / (cancel_time / 1e6)) << " cancels/sec\n\n";
+    std::cout << "  Throughput: " << (num_cancels / (cancel_time / 1e6)) << " cancels/sec\n";
+    cancel_batch_latency.print(std::cout, "cancel batch");
+    cancel_counters.print(std::cout, "cancel", num_cancels);
+    std::cout << "\n";
     
     // Benchmark: Amendments
     std::vector<uint64_t> remaining_ids;
@@ -165,23 +256,42 @@ void benchmark_performance() {
     }
     
     const size_t num_amends = std::min(remaining_ids.size(), (size_t)10000);
+    LatencyHistogram amend_latency;
     timer.reset();
+    perf.start();
     
     for (size_t i = 0; i < num_amends; ++i) {
-        double new_price = std::round(price_dist(rng) * 100.0) / 100.0;
+        Price new_price = price_dist(rng);
         uint64_t new_qty = qty_dist(rng);
+        ScopedLatency scope(amend_latency);
         book.amend_order(remaining_ids[i], new_price, new_qty);
     }
+    PerfSample amend_counters = perf.stop();
     double amend_time = timer.elapsed_us();
     double avg_amend_time = amend_time / num_amends;
     
     std::cout << "Amended " << num_amends << " orders\n";
     std::cout << "  Total time: " << amend_time / 1000.0 << " ms\n";
     std::cout << "  Average: " << avg_amend_time << " μs per amend\n";
-    std::cout << "  Throughput: " << (num_amends / (amend_time / 1e6)) << " amends/sec\n\n";
+    std::cout << "  Throughput: " << (num_amends / (amend_time / 1e6)) << " amends/sec\n";
+    amend_latency.print(std::cout, "amend");
+    amend_counters.print(std::cout, "amend", num_amends);
+    std::cout << "\n";
     
+    PoolStats pool = book.pool_stats();
     std::cout << "Final book state:\n";
-    std::cout << "  Active orders: " << book.get_order_count() << "\n\n";
+    std::cout << "  Active orders: " << book.get_order_count() << "\n";
+    std::cout << "  Pool high-water mark: " << pool.high_water
+              << " (capacity " << pool.capacity << ")\n\n";
+    
+#ifdef ORDERBOOK_INSTRUMENTATION
+    std::cout << "In-book instrumentation:\n";
+    book.latency().add.print(std::cout, "add");
+    book.latency().cancel.print(std::cout, "cancel");
+    book.latency().amend.print(std::cout, "amend");
+    book.latency().snapshot.print(std::cout, "snapshot");
+    std::cout << "\n";
+#endif
     
     book.print_book(5);
 }
@@ -193,9 +303,9 @@ void test_fifo_priority() {
     OrderBook book;
     
     // Add multiple orders at same price
-    book.add_order(Order(1, true, 100.0, 10, get_timestamp_ns()));
-    book.add_order(Order(2, true, 100.0, 20, get_timestamp_ns()));
-    book.add_order(Order(3, true, 100.0, 30, get_timestamp_ns()));
+    book.add_order(Order(1, true, ticks(100.0), 10, get_timestamp_ns()));
+    book.add_order(Order(2, true, ticks(100.0), 20, get_timestamp_ns()));
+    book.add_order(Order(3, true, ticks(100.0), 30, get_timestamp_ns()));
     
     std::vector<PriceLevel> bids, asks;
     book.get_snapshot(1, bids, asks);
@@ -209,9 +319,2590 @@ void test_fifo_priority() {
     assert(bids[0].total_quantity == 40);
     std::cout << "✓ FIFO cancellation test passed\n";
     
+    // Intrusive links keep arrival order through unlinks at any position
+    OrderNode a(Order(10, true, ticks(100.0), 1, 0));
+    OrderNode b(Order(11, true, ticks(100.0), 2, 0));
+    OrderNode c(Order(12, true, ticks(100.0), 3, 0));
+    PriceLevelQueue level;
+    level.add_order(&a);
+    level.add_order(&b);
+    level.add_order(&c);
+    level.remove_order(&b);
+    assert(level.front() == &a && a.next == &c && c.prev == &a);
+    level.remove_order(&a);
+    assert(level.front() == &c && c.prev == nullptr);
+    level.remove_order(&c);
+    assert(level.is_empty() && level.get_total_quantity() == 0);
+    std::cout << "✓ Intrusive FIFO link test passed\n";
+    
     std::cout << "\n✅ FIFO priority tests passed!\n\n";
 }
 
+// Pool recycles destroyed slots instead of growing under churn
+void test_memory_pool() {
+    std::cout << "=== Testing Memory Pool ===\n";
+    
+    MemoryPool<OrderNode, 64> pool;
+    OrderNode* first = pool.construct(Order(1, true, 0, 1, 0));
+    pool.destroy(first);
+    OrderNode* reused = pool.construct(Order(2, true, 0, 1, 0));
+    assert(reused == first); // Most recently freed slot comes back first
+    pool.destroy(reused);
+    
+    for (int round = 0; round < 1000; ++round) {
+        OrderNode* nodes[32];
+        for (auto& node : nodes) node = pool.construct(Order(3, false, 0, 1, 0));
+        for (auto* node : nodes) pool.destroy(node);
+    }
+    PoolStats stats = pool.stats();
+    assert(stats.live == 0);
+    assert(stats.high_water == 32);
+    assert(stats.blocks == 1);
+    std::cout << "✓ Slot recycling test passed\n";
+    
+    pool.reserve(1000);
+    assert(pool.stats().capacity >= 1000);
+    size_t blocks = pool.stats().blocks;
+    std::vector<OrderNode*> nodes;
+    for (int i = 0; i < 1000; ++i) nodes.push_back(pool.construct(Order(4, true, 0, 1, 0)));
+    assert(pool.stats().blocks == blocks); // Served from reserved blocks
+    for (auto* node : nodes) pool.destroy(node);
+    std::cout << "✓ Capacity reservation test passed\n";
+    
+    // Hot nodes stay 32-byte aligned; metadata is found from the node alone
+    OrderPool split;
+    split.reserve(5000);
+    std::vector<OrderNode*> hot;
+    for (uint64_t id = 1; id <= 5000; ++id) {
+        Order order(id, id % 2 == 0, ticks(100.0), id, id * 10);
+        hot.push_back(split.construct(OrderMeta(order), order));
+    }
+    assert(split.stats().blocks == 2);
+    for (uint64_t id = 1; id <= 5000; ++id) {
+        OrderNode* node = hot[id - 1];
+        const OrderMeta& meta = OrderPool::cold(node);
+        assert(reinterpret_cast<uintptr_t>(node) % 32 == 0);
+        assert(node->quantity == id && meta.order_id == id && meta.timestamp_ns == id * 10);
+    }
+    OrderNode* freed = hot.back();
+    split.destroy(freed);
+    Order order(9, true, 0, 1, 0);
+    assert(split.construct(OrderMeta(order), order) == freed);
+    assert(OrderPool::cold(freed).order_id == 9);
+    hot.back() = freed;
+    for (auto* node : hot) split.destroy(node);
+    assert(split.stats().live == 0);
+    std::cout << "✓ Hot/cold split pool test passed\n";
+
+    // Region hands out aligned bump allocations, then reports exhaustion
+    MemoryRegion region(1 << 20, RegionOptions{PageSize::Default, true, false});
+    assert(region.size() == (1 << 20) && !region.huge_pages());
+    void* a = region.allocate(100, 8);
+    void* b = region.allocate(64, 4096);
+    assert(region.owns(a) && region.owns(b) && !region.owns(&region));
+    assert(reinterpret_cast<uintptr_t>(b) % 4096 == 0);
+    assert(region.allocate(1 << 20, 8) == nullptr);
+    {
+        MemoryPool<OrderNode, 64> carved(&region);
+        carved.reserve(256);
+        assert(region.owns(carved.construct(Order(5, true, 0, 1, 0))));
+    }
+    {
+        // Without reserved 1 GiB pages the fallback is sized in 2 MiB units
+        MemoryRegion fallback(100000, RegionOptions{PageSize::Huge1G, true, false});
+        assert(fallback.huge_pages() ? fallback.size() == MemoryRegion::page_bytes(PageSize::Huge1G)
+                                     : fallback.size() == MemoryRegion::page_bytes(PageSize::Huge2M));
+    }
+    std::cout << "✓ Memory region test passed\n";
+
+    // A pinned book serves its pool and index from the region and behaves
+    // exactly like a heap-backed one, including past the reserved capacity
+    OrderBookConfig config;
+    config.expected_orders = 3000;
+    OrderBook heap(config);
+    config.pinned_memory = true;
+    OrderBook pinned(config);
+    const MemoryRegion* pinned_region = pinned.memory_region();
+    assert(pinned_region && heap.memory_region() == nullptr);
+    size_t used = pinned_region->used();
+    assert(used >= OrderPool::bytes_for(3000) - (1 << 18) && used <= pinned_region->size());
+    for (uint64_t id = 1; id <= 10000; ++id) {
+        Order o(id, id % 2 == 0, ticks(100.0) + static_cast<Price>(id % 40) - 20, 1 + id % 7, id);
+        assert(heap.add_order(o) == pinned.add_order(o));
+        if (id % 3 == 0) assert(heap.cancel_order(id / 2) == pinned.cancel_order(id / 2));
+    }
+    std::vector<PriceLevel> hb, ha, pb, pa;
+    heap.get_snapshot(50, hb, ha);
+    pinned.get_snapshot(50, pb, pa);
+    assert(heap.get_order_count() == pinned.get_order_count());
+    assert(hb.size() == pb.size() && ha.size() == pa.size());
+    for (size_t i = 0; i < hb.size(); ++i) {
+        assert(hb[i].price == pb[i].price && hb[i].total_quantity == pb[i].total_quantity);
+    }
+    for (size_t i = 0; i < ha.size(); ++i) {
+        assert(ha[i].price == pa[i].price && ha[i].total_quantity == pa[i].total_quantity);
+    }
+    std::cout << "✓ Pinned memory book test passed\n";
+
+    // Gateway thread builds nodes, book thread frees them through its own
+    // cache; slots circulate in magazines and the pool stops growing
+    {
+        using NodePool = ConcurrentPool<OrderNode, 1024, 64>;
+        NodePool shared;
+        const uint64_t count = 200000;
+        double single_ns;
+        {
+            NodePool::Cache cache(shared);
+            OrderNode* first = cache.construct(uint64_t{1});
+            cache.destroy(first);
+            assert(cache.construct(uint64_t{2}) == first);   // LIFO within a cache
+            cache.destroy(first);
+            auto start = std::chrono::steady_clock::now();
+            for (uint64_t i = 0; i < count; ++i) {
+                OrderNode* nodes[16];
+                for (auto& node : nodes) node = cache.construct(i);
+                for (auto* node : nodes) cache.destroy(node);
+            }
+            single_ns = std::chrono::duration<double, std::nano>(
+                std::chrono::steady_clock::now() - start).count() / (16.0 * count);
+        }
+        assert(shared.stats().live == 0);
+        
+        Fifo3<OrderNode*> handoff(4096);
+        auto start = std::chrono::steady_clock::now();
+        std::thread book_thread([&] {
+            NodePool::Cache cache(shared);
+            OrderNode* node;
+            for (uint64_t expected = 0; expected < count;) {
+                if (!handoff.pop(node)) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                assert(node->quantity == expected);
+                ++expected;
+                cache.destroy(node);
+            }
+        });
+        {
+            NodePool::Cache cache(shared);
+            for (uint64_t i = 0; i < count; ++i) {
+                OrderNode* node = cache.construct(i);
+                while (!handoff.push(node)) {
+                    std::this_thread::yield();
+                }
+            }
+            book_thread.join();
+        }
+        double cross_ns = std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - start).count() / count;
+        PoolStats stats = shared.stats();
+        assert(stats.live == 0);
+        assert(stats.high_water <= 4096 + 8 * 64);   // In flight plus four magazines
+        std::cout << "  concurrent pool: " << single_ns << " ns/object on one thread, "
+                  << cross_ns << " ns/object through a handoff\n";
+    }
+    std::cout << "✓ Cross-thread concurrent pool test passed\n";
+    
+    // Owning pointers hand objects back to their pool (or just destroy them
+    // in an arena); the stateless deleters add no space over a raw pointer
+    {
+        MemoryPool<OrderNode, 64> owned_pool;
+        {
+            PooledPtr<OrderNode, MemoryPool<OrderNode, 64>> a =
+                make_pooled<OrderNode>(owned_pool, uint64_t{5});
+            auto b = make_pooled<OrderNode>(owned_pool, uint64_t{7});
+            OrderNode* slot = a.get();
+            assert(owned_pool.stats().live == 2 && a->quantity == 5);
+            a = std::move(b);   // The first node goes back to the pool
+            assert(owned_pool.stats().live == 1 && a->quantity == 7);
+            auto c = make_pooled<OrderNode>(owned_pool, uint64_t{9});
+            assert(c.get() == slot);
+        }
+        assert(owned_pool.stats().live == 0);
+        
+        Arena arena(4096);
+        {
+            ArenaPtr<std::vector<int>> values = make_in_arena<std::vector<int>>(arena, 100, 1);
+            assert(values->size() == 100);
+        }   // Destructor ran (the vector freed its heap buffer); the arena keeps the bytes
+        static_assert(sizeof(ArenaPtr<OrderNode>) == sizeof(OrderNode*), "pointer-sized");
+    }
+    std::cout << "✓ Pooled owning pointer test passed\n";
+
+    std::cout << "\n✅ Memory pool tests passed!\n\n";
+}
+
+// Batched commands match one-at-a-time calls and report per-command results
+void test_apply_batch() {
+    std::cout << "=== Testing Batch API ===\n";
+    
+    OrderBookConfig config;
+    config.ladder_levels = 256;
+    OrderBook single(config), batched(config);
+    
+    std::mt19937_64 rng(3);
+    std::uniform_int_distribution<Price> price_dist(ticks(99.0), ticks(101.0));
+    std::vector<Command> commands;
+    for (uint64_t id = 1; id <= 5000; ++id) {
+        commands.push_back(Command::add(Order(id, id % 2 == 0, price_dist(rng), 1 + rng() % 50, 0)));
+        if (id % 3 == 0) commands.push_back(Command::cancel(1 + rng() % id));
+        if (id % 5 == 0) commands.push_back(Command::amend(1 + rng() % id, price_dist(rng), 1 + rng() % 50));
+    }
+    commands.push_back(Command::add(Order(9999, true, ticks(90.0), 1, 0)));
+    commands.push_back(Command::add(Order(9999, true, ticks(90.0), 1, 0))); // Duplicate ID
+    
+    std::vector<char> expected(commands.size());
+    for (size_t i = 0; i < commands.size(); ++i) {
+        const Command& c = commands[i];
+        switch (c.type) {
+            case CommandType::Add: expected[i] = single.add_order(c.order); break;
+            case CommandType::Cancel: expected[i] = single.cancel_order(c.order.order_id); break;
+            case CommandType::Amend:
+                expected[i] = single.amend_order(c.order.order_id, c.order.price, c.order.quantity);
+                break;
+            case CommandType::Reduce:
+                expected[i] = single.reduce_order(c.order.order_id, c.order.quantity);
+                break;
+        }
+    }
+    
+    std::unique_ptr<bool[]> results(new bool[commands.size()]);
+    size_t ok = 0;
+    for (size_t i = 0; i < commands.size(); i += 64) {
+        size_t n = std::min<size_t>(64, commands.size() - i);
+        ok += batched.apply_batch(&commands[i], n, &results[i]);
+    }
+    size_t expected_ok = 0;
+    for (size_t i = 0; i < commands.size(); ++i) {
+        assert(results[i] == static_cast<bool>(expected[i]));
+        expected_ok += expected[i];
+    }
+    assert(ok == expected_ok);
+    assert(results[commands.size() - 2] && !results[commands.size() - 1]);
+    assert(single.get_order_count() == batched.get_order_count());
+    
+    std::vector<PriceLevel> a_bids, a_asks, b_bids, b_asks;
+    single.get_snapshot(500, a_bids, a_asks);
+    batched.get_snapshot(500, b_bids, b_asks);
+    assert(a_bids.size() == b_bids.size() && a_asks.size() == b_asks.size());
+    for (size_t i = 0; i < a_bids.size(); ++i) {
+        assert(a_bids[i].price == b_bids[i].price && a_bids[i].total_quantity == b_bids[i].total_quantity);
+    }
+    std::cout << "✓ Batch/single equivalence test passed\n";
+    
+    std::cout << "\n✅ Batch API tests passed!\n\n";
+}
+
+// Log-linear buckets keep percentiles within a few percent; merge is exact
+void test_latency_histogram() {
+    std::cout << "=== Testing Latency Histogram ===\n";
+    
+    LatencyHistogram low, high;
+    for (uint64_t v = 1; v <= 1000; ++v) {
+        low.record(v);
+    }
+    for (uint64_t v = 1; v <= 10; ++v) {
+        high.record(1000000 + v);
+    }
+    assert(low.count() == 1000 && low.min() == 1 && low.max() == 1000);
+    uint64_t p50 = low.percentile(50.0);
+    uint64_t p99 = low.percentile(99.0);
+    assert(p50 >= 500 && p50 <= 500 * 1.04);
+    assert(p99 >= 990 && p99 <= 990 * 1.04);
+    assert(low.percentile(100.0) == 1000);
+    
+    for (uint64_t v : {0ull, 31ull, 32ull, 1000ull, 123456789ull, ~0ull}) {
+        size_t i = LatencyHistogram::bucket_index(v);
+        assert(LatencyHistogram::bucket_lower(i) <= v && v <= LatencyHistogram::bucket_upper(i));
+    }
+    std::cout << "✓ Percentile accuracy test passed\n";
+    
+    LatencyHistogram merged;
+    merged.merge(low);
+    merged.merge(high);
+    assert(merged.count() == 1010 && merged.max() == 1000010 && merged.min() == 1);
+    assert(merged.percentile(99.9) >= 1000000);
+    assert(merged.percentile(50.0) == low.percentile(50.5));
+    std::cout << "✓ Merge test passed\n";
+    
+    std::cout << "\n✅ Latency histogram tests passed!\n\n";
+}
+
+// Calibrated TSC tracks steady_clock; the coarse clock only moves on refresh
+void test_tsc_clock() {
+    std::cout << "=== Testing TSC Clock ===\n";
+    
+    const TscClock& clock = TscClock::instance();
+    assert(clock.cycles_per_ns() > 0.1 && clock.cycles_per_ns() < 10.0);
+    uint64_t cycles = static_cast<uint64_t>(clock.cycles_per_ns() * 1e6);
+    assert(clock.to_ns(cycles) > 999000 && clock.to_ns(cycles) < 1001000);
+    
+    auto steady_begin = std::chrono::steady_clock::now();
+    uint64_t tsc_begin = clock.now_ns();
+    uint64_t previous = tsc_begin;
+    while (std::chrono::steady_clock::now() - steady_begin < std::chrono::milliseconds(20)) {
+        uint64_t now = clock.now_ns();
+        assert(now >= previous);
+        previous = now;
+    }
+    double steady_ns = std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - steady_begin).count();
+    double tsc_ns = static_cast<double>(clock.now_ns() - tsc_begin);
+    assert(std::abs(tsc_ns - steady_ns) < 0.02 * steady_ns + 200000);
+    std::cout << "✓ Calibration test passed (" << clock.cycles_per_ns() << " cycles/ns)\n";
+    
+    uint64_t start = tsc::start();
+    uint64_t stop = tsc::stop();
+    assert(stop >= start);
+    CoarseClock coarse;
+    uint64_t cached = coarse.now_ns();
+    assert(coarse.now_ns() == cached);
+    assert(coarse.refresh() >= cached && coarse.now_ns() >= cached);
+    std::cout << "✓ Fenced and coarse read test passed\n";
+    
+    std::cout << "\n✅ TSC clock tests passed!\n\n";
+}
+
+// ITCH messages decode into the same book as the equivalent direct calls
+void test_itch_decoder() {
+    std::cout << "=== Testing ITCH Decoder ===\n";
+    
+    // Reduce keeps time priority and removes the order at zero, far or not
+    for (size_t far_band : {size_t{0}, size_t{2}}) {
+        OrderBookConfig config;
+        config.far_band_ticks = far_band;
+        OrderBook book(config);
+        book.add_order(Order(1, true, ticks(100.0), 10, 0));
+        book.add_order(Order(2, true, ticks(100.0), 10, 0));
+        book.add_order(Order(3, true, ticks(90.0), 10, 0));   // Far when banded
+        assert(book.reduce_order(1, 4) && book.reduce_order(3, 3));
+        std::vector<uint64_t> fifo;
+        book.visit_orders(true, 1, [&](const Order& o, size_t) { fifo.push_back(o.order_id); });
+        assert((fifo == std::vector<uint64_t>{1, 2}));
+        std::vector<PriceLevel> bids, asks;
+        book.get_snapshot(2, bids, asks);
+        assert(bids[0].total_quantity == 16 && bids[1].total_quantity == 7);
+        assert(book.reduce_order(3, 7) && book.reduce_order(1, 100) && !book.reduce_order(9, 1));
+        assert(book.get_order_count() == 1);
+    }
+    std::cout << "✓ Reduce command test passed\n";
+    
+    unsigned char m[64];
+    std::vector<unsigned char> stream;
+    auto frame = [&](size_t length) { itch::append_framed(stream, m, length); };
+    frame(itch::encode_add(m, 1, 100, 1, true, 100, 1000000));    // Buy 100 @ 100.00
+    frame(itch::encode_add(m, 1, 101, 2, false, 50, 1010000));    // Sell 50 @ 101.00
+    frame(itch::encode_add(m, 2, 102, 3, true, 30, 1000000));     // Other stock
+    frame(itch::encode_add(m, 1, 103, 4, true, 20, 1000000));
+    std::memset(m, 0, 12);
+    m[0] = 'S';
+    frame(12);                                                     // System event
+    frame(itch::encode_executed(m, 1, 104, 1, 40, 7));             // 1: 60 left, keeps priority
+    frame(itch::encode_cancel(m, 1, 105, 2, 10));                  // 2: 40 left
+    frame(itch::encode_replace(m, 1, 106, 4, 10, 70, 990000));     // 4 -> 10: 70 @ 99.00
+    frame(itch::encode_executed(m, 1, 107, 2, 40, 8));             // 2 fully executed
+    frame(itch::encode_delete(m, 1, 108, 1));
+    frame(itch::encode_add(m, 1, 109, 11, false, 5, 1020000));
+    m[0] = 'A';
+    frame(20);                                                     // Truncated add
+    
+    auto check = [](const OrderBook& book) {
+        std::vector<PriceLevel> bids, asks;
+        book.get_snapshot(5, bids, asks);
+        assert(bids.size() == 1 && bids[0].price == ticks(99.0) && bids[0].total_quantity == 70);
+        assert(asks.size() == 1 && asks[0].price == ticks(102.0) && asks[0].total_quantity == 5);
+        assert(book.get_order_count() == 2);
+    };
+    
+    // Chunked delivery: a split message is left unconsumed for the next call
+    OrderBook chunked;
+    ItchDecoder decoder(chunked, 1, 4);
+    std::vector<unsigned char> carry;
+    for (size_t at = 0; at < stream.size(); at += 7) {
+        carry.insert(carry.end(), stream.begin() + at,
+                     stream.begin() + std::min(stream.size(), at + 7));
+        size_t used = decoder.decode(carry.data(), carry.size());
+        carry.erase(carry.begin(), carry.begin() + used);
+    }
+    assert(carry.empty());
+    check(chunked);
+    const ItchStats& stats = decoder.stats();
+    assert(stats.messages == 12 && stats.adds == 4 && stats.executions == 2);
+    assert(stats.cancels == 1 && stats.replaces == 1 && stats.deletes == 1);
+    assert(stats.skipped == 2 && stats.malformed == 1);
+    std::cout << "✓ Message decode test passed\n";
+    
+    // The same messages as one MoldUDP64 packet inside a pcap
+    auto put16 = [](std::vector<unsigned char>& v, size_t at, uint16_t x) {
+        v[at] = static_cast<unsigned char>(x >> 8);
+        v[at + 1] = static_cast<unsigned char>(x);
+    };
+    size_t udp_length = 8 + 20 + stream.size();
+    std::vector<unsigned char> pcap(24 + 16 + 14 + 20 + udp_length, 0);
+    uint32_t header[6] = {0xa1b2c3d4, 0x00040002, 0, 0, 65535, 1};
+    std::memcpy(pcap.data(), header, sizeof(header));
+    uint32_t captured = static_cast<uint32_t>(14 + 20 + udp_length);
+    uint32_t record[4] = {0, 0, captured, captured};
+    std::memcpy(pcap.data() + 24, record, sizeof(record));
+    size_t eth = 40, ip = eth + 14, udp = ip + 20;
+    put16(pcap, eth + 12, 0x0800);
+    pcap[ip] = 0x45;
+    pcap[ip + 9] = 17;
+    put16(pcap, udp + 4, static_cast<uint16_t>(udp_length));
+    put16(pcap, udp + 8 + 18, 12);                                 // Mold message count
+    std::memcpy(pcap.data() + udp + 28, stream.data(), stream.size());
+    OrderBook from_pcap;
+    ItchDecoder pcap_decoder(from_pcap, 1);
+    assert(decode_pcap(pcap.data(), pcap.size(), pcap_decoder) == 1);
+    check(from_pcap);
+    std::cout << "✓ pcap / MoldUDP64 test passed\n";
+    
+    std::cout << "\n✅ ITCH decoder tests passed!\n\n";
+}
+
+// Generated flow is deterministic, near the touch, and cancels live IDs
+void test_workload_generator() {
+    std::cout << "=== Testing Workload Generator ===\n";
+    
+    WorkloadConfig config;
+    std::vector<Command> a, b;
+    WorkloadGenerator first(config), second(config);
+    first.prefill(1000, a);
+    first.generate(20000, a);
+    second.prefill(1000, b);
+    second.generate(20000, b);
+    assert(a.size() == b.size());
+    for (size_t i = 0; i < a.size(); ++i) {
+        assert(a[i].type == b[i].type && a[i].order.order_id == b[i].order.order_id &&
+               a[i].order.price == b[i].order.price);
+    }
+    std::cout << "✓ Determinism test passed\n";
+    
+    size_t counts[3] = {0, 0, 0};
+    size_t at_touch = 0, passive = 0;
+    std::unordered_map<uint64_t, bool> live;
+    for (size_t i = 0; i < a.size(); ++i) {
+        const Command& c = a[i];
+        ++counts[static_cast<size_t>(c.type)];
+        if (c.type == CommandType::Add) {
+            live[c.order.order_id] = true;
+            Price distance = c.order.price > config.start_mid ? c.order.price - config.start_mid
+                                                              : config.start_mid - c.order.price;
+            assert(distance <= static_cast<Price>(config.max_offset) + 100);
+            if (i < 1000) {
+                ++passive;
+                at_touch += distance == 1;
+            }
+        } else {
+            assert(live.count(c.order.order_id));
+            if (c.type == CommandType::Cancel) {
+                live.erase(c.order.order_id);
+            }
+        }
+    }
+    // Zipf head: the touch level gets far more than a uniform 1/201 share
+    assert(at_touch * 10 > passive);
+    assert(counts[1] > counts[2] && counts[1] > 20000 / 3);
+    assert(first.live_orders() == live.size());
+    std::cout << "✓ Mix and price shape test passed\n";
+    
+    OrderBook book(OrderBookConfig{kTickSize, 4096});
+    size_t applied = book.apply_batch(a.data(), a.size());
+    assert(applied > a.size() / 2 && book.get_order_count() <= live.size());
+    std::cout << "✓ Book replay test passed\n";
+    
+    std::cout << "\n✅ Workload generator tests passed!\n\n";
+}
+
+// A mirror fed only by level deltas tracks the book's aggregated depth
+void test_delta_feed() {
+    std::cout << "=== Testing L2 Delta Feed ===\n";
+    
+    DeltaFeed feed(1 << 16);
+    OrderBook book(OrderBookConfig{kTickSize, 256});
+    book.set_delta_feed(&feed);
+    
+    std::map<Price, uint64_t> mirror_bids, mirror_asks;
+    uint32_t last_sequence = 0;
+    auto drain = [&] {
+        LevelDelta delta;
+        bool consistent = true;
+        while (feed.pop(delta)) {
+            assert(delta.sequence == last_sequence + 1);
+            last_sequence = delta.sequence;
+            auto& side = delta.is_buy ? mirror_bids : mirror_asks;
+            if (delta.total_quantity == 0) {
+                side.erase(delta.price);
+            } else {
+                side[delta.price] = delta.total_quantity;
+            }
+            consistent = delta.end_of_batch != 0;
+        }
+        assert(consistent);
+    };
+    auto check = [&] {
+        drain();
+        std::vector<PriceLevel> bids, asks;
+        book.get_snapshot(1000, bids, asks);
+        assert(bids.size() == mirror_bids.size() && asks.size() == mirror_asks.size());
+        auto bid = mirror_bids.rbegin();
+        for (const PriceLevel& level : bids) {
+            assert(bid->first == level.price && bid->second == level.total_quantity);
+            ++bid;
+        }
+        auto ask = mirror_asks.begin();
+        for (const PriceLevel& level : asks) {
+            assert(ask->first == level.price && ask->second == level.total_quantity);
+            ++ask;
+        }
+    };
+    
+    // Single commands: one delta each, matching deltas for swept levels
+    book.add_order(Order(1, true, ticks(99.0), 10, 1));
+    assert(feed.size() == 1);
+    book.add_order(Order(2, false, ticks(101.0), 5, 2));
+    book.add_order(Order(3, false, ticks(102.0), 5, 3));
+    book.add_order(Order(4, true, ticks(101.5), 7, 4));   // Sweeps 101.0, rests 2 @ 101.5
+    check();
+    book.amend_order(1, ticks(99.0), 4);
+    book.cancel_order(3);
+    check();
+    std::cout << "✓ Single command deltas test passed\n";
+    
+    // Three adds and a cancel on one level in a batch coalesce to one delta
+    std::vector<Command> batch = {
+        Command::add(Order(10, true, ticks(98.0), 1, 5)),
+        Command::add(Order(11, true, ticks(98.0), 2, 6)),
+        Command::add(Order(12, true, ticks(98.0), 3, 7)),
+        Command::cancel(11),
+    };
+    book.apply_batch(batch.data(), batch.size());
+    assert(feed.size() == 1);
+    check();
+    assert(mirror_bids[ticks(98.0)] == 4);
+    assert(book.delta_sequence() == last_sequence);
+    assert(!book.cancel_order(999) && book.delta_sequence() == last_sequence);   // Nothing published
+    std::cout << "✓ Batch coalescing test passed\n";
+    
+    WorkloadGenerator generator;
+    std::vector<Command> flow;
+    generator.generate(20000, flow);
+    for (size_t i = 0; i < flow.size(); i += 100) {
+        book.apply_batch(flow.data() + i, std::min<size_t>(100, flow.size() - i));
+        check();
+    }
+    assert(book.deltas_dropped() == 0);
+    std::cout << "✓ Mirror book test passed\n";
+    
+    std::cout << "\n✅ L2 delta feed tests passed!\n\n";
+}
+
+// One write per delta reaches every reader; dependent readers trail theirs
+void test_delta_broadcast() {
+    std::cout << "=== Testing Delta Broadcast ===\n";
+    
+    BroadcastRing<uint64_t> ring(4);
+    auto& strategy = ring.addReader();
+    auto& risk = ring.addReader();
+    auto& recorder = ring.addReader({&risk});
+    for (uint64_t i = 1; i <= 4; ++i) {
+        assert(ring.push(i));
+    }
+    assert(ring.full() && !ring.push(5));
+    uint64_t value = 0;
+    assert(recorder.front() == nullptr);    // Risk has not seen anything yet
+    assert(risk.pop(value) && value == 1);
+    assert(recorder.pop(value) && value == 1 && !recorder.pop(value));
+    assert(!ring.push(5));                  // Strategy is still a full ring behind
+    for (uint64_t i = 1; i <= 4; ++i) {
+        assert(strategy.front() && *strategy.front() == i);
+        strategy.pop();
+    }
+    assert(ring.push(5) && ring.size() == 4);    // Now the recorder gates
+    assert(strategy.available() == 1 && risk.available() == 4 && recorder.available() == 0);
+    std::cout << "✓ Reader and producer gating test passed\n";
+    
+    DeltaBroadcast deltas(1 << 17);
+    auto& mirror_reader = deltas.addReader();
+    auto& risk_reader = deltas.addReader();
+    auto& recorder_reader = deltas.addReader({&risk_reader});
+    OrderBook book(OrderBookConfig{kTickSize, 256});
+    book.set_delta_broadcast(&deltas);
+    
+    std::atomic<bool> done{false};
+    std::atomic<uint32_t> risk_seen{0};
+    std::atomic<bool> risk_done{false};
+    std::map<Price, uint64_t> mirror_bids, mirror_asks;
+    uint32_t last[3] = {0, 0, 0};
+    auto consume = [&](DeltaBroadcast::Reader& reader, int index) {
+        while (true) {
+            const LevelDelta* delta = reader.front();
+            if (!delta) {
+                // A dependent reader is only caught up once its dependency is
+                // finished; before that available() can be 0 with more to come
+                if (done.load(std::memory_order_acquire) &&
+                    (index != 2 || risk_done.load(std::memory_order_acquire)) &&
+                    reader.available() == 0) {
+                    break;
+                }
+                std::this_thread::yield();
+                continue;
+            }
+            assert(delta->sequence == last[index] + 1);
+            last[index] = delta->sequence;
+            if (index == 0) {
+                auto& side = delta->is_buy ? mirror_bids : mirror_asks;
+                if (delta->total_quantity == 0) {
+                    side.erase(delta->price);
+                } else {
+                    side[delta->price] = delta->total_quantity;
+                }
+            } else if (index == 1) {
+                risk_seen.store(delta->sequence, std::memory_order_release);
+            } else {
+                assert(delta->sequence <= risk_seen.load(std::memory_order_acquire));
+            }
+            reader.pop();
+        }
+        if (index == 1) {
+            risk_done.store(true, std::memory_order_release);
+        }
+    };
+    std::thread t0(consume, std::ref(mirror_reader), 0);
+    std::thread t1(consume, std::ref(risk_reader), 1);
+    std::thread t2(consume, std::ref(recorder_reader), 2);
+    
+    WorkloadGenerator generator;
+    std::vector<Command> flow;
+    generator.generate(20000, flow);
+    for (size_t i = 0; i < flow.size(); i += 100) {
+        book.apply_batch(flow.data() + i, std::min<size_t>(100, flow.size() - i));
+    }
+    done.store(true, std::memory_order_release);
+    t0.join();
+    t1.join();
+    t2.join();
+    
+    assert(book.deltas_dropped() == 0 && last[0] > 0);
+    assert(last[0] == last[1] && last[1] == last[2] && deltas.empty());
+    std::vector<PriceLevel> bids, asks;
+    book.get_snapshot(1000, bids, asks);
+    assert(bids.size() == mirror_bids.size() && asks.size() == mirror_asks.size());
+    for (const PriceLevel& level : bids) {
+        assert(mirror_bids[level.price] == level.total_quantity);
+    }
+    std::cout << "✓ Three-reader fan-out test passed\n";
+    
+    std::cout << "\n✅ Delta broadcast tests passed!\n\n";
+}
+
+// Readers on other threads only ever see whole publications
+void test_snapshot_seqlock() {
+    std::cout << "=== Testing Seqlock Snapshots ===\n";
+    
+    OrderBook book;
+    SnapshotSeqlock<5> published;
+    book.add_order(Order(1, true, ticks(99.0), 1, 0));
+    book.add_order(Order(2, false, ticks(101.0), 1, 0));
+    published.attach(book);
+    
+    BookSnapshot<5> view;
+    published.load(view);
+    assert(view.bid_count == 1 && view.ask_count == 1 && view.bids[0].price == ticks(99.0));
+    uint64_t before = published.publications();
+    book.add_order(Order(3, true, ticks(50.0), 1, 0));   // New level inside the top 5
+    book.cancel_order(3);
+    assert(published.publications() == before + 2);
+    std::cout << "✓ Publish on change test passed\n";
+    
+    // Each batch amends both touches to the same size; a torn read would
+    // show them differing
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> reads{0};
+    auto reader = [&] {
+        BookSnapshot<5> snapshot;
+        uint64_t last_version = 0;
+        while (!done.load(std::memory_order_acquire)) {
+            published.load(snapshot);
+            assert(snapshot.bid_count == 1 && snapshot.ask_count == 1);
+            assert(snapshot.bids[0].total_quantity == snapshot.asks[0].total_quantity);
+            assert(snapshot.version >= last_version);
+            last_version = snapshot.version;
+            reads.fetch_add(1, std::memory_order_relaxed);
+            std::this_thread::yield();
+        }
+    };
+    std::thread r1(reader), r2(reader);
+    for (uint64_t qty = 2; qty < 20000; ++qty) {
+        Command both[] = {Command::amend(1, ticks(99.0), qty), Command::amend(2, ticks(101.0), qty)};
+        book.apply_batch(both, 2);
+        if (qty % 64 == 0) {
+            std::this_thread::yield();
+        }
+    }
+    done.store(true, std::memory_order_release);
+    r1.join();
+    r2.join();
+    assert(reads.load() > 0);
+    published.load(view);
+    assert(view.bids[0].total_quantity == 19999);
+    std::cout << "✓ Concurrent reader consistency test passed\n";
+    
+    std::cout << "\n✅ Seqlock snapshot tests passed!\n\n";
+}
+
+// Cached-cursor, masked and bulk fifos: in order across threads, through
+// full, empty and the ring's wrap
+void test_spsc_queues() {
+    std::cout << "=== Testing SPSC Queues ===\n";
+    
+    Fifo4<Command> single(2);
+    assert(single.push(Command::cancel(1)) && single.push(Command::cancel(2)));
+    assert(!single.push(Command::cancel(3)) && single.full());
+    Command command;
+    assert(single.pop(command) && command.order.order_id == 1);
+    assert(single.push(Command::cancel(3)));
+    assert(single.pop(command) && command.order.order_id == 2);
+    assert(single.pop(command) && command.order.order_id == 3);
+    assert(!single.pop(command) && single.empty());
+    std::cout << "✓ Full and empty test passed\n";
+    
+    // A small ring keeps both cached cursors going stale
+    const uint64_t count = 200000;
+    Fifo4<Command> queue(16);
+    std::thread producer([&] {
+        for (uint64_t id = 1; id <= count; ++id) {
+            while (!queue.push(Command::cancel(id))) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    for (uint64_t expected = 1; expected <= count;) {
+        if (queue.pop(command)) {
+            assert(command.order.order_id == expected);
+            ++expected;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    assert(queue.empty());
+    std::cout << "✓ Ordered transfer test passed\n";
+    
+    // Masked rings round up; bulk calls stop at full and empty
+    Fifo3<Command, std::allocator<Command>, true> masked(5);
+    assert(masked.capacity() == 8);
+    std::vector<Command> in, out(8);
+    for (uint64_t id = 1; id <= 12; ++id) {
+        in.push_back(Command::cancel(id));
+    }
+    assert(masked.push_n(in.data(), 6) == 6);
+    assert(masked.pop_n(out.data(), 4) == 4 && out[3].order.order_id == 4);
+    assert(masked.push_n(in.data() + 6, 6) == 6);    // Wraps, leaving the ring full
+    assert(masked.full() && masked.push_n(in.data(), 1) == 0);
+    assert(masked.pop_n(out.data(), 8) == 8);
+    for (size_t i = 0; i < 8; ++i) {
+        assert(out[i].order.order_id == i + 5);
+    }
+    assert(masked.pop_n(out.data(), 8) == 0);
+    std::cout << "✓ Masked bulk test passed\n";
+    
+    Fifo4<Command, std::allocator<Command>, true> bulk(64);
+    std::thread bulk_producer([&] {
+        std::vector<Command> burst;
+        for (uint64_t id = 1; id <= count;) {
+            burst.clear();
+            for (uint64_t i = 0; i < 37 && id + i <= count; ++i) {
+                burst.push_back(Command::cancel(id + i));
+            }
+            size_t sent = 0;
+            while (sent < burst.size()) {
+                size_t n = bulk.push_n(burst.data() + sent, burst.size() - sent);
+                sent += n;
+                if (n == 0) {
+                    std::this_thread::yield();
+                }
+            }
+            id += burst.size();
+        }
+    });
+    out.resize(50);
+    for (uint64_t expected = 1; expected <= count;) {
+        size_t n = bulk.pop_n(out.data(), out.size());
+        for (size_t i = 0; i < n; ++i) {
+            assert(out[i].order.order_id == expected);
+            ++expected;
+        }
+        if (n == 0) {
+            std::this_thread::yield();
+        }
+    }
+    bulk_producer.join();
+    assert(bulk.empty());
+    std::cout << "✓ Bulk ordered transfer test passed\n";
+    
+    // Built in the slot and read from it: no copies in or out
+    Fifo3<Order> in_place(2);
+    assert(in_place.emplace(1, true, ticks(99.0), 10, 0));
+    Order* slot = in_place.try_reserve();
+    assert(slot != nullptr);
+    new (slot) Order(2, false, ticks(101.0), 5, 0);
+    assert(in_place.size() == 1);    // Not visible before commit
+    in_place.commit();
+    assert(in_place.try_reserve() == nullptr && !in_place.emplace(3, true, 0, 1, 0));
+    assert(in_place.front()->order_id == 1 && in_place.front()->quantity == 10);
+    in_place.pop();
+    assert(in_place.front() == slot && slot->price == ticks(101.0));
+    in_place.pop();
+    assert(in_place.front() == nullptr && in_place.empty());
+    
+    Fifo3<Command> zero_copy(16);
+    std::thread writer([&] {
+        for (uint64_t id = 1; id <= count; ++id) {
+            Command* next;
+            while ((next = zero_copy.try_reserve()) == nullptr) {
+                std::this_thread::yield();
+            }
+            new (next) Command(Command::reduce(id, id * 2));
+            zero_copy.commit();
+        }
+    });
+    for (uint64_t expected = 1; expected <= count;) {
+        if (const Command* next = zero_copy.front()) {
+            assert(next->type == CommandType::Reduce && next->order.order_id == expected &&
+                   next->order.quantity == expected * 2);
+            zero_copy.pop();
+            ++expected;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    writer.join();
+    std::cout << "✓ In-place reserve/front test passed\n";
+    
+    std::cout << "\n✅ SPSC queue tests passed!\n\n";
+}
+
+// Many gateway threads into one book thread, and many-to-many
+void test_mpmc_queues() {
+    std::cout << "=== Testing MPSC/MPMC Queues ===\n";
+    
+    // Odd capacity: slot sequences must survive laps without a mask
+    MpmcFifo<Command> ring(3);
+    Command command;
+    for (uint64_t lap = 0; lap < 4; ++lap) {
+        for (uint64_t i = 1; i <= 3; ++i) {
+            assert(ring.push(Command::cancel(lap * 3 + i)));
+        }
+        assert(ring.full() && !ring.push(Command::cancel(99)));
+        for (uint64_t i = 1; i <= 3; ++i) {
+            assert(ring.pop(command) && command.order.order_id == lap * 3 + i);
+        }
+        assert(!ring.pop(command) && ring.empty());
+    }
+
+    // Capacity 2 is the smallest ring; 0 and 1 are raised to it
+    MpmcFifo<Command> pair(2);
+    MpscFifo<Command> tiny(1);
+    MpmcFifo<Command, std::allocator<Command>, true> none(0);
+    assert(tiny.capacity() == 2 && none.capacity() == 2);
+    for (uint64_t lap = 0; lap < 4; ++lap) {
+        assert(pair.push(Command::cancel(lap * 2 + 1)) && pair.push(Command::cancel(lap * 2 + 2)));
+        assert(tiny.push(Command::cancel(lap * 2 + 1)) && tiny.push(Command::cancel(lap * 2 + 2)));
+        assert(pair.full() && !pair.push(Command::cancel(99)));
+        assert(tiny.full() && !tiny.push(Command::cancel(99)));
+        for (uint64_t i = 1; i <= 2; ++i) {
+            assert(pair.pop(command) && command.order.order_id == lap * 2 + i);
+            assert(tiny.pop(command) && command.order.order_id == lap * 2 + i);
+        }
+        assert(!pair.pop(command) && pair.empty());
+        assert(!tiny.pop(command) && tiny.empty());
+    }
+    std::cout << "✓ Full and empty test passed\n";
+    
+    // Each producer's commands reach the single consumer in its own order
+    const uint64_t producers = 4;
+    const uint64_t per_producer = 50000;
+    MpscFifo<Command, std::allocator<Command>, true> funnel(64);
+    std::vector<std::thread> threads;
+    for (uint64_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p] {
+            for (uint64_t i = 0; i < per_producer; ++i) {
+                while (!funnel.push(Command::cancel(p << 32 | i))) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    std::vector<uint64_t> next(producers, 0);
+    for (uint64_t received = 0; received < producers * per_producer;) {
+        if (!funnel.pop(command)) {
+            std::this_thread::yield();
+            continue;
+        }
+        uint64_t p = command.order.order_id >> 32;
+        assert((command.order.order_id & 0xffffffff) == next[p]);
+        ++next[p];
+        ++received;
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    assert(funnel.empty());
+    std::cout << "✓ MPSC per-producer order test passed\n";
+    
+    // Every command is popped by exactly one consumer
+    MpmcFifo<Command, std::allocator<Command>, true> shared(64);
+    const uint64_t total = producers * per_producer;
+    std::vector<std::atomic<uint8_t>> seen(total);
+    std::atomic<uint64_t> popped{0};
+    threads.clear();
+    for (uint64_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p] {
+            for (uint64_t id = p; id < total; id += producers) {
+                while (!shared.push(Command::cancel(id))) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (int c = 0; c < 3; ++c) {
+        threads.emplace_back([&] {
+            Command received;
+            while (popped.load(std::memory_order_relaxed) < total) {
+                if (shared.pop(received)) {
+                    seen[received.order.order_id].fetch_add(1, std::memory_order_relaxed);
+                    popped.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    assert(popped.load() == total && shared.empty());
+    assert(std::all_of(seen.begin(), seen.end(), [](auto& n) { return n.load() == 1; }));
+    std::cout << "✓ MPMC exactly-once test passed\n";
+    
+    std::cout << "\n✅ MPSC/MPMC queue tests passed!\n\n";
+}
+
+// A forked producer process attaches by name and streams to this one
+void test_shm_fifo() {
+    std::cout << "=== Testing Shared-Memory Fifo ===\n";
+    
+    const std::string name = "/orderbook_test_" + std::to_string(::getpid());
+    ShmFifo<Command>::unlink(name);
+    auto ring = ShmFifo<Command, true>::create(name, 100);
+    assert(ring.capacity() == 128 && ring.empty());
+    
+    bool rejected = false;
+    try {
+        ShmFifo<Order>::attach(name);    // Another element type
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    assert(rejected);
+    rejected = false;
+    try {
+        ShmFifo<Command>::create(name, 8);    // Name already taken
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    assert(rejected);
+    std::cout << "✓ Header validation test passed\n";
+    
+    const uint64_t count = 100000;
+    pid_t child = ::fork();
+    if (child == 0) {
+        auto producer = ShmFifo<Command, true>::attach(name);
+        for (uint64_t id = 1; id <= count; ++id) {
+            while (!producer.push(Command::reduce(id, id + 1))) {
+                std::this_thread::yield();
+            }
+        }
+        ::_exit(0);
+    }
+    assert(child > 0);
+    Command command;
+    for (uint64_t expected = 1; expected <= count;) {
+        if (ring.pop(command)) {
+            assert(command.type == CommandType::Reduce && command.order.order_id == expected &&
+                   command.order.quantity == expected + 1);
+            ++expected;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    int status = 0;
+    ::waitpid(child, &status, 0);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0 && ring.empty());
+    ShmFifo<Command>::unlink(name);
+    std::cout << "✓ Cross-process transfer test passed\n";
+    
+    std::cout << "\n✅ Shared-memory fifo tests passed!\n\n";
+}
+
+// Every strategy drives the same consumer loop; a parked consumer is woken
+// only by pushes that find it asleep
+template<typename Wait>
+void transfer_with(Wait& consumer_wait, Wait& producer_wait, uint64_t count, bool pauses) {
+    Fifo3<uint64_t, std::allocator<uint64_t>, true> ring(64);
+    std::thread producer([&] {
+        for (uint64_t i = 1; i <= count; ++i) {
+            while (!push_notify(ring, i, producer_wait)) {
+                std::this_thread::yield();
+            }
+            if (pauses && i % 500 == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    });
+    uint64_t value = 0;
+    for (uint64_t expected = 1; expected <= count; ++expected) {
+        pop_wait(ring, value, consumer_wait);
+        assert(value == expected);
+    }
+    producer.join();
+}
+
+void test_wait_strategies() {
+    std::cout << "=== Testing Wait Strategies ===\n";
+    
+    SpinWait spin;
+    transfer_with(spin, spin, 20000, false);
+    PauseWait pause_a, pause_b;
+    transfer_with(pause_a, pause_b, 20000, false);
+    YieldWait yield;
+    transfer_with(yield, yield, 20000, false);
+    std::cout << "✓ Spin, pause and yield transfer test passed\n";
+    
+    // One ParkWait is shared: the consumer idles on it, the producer notifies
+    const uint64_t count = 5000;
+    ParkWait park(64);
+    transfer_with(park, park, count, true);
+    assert(park.parks() > 0 && park.wakes() > 0);
+    assert(park.wakes() <= park.parks());    // Every wake answers one park
+    std::cout << "✓ Park and notify test passed (" << park.parks() << " parks, "
+              << park.wakes() << " wakes)\n";
+    
+    std::cout << "\n✅ Wait strategy tests passed!\n\n";
+}
+
+// Commands reach the right book, inline and through pinned workers
+void test_book_manager() {
+    std::cout << "=== Testing Book Manager ===\n";
+    
+    const uint32_t instruments[] = {7, 1001, 42, 65000};
+    BookManager manager(8, OrderBookConfig{}, 1024);
+    for (uint32_t id : instruments) {
+        assert(manager.add_instrument(id));
+    }
+    assert(!manager.add_instrument(42));
+    for (uint32_t id : instruments) {
+        // Each book starts on its own cache line
+        assert(reinterpret_cast<uintptr_t>(manager.book(id)) % 64 == 0);
+    }
+    
+    assert(manager.apply(RoutedCommand{7, Command::add(Order(1, true, ticks(70.0), 10, 0))}));
+    assert(!manager.apply(RoutedCommand{9, Command::add(Order(1, true, ticks(100.0), 10, 0))}));
+    assert(manager.book(7)->get_order_count() == 1);
+    assert(manager.book(42)->get_order_count() == 0);
+    std::cout << "✓ Inline routing test passed\n";
+    
+    manager.start_workers({WorkerConfig{}, WorkerConfig{}});
+    const uint64_t per_instrument = 20000;
+    for (uint64_t i = 0; i < per_instrument; ++i) {
+        for (uint32_t id : instruments) {
+            RoutedCommand command{id, Command::add(Order(100 + i, i % 2 == 0, ticks(90.0) + (i % 50), 1, 0))};
+            if (i % 2 == 0) command.command.order.price = ticks(80.0) + (i % 50); // Bids never cross asks
+            while (!manager.submit(command)) {
+                std::this_thread::yield();
+            }
+        }
+    }
+    manager.stop_workers();
+    
+    // Nobody drains the rings once the workers are gone
+    assert(!manager.submit(RoutedCommand{7, Command::add(Order(1, true, ticks(60.0), 1, 0))}));
+    assert(manager.worker_processed(0) + manager.worker_processed(1) == per_instrument * 4);
+    assert(manager.book(7)->get_order_count() == per_instrument + 1);
+    assert(manager.book(1001)->get_order_count() == per_instrument);
+    assert(manager.book(65000)->get_order_count() == per_instrument);
+    std::cout << "✓ Worker sharding test passed\n";
+    
+    // Parked workers sleep between bursts and must still see every command,
+    // including those submitted just before stop
+    BookManager parked(4, OrderBookConfig{}, 256);
+    parked.add_instrument(1);
+    parked.add_instrument(2);
+    parked.start_workers({WorkerConfig{-1, WorkerWait::Park}, WorkerConfig{-1, WorkerWait::Yield}});
+    for (uint64_t burst = 0; burst < 5; ++burst) {
+        for (uint64_t i = 0; i < 50; ++i) {
+            uint64_t id = burst * 50 + i + 1;
+            for (uint32_t instrument : {1u, 2u}) {
+                while (!parked.submit(RoutedCommand{instrument, Command::add(Order(id, true, ticks(50.0), 1, 0))})) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    parked.stop_workers();
+    assert(parked.book(1)->get_order_count() == 250 && parked.book(2)->get_order_count() == 250);
+    std::cout << "✓ Parked worker test passed\n";
+    
+    std::cout << "\n✅ Book manager tests passed!\n\n";
+}
+
+// Journal captures every command; replay rebuilds an identical book
+void test_journal_replay() {
+    std::cout << "=== Testing Journal Replay ===\n";
+    
+    const std::string path = "/tmp/order_book_test.journal";
+    OrderBook live;
+    {
+        JournalWriter writer(path, kTickSize, 128); // Small buffer forces hand-offs
+        JournalWriter::Tap tap{&writer, 7};
+        live.set_command_callback(&JournalWriter::record, &tap);
+        
+        std::mt19937_64 rng(5);
+        std::uniform_int_distribution<Price> price_dist(ticks(99.0), ticks(101.0));
+        for (uint64_t id = 1; id <= 3000; ++id) {
+            live.add_order(Order(id, id % 2 == 0, price_dist(rng), 1 + rng() % 20, 1000 + id));
+            if (id % 4 == 0) live.cancel_order(1 + rng() % id);
+            if (id % 7 == 0) live.amend_order(1 + rng() % id, price_dist(rng), 1 + rng() % 20);
+        }
+        live.set_command_callback(nullptr);
+        writer.flush();
+        assert(writer.records_written() == 3000 + 750 + 428);
+    }
+    
+    JournalReader reader(path);
+    assert(reader.size() == 3000 + 750 + 428);
+    assert(reader.header().tick_size == kTickSize.size);
+    assert(reader.records()[0].instrument_id == 7);
+    assert(reader.records()[0].timestamp_ns == 1001);
+    
+    OrderBook replayed;
+    ReplayStats stats = replay_journal(reader.records(), reader.records() + reader.size(), replayed);
+    assert(stats.records == reader.size());
+    assert(replayed.get_order_count() == live.get_order_count());
+    
+    std::vector<PriceLevel> a_bids, a_asks, b_bids, b_asks;
+    live.get_snapshot(500, a_bids, a_asks);
+    replayed.get_snapshot(500, b_bids, b_asks);
+    assert(a_bids.size() == b_bids.size() && a_asks.size() == b_asks.size());
+    for (size_t i = 0; i < a_asks.size(); ++i) {
+        assert(a_asks[i].price == b_asks[i].price && a_asks[i].total_quantity == b_asks[i].total_quantity);
+    }
+    std::remove(path.c_str());
+    std::cout << "✓ Record/replay round-trip test passed\n";
+
+    // Cancels and amends keep their command timestamps, so paced replay
+    // reproduces the recorded 2 ms span rather than waiting across epochs
+    const std::string paced_path = "/tmp/order_book_paced.journal";
+    constexpr uint64_t kBase = 5'000'000'000;
+    constexpr uint64_t kStep = 20'000;
+    OrderBook timed;
+    {
+        JournalWriter writer(paced_path, kTickSize);
+        JournalWriter::Tap tap{&writer, 1};
+        timed.set_command_callback(&JournalWriter::record, &tap);
+        std::vector<Command> commands;
+        for (uint64_t id = 1; id <= 80; ++id) {
+            uint64_t ts = kBase + (commands.size() + 1) * kStep;
+            commands.push_back(Command::add(Order(id, id % 2 == 0, ticks(id % 2 ? 101.0 : 99.0), 10, ts)));
+            if (id % 4 == 0) {
+                commands.push_back(Command::cancel(id - 1, ts + kStep));
+            }
+        }
+        timed.apply_batch(commands.data(), commands.size());
+        timed.amend_order(2, ticks(98.0), 5, kBase + (commands.size() + 1) * kStep);
+        timed.set_command_callback(nullptr);
+        writer.flush();
+    }
+
+    JournalReader paced_reader(paced_path);
+    const JournalRecord* first = paced_reader.records();
+    const JournalRecord* last = first + paced_reader.size() - 1;
+    assert(paced_reader.size() == 80 + 20 + 1);
+    for (const JournalRecord* r = first; r <= last; ++r) {
+        assert(r->timestamp_ns > kBase && r->timestamp_ns <= last->timestamp_ns);
+    }
+    assert(static_cast<CommandType>(first[4].type) == CommandType::Cancel &&
+           first[4].timestamp_ns == kBase + 5 * kStep);
+
+    OrderBook paced;
+    ReplayStats paced_stats = replay_journal(first, last + 1, paced, ReplayPacing::Original);
+    double span_us = (last->timestamp_ns - first->timestamp_ns) / 1000.0;
+    assert(paced_stats.records == paced_reader.size());
+    assert(paced_stats.elapsed_us >= span_us && paced_stats.elapsed_us < span_us + 1e6);
+    assert(paced.get_order_count() == timed.get_order_count());
+    std::remove(paced_path.c_str());
+    std::cout << "✓ Paced replay test passed\n";
+
+    // A write error on the flusher thread reaches the appending thread:
+    // journal into a pipe whose reader is gone (EPIPE)
+    const std::string pipe_path = "/tmp/order_book_test_" + std::to_string(::getpid()) + ".fifo";
+    std::remove(pipe_path.c_str());
+    assert(::mkfifo(pipe_path.c_str(), 0600) == 0);
+    int pipe_reader = ::open(pipe_path.c_str(), O_RDONLY | O_NONBLOCK);
+    assert(pipe_reader >= 0);
+    auto old_sigpipe = std::signal(SIGPIPE, SIG_IGN);
+    {
+        JournalWriter writer(pipe_path, kTickSize, 4);   // Header fits in the pipe
+        ::close(pipe_reader);
+        for (uint64_t id = 1; id <= 4; ++id) {
+            writer.append(JournalRecord::from_command(Command::cancel(id, id), 1, id));
+        }
+        bool failed = false;
+        try {
+            writer.flush();
+        } catch (const std::system_error& e) {
+            failed = e.code() == std::errc::broken_pipe;
+        }
+        assert(failed);
+        failed = false;
+        try {
+            writer.flush();   // Still reported
+        } catch (const std::system_error&) {
+            failed = true;
+        }
+        assert(failed);
+    }   // Destructor swallows the error instead of terminating
+    std::signal(SIGPIPE, old_sigpipe);
+    std::remove(pipe_path.c_str());
+    std::cout << "✓ Flusher write error test passed\n";
+
+    std::cout << "\n✅ Journal tests passed!\n\n";
+}
+
+// Checkpoint preserves every order and its FIFO position
+void test_checkpoint_restore() {
+    std::cout << "=== Testing Checkpoint/Restore ===\n";
+    
+    OrderBookConfig config;
+    config.ladder_levels = 128;
+    OrderBook original(config);
+    std::mt19937_64 rng(9);
+    std::uniform_int_distribution<Price> price_dist(ticks(98.0), ticks(102.0));
+    for (uint64_t id = 1; id <= 5000; ++id) {
+        original.add_order(Order(id, id % 2 == 0, price_dist(rng), 1 + rng() % 30, id * 10));
+        if (id % 3 == 0) original.cancel_order(1 + rng() % id);
+    }
+    
+    const std::string path = "/tmp/order_book_test.ckpt";
+    original.save_checkpoint(path);
+    
+    OrderBook restored(config);
+    restored.restore_checkpoint(path);
+    std::remove(path.c_str());
+    assert(restored.get_order_count() == original.get_order_count());
+    
+    for (bool is_buy : {true, false}) {
+        std::vector<Order> a, b;
+        original.visit_orders(is_buy, 100000, [&](const Order& o, size_t) { a.push_back(o); });
+        restored.visit_orders(is_buy, 100000, [&](const Order& o, size_t) { b.push_back(o); });
+        assert(a.size() == b.size());
+        for (size_t i = 0; i < a.size(); ++i) {
+            assert(a[i].order_id == b[i].order_id && a[i].price == b[i].price);
+            assert(a[i].quantity == b[i].quantity && a[i].timestamp_ns == b[i].timestamp_ns);
+            assert(a[i].is_buy == b[i].is_buy);
+        }
+    }
+    std::cout << "✓ FIFO-preserving round-trip test passed\n";
+    
+    // Both books keep evolving identically after the restore
+    FillBuffer a_fills(1024), b_fills(1024);
+    original.set_fill_callback(&FillBuffer::record, &a_fills);
+    restored.set_fill_callback(&FillBuffer::record, &b_fills);
+    original.add_order(Order(99999, true, ticks(102.0), 500, 0));
+    restored.add_order(Order(99999, true, ticks(102.0), 500, 0));
+    assert(a_fills.size() == b_fills.size() && a_fills.size() > 0);
+    for (size_t i = 0; i < a_fills.size(); ++i) {
+        assert(a_fills[i].maker_order_id == b_fills[i].maker_order_id);
+    }
+    bool threw = false;
+    try {
+        restored.restore_checkpoint(path);
+    } catch (const std::logic_error&) {
+        threw = true; // Book is not empty
+    }
+    assert(threw);
+    std::cout << "✓ Post-restore matching test passed\n";
+    
+    std::cout << "\n✅ Checkpoint tests passed!\n\n";
+}
+
+// Market-by-order walk: best level first, FIFO inside each level
+void test_l3_visitor() {
+    std::cout << "=== Testing L3 Visitor ===\n";
+    
+    OrderBook book;
+    book.add_order(Order(1, true, ticks(99.0), 10, 0));
+    book.add_order(Order(2, true, ticks(100.0), 20, 0));
+    book.add_order(Order(3, true, ticks(99.0), 30, 0));
+    book.add_order(Order(4, true, ticks(100.0), 40, 0));
+    book.add_order(Order(5, true, ticks(98.0), 50, 0));
+    book.add_order(Order(6, false, ticks(101.0), 60, 0));
+    
+    std::vector<uint64_t> ids;
+    std::vector<size_t> levels;
+    book.visit_orders(true, 2, [&](const Order& order, size_t level) {
+        ids.push_back(order.order_id);
+        levels.push_back(level);
+    });
+    assert((ids == std::vector<uint64_t>{2, 4, 1, 3}));
+    assert((levels == std::vector<size_t>{0, 0, 1, 1}));
+    
+    // Queue-position style query: quantity ahead of order 3
+    uint64_t ahead = 0;
+    bool found = false;
+    book.visit_orders(true, 10, [&](const Order& order, size_t level) {
+        if (level == 1 && !found) {
+            if (order.order_id == 3) found = true;
+            else ahead += order.quantity;
+        }
+    });
+    assert(found && ahead == 10);
+    
+    ids.clear();
+    book.visit_orders(false, 5, [&](const Order& order, size_t) { ids.push_back(order.order_id); });
+    assert((ids == std::vector<uint64_t>{6}));
+    std::cout << "✓ FIFO per-level walk test passed\n";
+    
+    std::cout << "\n✅ L3 visitor tests passed!\n\n";
+}
+
+// Depth queries match a brute-force walk of a full snapshot
+void test_depth_queries() {
+    std::cout << "=== Testing Depth Queries ===\n";
+    
+    OrderBookConfig config;
+    config.cached_depth = 5;
+    OrderBook book(config);
+    assert(book.depth_quantity(true) == 0 && book.estimate_fill(true, 10).filled == 0);
+    for (uint64_t i = 0; i < 8; ++i) {
+        book.add_order(Order(2 * i + 1, true, ticks(99.0) - static_cast<Price>(2 * i), 10 + i, 0));
+        book.add_order(Order(2 * i + 2, false, ticks(101.0) + static_cast<Price>(i), 20 + i, 0));
+    }
+    
+    // Cached depth (5 levels) and a deeper walk (8 levels)
+    assert(book.depth_quantity(true) == 10 + 11 + 12 + 13 + 14);
+    assert(book.depth_quantity(true, 3) == 10 + 11 + 12);
+    assert(book.depth_quantity(false, 20) == 20 * 8 + 28);
+    assert(book.quantity_within(true, 4) == 10 + 11 + 12);   // 99.00, 98.98, 98.96
+    assert(book.quantity_within(false, 2) == 20 + 21 + 22);
+    std::cout << "✓ Cumulative depth test passed\n";
+    
+    // Buy 50: 20 @ 101.00, 21 @ 101.01, 9 @ 101.02
+    FillEstimate buy = book.estimate_fill(true, 50);
+    assert(buy.filled == 50 && buy.levels == 3 && buy.worst_price == ticks(101.02));
+    assert(buy.notional == 20 * ticks(101.00) + 21 * ticks(101.01) + 9 * ticks(101.02));
+    assert(std::abs(buy.vwap() - static_cast<double>(buy.notional) / 50) < 1e-9);
+    
+    // More than the cached levels hold: short at the default depth, full deeper
+    FillEstimate sell = book.estimate_fill(false, 1000);
+    assert(sell.filled == 10 + 11 + 12 + 13 + 14 && sell.levels == 5);
+    sell = book.estimate_fill(false, 1000, 100);
+    assert(sell.filled == 8 * 10 + 28 && sell.worst_price == ticks(99.0) - 14);
+    
+    // Matches brute force after churn
+    std::mt19937_64 rng(9);
+    for (uint64_t id = 100; id < 2000; ++id) {
+        bool is_buy = rng() % 2 == 0;
+        Price price = is_buy ? ticks(98.0) - static_cast<Price>(rng() % 40)
+                             : ticks(102.0) + static_cast<Price>(rng() % 40);
+        book.add_order(Order(id, is_buy, price, 1 + rng() % 100, 0));
+        if (id % 3 == 0) book.cancel_order(100 + rng() % (id - 99));
+    }
+    std::vector<PriceLevel> bids, asks;
+    book.get_snapshot(30, bids, asks);
+    uint64_t remaining = 777, filled = 0;
+    int64_t notional = 0;
+    for (const PriceLevel& level : asks) {
+        uint64_t take = std::min(remaining, level.total_quantity);
+        remaining -= take;
+        filled += take;
+        notional += level.price * static_cast<int64_t>(take);
+    }
+    FillEstimate swept = book.estimate_fill(true, 777, 30);
+    assert(swept.filled == filled && swept.notional == notional);
+    uint64_t within = 0;
+    for (const PriceLevel& level : bids) {
+        if (bids[0].price - level.price <= 10) within += level.total_quantity;
+    }
+    assert(book.quantity_within(true, 10, 30) == within);
+    std::cout << "✓ Cost-to-fill and VWAP test passed\n";
+    
+    std::cout << "\n✅ Depth query tests passed!\n\n";
+}
+
+// Incremental touch signals agree with a fresh snapshot after every command
+void test_book_signals() {
+    std::cout << "=== Testing Book Signals ===\n";
+    
+    OrderBook book;
+    assert(!book.signals().two_sided());
+    book.add_order(Order(1, true, ticks(99.0), 30, 0));
+    book.add_order(Order(2, false, ticks(101.0), 10, 0));
+    const BookSignals& s = book.signals();
+    assert(s.two_sided() && s.spread() == ticks(2.0) && s.mid() == ticks(100.0));
+    assert(s.imbalance() == 0.5);                               // (30 - 10) / 40
+    assert(s.microprice() == (ticks(99.0) * 10.0 + ticks(101.0) * 30.0) / 40.0);
+    book.cancel_order(1);
+    assert(!book.signals().two_sided() && book.signals().bid_quantity == 0);
+    std::cout << "✓ Derived signal test passed\n";
+    
+    for (size_t far_band : {size_t{0}, size_t{8}}) {
+        OrderBookConfig config;
+        config.ladder_levels = far_band ? 0 : 256;
+        config.far_band_ticks = far_band;
+        OrderBook churn(config);
+        std::mt19937_64 rng(17);
+        std::vector<PriceLevel> bids, asks;
+        for (uint64_t id = 1; id <= 20000; ++id) {
+            Price price = ticks(100.0) + static_cast<Price>(rng() % 60) - 30;
+            switch (rng() % 4) {
+                case 0:
+                case 1:
+                    churn.add_order(Order(id, rng() % 2 == 0, price, 1 + rng() % 50, 0));
+                    break;
+                case 2:
+                    churn.cancel_order(1 + rng() % id);
+                    break;
+                default:
+                    churn.amend_order(1 + rng() % id, price, 1 + rng() % 50);
+                    break;
+            }
+            churn.get_snapshot(1, bids, asks);
+            const BookSignals& signals = churn.signals();
+            assert(signals.bid_quantity == (bids.empty() ? 0 : bids[0].total_quantity));
+            assert(signals.ask_quantity == (asks.empty() ? 0 : asks[0].total_quantity));
+            assert(bids.empty() || signals.best_bid == bids[0].price);
+            assert(asks.empty() || signals.best_ask == asks[0].price);
+        }
+    }
+    std::cout << "✓ Incremental maintenance test passed\n";
+    
+    // One feed entry per command that moved the touch, after its deltas
+    DeltaFeed deltas(64);
+    SignalFeed feed(16);
+    OrderBook published;
+    published.set_delta_feed(&deltas);
+    published.set_signal_feed(&feed);
+    published.add_order(Order(1, true, ticks(99.0), 5, 0));
+    published.add_order(Order(2, true, ticks(98.0), 5, 0));   // Behind the touch
+    published.add_order(Order(3, false, ticks(100.0), 7, 0));
+    BookSignals update;
+    assert(feed.pop(update) && update.best_bid == ticks(99.0) && update.sequence == 1);
+    assert(feed.pop(update) && update.best_ask == ticks(100.0) && update.sequence == 3);
+    assert(!feed.pop(update));
+    std::cout << "✓ Signal feed test passed\n";
+    
+    std::cout << "\n✅ Book signal tests passed!\n\n";
+}
+
+// Top-N cache, version counter and fixed-array snapshots
+void test_snapshot_cache() {
+    std::cout << "=== Testing Snapshot Cache ===\n";
+    
+    OrderBookConfig config;
+    config.cached_depth = 3;
+    OrderBook book(config);
+    for (uint64_t i = 0; i < 6; ++i) {
+        book.add_order(Order(i + 1, true, ticks(100.0) - static_cast<Price>(i), 10, 0));
+    }
+    
+    BookSnapshot<3> view;
+    assert(book.get_snapshot(view));
+    assert(view.bid_count == 3 && view.ask_count == 0);
+    assert(view.bids[0].price == ticks(100.0) && view.bids[2].price == ticks(99.98));
+    assert(!book.get_snapshot(view)); // Nothing changed: no work
+    
+    // Changes beyond the top 3 leave the version untouched
+    uint64_t version = book.version();
+    book.amend_order(6, ticks(99.95), 99);
+    book.cancel_order(5);
+    book.add_order(Order(7, true, ticks(99.90), 5, 0));
+    assert(book.version() == version);
+    assert(!book.get_snapshot(view));
+    std::cout << "✓ Far-level change skip test passed\n";
+    
+    // Changes inside the top 3 bump the version and refresh the view
+    book.amend_order(2, ticks(99.99), 25);
+    assert(book.version() != version);
+    assert(book.get_snapshot(view));
+    assert(view.bids[1].total_quantity == 25);
+    
+    book.cancel_order(1);
+    assert(book.get_snapshot(view));
+    assert(view.bids[0].price == ticks(99.99) && view.bids[2].price == ticks(99.97));
+    std::cout << "✓ Top-level refresh test passed\n";
+    
+    // Cached and uncached depths agree
+    std::vector<PriceLevel> bids, asks;
+    book.get_snapshot(2, bids, asks);
+    assert(bids.size() == 2 && bids[1].price == view.bids[1].price);
+    book.get_snapshot(10, bids, asks);
+    assert(bids.size() == 5 && bids[2].price == view.bids[2].price);
+    std::cout << "✓ Cached/uncached consistency test passed\n";
+    
+    std::cout << "\n✅ Snapshot cache tests passed!\n\n";
+}
+
+// Open-addressing index against std::unordered_map under heavy churn
+void test_order_index() {
+    std::cout << "=== Testing Order Index ===\n";
+    
+    OrderIndex<uint64_t> index(16);
+    std::unordered_map<uint64_t, uint64_t> reference;
+    std::mt19937_64 rng(11);
+    std::uniform_int_distribution<uint64_t> key_dist(1, 5000);
+    
+    for (int i = 0; i < 200000; ++i) {
+        uint64_t key = key_dist(rng);
+        if (rng() % 3 != 0) {
+            bool inserted = index.insert(key, key * 3);
+            assert(inserted == reference.emplace(key, key * 3).second);
+        } else {
+            uint64_t value = 0;
+            bool taken = index.take(key, value);
+            assert(taken == (reference.erase(key) == 1));
+            assert(!taken || value == key * 3);
+        }
+    }
+    assert(index.size() == reference.size());
+    for (const auto& [key, value] : reference) {
+        const uint64_t* found = index.find(key);
+        assert(found && *found == value);
+    }
+    std::cout << "✓ Insert/take/find churn test passed\n";
+    
+    std::cout << "\n✅ Order index tests passed!\n\n";
+}
+
+// Test price-time priority matching
+void test_matching() {
+    std::cout << "=== Testing Matching Engine ===\n";
+    
+    OrderBook book;
+    FillBuffer fills(16);
+    book.set_fill_callback(&FillBuffer::record, &fills);
+    
+    book.add_order(Order(1, false, ticks(101.0), 10, get_timestamp_ns()));
+    book.add_order(Order(2, false, ticks(101.0), 20, get_timestamp_ns()));
+    book.add_order(Order(3, false, ticks(102.0), 30, get_timestamp_ns()));
+    book.add_order(Order(4, true, ticks(99.0), 5, get_timestamp_ns()));
+    assert(fills.size() == 0);
+    
+    // Partial fill of the oldest order at the best ask
+    book.add_order(Order(5, true, ticks(101.0), 4, get_timestamp_ns()));
+    assert(fills.size() == 1);
+    assert(fills[0].maker_order_id == 1);
+    assert(fills[0].quantity == 4);
+    assert(fills[0].price == ticks(101.0));
+    assert(book.get_order_count() == 4);
+    std::cout << "✓ Partial fill test passed\n";
+    
+    // Sweep two levels in FIFO order and rest the remainder
+    fills.clear();
+    book.add_order(Order(6, true, ticks(102.0), 60, get_timestamp_ns()));
+    assert(fills.size() == 3);
+    assert(fills[0].maker_order_id == 1 && fills[0].quantity == 6);
+    assert(fills[1].maker_order_id == 2 && fills[1].quantity == 20);
+    assert(fills[2].maker_order_id == 3 && fills[2].quantity == 30);
+    assert(fills[2].price == ticks(102.0));
+    
+    std::vector<PriceLevel> bids, asks;
+    book.get_snapshot(5, bids, asks);
+    assert(asks.empty());
+    assert(bids[0].price == ticks(102.0) && bids[0].total_quantity == 4);
+    assert(book.get_order_count() == 2);
+    std::cout << "✓ Multi-level sweep test passed\n";
+    
+    // Price amend that crosses fills before resting
+    fills.clear();
+    book.add_order(Order(7, false, ticks(105.0), 10, get_timestamp_ns()));
+    book.amend_order(7, ticks(99.0), 10);
+    assert(fills.size() == 2);
+    assert(fills[0].maker_order_id == 6 && fills[0].quantity == 4);
+    assert(fills[1].maker_order_id == 4 && fills[1].quantity == 5);
+    
+    book.get_snapshot(5, bids, asks);
+    assert(bids.empty());
+    assert(asks.size() == 1 && asks[0].price == ticks(99.0) && asks[0].total_quantity == 1);
+    assert(book.get_order_count() == 1);
+    std::cout << "✓ Crossing amend test passed\n";
+    
+    std::cout << "\n✅ Matching tests passed!\n\n";
+}
+
+// Ladder backend must behave exactly like the tree-only book
+void test_ladder_backend() {
+    std::cout << "=== Testing Ladder Backend ===\n";
+    
+    OrderBookConfig ladder_config;
+    ladder_config.ladder_levels = 64; // Narrow window so orders spill into the tree
+    OrderBook tree_book;
+    OrderBook ladder_book(ladder_config);
+    
+    FillBuffer tree_fills(1 << 16), ladder_fills(1 << 16);
+    tree_book.set_fill_callback(&FillBuffer::record, &tree_fills);
+    ladder_book.set_fill_callback(&FillBuffer::record, &ladder_fills);
+    
+    std::mt19937_64 rng(7);
+    std::uniform_int_distribution<Price> price_dist(ticks(99.0), ticks(101.0));
+    std::uniform_int_distribution<uint64_t> qty_dist(1, 100);
+    std::uniform_int_distribution<int> op_dist(0, 9);
+    
+    std::vector<PriceLevel> tree_bids, tree_asks, ladder_bids, ladder_asks;
+    uint64_t next_id = 1;
+    for (int i = 0; i < 20000; ++i) {
+        int op = op_dist(rng);
+        if (op < 6 || next_id < 10) {
+            Order order(next_id++, op % 2 == 0, price_dist(rng), qty_dist(rng), 0);
+            tree_book.add_order(order);
+            ladder_book.add_order(order);
+        } else if (op < 8) {
+            uint64_t id = std::uniform_int_distribution<uint64_t>(1, next_id - 1)(rng);
+            assert(tree_book.cancel_order(id) == ladder_book.cancel_order(id));
+        } else {
+            uint64_t id = std::uniform_int_distribution<uint64_t>(1, next_id - 1)(rng);
+            Price px = price_dist(rng);
+            uint64_t qty = qty_dist(rng);
+            assert(tree_book.amend_order(id, px, qty) == ladder_book.amend_order(id, px, qty));
+        }
+        if (i == 10000) {
+            ladder_book.recenter_ladder(ticks(100.5));
+        }
+        if (i % 500 == 0) {
+            tree_book.get_snapshot(1000, tree_bids, tree_asks);
+            ladder_book.get_snapshot(1000, ladder_bids, ladder_asks);
+            assert(tree_bids.size() == ladder_bids.size());
+            assert(tree_asks.size() == ladder_asks.size());
+            for (size_t j = 0; j < tree_bids.size(); ++j) {
+                assert(tree_bids[j].price == ladder_bids[j].price);
+                assert(tree_bids[j].total_quantity == ladder_bids[j].total_quantity);
+            }
+            for (size_t j = 0; j < tree_asks.size(); ++j) {
+                assert(tree_asks[j].price == ladder_asks[j].price);
+                assert(tree_asks[j].total_quantity == ladder_asks[j].total_quantity);
+            }
+        }
+    }
+    assert(tree_book.get_order_count() == ladder_book.get_order_count());
+    assert(tree_fills.size() == ladder_fills.size());
+    std::cout << "✓ Ladder/tree equivalence test passed\n";
+    
+    // Orders keep valid level handles as their levels migrate ladder <-> tree
+    OrderBook moving(ladder_config);
+    for (uint64_t id = 1; id <= 200; ++id) {
+        moving.add_order(Order(id, true, ticks(90.0) + static_cast<Price>(id), 10, 0));
+    }
+    for (Price center : {ticks(90.0), ticks(92.0), ticks(91.0), ticks(95.0)}) {
+        moving.recenter_ladder(center);
+        for (uint64_t id = 1; id <= 200; id += 7) {
+            assert(moving.amend_order(id, ticks(90.0) + static_cast<Price>(id), 5 + center % 3));
+        }
+    }
+    for (uint64_t id = 1; id <= 200; ++id) {
+        assert(moving.cancel_order(id));
+    }
+    moving.get_snapshot(1000, ladder_bids, ladder_asks);
+    assert(moving.get_order_count() == 0 && ladder_bids.empty());
+    std::cout << "✓ Level handle recenter test passed\n";
+    
+    std::cout << "\n✅ Ladder backend tests passed!\n\n";
+}
+
+// The skiplist must hold levels exactly like std::map, and stay ordered
+// while several threads insert, erase and walk it
+void test_skiplist_levels() {
+    std::cout << "=== Testing Skiplist Levels ===\n";
+    
+    using MapSide = BookSide<std::greater<Price>, std::map<Price, PriceLevelQueue, std::greater<Price>>>;
+    using SkipSide = BookSide<std::greater<Price>,
+                              LockFreeSkipList<Price, PriceLevelQueue, std::greater<Price>>>;
+    MapSide map_side;
+    SkipSide skip_side;
+    map_side.enable_ladder(64);
+    skip_side.enable_ladder(64);
+    
+    // One resting node per (side, price) slot; quantities mirror each other
+    std::map<Price, OrderNode> map_nodes, skip_nodes;
+    std::mt19937_64 rng(11);
+    std::uniform_int_distribution<Price> price_dist(ticks(99.0), ticks(101.0));
+    for (int i = 0; i < 20000; ++i) {
+        Price price = price_dist(rng);
+        auto found = map_nodes.find(price);
+        if (found == map_nodes.end()) {
+            uint64_t qty = 1 + rng() % 100;
+            OrderNode& a = map_nodes.emplace(price, OrderNode(qty)).first->second;
+            OrderNode& b = skip_nodes.emplace(price, OrderNode(qty)).first->second;
+            map_side.get_or_create_level(price).add_order(&a);
+            skip_side.get_or_create_level(price).add_order(&b);
+        } else {
+            OrderNode& b = skip_nodes.at(price);
+            PriceLevelQueue* map_level = found->second.level;
+            PriceLevelQueue* skip_level = b.level;
+            assert(map_side.find_level(price) == map_level && skip_side.find_level(price) == skip_level);
+            map_level->remove_order(&found->second);
+            skip_level->remove_order(&b);
+            map_side.remove_level_if_empty(price, *map_level);
+            skip_side.remove_level_if_empty(price, *skip_level);
+            map_nodes.erase(found);
+            skip_nodes.erase(price);
+        }
+        if (i % 2000 == 1000) {
+            Price anchor = price_dist(rng);
+            map_side.recenter(anchor);
+            skip_side.recenter(anchor);
+        }
+        if (i % 250 == 0) {
+            std::vector<std::pair<Price, uint64_t>> map_levels, skip_levels;
+            map_side.for_each_level([&](Price px, const PriceLevelQueue& level) {
+                map_levels.emplace_back(px, level.get_total_quantity());
+                return true;
+            });
+            skip_side.for_each_level([&](Price px, const PriceLevelQueue& level) {
+                skip_levels.emplace_back(px, level.get_total_quantity());
+                return true;
+            });
+            assert(map_levels == skip_levels);
+            Price map_best = 0, skip_best = 0;
+            assert((map_side.best_level(map_best) == nullptr) == (skip_side.best_level(skip_best) == nullptr));
+            assert(map_best == skip_best);
+        }
+    }
+    std::cout << "✓ Skiplist/map BookSide equivalence test passed\n";
+    
+    // Writers own disjoint keys; a reader checks every walk is best-first
+    LockFreeSkipList<Price, std::atomic<uint64_t>, std::greater<Price>> index;
+    const int writers = 3;
+    const Price keys = 3000;
+    std::atomic<bool> done{false};
+    std::thread reader([&] {
+        while (!done.load(std::memory_order_acquire)) {
+            Price last = keys;
+            index.for_each([&](Price px, const std::atomic<uint64_t>& qty) {
+                assert(px < last && qty.load(std::memory_order_relaxed) == static_cast<uint64_t>(px));
+                last = px;
+                return true;
+            });
+        }
+    });
+    std::vector<std::thread> threads;
+    for (int t = 0; t < writers; ++t) {
+        threads.emplace_back([&, t] {
+            for (int round = 0; round < 10; ++round) {
+                for (Price px = t; px < keys; px += writers) {
+                    bool inserted = index.try_emplace(px, static_cast<uint64_t>(px)).second;
+                    assert(inserted);
+                    (void)inserted;
+                }
+                for (Price px = t + writers * (round % 2); px < keys; px += 2 * writers) {
+                    size_t erased = index.erase(px);
+                    assert(erased == 1);
+                    (void)erased;
+                }
+                if (round < 9) {
+                    for (Price px = t + writers * (1 - round % 2); px < keys; px += 2 * writers) {
+                        index.erase(px);
+                    }
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    done.store(true, std::memory_order_release);
+    reader.join();
+    assert(index.size() == static_cast<size_t>(keys / 2));
+    for (const auto& entry : index) {
+        assert((entry.first / writers) % 2 == 0);   // Survivors of the last round
+    }
+    std::cout << "✓ Concurrent skiplist index test passed\n";
+    
+    std::cout << "\n✅ Skiplist level tests passed!\n\n";
+}
+
+// Far-from-touch aggregation is invisible to fills, depth and checkpoints
+void test_depth_limited() {
+    std::cout << "=== Testing Depth-Limited Mode ===\n";
+    
+    OrderBookConfig full_config{kTickSize, 256};
+    OrderBookConfig limited_config = full_config;
+    limited_config.far_band_ticks = 8;
+    OrderBook full(full_config), limited(limited_config);
+    FillBuffer full_fills(1 << 18), limited_fills(1 << 18);
+    full.set_fill_callback(&FillBuffer::record, &full_fills);
+    limited.set_fill_callback(&FillBuffer::record, &limited_fills);
+    
+    // Wide price tail and a fast-moving mid so levels cross the band both ways
+    WorkloadConfig workload;
+    workload.max_offset = 60;
+    workload.zipf_exponent = 0.7;
+    workload.mid_step_probability = 0.2;
+    workload.mix = WorkloadMix{0.40, 0.30, 0.15, 0.15};
+    WorkloadGenerator generator(workload);
+    std::vector<Command> flow;
+    generator.prefill(2000, flow);
+    generator.generate(40000, flow);
+    
+    std::vector<PriceLevel> full_bids, full_asks, limited_bids, limited_asks;
+    size_t peak_far = 0;
+    for (size_t i = 0; i < flow.size(); i += 50) {
+        size_t n = std::min<size_t>(50, flow.size() - i);
+        bool full_ok[50], limited_ok[50];
+        full.apply_batch(flow.data() + i, n, full_ok);
+        limited.apply_batch(flow.data() + i, n, limited_ok);
+        for (size_t j = 0; j < n; ++j) {
+            assert(full_ok[j] == limited_ok[j]);
+        }
+        peak_far = std::max(peak_far, limited.far_order_count());
+        
+        full.get_snapshot(1000, full_bids, full_asks);
+        limited.get_snapshot(1000, limited_bids, limited_asks);
+        assert(full_bids.size() == limited_bids.size() && full_asks.size() == limited_asks.size());
+        for (size_t j = 0; j < full_bids.size(); ++j) {
+            assert(full_bids[j].price == limited_bids[j].price);
+            assert(full_bids[j].total_quantity == limited_bids[j].total_quantity);
+        }
+        for (size_t j = 0; j < full_asks.size(); ++j) {
+            assert(full_asks[j].price == limited_asks[j].price);
+            assert(full_asks[j].total_quantity == limited_asks[j].total_quantity);
+        }
+    }
+    assert(peak_far > 0 && full.get_order_count() == limited.get_order_count());
+    assert(full_fills.size() == limited_fills.size() && full_fills.dropped() == 0);
+    for (size_t i = 0; i < full_fills.size(); ++i) {
+        assert(full_fills[i].maker_order_id == limited_fills[i].maker_order_id);
+        assert(full_fills[i].quantity == limited_fills[i].quantity);
+        assert(full_fills[i].price == limited_fills[i].price);
+    }
+    std::cout << "✓ Fill and depth equivalence test passed (peak far orders "
+              << peak_far << ")\n";
+    
+    // A checkpoint of the limited book restores with every order tracked
+    const std::string path = "/tmp/orderbook_depth_limited.ckpt";
+    limited.save_checkpoint(path);
+    full.save_checkpoint(path + ".full");
+    OrderBook restored(full_config), reference(full_config);
+    restored.restore_checkpoint(path);
+    reference.restore_checkpoint(path + ".full");
+    std::remove(path.c_str());
+    std::remove((path + ".full").c_str());
+    assert(restored.get_order_count() == reference.get_order_count());
+    std::vector<std::pair<uint64_t, uint64_t>> restored_orders, reference_orders;
+    for (bool side : {true, false}) {
+        restored.visit_orders(side, 1000, [&](const Order& o, size_t) {
+            restored_orders.emplace_back(o.order_id, o.quantity);
+        });
+        reference.visit_orders(side, 1000, [&](const Order& o, size_t) {
+            reference_orders.emplace_back(o.order_id, o.quantity);
+        });
+    }
+    assert(restored_orders == reference_orders);
+    std::cout << "✓ Checkpoint with far levels test passed\n";
+    
+    std::cout << "\n✅ Depth-limited mode tests passed!\n\n";
+}
+
+// Upstream that counts what the arena asks of it
+class CountingResource : public std::pmr::memory_resource {
+public:
+    size_t allocations = 0;
+    size_t deallocations = 0;
+    size_t live_bytes = 0;
+    
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        ++allocations;
+        live_bytes += bytes;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        ++deallocations;
+        live_bytes -= bytes;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+void test_arena() {
+    std::cout << "=== Testing Arena Allocator ===\n";
+    
+    CountingResource upstream;
+    {
+        Arena arena(1024, &upstream);
+        for (size_t alignment : {1, 8, 16, 64, 4096}) {
+            void* p = arena.allocate(3, alignment);
+            assert(reinterpret_cast<uintptr_t>(p) % alignment == 0);
+        }
+        // Oversized requests get a chunk of their own
+        assert(arena.allocate(1 << 16, 64) != nullptr);
+        size_t chunks = arena.chunk_count();
+        assert(chunks >= 2 && upstream.allocations == chunks);
+        
+        // Rewinding hands the same bytes out again
+        Arena::Marker marker = arena.mark();
+        uint64_t* first = arena.create<uint64_t>(7);
+        {
+            ArenaScope scope(arena);
+            for (int i = 0; i < 1000; ++i) {
+                arena.create<uint64_t>(i);
+            }
+        }
+        assert(arena.create<uint64_t>(8) == first + 1);
+        arena.rewind(marker);
+        assert(arena.create<uint64_t>(9) == first && *first == 9);
+        
+        // reset() keeps the chunks: a second pass of the same requests is
+        // served without going upstream
+        size_t reserved = arena.reserved();
+        size_t allocations = upstream.allocations;
+        arena.reset();
+        assert(arena.used() == 0);
+        for (int i = 0; i < 1000; ++i) {
+            arena.allocate(24, 8);
+        }
+        assert(upstream.allocations == allocations && arena.reserved() == reserved);
+        
+        arena.release();
+        assert(upstream.live_bytes == 0 && arena.chunk_count() == 0);
+    }
+    
+    // Initial buffer first, then upstream chunks
+    {
+        alignas(64) unsigned char buffer[4096];
+        Arena arena(buffer, sizeof(buffer), 1024, &upstream);
+        void* p = arena.allocate(100);
+        assert(p >= buffer && p < buffer + sizeof(buffer));
+        size_t allocations = upstream.allocations;
+        arena.allocate(8192);
+        assert(upstream.allocations == allocations + 1);
+        assert(arena.chunk_count() == 2);
+        
+        // Scopes that spill past the buffer reuse the same upstream chunk
+        arena.reset();
+        size_t reserved = arena.reserved();
+        for (int i = 0; i < 5; ++i) {
+            ArenaScope scope(arena);
+            arena.allocate(6000);
+        }
+        assert(upstream.allocations == allocations + 1 && arena.chunk_count() == 2);
+        assert(arena.reserved() == reserved);
+        
+        // reset() serves from the buffer again
+        arena.reset();
+        void* q = arena.allocate(100);
+        assert(q >= buffer && q < buffer + sizeof(buffer));
+    }
+    assert(upstream.live_bytes == 0);
+    std::cout << "✓ Alignment, mark/rewind and reset reuse test passed\n";
+    
+    // pmr containers draw from the arena; their frees are no-ops
+    {
+        Arena arena(1 << 16, &upstream);
+        ArenaResource resource(arena);
+        std::pmr::vector<int> values(&resource);
+        for (int i = 0; i < 10000; ++i) {
+            values.push_back(i);
+        }
+        std::pmr::map<int, int> index(&resource);
+        for (int i = 0; i < 1000; ++i) {
+            index[i] = i;
+        }
+        assert(values[9999] == 9999 && index.size() == 1000);
+        assert(arena.used() >= 10000 * sizeof(int));
+    }
+    assert(upstream.live_bytes == 0);
+    std::cout << "✓ std::pmr adapter test passed\n";
+    
+    // A book whose session memory lives in an arena matches a heap book,
+    // and every byte it took goes back with one reset
+    OrderBookConfig heap_config{kTickSize, 64};
+    heap_config.expected_orders = 4000;
+    heap_config.far_band_ticks = 16;
+    OrderBookConfig arena_config = heap_config;
+    Arena arena(1 << 20, &upstream);
+    ArenaResource resource(arena);
+    arena_config.memory_resource = &resource;
+    
+    WorkloadConfig workload;
+    workload.max_offset = 80;
+    workload.mid_step_probability = 0.2;
+    WorkloadGenerator generator(workload);
+    std::vector<Command> flow;
+    generator.prefill(2000, flow);
+    generator.generate(20000, flow);
+    for (int session = 0; session < 2; ++session) {
+        size_t allocations = upstream.allocations;
+        {
+            OrderBook heap(heap_config), pooled(arena_config);
+            std::vector<bool> heap_ok(flow.size()), pooled_ok(flow.size());
+            for (size_t i = 0; i < flow.size(); ++i) {
+                bool a = heap.apply_batch(&flow[i], 1) == 1;
+                bool b = pooled.apply_batch(&flow[i], 1) == 1;
+                assert(a == b);
+            }
+            std::pmr::vector<PriceLevel> bids(&resource), asks(&resource);
+            std::vector<PriceLevel> heap_bids, heap_asks;
+            pooled.get_snapshot(500, bids, asks);
+            heap.get_snapshot(500, heap_bids, heap_asks);
+            assert(bids.size() == heap_bids.size() && asks.size() == heap_asks.size());
+            for (size_t j = 0; j < bids.size(); ++j) {
+                assert(bids[j].price == heap_bids[j].price);
+                assert(bids[j].total_quantity == heap_bids[j].total_quantity);
+            }
+            assert(heap.get_order_count() == pooled.get_order_count());
+            assert(pooled.far_order_count() > 0);
+        }
+        // The second session reuses the first one's chunks
+        if (session == 1) {
+            assert(upstream.allocations == allocations);
+        }
+        assert(arena.used() > 0);
+        arena.reset();
+    }
+    std::cout << "✓ Arena-backed order book test passed (" << arena.chunk_count()
+              << " chunks, " << arena.reserved() / 1024 << " KiB)\n";
+    
+    std::cout << "\n✅ Arena allocator tests passed!\n\n";
+}
+
+void test_slab_allocator() {
+    std::cout << "=== Testing Slab Allocator ===\n";
+    
+    // Size classes cover every size once, and honour alignment
+    for (size_t bytes = 1; bytes <= SlabHeap::kMaxBlock; ++bytes) {
+        size_t index = SlabHeap::class_of(bytes, 8);
+        assert(SlabHeap::class_size(index) >= bytes);
+        assert(index == 0 || SlabHeap::class_size(index - 1) < bytes);
+    }
+    assert(SlabHeap::class_of(SlabHeap::kMaxBlock + 1, 8) == SlabHeap::kClassCount);
+    assert(SlabHeap::class_of(16, 8192) == SlabHeap::kClassCount);
+    
+    SlabHeap& heap = SlabHeap::local();
+    SlabHeap::Stats before = heap.stats();
+    std::vector<std::pair<void*, size_t>> blocks;
+    for (size_t alignment : {8, 16, 64, 256, 4096}) {
+        for (size_t bytes : {1, 24, 100, 1000, 5000, 40000}) {
+            void* p = heap.allocate(bytes, alignment);
+            assert(reinterpret_cast<uintptr_t>(p) % alignment == 0);
+            std::memset(p, 0xab, bytes);
+            blocks.emplace_back(p, bytes * 10000 + alignment);
+        }
+    }
+    for (auto& [p, key] : blocks) {
+        SlabHeap::deallocate(p, key / 10000, key % 10000);
+    }
+    // A freed block is the next one handed out for its class
+    void* first = heap.allocate(48, 8);
+    SlabHeap::deallocate(first, 48, 8);
+    assert(heap.allocate(40, 8) == first);
+    SlabHeap::deallocate(first, 40, 8);
+    SlabHeap::Stats after = heap.stats();
+    assert(after.live_blocks() == before.live_blocks());
+    assert(after.large_allocations - before.large_allocations == 5);
+    assert(after.large_frees - before.large_frees == 5);
+    std::cout << "✓ Size class, alignment and reuse test passed\n";
+    
+    // Blocks freed on another thread return to their owner's lists
+    constexpr int kBlocks = 10000;
+    std::vector<void*> handed(kBlocks);
+    for (int i = 0; i < kBlocks; ++i) {
+        handed[i] = heap.allocate(64, 8);
+    }
+    std::thread other([&] {
+        for (void* p : handed) {
+            SlabHeap::deallocate(p, 64, 8);
+        }
+    });
+    other.join();
+    size_t slabs = heap.stats().classes[SlabHeap::class_of(64, 8)].slabs;
+    for (int i = 0; i < kBlocks; ++i) {
+        handed[i] = heap.allocate(64, 8);
+    }
+    for (void* p : handed) {
+        SlabHeap::deallocate(p, 64, 8);
+    }
+    after = heap.stats();
+    const SlabHeap::ClassStats& c64 = after.classes[SlabHeap::class_of(64, 8)];
+    assert(c64.remote_frees - before.classes[SlabHeap::class_of(64, 8)].remote_frees == kBlocks);
+    assert(c64.slabs == slabs && after.live_blocks() == before.live_blocks());
+    std::cout << "✓ Cross-thread free test passed\n";
+    
+    // Allocator-traits front end under Fifo3 and a node container
+    {
+        Fifo3<int, SlabAllocator<int>, true> fifo(1000);
+        for (int i = 0; i < 1000; ++i) {
+            assert(fifo.push(i));
+        }
+        int value = 0;
+        for (int i = 0; i < 1000; ++i) {
+            assert(fifo.pop(value) && value == i);
+        }
+        std::map<Price, int, std::less<Price>, SlabAllocator<std::pair<const Price, int>>> levels;
+        for (int i = 0; i < 5000; ++i) {
+            levels[i * 7 % 5003] = i;
+        }
+        assert(levels.size() == 5000);
+    }
+    // pmr front end behind an order book
+    {
+        OrderBookConfig config{kTickSize, 64};
+        config.memory_resource = SlabResource::instance();
+        OrderBook slab_book(config), heap_book(OrderBookConfig{kTickSize, 64});
+        WorkloadGenerator generator(WorkloadConfig{});
+        std::vector<Command> flow;
+        generator.prefill(1000, flow);
+        generator.generate(10000, flow);
+        assert(slab_book.apply_batch(flow.data(), flow.size()) ==
+               heap_book.apply_batch(flow.data(), flow.size()));
+        assert(slab_book.get_order_count() == heap_book.get_order_count());
+    }
+    assert(heap.stats().live_blocks() == before.live_blocks());
+    std::cout << "✓ SlabAllocator and SlabResource test passed\n";
+    
+    std::cout << "\n✅ Slab allocator tests passed!\n\n";
+}
+
+struct CountedNode : RefCounted<CountedNode, SingleThreadRefCount> {
+    explicit CountedNode(int v) : value(v) {}
+    ~CountedNode() { ++destroyed; }
+    int value;
+    static inline int destroyed = 0;
+};
+
+struct PooledMessage : PooledRefCounted<PooledMessage, MemoryPool<PooledMessage, 64>,
+                                        SingleThreadRefCount> {
+    explicit PooledMessage(uint64_t s) : sequence(s) {}
+    uint64_t sequence;
+};
+
+void test_intrusive_ptr() {
+    std::cout << "=== Testing Intrusive Pointer ===\n";
+    
+    static_assert(sizeof(IntrusivePtr<CountedNode>) == sizeof(CountedNode*), "one pointer");
+    {
+        IntrusivePtr<CountedNode> a = make_intrusive<CountedNode>(7);
+        assert(a.use_count() == 1);
+        IntrusivePtr<CountedNode> b = a;
+        IntrusivePtr<const CountedNode> c = b;
+        assert(a.use_count() == 3 && c->value == 7);
+        b.reset();
+        IntrusivePtr<CountedNode> d = std::move(a);
+        assert(!a && d.use_count() == 2);
+        CountedNode* raw = d.detach();
+        IntrusivePtr<CountedNode> e = IntrusivePtr<CountedNode>::adopt(raw);
+        assert(e.use_count() == 2 && CountedNode::destroyed == 0);
+    }
+    assert(CountedNode::destroyed == 1);
+    
+    // The last release returns the object to its pool
+    MemoryPool<PooledMessage, 64> messages;
+    PooledMessage* slot;
+    {
+        auto first = make_pooled_intrusive<PooledMessage>(messages, uint64_t{1});
+        auto copy = first;
+        slot = first.get();
+        assert(messages.stats().live == 1 && copy->sequence == 1);
+    }
+    assert(messages.stats().live == 0);
+    auto second = make_pooled_intrusive<PooledMessage>(messages, uint64_t{2});
+    assert(second.get() == slot);
+    second.reset();
+    std::cout << "✓ Copy, move, adopt and pooled release test passed\n";
+    
+    // Snapshots shared by reference with reader threads, recycled by
+    // whichever thread drops the last copy
+    constexpr size_t kReaders = 2;
+    OrderBook book(OrderBookConfig{kTickSize, 256});
+    SnapshotPool<10> snapshots;
+    std::vector<std::unique_ptr<Fifo3<const SharedSnapshot<10>*>>> queues;
+    for (size_t r = 0; r < kReaders; ++r) {
+        queues.push_back(std::make_unique<Fifo3<const SharedSnapshot<10>*>>(64));
+    }
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> seen{0};
+    std::vector<std::thread> readers;
+    for (size_t r = 0; r < kReaders; ++r) {
+        readers.emplace_back([&, r] {
+            const SharedSnapshot<10>* raw;
+            while (true) {
+                if (!queues[r]->pop(raw)) {
+                    if (done.load(std::memory_order_acquire) && queues[r]->empty()) {
+                        break;
+                    }
+                    std::this_thread::yield();
+                    continue;
+                }
+                SnapshotRef<10> snapshot = SnapshotRef<10>::adopt(raw);
+                const BookSnapshot<10>& view = snapshot->view;
+                assert(view.bid_count <= 10 && view.ask_count <= 10);
+                if (view.bid_count && view.ask_count) {
+                    assert(view.bids[0].price < view.asks[0].price);
+                }
+                seen.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+    WorkloadGenerator generator(WorkloadConfig{});
+    std::vector<Command> flow;
+    generator.prefill(500, flow);
+    generator.generate(20000, flow);
+    uint64_t handed = 0;
+    for (size_t i = 0; i < flow.size(); ++i) {
+        book.apply_batch(&flow[i], 1);
+        if (i % 10 == 0) {
+            SnapshotRef<10> snapshot = snapshots.take(book);
+            for (auto& queue : queues) {
+                SnapshotRef<10> copy = snapshot;
+                const SharedSnapshot<10>* raw = copy.detach();
+                while (!queue->push(raw)) {
+                    std::this_thread::yield();
+                }
+                ++handed;
+            }
+        }
+    }
+    done.store(true, std::memory_order_release);
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    snapshots.release();
+    SnapshotRef<10> last = snapshots.take(book);   // Owner thread takes returned slots back
+    PoolStats stats = snapshots.stats();
+    assert(seen.load() == handed && stats.live == 1);
+    assert(stats.high_water <= kReaders * 64 + 2);   // In flight, never one per publish
+    std::cout << "✓ Cross-thread snapshot sharing test passed (" << handed << " handoffs, peak "
+              << stats.high_water << " snapshots)\n";
+    
+    std::cout << "\n✅ Intrusive pointer tests passed!\n\n";
+}
+
+// Compile-time tables: histogram edges, fixed-point text, integer tick maps
+void test_constexpr_tables() {
+    std::cout << "=== Testing Constexpr Tables ===\n";
+    
+    for (size_t i = 0; i < LatencyHistogram::kBucketCount; ++i) {
+        uint64_t lower = LatencyHistogram::bucket_lower(i);
+        uint64_t upper = LatencyHistogram::bucket_upper(i);
+        assert(lower <= upper);
+        assert(LatencyHistogram::bucket_index(lower) == i && LatencyHistogram::bucket_index(upper) == i);
+        if (i + 1 < LatencyHistogram::kBucketCount) {
+            assert(LatencyHistogram::bucket_lower(i + 1) == upper + 1);
+        }
+    }
+    static_assert(LatencyHistogram::kLowerEdges[LatencyHistogram::bucket_index(1000)] <= 1000, "constexpr edges");
+    std::cout << "✓ Histogram edge table test passed\n";
+    
+    uint64_t power = 1;
+    for (unsigned d = 0; d <= tables::kMaxDecimals; ++d, power *= 10) {
+        assert(tables::kPow10[d] == power);
+    }
+    char text[24];
+    assert(std::string(text, tables::format_fixed(text, 1234500, 4)) == "123.4500");
+    assert(std::string(text, tables::format_fixed(text, -5, 2)) == "-0.05");
+    assert(std::string(text, tables::format_fixed(text, 42, 0)) == "42");
+    assert(std::string(text, tables::format_fixed(text, INT64_MIN, 0)) == "-9223372036854775808");
+    int64_t units = 0;
+    assert(tables::parse_fixed("123.45", 4, units) && units == 1234500);
+    assert(tables::parse_fixed("-0.05", 2, units) && units == -5);
+    assert(tables::parse_fixed("7", 3, units) && units == 7000);
+    assert(tables::parse_fixed(".5", 1, units) && units == 5);
+    assert(tables::parse_fixed("1.23456", 2, units) && units == 123);   // Truncated
+    assert(!tables::parse_fixed("", 2, units) && !tables::parse_fixed("-", 2, units));
+    assert(!tables::parse_fixed("1.2x", 2, units) && !tables::parse_fixed("99999999999999999999", 0, units));
+    std::mt19937_64 rng(47);
+    for (int i = 0; i < 10000; ++i) {
+        int64_t value = static_cast<int64_t>(rng() >> 20) - (int64_t{1} << 43);
+        unsigned decimals = static_cast<unsigned>(rng() % 7);
+        size_t length = tables::format_fixed(text, value, decimals);
+        assert(tables::parse_fixed(std::string_view(text, length), decimals, units) && units == value);
+    }
+    constexpr auto parsed = [] {
+        int64_t out = 0;
+        return tables::parse_fixed("101.25", 2, out) ? out : -1;
+    }();
+    static_assert(parsed == 10125, "parse at compile time");
+    std::cout << "✓ Fixed-point format/parse test passed\n";
+    
+    tables::DecimalTick quarter = tables::DecimalTick::from(0.25);
+    assert(quarter.valid() && std::string(text, quarter.format(text, 401)) == "100.25");
+    assert(tables::DecimalTick::from(0.0001).units == 1 && tables::DecimalTick::from(0.0001).decimals == 4);
+    assert(!tables::DecimalTick::from(1.0 / 3.0).valid());
+    for (uint64_t divisor : {1ull, 3ull, 7ull, 100ull, 500ull, 9999ull, (1ull << 31) - 1}) {
+        tables::ReciprocalDivider divider(divisor);
+        for (int i = 0; i < 20000; ++i) {
+            uint64_t n = rng() & 0xffffffffull;
+            assert(divider.divide(n) == n / divisor);
+            assert(divider.divide_rounded(n) == (n + divisor / 2) / divisor);
+        }
+        assert(divider.divide(0xffffffffull) == 0xffffffffull / divisor);
+    }
+    std::cout << "✓ Reciprocal divider test passed\n";
+    
+    // ITCH prices (1e-4 units) to book ticks with integer math, for ticks that
+    // divide the ITCH unit and for one that does not
+    for (double tick : {0.01, 0.05, 0.0001, 1.0, 1.0 / 3.0}) {
+        for (uint32_t price : {1000000u, 1000300u, 999949u, 1u, 4294967295u}) {
+            OrderBook book(OrderBookConfig{TickSize(tick), 0});
+            ItchDecoder decoder(book, 1, 1);
+            unsigned char m[64];
+            std::vector<unsigned char> stream;
+            itch::append_framed(stream, m, itch::encode_add(m, 1, 1, 1, true, 10, price));
+            decoder.decode(stream.data(), stream.size());
+            decoder.flush();
+            std::vector<PriceLevel> bids, asks;
+            book.get_snapshot(1, bids, asks);
+            Price expected = static_cast<Price>(std::llround(price * itch::kPriceScale / tick));
+            assert(bids.size() == 1 && bids[0].price == expected);
+        }
+    }
+    std::cout << "✓ ITCH integer tick mapping test passed\n";
+    
+    std::cout << "\n✅ Constexpr table tests passed!\n\n";
+}
+
+// perf_event_open counters: whatever opened counts, the rest stay out
+void test_perf_counters() {
+    std::cout << "=== Testing Perf Counters ===\n";
+    
+    PerfCounters perf;
+    std::cout << "  available: " << (perf.available() ? "yes" : "no");
+    if (!perf.missing().empty()) {
+        std::cout << ", missing " << perf.missing();
+    }
+    std::cout << "\n";
+    
+    std::vector<uint64_t> data(1 << 20);
+    perf.start();
+    uint64_t sum = 0;
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = i * 2654435761u;
+        sum += data[i] >> 7;
+    }
+    PerfSample sample = perf.stop();
+    assert(sum != 0);
+    for (unsigned e = 0; e < kPerfEventCount; ++e) {
+        PerfEvent event = static_cast<PerfEvent>(e);
+        assert(!sample.has(event) || perf.has(event));   // Only opened events report
+    }
+    if (sample.has(PerfEvent::Instructions)) {
+        assert(sample[PerfEvent::Instructions] >= data.size());
+    }
+    if (sample.has(PerfEvent::TaskClock)) {
+        assert(sample[PerfEvent::TaskClock] > 0);
+    }
+    sample.print(std::cout, "fill", data.size());
+    std::cout << "✓ Phase counters test passed\n";
+    
+    // Scopes accumulate; nothing outside them is counted
+    PerfSample total;
+    {
+        ScopedPerf scope(perf, total);
+        for (auto& v : data) {
+            v += 1;
+        }
+    }
+    PerfSample one = total;
+    for (auto& v : data) {
+        v += 1;   // Not counted
+    }
+    {
+        ScopedPerf scope(perf, total);
+        for (auto& v : data) {
+            v += 1;
+        }
+    }
+    assert(total.valid == one.valid);
+    for (unsigned e = 0; e < kPerfEventCount; ++e) {
+        assert(total.values[e] >= one.values[e]);
+    }
+    PerfSample none;
+    assert(none.valid == 0 && !none.has(PerfEvent::Cycles));
+    std::cout << "✓ Scoped accumulation test passed\n";
+    
+    std::cout << "\n✅ Perf counter tests passed!\n\n";
+}
+
+// Per-instrument books on a work-stealing pool match one-at-a-time replay
+void test_parallel_replay() {
+    std::cout << "=== Testing Parallel Replay ===\n";
+    
+    {
+        StealingDeque deque(4);
+        assert(deque.push(1) && deque.push(2) && deque.push(3) && deque.push(4) && !deque.push(5));
+        assert(deque.steal() == 1 && deque.take() == 4 && deque.take() == 3);
+        assert(deque.steal() == 2 && deque.take() == StealingDeque::kEmpty && deque.empty());
+        
+        // Uneven tasks, every one run exactly once, pool reused across runs
+        WorkStealingPool pool(4);
+        std::vector<std::atomic<int>> runs(2000);
+        std::vector<size_t> order(runs.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            order[i] = i;
+        }
+        for (int pass = 1; pass <= 3; ++pass) {
+            pool.run(order, [&](size_t task, size_t worker) {
+                assert(worker < pool.size());
+                volatile uint64_t spin = 0;
+                for (size_t k = 0; k < (task % 97 == 0 ? 200000u : 200u); ++k) {
+                    spin = spin + k;
+                }
+                runs[task].fetch_add(1, std::memory_order_relaxed);
+            });
+            uint64_t total = 0;
+            for (const StealStats& stats : pool.stats()) {
+                total += stats.tasks;
+            }
+            assert(total == runs.size());
+            for (auto& count : runs) {
+                assert(count.load() == pass);
+            }
+        }
+    }
+    std::cout << "✓ Work-stealing pool test passed\n";
+    
+    // Interleave uneven instruments into one journal, keeping each one's order
+    const uint32_t kInstruments = 12;
+    std::vector<std::vector<Command>> flows(kInstruments);
+    for (uint32_t k = 0; k < kInstruments; ++k) {
+        WorkloadConfig workload;
+        workload.seed = 100 + k;
+        workload.start_mid = 5000 + 100 * k;
+        WorkloadGenerator generator(workload);
+        generator.prefill(200, flows[k]);
+        generator.generate(1000 + 800 * k, flows[k]);
+    }
+    std::vector<JournalRecord> journal;
+    std::vector<size_t> next(kInstruments, 0);
+    std::mt19937_64 rng(49);
+    for (size_t left = 0;;) {
+        left = 0;
+        for (uint32_t k = 0; k < kInstruments; ++k) {
+            left += flows[k].size() - next[k];
+        }
+        if (left == 0) {
+            break;
+        }
+        uint32_t k = static_cast<uint32_t>(rng() % kInstruments);
+        if (next[k] < flows[k].size()) {
+            journal.push_back(JournalRecord::from_command(flows[k][next[k]++], 900 + k * 7, journal.size()));
+        }
+    }
+    const JournalRecord* begin = journal.data();
+    const JournalRecord* end = begin + journal.size();
+    
+    ParallelReplayConfig config;
+    config.threads = 4;
+    config.collect_deltas = true;
+    config.keep_books = true;
+    ParallelReplayResult result = replay_parallel(begin, end, config);
+    assert(result.instruments.size() == kInstruments && result.books.size() == kInstruments);
+    assert(result.totals.records == journal.size());
+    for (size_t i = 1; i < result.fills.size(); ++i) {
+        assert(result.fills[i - 1].sequence <= result.fills[i].sequence);
+    }
+    for (size_t i = 1; i < result.deltas.size(); ++i) {
+        assert(result.deltas[i - 1].sequence <= result.deltas[i].sequence);
+    }
+    assert(!result.fills.empty());
+    
+    for (size_t i = 0; i < kInstruments; ++i) {
+        const InstrumentReplay& replay = result.instruments[i];
+        assert(replay.instrument_id == 900 + i * 7 && replay.deltas_dropped == 0);
+        
+        // One book, filtered replay of the whole journal
+        OrderBook reference;
+        FillBuffer reference_fills(1 << 16);
+        reference.set_fill_callback(&FillBuffer::record, &reference_fills);
+        ReplayStats stats = replay_journal(begin, end, reference, ReplayPacing::FullSpeed, &replay.instrument_id);
+        assert(stats.records == replay.stats.records && stats.succeeded == replay.stats.succeeded);
+        assert(reference.get_order_count() == replay.resting_orders);
+        
+        std::vector<PriceLevel> a_bids, a_asks, b_bids, b_asks;
+        reference.get_snapshot(1000, a_bids, a_asks);
+        result.books[i]->get_snapshot(1000, b_bids, b_asks);
+        assert(a_bids.size() == b_bids.size() && a_asks.size() == b_asks.size());
+        for (size_t l = 0; l < a_bids.size(); ++l) {
+            assert(a_bids[l].price == b_bids[l].price && a_bids[l].total_quantity == b_bids[l].total_quantity);
+        }
+        for (size_t l = 0; l < a_asks.size(); ++l) {
+            assert(a_asks[l].price == b_asks[l].price && a_asks[l].total_quantity == b_asks[l].total_quantity);
+        }
+        
+        // The instrument's share of the merged fills is its own fill stream
+        size_t f = 0;
+        for (const ReplayFill& fill : result.fills) {
+            if (fill.instrument_id != replay.instrument_id) {
+                continue;
+            }
+            assert(f < reference_fills.size());
+            assert(fill.fill.taker_order_id == reference_fills[f].taker_order_id);
+            assert(fill.fill.maker_order_id == reference_fills[f].maker_order_id);
+            assert(fill.fill.price == reference_fills[f].price && fill.fill.quantity == reference_fills[f].quantity);
+            ++f;
+        }
+        assert(f == reference_fills.size() && f == replay.fills);
+        
+        // And its deltas rebuild the final depth
+        std::map<Price, uint64_t> bid_mirror, ask_mirror;
+        size_t d = 0;
+        for (const ReplayDelta& delta : result.deltas) {
+            if (delta.instrument_id != replay.instrument_id) {
+                continue;
+            }
+            auto& side = delta.delta.is_buy ? bid_mirror : ask_mirror;
+            if (delta.delta.total_quantity) {
+                side[delta.delta.price] = delta.delta.total_quantity;
+            } else {
+                side.erase(delta.delta.price);
+            }
+            ++d;
+        }
+        assert(d == replay.deltas);
+        assert(bid_mirror.size() == b_bids.size() && ask_mirror.size() == b_asks.size());
+        for (const PriceLevel& level : b_bids) {
+            assert(bid_mirror[level.price] == level.total_quantity);
+        }
+    }
+    std::cout << "✓ Per-instrument ordering test passed (" << journal.size() << " records, "
+              << result.fills.size() << " fills, " << result.deltas.size() << " deltas)\n";
+    
+    // Any thread count gives the same merged output
+    for (size_t threads : {1u, 3u, 16u}) {
+        ParallelReplayConfig other = config;
+        other.threads = threads;
+        other.keep_books = false;
+        ParallelReplayResult again = replay_parallel(begin, end, other);
+        assert(again.books.empty() && again.fills.size() == result.fills.size());
+        assert(again.deltas.size() == result.deltas.size());
+        for (size_t i = 0; i < result.fills.size(); ++i) {
+            assert(again.fills[i].sequence == result.fills[i].sequence);
+            assert(again.fills[i].fill.maker_order_id == result.fills[i].fill.maker_order_id);
+        }
+        for (size_t i = 0; i < result.deltas.size(); ++i) {
+            assert(again.deltas[i].sequence == result.deltas[i].sequence);
+            assert(again.deltas[i].delta.total_quantity == result.deltas[i].delta.total_quantity);
+        }
+    }
+    ParallelReplayResult empty = replay_parallel(begin, begin, config);
+    assert(empty.instruments.empty() && empty.totals.records == 0);
+    std::cout << "✓ Deterministic merge test passed\n";
+    
+    std::cout << "\n✅ Parallel replay tests passed!\n\n";
+}
+
 int main() {
     std::cout << "\n╔════════════════════════════════════════╗\n";
     std::cout << "║  Low-Latency Limit Order Book (C++17)  ║\n";
@@ -220,7 +2911,39 @@ int main() {
     try {
         test_basic_operations();
         test_fifo_priority();
-        benchmark_performance();
+        test_memory_pool();
+        test_order_index();
+        test_snapshot_cache();
+        test_depth_queries();
+        test_book_signals();
+        test_l3_visitor();
+        test_apply_batch();
+        test_latency_histogram();
+        test_tsc_clock();
+        test_itch_decoder();
+        test_workload_generator();
+        test_delta_feed();
+        test_delta_broadcast();
+        test_snapshot_seqlock();
+        test_spsc_queues();
+        test_mpmc_queues();
+        test_shm_fifo();
+        test_wait_strategies();
+        test_book_manager();
+        test_journal_replay();
+        test_checkpoint_restore();
+        test_matching();
+        test_ladder_backend();
+        test_skiplist_levels();
+        test_depth_limited();
+        test_arena();
+        test_slab_allocator();
+        test_intrusive_ptr();
+        test_constexpr_tables();
+        test_perf_counters();
+        test_parallel_replay();
+        benchmark_performance("tree", OrderBookConfig{kTickSize, 0});
+        benchmark_performance("ladder", OrderBookConfig{kTickSize, 4096});
         
         std::cout << "╔════════════════════════════════════════╗\n";
         std::cout << "║          All Tests Passed! ✓           ║\n";
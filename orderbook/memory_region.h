@@ -0,0 +1,159 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <stdexcept>
+#include <sys/mman.h>
+
+// One up-front anonymous mapping that the order pool and order index carve
+// their storage from, so nothing is allocated or first-touched once trading
+// starts. Huge pages are tried first (MAP_HUGETLB, needs pages reserved in
+// /proc/sys/vm/nr_hugepages); if that fails the region falls back to normal
+// pages with transparent huge pages requested via madvise. Allocation is a
+// bump pointer; nothing is returned to the region before it is unmapped.
+enum class PageSize { Default, Huge2M, Huge1G };
+
+struct RegionOptions {
+    PageSize page_size = PageSize::Huge2M;
+    bool prefault = true;    // Touch every page at construction
+    bool lock = false;       // mlock(); skipped silently if RLIMIT_MEMLOCK refuses
+};
+
+class MemoryRegion {
+public:
+    // Throws std::runtime_error only if even a normal-page mapping fails
+    MemoryRegion(size_t bytes, const RegionOptions& options = RegionOptions{}) {
+        void* base = MAP_FAILED;
+        if (options.page_size != PageSize::Default) {
+            size_ = round_up(bytes, page_bytes(options.page_size));
+            int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB |
+                        (options.page_size == PageSize::Huge1G ? kMapHuge1G : kMapHuge2M) |
+                        (options.prefault ? MAP_POPULATE : 0);
+            base = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, flags, -1, 0);
+            huge_pages_ = base != MAP_FAILED;
+        }
+        if (base == MAP_FAILED) {
+            // Sized for the pages actually used: a failed 1 GiB attempt must
+            // not leave a small request mapping (and prefaulting) 1 GiB.
+            // Transparent huge pages come in 2 MiB units
+            size_ = round_up(bytes, page_bytes(options.page_size == PageSize::Default
+                                                   ? PageSize::Default : PageSize::Huge2M));
+            base = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (base == MAP_FAILED) {
+                throw std::runtime_error("memory region: mmap failed");
+            }
+            if (options.page_size != PageSize::Default) {
+                ::madvise(base, size_, MADV_HUGEPAGE);
+            }
+            if (options.prefault) {
+                // Write-touch after madvise so the faults can use huge pages
+                volatile unsigned char* p = static_cast<unsigned char*>(base);
+                for (size_t offset = 0; offset < size_; offset += 4096) {
+                    p[offset] = 0;
+                }
+            }
+        }
+        base_ = static_cast<unsigned char*>(base);
+        locked_ = options.lock && ::mlock(base_, size_) == 0;
+    }
+
+    ~MemoryRegion() {
+        if (locked_) {
+            ::munlock(base_, size_);
+        }
+        ::munmap(base_, size_);
+    }
+
+    MemoryRegion(const MemoryRegion&) = delete;
+    MemoryRegion& operator=(const MemoryRegion&) = delete;
+
+    // nullptr once the region cannot fit the request
+    void* allocate(size_t bytes, size_t alignment) {
+        size_t start = (used_ + alignment - 1) & ~(alignment - 1);
+        if (start > size_ || size_ - start < bytes) {
+            return nullptr;
+        }
+        used_ = start + bytes;
+        return base_ + start;
+    }
+
+    bool owns(const void* ptr) const {
+        auto p = static_cast<const unsigned char*>(ptr);
+        return p >= base_ && p < base_ + size_;
+    }
+
+    size_t size() const { return size_; }
+    size_t used() const { return used_; }
+    bool huge_pages() const { return huge_pages_; }   // Explicit MAP_HUGETLB pages
+    bool locked() const { return locked_; }
+
+    static size_t page_bytes(PageSize page_size) {
+        switch (page_size) {
+            case PageSize::Huge1G: return size_t{1} << 30;
+            case PageSize::Huge2M: return size_t{1} << 21;
+            default: return 4096;
+        }
+    }
+
+private:
+    static size_t round_up(size_t bytes, size_t page) { return (bytes + page - 1) / page * page; }
+
+    // MAP_HUGE_2MB / MAP_HUGE_1GB: log2(page size) << MAP_HUGE_SHIFT (26)
+    static constexpr int kMapHuge2M = 21 << 26;
+    static constexpr int kMapHuge1G = 30 << 26;
+
+    unsigned char* base_ = nullptr;
+    size_t size_ = 0;
+    size_t used_ = 0;
+    bool huge_pages_ = false;
+    bool locked_ = false;
+};
+
+// Standard allocator over a MemoryRegion; falls back to `resource` (the
+// heap if null) when the region is absent or full. deallocate() is a no-op
+// for region memory.
+template<typename T>
+struct RegionAllocator {
+    using value_type = T;
+
+    RegionAllocator() = default;
+    explicit RegionAllocator(MemoryRegion* r, std::pmr::memory_resource* res = nullptr)
+        : region(r), resource(res) {}
+    template<typename U>
+    RegionAllocator(const RegionAllocator<U>& other)
+        : region(other.region), resource(other.resource) {}
+
+    T* allocate(size_t n) {
+        if (region) {
+            if (void* p = region->allocate(n * sizeof(T), alignof(T))) {
+                return static_cast<T*>(p);
+            }
+        }
+        if (resource) {
+            return static_cast<T*>(resource->allocate(n * sizeof(T), alignof(T)));
+        }
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t n) {
+        if (region && region->owns(p)) {
+            return;
+        }
+        if (resource) {
+            resource->deallocate(p, n * sizeof(T), alignof(T));
+        } else {
+            ::operator delete(p);
+        }
+    }
+
+    template<typename U>
+    bool operator==(const RegionAllocator<U>& other) const {
+        return region == other.region && resource == other.resource;
+    }
+    template<typename U>
+    bool operator!=(const RegionAllocator<U>& other) const { return !(*this == other); }
+
+    MemoryRegion* region = nullptr;
+    std::pmr::memory_resource* resource = nullptr;
+};
@@ -1,136 +1,414 @@
 #include "order_book.h"
 #include <algorithm>
+#include <cstring>
 #include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-OrderBook::OrderBook() {
-    // Reserve space to minimize rehashing
-    order_lookup_.reserve(10000);
+namespace {
+
+// Checkpoint file layout:
+//   CheckpointHeader
+//   bids best-first: CheckpointLevel, then its CheckpointOrders in FIFO order
+//   asks best-first: same
+struct CheckpointHeader {
+    char magic[8];            // "OBCKPT\0\0"
+    uint32_t version;
+    uint32_t reserved;
+    double tick_size;
+    uint64_t order_count;
+    uint64_t bid_levels;
+    uint64_t ask_levels;
+    uint64_t pool_capacity;
+    uint64_t index_capacity;
+};
+static_assert(sizeof(CheckpointHeader) == 64, "checkpoint header layout is part of the file format");
+
+struct CheckpointLevel {
+    int64_t price;
+    uint64_t order_count;
+};
+
+struct CheckpointOrder {
+    uint64_t order_id;
+    uint64_t quantity;
+    uint64_t timestamp_ns;
+};
+
+constexpr char kCheckpointMagic[8] = {'O', 'B', 'C', 'K', 'P', 'T', 0, 0};
+constexpr uint32_t kCheckpointVersion = 1;
+
+void write_or_throw(const void* data, size_t bytes, std::FILE* file) {
+    if (std::fwrite(data, 1, bytes, file) != bytes) {
+        throw std::runtime_error("checkpoint: write failed");
+    }
+}
+
+} // namespace
+
+class OrderBook::CommandScope {
+public:
+    explicit CommandScope(OrderBook& book) : book_(book), outer_(!book.in_batch_) {
+        book_.in_batch_ = true;
+    }
+    ~CommandScope() {
+        if (outer_) {
+            book_.in_batch_ = false;
+            book_.flush_deltas();
+            book_.publish_signals();
+            book_.publish_snapshot();
+        }
+    }
+    
+private:
+    OrderBook& book_;
+    bool outer_;
+};
+
+OrderBook::OrderBook(TickSize tick_size) : OrderBook(OrderBookConfig{tick_size}) {}
+
+OrderBook::OrderBook(const OrderBookConfig& config)
+    : tick_size_(config.tick_size), ladder_levels_(config.ladder_levels),
+      resource_(config.memory_resource ? config.memory_resource
+                                       : std::pmr::get_default_resource()),
+      bid_cache_{std::pmr::vector<PriceLevel>(config.cached_depth, resource_)},
+      ask_cache_{std::pmr::vector<PriceLevel>(config.cached_depth, resource_)},
+      depth_scratch_(resource_),
+      bids_(resource_),
+      asks_(resource_),
+      region_(make_region(config)),
+      order_lookup_(config.expected_orders,
+                    RegionAllocator<OrderNode*>(region_.get(), config.memory_resource)),
+      order_pool_(region_.get(), config.memory_resource),
+      far_band_(static_cast<Price>(config.far_band_ticks)),
+      far_orders_(far_band_ > 0 ? config.expected_orders : 16,
+                  RegionAllocator<FarOrder>(region_.get(), config.memory_resource)),
+      far_bids_(resource_),
+      far_asks_(resource_) {
+    // Reserve space to minimize rehashing and block allocation
+    order_pool_.reserve(config.expected_orders);
+    
+    if (ladder_levels_ > 0) {
+        bids_.enable_ladder(ladder_levels_);
+        asks_.enable_ladder(ladder_levels_);
+    }
+}
+
+std::unique_ptr<MemoryRegion> OrderBook::make_region(const OrderBookConfig& config) {
+    if (!config.pinned_memory) {
+        return nullptr;
+    }
+    size_t far_entries = config.far_band_ticks > 0 ? config.expected_orders : 16;
+    size_t bytes = OrderPool::bytes_for(config.expected_orders) +
+                   OrderIndex<OrderNode*>::bytes_for(config.expected_orders) +
+                   OrderIndex<FarOrder>::bytes_for(far_entries) + 4096;
+    return std::make_unique<MemoryRegion>(bytes, config.region_options);
 }
 
 OrderBook::~OrderBook() {
     // Clean up all order nodes
-    for (auto& [order_id, node] : order_lookup_) {
+    order_lookup_.for_each([this](uint64_t, OrderNode* node) {
         order_pool_.destroy(node);
-    }
+    });
 }
 
-void OrderBook::add_order(const Order& order) {
+bool OrderBook::add_order(const Order& order) {
+    ORDERBOOK_TIME_SCOPE(latency_.add);
+    CommandScope scope(*this);
+    
+    if (command_callback_) {
+        command_callback_(Command::add(order), command_user_data_);
+    }
+    
     // Check if order already exists
-    if (order_lookup_.find(order.order_id) != order_lookup_.end()) {
-        return; // Duplicate order ID
+    if (order_lookup_.contains(order.order_id) ||
+        (far_band_ > 0 && far_orders_.contains(order.order_id))) {
+        return false; // Duplicate order ID
+    }
+    
+    // Match against the opposite side first; only the remainder rests
+    Order remaining = order;
+    match(remaining);
+    if (remaining.quantity == 0) {
+        return true; // Fully filled
+    }
+    
+    // Depth-limited mode: far from the touch only the aggregate is kept
+    if (far_band_ > 0 && is_far(remaining)) {
+        add_far(remaining);
+        return true;
     }
     
     // Allocate from pool (cache-friendly, no heap fragmentation)
-    OrderNode* node = order_pool_.construct(order);
+    OrderNode* node = order_pool_.construct(OrderMeta(remaining), remaining);
     
     // Add to appropriate side
-    add_to_side(node);
+    add_to_side(node, remaining.is_buy, remaining.price);
     
     // Add to lookup table for O(1) access
-    order_lookup_[order.order_id] = node;
+    order_lookup_.insert(order.order_id, node);
+    return true;
 }
 
-bool OrderBook::cancel_order(uint64_t order_id) {
-    auto it = order_lookup_.find(order_id);
-    if (it == order_lookup_.end()) {
-        return false;
+bool OrderBook::cancel_order(uint64_t order_id, uint64_t timestamp_ns) {
+    ORDERBOOK_TIME_SCOPE(latency_.cancel);
+    CommandScope scope(*this);
+    
+    if (command_callback_) {
+        command_callback_(Command::cancel(order_id, timestamp_ns), command_user_data_);
     }
     
-    OrderNode* node = it->second;
+    // Find and remove from lookup in a single probe
+    OrderNode* node;
+    if (!order_lookup_.take(order_id, node)) {
+        return far_band_ > 0 && cancel_far(order_id);
+    }
     
-    // Remove from price level
+    // Unlink through the node's level handle; no price search
     remove_from_side(node);
     
-    // Remove from lookup
-    order_lookup_.erase(it);
-    
     // Return to pool
     order_pool_.destroy(node);
     
     return true;
 }
 
-bool OrderBook::amend_order(uint64_t order_id, double new_price, uint64_t new_quantity) {
-    auto it = order_lookup_.find(order_id);
-    if (it == order_lookup_.end()) {
-        return false;
+bool OrderBook::amend_order(uint64_t order_id, Price new_price, uint64_t new_quantity,
+                            uint64_t timestamp_ns) {
+    ORDERBOOK_TIME_SCOPE(latency_.amend);
+    CommandScope scope(*this);
+    
+    if (command_callback_) {
+        command_callback_(Command::amend(order_id, new_price, new_quantity, timestamp_ns),
+                          command_user_data_);
+    }
+    
+    OrderNode** found = order_lookup_.find(order_id);
+    if (!found) {
+        return far_band_ > 0 && amend_far(order_id, new_price, new_quantity);
     }
     
-    OrderNode* node = it->second;
-    Order& order = node->order;
+    OrderNode* node = *found;
+    PriceLevelQueue* level = node->level;
     
     // If price changes, treat as cancel + add (loses time priority)
-    if (order.price != new_price) {
+    if (level->price() != new_price) {
+        bool is_buy = level->is_buy();
+        Order taker = order_of(node);
+        taker.price = new_price;
+        taker.quantity = new_quantity;
+        
         // Remove from old price level
         remove_from_side(node);
         
-        // Update order details
-        order.price = new_price;
-        order.quantity = new_quantity;
+        // New price may cross the opposite side
+        match(taker);
+        if (taker.quantity == 0) {
+            order_lookup_.erase(order_id);
+            order_pool_.destroy(node);
+            return true;
+        }
+        
+        // A price that is already aggregated must stay that way
+        if (far_band_ > 0 && is_far(taker)) {
+            order_lookup_.erase(order_id);
+            order_pool_.destroy(node);
+            add_far(taker);
+            return true;
+        }
         
         // Add to new price level (goes to back of queue)
-        add_to_side(node);
+        node->quantity = taker.quantity;
+        add_to_side(node, is_buy, new_price);
         
         return true;
     }
     
     // Only quantity changed - update in place (maintains time priority)
-    if (order.quantity != new_quantity) {
-        if (order.is_buy) {
-            auto level_it = bids_.find(order.price);
-            if (level_it != bids_.end()) {
-                uint64_t old_qty = order.quantity;
-                order.quantity = new_quantity;
-                level_it->second.update_quantity(nullptr, old_qty, new_quantity);
-                return true;
-            }
-        } else {
-            auto level_it = asks_.find(order.price);
-            if (level_it != asks_.end()) {
-                uint64_t old_qty = order.quantity;
-                order.quantity = new_quantity;
-                level_it->second.update_quantity(nullptr, old_qty, new_quantity);
-                return true;
-            }
+    if (node->quantity != new_quantity) {
+        uint64_t old_qty = node->quantity;
+        node->quantity = new_quantity;
+        level->update_quantity(node, old_qty, new_quantity);
+        touch_level(level->is_buy(), level->price(), level->get_total_quantity());
+    }
+    
+    return true;
+}
+
+bool OrderBook::reduce_order(uint64_t order_id, uint64_t quantity, uint64_t timestamp_ns) {
+    ORDERBOOK_TIME_SCOPE(latency_.cancel);
+    CommandScope scope(*this);
+    
+    if (command_callback_) {
+        command_callback_(Command::reduce(order_id, quantity, timestamp_ns), command_user_data_);
+    }
+    
+    OrderNode** found = order_lookup_.find(order_id);
+    if (!found) {
+        FarOrder* record = far_band_ > 0 ? far_orders_.find(order_id) : nullptr;
+        if (!record) {
+            return false;
         }
+        if (quantity >= record->quantity) {
+            return cancel_far(order_id);
+        }
+        return amend_far(order_id, record->price, record->quantity - quantity);
     }
     
-    // No changes made (price and quantity are the same)
+    OrderNode* node = *found;
+    if (quantity >= node->quantity) {
+        order_lookup_.erase(order_id);
+        remove_from_side(node);
+        order_pool_.destroy(node);
+        return true;
+    }
+    
+    PriceLevelQueue* level = node->level;
+    uint64_t old_qty = node->quantity;
+    node->quantity = old_qty - quantity;
+    level->update_quantity(node, old_qty, node->quantity);
+    touch_level(level->is_buy(), level->price(), level->get_total_quantity());
     return true;
 }
 
-void OrderBook::get_snapshot(size_t depth, std::vector<PriceLevel>& bids,
-                             std::vector<PriceLevel>& asks) const {
-    bids.clear();
-    asks.clear();
+size_t OrderBook::apply_batch(const Command* commands, size_t count, bool* results) {
+    // Two-stage lookahead: index/level slots far ahead, order nodes (whose
+    // address needs the now-cached index slot) closer in
+    constexpr size_t kSlotDistance = 8;
+    constexpr size_t kNodeDistance = 4;
+    CommandScope scope(*this);
     
-    // Reserve space to avoid reallocation
-    bids.reserve(depth);
-    asks.reserve(depth);
+    for (size_t i = 0; i < std::min(count, kSlotDistance); ++i) {
+        prefetch_command(commands[i]);
+    }
     
-    // Get top N bids (already sorted descending)
-    size_t count = 0;
-    for (const auto& [price, level] : bids_) {
-        if (count >= depth) break;
-        bids.emplace_back(price, level.get_total_quantity());
-        ++count;
+    size_t succeeded = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (i + kSlotDistance < count) {
+            prefetch_command(commands[i + kSlotDistance]);
+        }
+        if (i + kNodeDistance < count) {
+            prefetch_node(commands[i + kNodeDistance]);
+        }
+        
+        const Command& command = commands[i];
+        bool ok = false;
+        switch (command.type) {
+            case CommandType::Add:
+                ok = add_order(command.order);
+                break;
+            case CommandType::Cancel:
+                ok = cancel_order(command.order.order_id, command.order.timestamp_ns);
+                break;
+            case CommandType::Amend:
+                ok = amend_order(command.order.order_id, command.order.price,
+                                 command.order.quantity, command.order.timestamp_ns);
+                break;
+            case CommandType::Reduce:
+                ok = reduce_order(command.order.order_id, command.order.quantity,
+                                  command.order.timestamp_ns);
+                break;
+        }
+        if (results) {
+            results[i] = ok;
+        }
+        succeeded += ok;
+    }
+    return succeeded;
+}
+
+void OrderBook::get_snapshot(size_t depth, PriceLevel* bids, size_t& bid_count,
+                             PriceLevel* asks, size_t& ask_count) const {
+    ORDERBOOK_TIME_SCOPE(latency_.snapshot);
+    
+    if (depth > bid_cache_.levels.size()) {
+        // Deeper than the cache: walk the levels directly
+        bid_count = copy_levels(bids_, far_bids_, depth, bids);
+        ask_count = copy_levels(asks_, far_asks_, depth, asks);
+        return;
     }
     
-    // Get top N asks (already sorted ascending)
-    count = 0;
-    for (const auto& [price, level] : asks_) {
-        if (count >= depth) break;
-        asks.emplace_back(price, level.get_total_quantity());
-        ++count;
+    const TopCache& bid_top = refreshed_cache(bid_cache_, bids_, far_bids_);
+    const TopCache& ask_top = refreshed_cache(ask_cache_, asks_, far_asks_);
+    bid_count = std::min(depth, bid_top.count);
+    ask_count = std::min(depth, ask_top.count);
+    std::copy_n(bid_top.levels.begin(), bid_count, bids);
+    std::copy_n(ask_top.levels.begin(), ask_count, asks);
+}
+
+const PriceLevel* OrderBook::depth_view(bool is_buy, size_t& max_levels) const {
+    size_t cached = bid_cache_.levels.size();
+    if (max_levels == 0 || max_levels <= cached) {
+        const TopCache& top = is_buy ? refreshed_cache(bid_cache_, bids_, far_bids_)
+                                     : refreshed_cache(ask_cache_, asks_, far_asks_);
+        max_levels = std::min(max_levels == 0 ? cached : max_levels, top.count);
+        return top.levels.data();
+    }
+    depth_scratch_.resize(max_levels);
+    max_levels = is_buy ? copy_levels(bids_, far_bids_, max_levels, depth_scratch_.data())
+                        : copy_levels(asks_, far_asks_, max_levels, depth_scratch_.data());
+    return depth_scratch_.data();
+}
+
+// depth_quantity and quantity_within have fixed trip counts and no early
+// exit, so they vectorize over the contiguous level array
+uint64_t OrderBook::depth_quantity(bool is_buy, size_t max_levels) const {
+    const PriceLevel* levels = depth_view(is_buy, max_levels);
+    uint64_t total = 0;
+    for (size_t i = 0; i < max_levels; ++i) {
+        total += levels[i].total_quantity;
     }
+    return total;
+}
+
+uint64_t OrderBook::quantity_within(bool is_buy, Price ticks, size_t max_levels) const {
+    const PriceLevel* levels = depth_view(is_buy, max_levels);
+    if (max_levels == 0) {
+        return 0;
+    }
+    // Levels are sorted, so this is a masked sum rather than a search
+    Price best = levels[0].price;
+    uint64_t total = 0;
+    for (size_t i = 0; i < max_levels; ++i) {
+        Price behind = is_buy ? best - levels[i].price : levels[i].price - best;
+        total += behind <= ticks ? levels[i].total_quantity : 0;
+    }
+    return total;
+}
+
+FillEstimate OrderBook::estimate_fill(bool is_buy, uint64_t quantity, size_t max_levels) const {
+    const PriceLevel* levels = depth_view(!is_buy, max_levels);
+    FillEstimate estimate;
+    uint64_t remaining = quantity;
+    for (size_t i = 0; i < max_levels && remaining > 0; ++i) {
+        uint64_t take = std::min(remaining, levels[i].total_quantity);
+        remaining -= take;
+        estimate.notional += levels[i].price * static_cast<int64_t>(take);
+        estimate.worst_price = levels[i].price;
+        ++estimate.levels;
+    }
+    estimate.filled = quantity - remaining;
+    return estimate;
 }
 
 void OrderBook::print_book(size_t depth) const {
     std::vector<PriceLevel> bids, asks;
     get_snapshot(depth, bids, asks);
     
+    // Prices print with exactly the tick's decimals through integer
+    // formatting; a tick that is not a short decimal falls back to doubles
+    tables::DecimalTick tick = tables::DecimalTick::from(tick_size_.size);
+    auto price_text = [&](Price price) {
+        if (!tick.valid()) {
+            return std::to_string(tick_size_.to_price(price));
+        }
+        char text[24];
+        return std::string(text, tick.format(text, price));
+    };
+    
     std::cout << "\n========== ORDER BOOK ==========\n";
-    std::cout << std::fixed << std::setprecision(2);
     
     // Print asks in reverse (highest first)
     std::cout << "\n--- ASKS ---\n";
@@ -139,7 +417,7 @@ void OrderBook::print_book(size_t depth) const {
     std::cout << std::string(28, '-') << "\n";
     
     for (auto it = asks.rbegin(); it != asks.rend(); ++it) {
-        std::cout << std::setw(12) << it->price << " | "
+        std::cout << std::setw(12) << price_text(it->price) << " | "
                   << std::setw(12) << it->total_quantity << "\n";
     }
     
@@ -152,53 +430,615 @@ void OrderBook::print_book(size_t depth) const {
     std::cout << std::string(28, '-') << "\n";
     
     for (const auto& bid : bids) {
-        std::cout << std::setw(12) << bid.price << " | "
+        std::cout << std::setw(12) << price_text(bid.price) << " | "
                   << std::setw(12) << bid.total_quantity << "\n";
     }
     
     std::cout << "================================\n\n";
 }
 
-// Private helper methods
+void OrderBook::prefetch_command(const Command& command) const {
+    order_lookup_.prefetch(command.order.order_id);
+    if (far_band_ > 0 && command.type != CommandType::Add) {
+        far_orders_.prefetch(command.order.order_id);
+    }
+    if (command.type == CommandType::Add) {
+        // Resting side for a new order. A marketable add also walks the
+        // opposite touch, which is not hinted: finding it is a search, not
+        // an address, and the previous commands usually left it cached
+        if (command.order.is_buy) {
+            bids_.prefetch_level(command.order.price);
+        } else {
+            asks_.prefetch_level(command.order.price);
+        }
+    } else if (command.type == CommandType::Amend) {
+        // The side lives in the order's node, which is not loaded yet;
+        // touch the new price on both sides rather than wait for it
+        bids_.prefetch_level(command.order.price);
+        asks_.prefetch_level(command.order.price);
+    }
+}
+
+void OrderBook::prefetch_node(const Command& command) const {
+    if (command.type == CommandType::Add) {
+        return;
+    }
+    // The node address has to be read from the index, so this is a full
+    // synchronous probe. That is intended: the slot was prefetched
+    // kSlotDistance commands ago, so the probe normally hits cache, and the
+    // two stages need no state carried between them. The node itself is
+    // only hinted, never dereferenced here
+    if (OrderNode* const* node = order_lookup_.find(command.order.order_id)) {
+        __builtin_prefetch(*node);
+    }
+}
+
+// Copy up to depth levels best-first (bids descending, asks ascending),
+// merging far aggregates in price order with the tracked levels
+template<typename Side, typename FarMap>
+size_t OrderBook::copy_levels(const Side& side, const FarMap& far, size_t depth,
+                              PriceLevel* out) {
+    size_t count = 0;
+    if (depth == 0) {
+        return 0;
+    }
+    auto far_it = far.begin();
+    auto better = far.key_comp();
+    side.for_each_level([&](Price price, const PriceLevelQueue& level) {
+        for (; far_it != far.end() && better(far_it->first, price) && count < depth; ++far_it) {
+            out[count++] = PriceLevel(far_it->first, far_it->second.total_quantity);
+        }
+        if (count == depth) {
+            return false;
+        }
+        out[count++] = PriceLevel(price, level.get_total_quantity());
+        return count < depth;
+    });
+    for (; far_it != far.end() && count < depth; ++far_it) {
+        out[count++] = PriceLevel(far_it->first, far_it->second.total_quantity);
+    }
+    return count;
+}
 
-void OrderBook::add_to_side(OrderNode* node) {
-    double price = node->order.price;
+template<typename Side, typename FarMap>
+const OrderBook::TopCache& OrderBook::refreshed_cache(TopCache& cache, const Side& side,
+                                                      const FarMap& far) const {
+    if (cache.dirty) {
+        cache.count = copy_levels(side, far, cache.levels.size(), cache.levels.data());
+        cache.dirty = false;
+    }
+    return cache;
+}
+
+void OrderBook::touch_level(bool is_buy, Price price, uint64_t total_quantity) {
+    if (is_buy) {
+        touch_level<true>(price, total_quantity);
+    } else {
+        touch_level<false>(price, total_quantity);
+    }
+}
+
+// Invalidate the cached view only if the changed level can be inside it:
+// the side has fewer than N levels cached, or price is at/above the Nth
+template<bool IsBuy>
+void OrderBook::touch_level(Price price, uint64_t total_quantity) {
+    if (delta_feed_ || delta_broadcast_) {
+        publish_level(IsBuy, price, total_quantity);
+    }
+    update_signals<IsBuy>(price, total_quantity);
     
-    if (node->order.is_buy) {
-        // Get or create price level for bids
-        auto& level = bids_[price];
-        level.add_order(node);
+    TopCache& cache = IsBuy ? bid_cache_ : ask_cache_;
+    if (!cache.dirty) {
+        size_t n = cache.levels.size();
+        if (n > 0 && cache.count == n) {
+            Price worst = cache.levels[n - 1].price;
+            bool inside = IsBuy ? price >= worst : price <= worst;
+            if (!inside) {
+                return;
+            }
+        }
+        cache.dirty = true;
+    }
+    ++version_;
+}
+
+// Only a change at or through the touch does work; the best level emptying
+// looks up the next one (the level is already gone from its side)
+template<bool IsBuy>
+void OrderBook::update_signals(Price price, uint64_t total_quantity) {
+    Price& best = IsBuy ? signals_.best_bid : signals_.best_ask;
+    uint64_t& quantity = IsBuy ? signals_.bid_quantity : signals_.ask_quantity;
+    bool at_or_through = quantity == 0 || (IsBuy ? price >= best : price <= best);
+    if (total_quantity > 0 && at_or_through) {
+        best = price;
+        quantity = total_quantity;
+    } else if (total_quantity == 0 && quantity > 0 && price == best) {
+        refresh_touch<IsBuy>();
     } else {
-        // Get or create price level for asks
-        auto& level = asks_[price];
-        level.add_order(node);
+        return;
     }
+    signals_changed_ = true;
 }
 
-void OrderBook::remove_from_side(OrderNode* node) {
-    double price = node->order.price;
+// Best of the tracked side and its far levels
+template<bool IsBuy>
+void OrderBook::refresh_touch() {
+    Price& best = IsBuy ? signals_.best_bid : signals_.best_ask;
+    uint64_t& quantity = IsBuy ? signals_.bid_quantity : signals_.ask_quantity;
+    auto& far = far_of<IsBuy>();
+    Price price;
+    PriceLevelQueue* level = side_of<IsBuy>().best_level(price);
+    if (!far.empty() && (!level || far.key_comp()(far.begin()->first, price))) {
+        best = far.begin()->first;
+        quantity = far.begin()->second.total_quantity;
+    } else {
+        best = level ? price : 0;
+        quantity = level ? level->get_total_quantity() : 0;
+    }
+}
+
+// Outside a batch scope deltas go straight out; inside one, a repeat change
+// to the same level overwrites its pending total
+void OrderBook::publish_level(bool is_buy, Price price, uint64_t total_quantity) {
+    uint64_t key = (static_cast<uint64_t>(price) << 1) | static_cast<uint64_t>(is_buy);
+    if (uint32_t* slot = pending_index_.find(key)) {
+        pending_deltas_[*slot].total_quantity = total_quantity;
+        return;
+    }
+    pending_index_.insert(key, static_cast<uint32_t>(pending_deltas_.size()));
+    pending_deltas_.push_back(LevelDelta{price, total_quantity, 0,
+                                         static_cast<uint8_t>(is_buy), 0, 0});
+    if (!in_batch_) {
+        flush_deltas();
+    }
+}
+
+void OrderBook::flush_deltas() {
+    if (pending_deltas_.empty()) {
+        return;
+    }
+    pending_deltas_.back().end_of_batch = 1;
+    for (LevelDelta& delta : pending_deltas_) {
+        delta.sequence = ++delta_sequence_;
+        bool delivered = delta_feed_ || delta_broadcast_;
+        if (delta_feed_ && !delta_feed_->push(delta)) {
+            delivered = false;
+        }
+        if (delta_broadcast_ && !delta_broadcast_->push(delta)) {
+            delivered = false;
+        }
+        if (!delivered) {
+            ++deltas_dropped_;
+        }
+        pending_index_.erase((static_cast<uint64_t>(delta.price) << 1) |
+                             static_cast<uint64_t>(delta.is_buy));
+    }
+    pending_deltas_.clear();
+}
+
+void OrderBook::publish_signals() {
+    if (!signals_changed_) {
+        return;
+    }
+    signals_changed_ = false;
+    if (signal_feed_) {
+        signals_.sequence = delta_sequence_;
+        if (!signal_feed_->push(signals_)) {
+            ++signals_dropped_;
+        }
+    }
+}
+
+void OrderBook::publish_snapshot() {
+    if (publish_callback_ && published_version_ != version_) {
+        published_version_ = version_;
+        publish_callback_(*this, publish_user_data_);
+    }
+}
+
+void OrderBook::save_checkpoint(const std::string& path) const {
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        throw std::runtime_error("checkpoint: cannot open " + path);
+    }
+    std::setvbuf(file, nullptr, _IOFBF, 1 << 20);
     
-    if (node->order.is_buy) {
-        // Remove from bids
-        auto it = bids_.find(price);
-        if (it != bids_.end()) {
-            it->second.remove_order(node);
-            
-            // Remove empty price levels
-            if (it->second.is_empty()) {
-                bids_.erase(it);
+    PoolStats pool = order_pool_.stats();
+    CheckpointHeader header{};
+    std::memcpy(header.magic, kCheckpointMagic, sizeof(header.magic));
+    header.version = kCheckpointVersion;
+    header.tick_size = tick_size_.size;
+    header.order_count = get_order_count();
+    header.bid_levels = bids_.level_count() + far_bids_.size();
+    header.ask_levels = asks_.level_count() + far_asks_.size();
+    header.pool_capacity = pool.capacity;
+    header.index_capacity = order_lookup_.capacity();
+    
+    try {
+        write_or_throw(&header, sizeof(header), file);
+        write_side(bids_, far_bids_, file);
+        write_side(asks_, far_asks_, file);
+    } catch (...) {
+        std::fclose(file);
+        throw;
+    }
+    if (std::fclose(file) != 0) {
+        throw std::runtime_error("checkpoint: write failed for " + path);
+    }
+}
+
+// Far levels are written like tracked ones (their orders in arrival order),
+// so a restored book tracks every order
+template<typename Side, typename FarMap>
+void OrderBook::write_side(const Side& side, const FarMap& far, std::FILE* file) const {
+    auto better = far.key_comp();
+    auto far_it = far.begin();
+    auto write_far_level = [&] {
+        CheckpointLevel record{far_it->first, far_it->second.order_count};
+        write_or_throw(&record, sizeof(record), file);
+        for (const auto& arrival : far_it->second.arrivals) {
+            const FarOrder* far_order = const_cast<OrderBook*>(this)->live_far(arrival);
+            if (far_order) {
+                CheckpointOrder order{arrival.first, far_order->quantity, far_order->timestamp_ns};
+                write_or_throw(&order, sizeof(order), file);
             }
         }
+        ++far_it;
+    };
+    
+    side.for_each_level([&](Price price, const PriceLevelQueue& level) {
+        while (far_it != far.end() && better(far_it->first, price)) {
+            write_far_level();
+        }
+        CheckpointLevel record{price, level.get_order_count()};
+        write_or_throw(&record, sizeof(record), file);
+        for (const OrderNode* node = level.front(); node; node = node->next) {
+            const OrderMeta& meta = OrderPool::cold(node);
+            CheckpointOrder order{meta.order_id, node->quantity, meta.timestamp_ns};
+            write_or_throw(&order, sizeof(order), file);
+        }
+        return true;
+    });
+    while (far_it != far.end()) {
+        write_far_level();
+    }
+}
+
+void OrderBook::restore_checkpoint(const std::string& path) {
+    if (get_order_count() != 0) {
+        throw std::logic_error("checkpoint: restore requires an empty book");
+    }
+    CommandScope scope(*this);
+    
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("checkpoint: cannot open " + path);
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(CheckpointHeader)) {
+        ::close(fd);
+        throw std::runtime_error("checkpoint: truncated file " + path);
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void* map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        throw std::runtime_error("checkpoint: mmap failed for " + path);
+    }
+    ::madvise(map, size, MADV_SEQUENTIAL);
+    
+    const unsigned char* p = static_cast<const unsigned char*>(map);
+    const unsigned char* end = p + size;
+    CheckpointHeader header;
+    std::memcpy(&header, p, sizeof(header));
+    p += sizeof(header);
+    
+    try {
+        if (std::memcmp(header.magic, kCheckpointMagic, sizeof(kCheckpointMagic)) != 0 ||
+            header.version != kCheckpointVersion) {
+            throw std::runtime_error("checkpoint: bad header in " + path);
+        }
+        if (header.tick_size != tick_size_.size) {
+            throw std::runtime_error("checkpoint: tick size mismatch in " + path);
+        }
+        
+        // Presize everything so the pass below never grows or rehashes
+        order_pool_.reserve(std::max<uint64_t>(header.pool_capacity, header.order_count));
+        order_lookup_.reserve(std::max<uint64_t>(header.index_capacity, header.order_count));
+        
+        p = read_side(bids_, true, header.bid_levels, p, end);
+        p = read_side(asks_, false, header.ask_levels, p, end);
+        if (order_lookup_.size() != header.order_count) {
+            throw std::runtime_error("checkpoint: order count mismatch in " + path);
+        }
+    } catch (...) {
+        ::munmap(map, size);
+        throw;
+    }
+    ::munmap(map, size);
+    
+    bid_cache_.dirty = true;
+    ask_cache_.dirty = true;
+    ++version_;
+    refresh_touch<true>();
+    refresh_touch<false>();
+    signals_changed_ = true;
+}
+
+template<typename Side>
+const unsigned char* OrderBook::read_side(Side& side, bool is_buy, uint64_t levels,
+                                          const unsigned char* p, const unsigned char* end) {
+    for (uint64_t l = 0; l < levels; ++l) {
+        CheckpointLevel level_record;
+        if (static_cast<size_t>(end - p) < sizeof(level_record)) {
+            throw std::runtime_error("checkpoint: truncated level");
+        }
+        std::memcpy(&level_record, p, sizeof(level_record));
+        p += sizeof(level_record);
+        if (static_cast<size_t>(end - p) / sizeof(CheckpointOrder) < level_record.order_count) {
+            throw std::runtime_error("checkpoint: truncated orders");
+        }
+        
+        PriceLevelQueue& level = side.append_level(level_record.price);
+        for (uint64_t i = 0; i < level_record.order_count; ++i) {
+            CheckpointOrder record;
+            std::memcpy(&record, p, sizeof(record));
+            p += sizeof(record);
+            
+            Order order(record.order_id, is_buy, level_record.price, record.quantity,
+                        record.timestamp_ns);
+            OrderNode* node = order_pool_.construct(OrderMeta(order), order);
+            level.add_order(node);
+            order_lookup_.insert(record.order_id, node);
+        }
+        if (delta_feed_ || delta_broadcast_) {
+            publish_level(is_buy, level_record.price, level.get_total_quantity());
+        }
+    }
+    return p;
+}
+
+void OrderBook::recenter_ladder(Price center) {
+    Price anchor = center - static_cast<Price>(ladder_levels_ / 2);
+    bids_.recenter(anchor);
+    asks_.recenter(anchor);
+}
+
+// Private helper methods
+
+void OrderBook::match(Order& taker) {
+    if (taker.is_buy) {
+        match_against(taker, asks_);
     } else {
-        // Remove from asks
-        auto it = asks_.find(price);
-        if (it != asks_.end()) {
-            it->second.remove_order(node);
+        match_against(taker, bids_);
+    }
+}
+
+// Walk opposite levels best-first, filling each level's FIFO oldest-first
+template<typename Side>
+void OrderBook::match_against(Order& taker, Side& side) {
+    constexpr bool kMakerIsBuy = Side::kIsBuy;
+    while (taker.quantity > 0) {
+        Price level_price;
+        PriceLevelQueue* level = side.best_level(level_price);
+        if (!level) {
+            break;
+        }
+        bool crosses = kMakerIsBuy ? level_price >= taker.price
+                                   : level_price <= taker.price;
+        if (!crosses) {
+            break;
+        }
+        
+        while (taker.quantity > 0 && !level->is_empty()) {
+            OrderNode* maker = level->front();
+            uint64_t maker_qty = maker->quantity;
+            uint64_t fill_qty = std::min(taker.quantity, maker_qty);
+            
+            if (fill_callback_) {
+                Fill fill{taker.order_id, OrderPool::cold(maker).order_id, level_price,
+                          fill_qty, !kMakerIsBuy};
+                fill_callback_(fill, fill_user_data_);
+            }
             
-            // Remove empty price levels
-            if (it->second.is_empty()) {
-                asks_.erase(it);
+            taker.quantity -= fill_qty;
+            if (fill_qty == maker_qty) {
+                // Maker fully filled: remove from level, lookup and pool
+                level->remove_order(maker);
+                order_lookup_.erase(OrderPool::cold(maker).order_id);
+                order_pool_.destroy(maker);
+            } else {
+                maker->quantity = maker_qty - fill_qty;
+                level->update_quantity(maker, maker_qty, maker->quantity);
             }
         }
+        
+        uint64_t remaining = level->get_total_quantity();
+        bool emptied = level->is_empty();
+        side.remove_level_if_empty(level_price, *level);
+        touch_level<kMakerIsBuy>(level_price, remaining);
+        if (emptied && far_band_ > 0) {
+            // The touch moved back; far levels may now need their orders
+            promote_far_levels<kMakerIsBuy>();
+        }
+    }
+}
+
+void OrderBook::add_to_side(OrderNode* node, bool is_buy, Price price) {
+    if (is_buy) {
+        add_to<true>(node, price);
+    } else {
+        add_to<false>(node, price);
+    }
+}
+
+template<bool IsBuy>
+void OrderBook::add_to(OrderNode* node, Price price) {
+    PriceLevelQueue& level = side_of<IsBuy>().get_or_create_level(price);
+    level.add_order(node);
+    touch_level<IsBuy>(price, level.get_total_quantity());
+}
+
+void OrderBook::remove_from_side(OrderNode* node) {
+    if (node->level->is_buy()) {
+        remove_from<true>(node);
+    } else {
+        remove_from<false>(node);
     }
-}
\ No newline at end of file
+}
+
+// The node's level handle makes this O(1); the tree is only touched when
+// the level empties and is erased
+template<bool IsBuy>
+void OrderBook::remove_from(OrderNode* node) {
+    PriceLevelQueue* level = node->level;
+    Price price = level->price();
+    
+    level->remove_order(node);
+    uint64_t remaining = level->get_total_quantity();
+    bool emptied = level->is_empty();
+    side_of<IsBuy>().remove_level_if_empty(price, *level);
+    touch_level<IsBuy>(price, remaining);
+    if (emptied && far_band_ > 0) {
+        promote_far_levels<IsBuy>();
+    }
+}
+
+// Depth-limited mode
+
+// Far when the price already has a far level, or is new and more than the
+// band behind the side's best tracked price. A tracked price stays tracked.
+bool OrderBook::is_far(const Order& order) {
+    return order.is_buy ? is_far_on<true>(order.price) : is_far_on<false>(order.price);
+}
+
+template<bool IsBuy>
+bool OrderBook::is_far_on(Price price) {
+    auto& side = side_of<IsBuy>();
+    Price best;
+    if (far_of<IsBuy>().count(price)) return true;
+    if (side.find_level(price) || !side.best_level(best)) return false;
+    return IsBuy ? price < best - far_band_ : price > best + far_band_;
+}
+
+void OrderBook::add_far(const Order& order) {
+    FarOrder record{order.price, order.quantity, order.timestamp_ns, far_sequence_++,
+                    order.is_buy};
+    far_orders_.insert(order.order_id, record);
+    FarLevel& level = order.is_buy ? far_bids_[order.price] : far_asks_[order.price];
+    level.total_quantity += order.quantity;
+    ++level.order_count;
+    level.arrivals.emplace_back(order.order_id, static_cast<uint64_t>(record.sequence));
+    touch_level(order.is_buy, order.price, level.total_quantity);
+}
+
+// Caller removes the record from far_orders_ after this returns
+void OrderBook::remove_far(const FarOrder& record) {
+    bool is_buy = record.is_buy;
+    FarLevel& level = is_buy ? far_bids_.find(record.price)->second
+                             : far_asks_.find(record.price)->second;
+    uint64_t remaining = level.total_quantity -= record.quantity;
+    if (--level.order_count == 0) {
+        if (is_buy) {
+            far_bids_.erase(record.price);
+        } else {
+            far_asks_.erase(record.price);
+        }
+    } else if (level.arrivals.size() > 2 * level.order_count + 16) {
+        // Drop dead arrival entries; the departing order is one of them
+        auto dead = [&](const std::pair<uint64_t, uint64_t>& arrival) {
+            return arrival.second == record.sequence || !live_far(arrival);
+        };
+        level.arrivals.erase(std::remove_if(level.arrivals.begin(), level.arrivals.end(), dead),
+                             level.arrivals.end());
+    }
+    touch_level(is_buy, record.price, remaining);
+}
+
+// Record for an arrival entry, or nullptr if that order has since left
+OrderBook::FarOrder* OrderBook::live_far(const std::pair<uint64_t, uint64_t>& arrival) {
+    FarOrder* record = far_orders_.find(arrival.first);
+    return record && record->sequence == arrival.second ? record : nullptr;
+}
+
+bool OrderBook::cancel_far(uint64_t order_id) {
+    FarOrder record{};
+    if (!far_orders_.take(order_id, record)) {
+        return false;
+    }
+    remove_far(record);
+    return true;
+}
+
+bool OrderBook::amend_far(uint64_t order_id, Price new_price, uint64_t new_quantity) {
+    FarOrder* record = far_orders_.find(order_id);
+    if (!record) {
+        return false;
+    }
+    bool is_buy = record->is_buy;
+    
+    // Quantity only: adjust the aggregate, keep the arrival rank
+    if (record->price == new_price) {
+        FarLevel& level = is_buy ? far_bids_[new_price] : far_asks_[new_price];
+        level.total_quantity = level.total_quantity - record->quantity + new_quantity;
+        record->quantity = new_quantity;
+        touch_level(is_buy, new_price, level.total_quantity);
+        return true;
+    }
+    
+    // Price change: leave, match, rest again at the back of the new level
+    Order order(order_id, is_buy, new_price, new_quantity, record->timestamp_ns);
+    remove_far(*record);
+    far_orders_.erase(order_id);
+    match(order);
+    if (order.quantity == 0) {
+        return true;
+    }
+    if (is_far(order)) {
+        add_far(order);
+        return true;
+    }
+    OrderNode* node = order_pool_.construct(OrderMeta(order), order);
+    add_to_side(node, is_buy, new_price);
+    order_lookup_.insert(order_id, node);
+    return true;
+}
+
+// Once the best far level is within the band of the touch, give every far
+// level within 1.5x the band full tracking. Each level's arrival list
+// rebuilds its FIFO exactly; promoting a wider range than needed means the
+// touch has to move several ticks before the next promotion.
+template<bool IsBuy>
+void OrderBook::promote_far_levels() {
+    auto& side = side_of<IsBuy>();
+    auto& far = far_of<IsBuy>();
+    if (far.empty()) {
+        return;
+    }
+    Price best;
+    Price reference = side.best_level(best) ? best : far.begin()->first;
+    Price far_best = far.begin()->first;
+    if ((IsBuy ? reference - far_best : far_best - reference) > far_band_) {
+        return;
+    }
+    
+    Price reach = far_band_ + far_band_ / 2;
+    Price limit = IsBuy ? reference - reach : reference + reach;
+    auto last = far.upper_bound(limit);
+    for (auto it = far.begin(); it != last; ++it) {
+        PriceLevelQueue& level = side.get_or_create_level(it->first);
+        for (const auto& arrival : it->second.arrivals) {
+            FarOrder* record = live_far(arrival);
+            if (!record) {
+                continue;
+            }
+            Order order(arrival.first, IsBuy, it->first, record->quantity, record->timestamp_ns);
+            far_orders_.erase(arrival.first);
+            OrderNode* node = order_pool_.construct(OrderMeta(order), order);
+            level.add_order(node);
+            order_lookup_.insert(order.order_id, node);
+        }
+    }
+    // Aggregates are unchanged, so the top-N cache and delta feed need nothing
+    far.erase(far.begin(), last);
+}
@@ -1,98 +1,546 @@
 #pragma once
 #include <cstdint>
 #include <vector>
+#include <array>
 #include <string>
-#include <unordered_map>
 #include <map>
-#include <list>
+#include <memory_resource>
 #include <memory>
+#include <new>
 #include <iostream>
 #include <iomanip>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <type_traits>
+#include "constexpr_tables.h"
+#include "price_ladder.h"
+#include "order_index.h"
+#include "memory_region.h"
+#include "../SPSC_QUEUES/spsc_q3.cpp"
+#include "../SPSC_QUEUES/broadcast_q.cpp"
+#ifdef ORDERBOOK_SKIPLIST_LEVELS
+#include "../lockFreeWaitFree/lockFreeSkipList.h"
+#endif
+
+// Optional in-book latency instrumentation; compiles to nothing unless
+// built with -DORDERBOOK_INSTRUMENTATION
+#ifdef ORDERBOOK_INSTRUMENTATION
+#include "latency_histogram.h"
+
+// Per-operation latency histograms recorded inside the book
+struct BookLatency {
+    LatencyHistogram add;
+    LatencyHistogram cancel;
+    LatencyHistogram amend;
+    LatencyHistogram snapshot;
+};
+#define ORDERBOOK_TIME_SCOPE(histogram) ScopedLatency orderbook_scope_latency_(histogram)
+#else
+#define ORDERBOOK_TIME_SCOPE(histogram) ((void)0)
+#endif
+
+// Fixed-point price: integer number of ticks
+using Price = int64_t;
+
+// Per-instrument tick size; double <-> tick conversion happens only here
+struct TickSize {
+    double size;
+    
+    constexpr explicit TickSize(double s = 0.01) : size(s) {}
+    
+    Price to_ticks(double price) const {
+        return static_cast<Price>(std::llround(price / size));
+    }
+    
+    double to_price(Price ticks) const {
+        return static_cast<double>(ticks) * size;
+    }
+};
 
 // Order structure
 struct Order {
     uint64_t order_id;
     bool is_buy;
-    double price;
+    Price price;           // In ticks
     uint64_t quantity;
     uint64_t timestamp_ns;
     
-    Order(uint64_t id, bool buy, double p, uint64_t q, uint64_t ts)
+    Order() : order_id(0), is_buy(false), price(0), quantity(0), timestamp_ns(0) {}
+    Order(uint64_t id, bool buy, Price p, uint64_t q, uint64_t ts)
         : order_id(id), is_buy(buy), price(p), quantity(q), timestamp_ns(ts) {}
 };
 
 // Price level aggregation
 struct PriceLevel {
-    double price;
+    Price price;           // In ticks
     uint64_t total_quantity;
     
-    PriceLevel(double p = 0.0, uint64_t q = 0)
+    PriceLevel(Price p = 0, uint64_t q = 0)
         : price(p), total_quantity(q) {}
 };
 
-// Memory pool for efficient order allocation
+// Batched command for OrderBook::apply_batch
+enum class CommandType : uint8_t { Add, Cancel, Amend, Reduce };
+
+struct Command {
+    CommandType type;
+    Order order;   // Add: full order; Cancel: order_id; Amend: order_id, price, quantity;
+                   // Reduce: order_id, quantity to remove
+    
+    static Command add(const Order& order) { return Command{CommandType::Add, order}; }
+    static Command cancel(uint64_t order_id, uint64_t timestamp_ns = 0) {
+        return Command{CommandType::Cancel, Order(order_id, false, 0, 0, timestamp_ns)};
+    }
+    static Command amend(uint64_t order_id, Price new_price, uint64_t new_quantity,
+                         uint64_t timestamp_ns = 0) {
+        return Command{CommandType::Amend,
+                       Order(order_id, false, new_price, new_quantity, timestamp_ns)};
+    }
+    static Command reduce(uint64_t order_id, uint64_t quantity, uint64_t timestamp_ns = 0) {
+        return Command{CommandType::Reduce, Order(order_id, false, 0, quantity, timestamp_ns)};
+    }
+};
+
+// Observer of every command entering the book (e.g. a journal writer)
+using CommandCallback = void (*)(const Command& command, void* user_data);
+
+// Caller-owned fixed-size depth view, filled without allocation
+template<size_t N>
+struct BookSnapshot {
+    std::array<PriceLevel, N> bids;
+    std::array<PriceLevel, N> asks;
+    size_t bid_count = 0;
+    size_t ask_count = 0;
+    uint64_t version = ~uint64_t{0};  // Book version this view was taken at
+};
+
+// Trade generated when an incoming order crosses a resting order
+struct Fill {
+    uint64_t taker_order_id;
+    uint64_t maker_order_id;
+    Price price;           // Resting (maker) price, in ticks
+    uint64_t quantity;
+    bool taker_is_buy;
+};
+
+// Result of sweeping one side for a hypothetical taker; the book is unchanged
+struct FillEstimate {
+    uint64_t filled = 0;        // Short of the request when the levels ran out
+    int64_t notional = 0;       // Sum of price * quantity, ticks x units
+    Price worst_price = 0;      // Last level reached (price-for-size); 0 if none
+    size_t levels = 0;          // Levels consumed, the last one possibly partially
+    
+    // Average fill price in ticks
+    double vwap() const { return filled ? static_cast<double>(notional) / filled : 0.0; }
+};
+
+// Fill sink: plain function pointer + context so matching never allocates
+using FillCallback = void (*)(const Fill& fill, void* user_data);
+
+class OrderBook;
+
+// Called on the book thread after each command or batch that changed the
+// top-N view (e.g. SnapshotSeqlock::publish)
+using PublishCallback = void (*)(const OrderBook& book, void* user_data);
+
+// Preallocated fill buffer usable as a FillCallback target
+class FillBuffer {
+public:
+    explicit FillBuffer(size_t capacity) : fills_(capacity) {}
+    
+    static void record(const Fill& fill, void* user_data) {
+        auto* self = static_cast<FillBuffer*>(user_data);
+        if (self->count_ < self->fills_.size()) {
+            self->fills_[self->count_++] = fill;
+        } else {
+            ++self->dropped_;
+        }
+    }
+    
+    void clear() { count_ = 0; dropped_ = 0; }
+    size_t size() const { return count_; }
+    size_t dropped() const { return dropped_; }
+    const Fill& operator[](size_t i) const { return fills_[i]; }
+    
+private:
+    std::vector<Fill> fills_;
+    size_t count_ = 0;
+    size_t dropped_ = 0;
+};
+
+// Aggregate change of one price level (total_quantity 0 = level removed)
+struct LevelDelta {
+    Price price;
+    uint64_t total_quantity;
+    uint32_t sequence;      // +1 per delta published by the book; a gap means the ring was full
+    uint8_t is_buy;
+    uint8_t end_of_batch;   // Last delta of a command / apply_batch: a mirror is consistent here
+    uint16_t reserved;
+};
+
+// SPSC ring of level deltas: the book's thread pushes, one reader pops
+using DeltaFeed = Fifo3<LevelDelta>;
+
+// The same deltas written once for several readers (strategy, risk,
+// recorder), each with its own cursor
+using DeltaBroadcast = BroadcastRing<LevelDelta>;
+
+// Touch-derived signals, kept current by the book as touch levels change.
+// Prices are in ticks; a side with zero quantity is empty, and the
+// two-sided values are only meaningful when two_sided() holds.
+struct BookSignals {
+    Price best_bid = 0;
+    Price best_ask = 0;
+    uint64_t bid_quantity = 0;
+    uint64_t ask_quantity = 0;
+    uint32_t sequence = 0;   // On the signal feed: last LevelDelta sequence it reflects
+    
+    bool two_sided() const { return bid_quantity > 0 && ask_quantity > 0; }
+    Price spread() const { return best_ask - best_bid; }
+    double mid() const { return 0.5 * static_cast<double>(best_bid + best_ask); }
+    
+    // Touch quantity imbalance (bid - ask) / (bid + ask), in [-1, 1]
+    double imbalance() const {
+        double bid = static_cast<double>(bid_quantity), ask = static_cast<double>(ask_quantity);
+        return bid + ask > 0 ? (bid - ask) / (bid + ask) : 0.0;
+    }
+    
+    // Touch prices weighted by the opposite side's quantity
+    double microprice() const {
+        double bid = static_cast<double>(bid_quantity), ask = static_cast<double>(ask_quantity);
+        if (bid + ask == 0) {
+            return mid();
+        }
+        return (static_cast<double>(best_bid) * ask + static_cast<double>(best_ask) * bid) /
+               (bid + ask);
+    }
+};
+
+// SPSC ring of signal updates, one per command or batch that moved the touch
+using SignalFeed = Fifo3<BookSignals>;
+
+// Memory pool occupancy statistics
+struct PoolStats {
+    size_t live;          // Currently constructed objects
+    size_t high_water;    // Peak live objects since construction
+    size_t capacity;      // Slots backed by allocated blocks
+    size_t blocks;
+};
+
+// Memory pool for efficient order allocation. Destroyed slots go onto an
+// intrusive free list and are handed out again LIFO (most recently freed,
+// cache-hot slot first), so memory stays flat under add/cancel churn.
+// Blocks come from `region` while it has room, then from the heap.
 template<typename T, size_t BlockSize = 4096>
 class MemoryPool {
 public:
-    MemoryPool() : current_block_(nullptr), current_slot_(0) {
+    explicit MemoryPool(MemoryRegion* region = nullptr)
+        : region_(region), current_block_(nullptr), current_slot_(0) {
         allocate_block();
     }
     
     ~MemoryPool() {
         for (auto block : blocks_) {
-            ::operator delete(block);
+            if (!region_ || !region_->owns(block)) {
+                ::operator delete(block);
+            }
         }
     }
     
+    MemoryPool(const MemoryPool&) = delete;
+    MemoryPool& operator=(const MemoryPool&) = delete;
+    
     template<typename... Args>
     T* construct(Args&&... args) {
-        if (current_slot_ >= BlockSize) {
-            allocate_block();
+        T* ptr;
+        if (free_list_) {
+            ptr = reinterpret_cast<T*>(free_list_);
+            free_list_ = free_list_->next;
+        } else {
+            if (current_slot_ >= BlockSize) {
+                next_block();
+            }
+            ptr = &current_block_[current_slot_++];
         }
         
-        T* ptr = &current_block_[current_slot_++];
         new (ptr) T(std::forward<Args>(args)...);
+        if (++live_ > high_water_) {
+            high_water_ = live_;
+        }
         return ptr;
     }
     
     void destroy(T* ptr) {
         ptr->~T();
-        // Note: We don't actually free memory, it's reused in the pool
+        deallocate(ptr);
+    }
+    
+    // Take back the slot of an object that was already destroyed
+    void deallocate(T* ptr) {
+        // Thread the slot onto the free list for reuse
+        FreeSlot* slot = reinterpret_cast<FreeSlot*>(ptr);
+        slot->next = free_list_;
+        free_list_ = slot;
+        --live_;
+    }
+    
+    // Pre-allocate blocks so at least `count` objects fit without allocating
+    void reserve(size_t count) {
+        while (blocks_.size() * BlockSize < count) {
+            blocks_.push_back(allocate());
+        }
+    }
+    
+    // Bytes reserve(count) allocates, for sizing a MemoryRegion
+    static constexpr size_t bytes_for(size_t count) {
+        return (count + BlockSize - 1) / BlockSize * BlockSize * sizeof(T);
+    }
+    
+    PoolStats stats() const {
+        return PoolStats{live_, high_water_, blocks_.size() * BlockSize, blocks_.size()};
     }
     
 private:
+    struct FreeSlot {
+        FreeSlot* next;
+    };
+    static_assert(sizeof(T) >= sizeof(FreeSlot), "slot must fit a free-list link");
+    
+    T* allocate() {
+        if (region_) {
+            if (void* block = region_->allocate(BlockSize * sizeof(T), alignof(T))) {
+                return static_cast<T*>(block);
+            }
+        }
+        return static_cast<T*>(::operator new(BlockSize * sizeof(T)));
+    }
+    
     void allocate_block() {
-        T* new_block = static_cast<T*>(::operator new(BlockSize * sizeof(T)));
+        T* new_block = allocate();
         blocks_.push_back(new_block);
+        current_block_index_ = blocks_.size() - 1;
         current_block_ = new_block;
         current_slot_ = 0;
     }
     
+    // Advance to the next reserved block, allocating only when none is left
+    void next_block() {
+        if (current_block_index_ + 1 < blocks_.size()) {
+            current_block_ = blocks_[++current_block_index_];
+            current_slot_ = 0;
+        } else {
+            allocate_block();
+        }
+    }
+    
+    MemoryRegion* region_;
     std::vector<T*> blocks_;
     T* current_block_;
+    size_t current_block_index_ = 0;
     size_t current_slot_;
+    FreeSlot* free_list_ = nullptr;
+    size_t live_ = 0;
+    size_t high_water_ = 0;
 };
 
-// Internal order node with list iterator
-struct OrderNode {
-    Order order;
-    std::list<OrderNode*>::iterator list_iter;
+// Pool of hot objects with a parallel array of cold metadata per block.
+// Each block is one allocation aligned to its power-of-two size,
+//   [Hot x BlockSize][Cold x BlockSize]
+// so cold(hot) is a mask, a shift and an add (no back pointer per object),
+// and a sweep over hot objects never pulls cold bytes into cache.
+// Blocks come from `region` while it has room, then from `resource` (the
+// heap if null).
+template<typename Hot, typename Cold, size_t BlockSize = 4096>
+class SplitPool {
+public:
+    explicit SplitPool(MemoryRegion* region = nullptr,
+                       std::pmr::memory_resource* resource = nullptr)
+        : region_(region), resource_(resource) {}
+    
+    ~SplitPool() {
+        for (auto block : blocks_) {
+            if (region_ && region_->owns(block)) {
+                continue;
+            }
+            if (resource_) {
+                resource_->deallocate(block, kBlockBytes, kBlockBytes);
+            } else {
+                ::operator delete(block, std::align_val_t(kBlockBytes));
+            }
+        }
+    }
     
-    OrderNode(const Order& o) : order(o) {}
+    SplitPool(const SplitPool&) = delete;
+    SplitPool& operator=(const SplitPool&) = delete;
+    
+    template<typename... Args>
+    Hot* construct(const Cold& cold_data, Args&&... args) {
+        Hot* ptr;
+        if (free_list_) {
+            ptr = reinterpret_cast<Hot*>(free_list_);
+            free_list_ = free_list_->next;
+        } else {
+            if (current_slot_ >= BlockSize) {
+                next_block();
+            }
+            ptr = reinterpret_cast<Hot*>(current_block_) + current_slot_++;
+        }
+        
+        new (ptr) Hot(std::forward<Args>(args)...);
+        new (&cold(ptr)) Cold(cold_data);
+        if (++live_ > high_water_) {
+            high_water_ = live_;
+        }
+        return ptr;
+    }
+    
+    void destroy(Hot* ptr) {
+        cold(ptr).~Cold();
+        ptr->~Hot();
+        FreeSlot* slot = reinterpret_cast<FreeSlot*>(ptr);
+        slot->next = free_list_;
+        free_list_ = slot;
+        --live_;
+    }
+    
+    static Cold& cold(Hot* ptr) {
+        uintptr_t address = reinterpret_cast<uintptr_t>(ptr);
+        uintptr_t base = address & ~(uintptr_t{kBlockBytes} - 1);
+        size_t index = (address - base) / sizeof(Hot);
+        return reinterpret_cast<Cold*>(base + kHotBytes)[index];
+    }
+    static const Cold& cold(const Hot* ptr) { return cold(const_cast<Hot*>(ptr)); }
+    
+    // Pre-allocate blocks so at least `count` objects fit without allocating
+    void reserve(size_t count) {
+        while (blocks_.size() * BlockSize < count) {
+            blocks_.push_back(allocate());
+        }
+    }
+    
+    // Bytes reserve(count) allocates, plus one block of alignment slack,
+    // for sizing a MemoryRegion
+    static constexpr size_t bytes_for(size_t count) {
+        return ((count + BlockSize - 1) / BlockSize + 1) * kBlockBytes;
+    }
+    
+    PoolStats stats() const {
+        return PoolStats{live_, high_water_, blocks_.size() * BlockSize, blocks_.size()};
+    }
+    
+private:
+    struct FreeSlot {
+        FreeSlot* next;
+    };
+    static_assert(sizeof(Hot) >= sizeof(FreeSlot), "slot must fit a free-list link");
+    
+    static constexpr size_t round_up_pow2(size_t n) {
+        size_t p = 1;
+        while (p < n) {
+            p <<= 1;
+        }
+        return p;
+    }
+    static constexpr size_t kHotBytes = BlockSize * sizeof(Hot);
+    static constexpr size_t kBlockBytes = round_up_pow2(kHotBytes + BlockSize * sizeof(Cold));
+    static_assert(kHotBytes % alignof(Cold) == 0, "cold array must start aligned");
+    
+    unsigned char* allocate() {
+        if (region_) {
+            if (void* block = region_->allocate(kBlockBytes, kBlockBytes)) {
+                return static_cast<unsigned char*>(block);
+            }
+        }
+        if (resource_) {
+            return static_cast<unsigned char*>(resource_->allocate(kBlockBytes, kBlockBytes));
+        }
+        return static_cast<unsigned char*>(
+            ::operator new(kBlockBytes, std::align_val_t(kBlockBytes)));
+    }
+    
+    // Advance to the next reserved block, allocating only when none is left
+    void next_block() {
+        if (next_block_ == blocks_.size()) {
+            blocks_.push_back(allocate());
+        }
+        current_block_ = blocks_[next_block_++];
+        current_slot_ = 0;
+    }
+    
+    MemoryRegion* region_;
+    std::pmr::memory_resource* resource_;
+    std::vector<unsigned char*> blocks_;
+    unsigned char* current_block_ = nullptr;
+    size_t next_block_ = 0;
+    size_t current_slot_ = BlockSize;   // Forces a block on first construct
+    FreeSlot* free_list_ = nullptr;
+    size_t live_ = 0;
+    size_t high_water_ = 0;
 };
 
-// Price level implementation with FIFO queue
+class PriceLevelQueue;
+
+// Hot half of a resting order: everything a level sweep touches, packed into
+// 32 bytes so two nodes share a cache line and none straddles one.
+// prev/next are the intrusive FIFO links of its level; level is the queue
+// the order rests in (price and side live there), set by add_order.
+struct alignas(32) OrderNode {
+    OrderNode* prev = nullptr;
+    OrderNode* next = nullptr;
+    PriceLevelQueue* level = nullptr;
+    uint64_t quantity;
+    
+    explicit OrderNode(uint64_t q) : quantity(q) {}
+    explicit OrderNode(const Order& o) : quantity(o.quantity) {}
+};
+static_assert(sizeof(OrderNode) == 32, "hot order node must stay at half a cache line");
+
+// Cold half: read on fills and reporting, never while walking a level
+struct OrderMeta {
+    uint64_t order_id;
+    uint64_t timestamp_ns;
+    
+    explicit OrderMeta(const Order& o) : order_id(o.order_id), timestamp_ns(o.timestamp_ns) {}
+};
+static_assert(sizeof(OrderMeta) == 16, "cold order metadata is 16 bytes");
+
+using OrderPool = SplitPool<OrderNode, OrderMeta, 4096>;
+
+// Price level implementation with intrusive FIFO queue (no per-order
+// allocation: the links live inside the pooled OrderNode). Each level knows
+// its own price and side so a node's level handle is all cancel/amend need.
 class PriceLevelQueue {
 public:
     void add_order(OrderNode* node) {
-        orders_.push_back(node);
-        node->list_iter = std::prev(orders_.end());
-        total_quantity_ += node->order.quantity;
+        node->level = this;
+        node->prev = tail_;
+        node->next = nullptr;
+        if (tail_) {
+            tail_->next = node;
+        } else {
+            head_ = node;
+        }
+        tail_ = node;
+        total_quantity_ += node->quantity;
+        ++order_count_;
     }
     
     void remove_order(OrderNode* node) {
-        total_quantity_ -= node->order.quantity;
-        orders_.erase(node->list_iter);
+        total_quantity_ -= node->quantity;
+        if (node->prev) {
+            node->prev->next = node->next;
+        } else {
+            head_ = node->next;
+        }
+        if (node->next) {
+            node->next->prev = node->prev;
+        } else {
+            tail_ = node->prev;
+        }
+        node->prev = nullptr;
+        node->next = nullptr;
+        --order_count_;
     }
     
     void update_quantity(OrderNode*, uint64_t old_qty, uint64_t new_qty) {
@@ -100,56 +548,572 @@ public:
     }
     
     bool is_empty() const {
-        return orders_.empty();
+        return head_ == nullptr;
+    }
+    
+    // Oldest order at this level (next to be matched); walk with node->next
+    OrderNode* front() const {
+        return head_;
     }
     
     uint64_t get_total_quantity() const {
         return total_quantity_;
     }
     
-    const std::list<OrderNode*>& get_orders() const {
-        return orders_;
+    size_t get_order_count() const {
+        return order_count_;
+    }
+    
+    Price price() const { return price_; }
+    bool is_buy() const { return is_buy_; }
+    
+    // Set by BookSide when the level is created
+    void set_key(Price price, bool is_buy) {
+        price_ = price;
+        is_buy_ = is_buy;
+    }
+    
+    // Point every resting order back at this level after it was moved
+    void relink() {
+        for (OrderNode* node = head_; node; node = node->next) {
+            node->level = this;
+        }
     }
     
 private:
-    std::list<OrderNode*> orders_;
+    OrderNode* head_ = nullptr;
+    OrderNode* tail_ = nullptr;
     uint64_t total_quantity_ = 0;
+    size_t order_count_ = 0;
+    Price price_ = 0;
+    bool is_buy_ = false;
+};
+
+// Ordered container for levels outside the ladder; its nodes come from the
+// book's memory resource. Building with -DORDERBOOK_SKIPLIST_LEVELS swaps
+// std::pmr::map for the lock-free skiplist (which always uses the heap).
+// The book stays single-threaded either way: the PriceLevelQueues under
+// the skiplist's nodes are written without synchronization, so no other
+// thread may walk a book's levels while it is being updated.
+#ifdef ORDERBOOK_SKIPLIST_LEVELS
+template<typename Compare>
+using LevelTree = LockFreeSkipList<Price, PriceLevelQueue, Compare>;
+#else
+template<typename Compare>
+using LevelTree = std::pmr::map<Price, PriceLevelQueue, Compare>;
+#endif
+
+// One side of the book. Prices inside the optional ladder window live in
+// contiguous direct-indexed levels; everything else (far from the touch)
+// falls back to the tree. A price is held by exactly one of the two.
+// Tree is any ordered map with std::map's interface (see LevelTree).
+template<typename Compare, typename Tree = LevelTree<Compare>>
+class BookSide {
+public:
+    static constexpr bool kDescending = std::is_same<Compare, std::greater<Price>>::value;
+    static constexpr bool kIsBuy = kDescending;   // Bids are kept best (highest) first
+    
+    BookSide() = default;
+    // Tree nodes from `resource` when Tree takes one (a pmr map); ignored otherwise
+    template<typename T = Tree,
+             std::enable_if_t<std::is_constructible_v<T, std::pmr::memory_resource*>, int> = 0>
+    explicit BookSide(std::pmr::memory_resource* resource) : tree_(resource) {}
+    template<typename T = Tree,
+             std::enable_if_t<!std::is_constructible_v<T, std::pmr::memory_resource*>, int> = 0>
+    explicit BookSide(std::pmr::memory_resource*) {}
+    
+    void enable_ladder(size_t num_levels) { ladder_.init(num_levels); }
+    bool has_ladder() const { return ladder_.enabled(); }
+    
+    PriceLevelQueue& get_or_create_level(Price price) {
+        // An empty ladder follows the market: re-anchor around the new price
+        if (ladder_.enabled() && ladder_.empty() && !ladder_.contains(price)) {
+            recenter(price - static_cast<Price>(ladder_.size() / 2));
+        }
+        if (ladder_.contains(price)) {
+            PriceLevelQueue& level = ladder_.at(price);
+            if (!ladder_.is_occupied(price)) {
+                ladder_.set_occupied(price);
+                level.set_key(price, kIsBuy);
+            }
+            return level;
+        }
+        auto inserted = tree_.try_emplace(price);
+        if (inserted.second) {
+            inserted.first->second.set_key(price, kIsBuy);
+        }
+        return inserted.first->second;
+    }
+    
+    PriceLevelQueue* find_level(Price price) {
+        if (ladder_.contains(price)) {
+            return ladder_.is_occupied(price) ? &ladder_.at(price) : nullptr;
+        }
+        auto it = tree_.find(price);
+        return it == tree_.end() ? nullptr : &it->second;
+    }
+    
+    // Restore path: levels arrive best-first, so tree inserts hint at the end
+    PriceLevelQueue& append_level(Price price) {
+        if (ladder_.enabled() && (ladder_.empty() || ladder_.contains(price))) {
+            return get_or_create_level(price);
+        }
+        PriceLevelQueue& level = tree_.emplace_hint(tree_.end(), price, PriceLevelQueue{})->second;
+        level.set_key(price, kIsBuy);
+        return level;
+    }
+    
+    size_t level_count() const {
+        size_t count = 0;
+        for_each_level([&](Price, const PriceLevelQueue&) { ++count; return true; });
+        return count;
+    }
+    
+    // Cache hint for an upcoming access; only ladder levels have a fixed address
+    void prefetch_level(Price price) const {
+        if (ladder_.contains(price)) {
+            ladder_.prefetch(price);
+        }
+    }
+    
+    void remove_level_if_empty(Price price, PriceLevelQueue& level) {
+        if (!level.is_empty()) {
+            return;
+        }
+        if (ladder_.contains(price)) {
+            ladder_.clear_occupied(price);
+        } else {
+            tree_.erase(price);
+        }
+    }
+    
+    // Most aggressive level, or nullptr when the side is empty
+    PriceLevelQueue* best_level(Price& price) {
+        Price ladder_price;
+        bool in_ladder = first_ladder_price(ladder_price);
+        if (!tree_.empty() &&
+            (!in_ladder || Compare{}(tree_.begin()->first, ladder_price))) {
+            price = tree_.begin()->first;
+            return &tree_.begin()->second;
+        }
+        if (!in_ladder) {
+            return nullptr;
+        }
+        price = ladder_price;
+        return &ladder_.at(ladder_price);
+    }
+    
+    // Visit levels best-first; f(price, level) returns false to stop
+    template<typename F>
+    void for_each_level(F&& f) const {
+        auto tree_it = tree_.begin();
+        Price ladder_price;
+        bool in_ladder = first_ladder_price(ladder_price);
+        while (in_ladder || tree_it != tree_.end()) {
+            if (in_ladder && (tree_it == tree_.end() ||
+                              Compare{}(ladder_price, tree_it->first))) {
+                if (!f(ladder_price, ladder_.at(ladder_price))) return;
+                in_ladder = next_ladder_price(ladder_price, ladder_price);
+            } else {
+                if (!f(tree_it->first, tree_it->second)) return;
+                ++tree_it;
+            }
+        }
+    }
+    
+    // Move the ladder window to start at new_anchor, migrating levels
+    // between ladder and tree so each price stays in exactly one place.
+    // Moved levels re-point their orders' level handles.
+    void recenter(Price new_anchor) {
+        if (!ladder_.enabled()) {
+            return;
+        }
+        Price price;
+        bool more = !ladder_.empty() &&
+                    ladder_.lowest_at_or_above(ladder_.lowest_price(), price);
+        while (more) {
+            tree_.emplace(price, std::move(ladder_.at(price))).first->second.relink();
+            ladder_.at(price) = PriceLevelQueue{};
+            ladder_.clear_occupied(price);
+            more = !ladder_.empty() && ladder_.lowest_at_or_above(price, price);
+        }
+        
+        ladder_.set_anchor(new_anchor);
+        Price lo = ladder_.lowest_price();
+        Price hi = ladder_.highest_price();
+        auto it = tree_.lower_bound(kDescending ? hi : lo);
+        auto last = tree_.upper_bound(kDescending ? lo : hi);
+        while (it != last) {
+            ladder_.at(it->first) = std::move(it->second);
+            ladder_.at(it->first).relink();
+            ladder_.set_occupied(it->first);
+            it = tree_.erase(it);
+        }
+    }
+    
+private:
+    bool first_ladder_price(Price& price) const {
+        if (ladder_.empty()) {
+            return false;
+        }
+        return kDescending ? ladder_.highest_at_or_below(ladder_.highest_price(), price)
+                           : ladder_.lowest_at_or_above(ladder_.lowest_price(), price);
+    }
+    
+    bool next_ladder_price(Price from, Price& price) const {
+        if (kDescending) {
+            return from != ladder_.lowest_price() &&
+                   ladder_.highest_at_or_below(from - 1, price);
+        }
+        return from != ladder_.highest_price() &&
+               ladder_.lowest_at_or_above(from + 1, price);
+    }
+    
+    Tree tree_;
+    PriceLadder<PriceLevelQueue> ladder_;
+};
+
+// Construction-time book parameters
+struct OrderBookConfig {
+    TickSize tick_size{};
+    size_t ladder_levels = 0;   // Ticks per side in the direct-indexed ladder (0 = tree only)
+    size_t expected_orders = 10000; // Resting orders to presize the pool and order index for
+    size_t cached_depth = 10;       // Levels per side kept in the top-of-book cache
+    size_t far_band_ticks = 0;      // Depth-limited mode: see OrderBook (0 = track every order)
+    // Carve the pool and order index(es) for expected_orders out of one
+    // pre-faulted MemoryRegion at construction (huge pages where available)
+    bool pinned_memory = false;
+    RegionOptions region_options{};
+    // Upstream for everything else the book allocates (level tree and far
+    // level nodes, pool blocks and index slots outside the region, cache
+    // buffers); null uses std::pmr::get_default_resource(). Point it at an
+    // ArenaResource to release a whole session's book memory with one
+    // Arena::reset() after the book is destroyed. Must outlive the book.
+    std::pmr::memory_resource* memory_resource = nullptr;
 };
 
+// Depth-limited mode (far_band_ticks > 0): an order resting more than
+// far_band_ticks behind its side's best price gets no OrderNode or FIFO
+// slot, only a compact FarOrder record and a share of its level's
+// aggregate. When the touch moves to within the band of a far level, all
+// far levels within 1.5x the band are promoted to full tracking in arrival
+// order, so matching and time priority are unchanged. Snapshots include
+// far levels; visit_orders only walks fully tracked levels.
 class OrderBook {
 public:
-    OrderBook();
+    explicit OrderBook(TickSize tick_size = TickSize{});
+    explicit OrderBook(const OrderBookConfig& config);
     ~OrderBook();
     
-    // Core operations
-    void add_order(const Order& order);
-    bool cancel_order(uint64_t order_id);
-    bool amend_order(uint64_t order_id, double new_price, uint64_t new_quantity);
+    // Core operations (add and price-changing amend match before resting)
+    // add_order returns false for a duplicate order ID. timestamp_ns is
+    // only passed on to the command callback (0 = none, as for Command)
+    bool add_order(const Order& order);
+    bool cancel_order(uint64_t order_id, uint64_t timestamp_ns = 0);
+    bool amend_order(uint64_t order_id, Price new_price, uint64_t new_quantity,
+                     uint64_t timestamp_ns = 0);
+    // Remove `quantity` from a resting order in place (time priority kept),
+    // cancelling it once nothing is left; feed executions and partial cancels
+    bool reduce_order(uint64_t order_id, uint64_t quantity, uint64_t timestamp_ns = 0);
+    
+    // Run commands in order; results[i] (optional) receives each command's
+    // return value. Index slots, level slots and order nodes of upcoming
+    // commands are prefetched while the current one executes.
+    // Returns the number of commands that succeeded.
+    size_t apply_batch(const Command* commands, size_t count, bool* results = nullptr);
     
-    // Query operations
-    void get_snapshot(size_t depth, std::vector<PriceLevel>& bids, 
-                     std::vector<PriceLevel>& asks) const;
+    // Query operations (depth <= cached_depth is served from the top-N cache)
+    // Any vector allocator, so the buffers can live in the caller's arena
+    template<typename Alloc>
+    void get_snapshot(size_t depth, std::vector<PriceLevel, Alloc>& bids,
+                      std::vector<PriceLevel, Alloc>& asks) const {
+        // Size once; no-op for callers that reuse their vectors at a fixed depth
+        bids.resize(depth);
+        asks.resize(depth);
+        size_t bid_count, ask_count;
+        get_snapshot(depth, bids.data(), bid_count, asks.data(), ask_count);
+        bids.resize(bid_count);
+        asks.resize(ask_count);
+    }
+    void get_snapshot(size_t depth, PriceLevel* bids, size_t& bid_count,
+                      PriceLevel* asks, size_t& ask_count) const;
+    
+    // Refresh a caller-owned view; returns false (no work) if unchanged
+    template<size_t N>
+    bool get_snapshot(BookSnapshot<N>& out) const {
+        if (out.version == version_) {
+            return false;
+        }
+        get_snapshot(N, out.bids.data(), out.bid_count, out.asks.data(), out.ask_count);
+        out.version = version_;
+        return true;
+    }
+    
+    // Depth queries over the best max_levels levels of one side, far levels
+    // included. max_levels 0 means the cached depth; up to that depth they
+    // read the top-N cache in place and never allocate.
+    uint64_t depth_quantity(bool is_buy, size_t max_levels = 0) const;
+    // Quantity resting at most `ticks` behind the side's best price
+    uint64_t quantity_within(bool is_buy, Price ticks, size_t max_levels = 0) const;
+    // Cost, VWAP and price-for-size of a taker of side is_buy for `quantity`
+    FillEstimate estimate_fill(bool is_buy, uint64_t quantity, size_t max_levels = 0) const;
+    
+    // Bumped whenever a change touches the cached top-N of either side
+    uint64_t version() const { return version_; }
     void print_book(size_t depth = 10) const;
     
+    // Market-by-order (L3) walk: visitor(const Order&, size_t level_index)
+    // is called for each resting order of the best max_levels levels of one
+    // side, best price first and FIFO within a level. No copies are made;
+    // the book must not be modified from inside the visitor.
+    template<typename Visitor>
+    void visit_orders(bool is_buy, size_t max_levels, Visitor&& visitor) const {
+        if (is_buy) {
+            visit_side(bids_, max_levels, visitor);
+        } else {
+            visit_side(asks_, max_levels, visitor);
+        }
+    }
+    
+    // Write every resting order (FIFO position per level) plus pool and index
+    // capacities to a compact file; throws std::runtime_error on I/O failure
+    void save_checkpoint(const std::string& path) const;
+    
+    // Rebuild an empty book from a checkpoint in one linear pass over a
+    // memory-mapped copy, presizing pool, index and levels up front
+    void restore_checkpoint(const std::string& path);
+    
+    // Re-anchor both ladders so they cover ladder_levels ticks around center
+    void recenter_ladder(Price center);
+    
+    // Fills are reported synchronously from add_order / amend_order
+    void set_fill_callback(FillCallback callback, void* user_data = nullptr) {
+        fill_callback_ = callback;
+        fill_user_data_ = user_data;
+    }
+    
+    // Every add/cancel/amend is reported before it is applied
+    void set_command_callback(CommandCallback callback, void* user_data = nullptr) {
+        command_callback_ = callback;
+        command_user_data_ = user_data;
+    }
+    
+    // Run callback once per command / apply_batch that bumped version();
+    // it reads the book through the snapshot API
+    void set_publish_callback(PublishCallback callback, void* user_data = nullptr) {
+        publish_callback_ = callback;
+        publish_user_data_ = user_data;
+        published_version_ = ~uint64_t{0};
+    }
+    
+    // Publish a LevelDelta into feed whenever a level total changes (nullptr
+    // disables). Each command's deltas, or a whole apply_batch's, are
+    // coalesced to one delta per level and pushed when it completes.
+    void set_delta_feed(DeltaFeed* feed) { delta_feed_ = feed; }
+    // Also, or instead, publish them to every reader of a broadcast ring
+    void set_delta_broadcast(DeltaBroadcast* ring) { delta_broadcast_ = ring; }
+    // Deltas some attached ring was too full to take, or with none attached
+    uint64_t deltas_dropped() const { return deltas_dropped_; }
+    // Sequence of the last LevelDelta published (0 before the first); a
+    // command or batch that leaves it unchanged published nothing
+    uint32_t delta_sequence() const { return delta_sequence_; }
+    
+    // Best bid/ask and their quantities as of the last change; mid, spread,
+    // imbalance and microprice derive from them without touching the book
+    const BookSignals& signals() const { return signals_; }
+    
+    // Also push signals_ (nullptr disables) after each command or batch that
+    // changed the touch, following that command's deltas
+    void set_signal_feed(SignalFeed* feed) { signal_feed_ = feed; }
+    uint64_t signals_dropped() const { return signals_dropped_; }
+    
     // Statistics
-    size_t get_order_count() const { return order_lookup_.size(); }
+    size_t get_order_count() const { return order_lookup_.size() + far_orders_.size(); }
+    size_t far_order_count() const { return far_orders_.size(); }
+    const TickSize& tick_size() const { return tick_size_; }
+    size_t cached_depth() const { return bid_cache_.levels.size(); }
+    PoolStats pool_stats() const { return order_pool_.stats(); }
+    // Null unless constructed with pinned_memory
+    const MemoryRegion* memory_region() const { return region_.get(); }
+#ifdef ORDERBOOK_INSTRUMENTATION
+    const BookLatency& latency() const { return latency_; }
+    void reset_latency() { latency_ = BookLatency{}; }
+#endif
     
 private:
-    // Internal helper methods
-    void add_to_side(OrderNode* node);
+    // Internal helper methods. Public entry points branch on side once;
+    // the templates below run against one BookSide, with every further
+    // side test resolved at compile time.
+    template<bool IsBuy>
+    auto& side_of() {
+        if constexpr (IsBuy) return bids_; else return asks_;
+    }
+    template<bool IsBuy>
+    auto& far_of() {
+        if constexpr (IsBuy) return far_bids_; else return far_asks_;
+    }
+    
+    void match(Order& taker);
+    template<typename Side>
+    void match_against(Order& taker, Side& side);
+    void add_to_side(OrderNode* node, bool is_buy, Price price);
+    template<bool IsBuy>
+    void add_to(OrderNode* node, Price price);
     void remove_from_side(OrderNode* node);
-    PriceLevelQueue* get_or_create_level(double price, bool is_buy);
-    void remove_level_if_empty(double price, bool is_buy);
+    template<bool IsBuy>
+    void remove_from(OrderNode* node);
+    void prefetch_command(const Command& command) const;
+    // Region sized for config.expected_orders, or null without pinned_memory
+    static std::unique_ptr<MemoryRegion> make_region(const OrderBookConfig& config);
+    
+    static Order order_of(const OrderNode* node) {
+        const OrderMeta& meta = OrderPool::cold(node);
+        return Order(meta.order_id, node->level->is_buy(), node->level->price(), node->quantity,
+                     meta.timestamp_ns);
+    }
+    void prefetch_node(const Command& command) const;
+    
+    // Depth-limited mode: resting order without a node, FIFO rank kept as sequence
+    struct FarOrder {
+        Price price;
+        uint64_t quantity;
+        uint64_t timestamp_ns;
+        uint64_t sequence : 63;
+        uint64_t is_buy : 1;
+    };
+    struct FarLevel {
+        // The far maps hand their resource down to arrivals
+        using allocator_type = std::pmr::polymorphic_allocator<char>;
+        explicit FarLevel(const allocator_type& alloc = {}) : arrivals(alloc) {}
+        FarLevel(const FarLevel& other, const allocator_type& alloc)
+            : total_quantity(other.total_quantity), order_count(other.order_count),
+              arrivals(other.arrivals, alloc) {}
+        
+        uint64_t total_quantity = 0;
+        uint64_t order_count = 0;
+        // (order ID, sequence) in arrival order; entries of cancelled or
+        // moved orders stay until compaction and are skipped by sequence
+        std::pmr::vector<std::pair<uint64_t, uint64_t>> arrivals;
+    };
+    using FarBids = std::pmr::map<Price, FarLevel, std::greater<Price>>;
+    using FarAsks = std::pmr::map<Price, FarLevel, std::less<Price>>;
+    
+    bool is_far(const Order& order);
+    template<bool IsBuy>
+    bool is_far_on(Price price);
+    void add_far(const Order& order);
+    bool cancel_far(uint64_t order_id);
+    bool amend_far(uint64_t order_id, Price new_price, uint64_t new_quantity);
+    void remove_far(const FarOrder& record);
+    FarOrder* live_far(const std::pair<uint64_t, uint64_t>& arrival);
+    template<bool IsBuy>
+    void promote_far_levels();
+    
+    template<typename Side, typename FarMap>
+    void write_side(const Side& side, const FarMap& far, std::FILE* file) const;
+    template<typename Side>
+    const unsigned char* read_side(Side& side, bool is_buy, uint64_t levels,
+                                   const unsigned char* p, const unsigned char* end);
+    
+    template<typename Side, typename Visitor>
+    static void visit_side(const Side& side, size_t max_levels, Visitor& visitor) {
+        if (max_levels == 0) {
+            return;
+        }
+        size_t level_index = 0;
+        side.for_each_level([&](Price, const PriceLevelQueue& level) {
+            for (const OrderNode* node = level.front(); node; node = node->next) {
+                visitor(order_of(node), level_index);
+            }
+            return ++level_index < max_levels;
+        });
+    }
+    
+    // Top-N view of one side, rebuilt lazily once a change lands inside it
+    struct TopCache {
+        std::pmr::vector<PriceLevel> levels;  // Sized to cached_depth
+        size_t count = 0;
+        bool dirty = false;
+    };
+    void touch_level(bool is_buy, Price price, uint64_t total_quantity);
+    template<bool IsBuy>
+    void touch_level(Price price, uint64_t total_quantity);
+    template<bool IsBuy>
+    void update_signals(Price price, uint64_t total_quantity);
+    template<bool IsBuy>
+    void refresh_touch();
+    template<typename Side, typename FarMap>
+    const TopCache& refreshed_cache(TopCache& cache, const Side& side, const FarMap& far) const;
+    template<typename Side, typename FarMap>
+    static size_t copy_levels(const Side& side, const FarMap& far, size_t depth, PriceLevel* out);
+    // Contiguous best-first levels of one side for the depth queries;
+    // max_levels is replaced by the number available
+    const PriceLevel* depth_view(bool is_buy, size_t& max_levels) const;
+    
+    // Holds deltas and snapshot publication back until the outermost
+    // command or batch finishes
+    class CommandScope;
+    void publish_level(bool is_buy, Price price, uint64_t total_quantity);
+    void flush_deltas();
+    void publish_signals();
+    void publish_snapshot();
+    
+    TickSize tick_size_;
+    size_t ladder_levels_;
+    std::pmr::memory_resource* resource_;
+    
+    mutable TopCache bid_cache_;
+    mutable TopCache ask_cache_;
+    mutable std::pmr::vector<PriceLevel> depth_scratch_;   // Depth queries deeper than the cache
+    uint64_t version_ = 0;
     
     // Buy side: descending order (highest price first)
-    std::map<double, PriceLevelQueue, std::greater<double>> bids_;
+    BookSide<std::greater<Price>> bids_;
     
     // Sell side: ascending order (lowest price first)
-    std::map<double, PriceLevelQueue, std::less<double>> asks_;
+    BookSide<std::less<Price>> asks_;
+    
+    // Pinned storage for the index and pool below; declared first so it
+    // outlives them
+    std::unique_ptr<MemoryRegion> region_;
+    
+    // Fast O(1) order lookup (flat open addressing, no per-insert allocation)
+    OrderIndex<OrderNode*, RegionAllocator<OrderNode*>> order_lookup_;
+    
+    // Hot nodes and their cold metadata, allocated in aligned blocks
+    OrderPool order_pool_;
+    
+    // Depth-limited mode: far orders by ID and per-side far aggregates
+    Price far_band_ = 0;
+    OrderIndex<FarOrder, RegionAllocator<FarOrder>> far_orders_;
+    FarBids far_bids_;
+    FarAsks far_asks_;
+    uint64_t far_sequence_ = 0;
+    
+    FillCallback fill_callback_ = nullptr;
+    void* fill_user_data_ = nullptr;
+    
+    CommandCallback command_callback_ = nullptr;
+    void* command_user_data_ = nullptr;
+    
+    DeltaFeed* delta_feed_ = nullptr;
+    DeltaBroadcast* delta_broadcast_ = nullptr;
+    bool in_batch_ = false;
+    std::vector<LevelDelta> pending_deltas_;
+    OrderIndex<uint32_t> pending_index_{64};   // (price, side) -> pending_deltas_ slot
+    uint32_t delta_sequence_ = 0;
+    uint64_t deltas_dropped_ = 0;
+    
+    BookSignals signals_;
+    bool signals_changed_ = false;
+    SignalFeed* signal_feed_ = nullptr;
+    uint64_t signals_dropped_ = 0;
     
-    // Fast O(1) order lookup
-    std::unordered_map<uint64_t, OrderNode*> order_lookup_;
+    PublishCallback publish_callback_ = nullptr;
+    void* publish_user_data_ = nullptr;
+    uint64_t published_version_ = ~uint64_t{0};
     
-    // Memory pool for efficient allocation
-    MemoryPool<OrderNode, 4096> order_pool_;
+#ifdef ORDERBOOK_INSTRUMENTATION
+    mutable BookLatency latency_;
+#endif
 };
\ No newline at end of file
@@ -0,0 +1,178 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <utility>
+
+// Flat open-addressing index keyed by order ID. Robin Hood probing keeps
+// probe sequences short and sorted by displacement, so a miss stops early;
+// deletion shifts the following run back one slot instead of leaving
+// tombstones, so heavy cancel traffic never degrades lookups.
+// Value is expected to be small and trivially copyable (e.g. a pointer).
+// Allocator (rebound to the slot type) supplies the slot array, e.g. a
+// RegionAllocator to place it in pre-faulted memory.
+template<typename Value, typename Allocator = std::allocator<Value>>
+class OrderIndex {
+public:
+    explicit OrderIndex(size_t expected_entries = 1024, const Allocator& allocator = Allocator())
+        : slots_(SlotAllocator(allocator)) {
+        reserve(expected_entries);
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_t capacity() const { return slots_.size(); }
+
+    // Size the table so `count` entries fit without growing
+    void reserve(size_t count) {
+        size_t needed = capacity_for(count);
+        if (needed > slots_.size()) {
+            rehash(needed);
+        }
+    }
+    
+    // Bytes of slot storage reserve(count) allocates
+    static size_t bytes_for(size_t count) { return capacity_for(count) * sizeof(Slot); }
+
+    Value* find(uint64_t key) {
+        size_t i = home(key);
+        for (uint32_t dist = 1;; ++dist, i = (i + 1) & mask_) {
+            Slot& slot = slots_[i];
+            if (slot.dist < dist) return nullptr;   // Robin Hood invariant: key absent
+            if (slot.key == key) return &slot.value;
+        }
+    }
+
+    const Value* find(uint64_t key) const {
+        return const_cast<OrderIndex*>(this)->find(key);
+    }
+
+    bool contains(uint64_t key) const { return find(key) != nullptr; }
+
+    // Pull the key's home slot into cache ahead of a find/insert/take
+    void prefetch(uint64_t key) const {
+        __builtin_prefetch(&slots_[home(key)]);
+    }
+
+    // Returns false (and leaves the table unchanged) if key already exists
+    bool insert(uint64_t key, Value value) {
+        if (find(key)) {
+            return false;
+        }
+        if ((size_ + 1) * kMaxLoadDen > slots_.size() * kMaxLoadNum) {
+            rehash(slots_.size() * 2);
+        }
+        place(Slot{key, value, 1});
+        ++size_;
+        return true;
+    }
+
+    // Remove key, returning its value through `out`; single probe sequence
+    bool take(uint64_t key, Value& out) {
+        size_t i = home(key);
+        for (uint32_t dist = 1;; ++dist, i = (i + 1) & mask_) {
+            Slot& slot = slots_[i];
+            if (slot.dist < dist) return false;
+            if (slot.key == key) {
+                out = slot.value;
+                erase_at(i);
+                return true;
+            }
+        }
+    }
+
+    bool erase(uint64_t key) {
+        Value ignored;
+        return take(key, ignored);
+    }
+
+    // Visit every (key, value) pair in table order
+    template<typename F>
+    void for_each(F&& f) const {
+        for (const Slot& slot : slots_) {
+            if (slot.dist != 0) f(slot.key, slot.value);
+        }
+    }
+
+    void clear() {
+        for (Slot& slot : slots_) slot.dist = 0;
+        size_ = 0;
+    }
+
+private:
+    // dist is probe distance + 1; 0 marks an empty slot
+    struct Slot {
+        uint64_t key;
+        Value value;
+        uint32_t dist;
+    };
+
+    using SlotAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Slot>;
+    
+    // Max load factor 7/8
+    static constexpr size_t kMaxLoadNum = 7;
+    static constexpr size_t kMaxLoadDen = 8;
+    
+    static size_t capacity_for(size_t count) {
+        size_t needed = 16;
+        while (needed * kMaxLoadNum < count * kMaxLoadDen) {
+            needed <<= 1;
+        }
+        return needed;
+    }
+
+    // Fibonacci hashing spreads sequential order IDs across the table
+    size_t home(uint64_t key) const {
+        return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> shift_);
+    }
+
+    void place(Slot incoming) {
+        size_t i = home(incoming.key);
+        while (true) {
+            Slot& slot = slots_[i];
+            if (slot.dist == 0) {
+                slot = incoming;
+                return;
+            }
+            // Steal from the rich: the less displaced entry moves on
+            if (slot.dist < incoming.dist) {
+                std::swap(slot, incoming);
+            }
+            i = (i + 1) & mask_;
+            ++incoming.dist;
+        }
+    }
+
+    // Backward-shift deletion: pull the rest of the run one slot closer home
+    void erase_at(size_t i) {
+        size_t next = (i + 1) & mask_;
+        while (slots_[next].dist > 1) {
+            slots_[i] = slots_[next];
+            --slots_[i].dist;
+            i = next;
+            next = (next + 1) & mask_;
+        }
+        slots_[i].dist = 0;
+        --size_;
+    }
+
+    void rehash(size_t new_capacity) {
+        std::vector<Slot, SlotAllocator> old(new_capacity, Slot{0, Value{}, 0},
+                                             slots_.get_allocator());
+        old.swap(slots_);
+        mask_ = new_capacity - 1;
+        shift_ = 64;
+        for (size_t c = new_capacity; c > 1; c >>= 1) {
+            --shift_;
+        }
+        for (const Slot& slot : old) {
+            if (slot.dist != 0) place(Slot{slot.key, slot.value, 1});
+        }
+    }
+
+    std::vector<Slot, SlotAllocator> slots_;
+    size_t mask_ = 0;
+    unsigned shift_ = 64;
+    size_t size_ = 0;
+};
@@ -0,0 +1,222 @@
+#include "parallel_replay.h"
+#include "order_index.h"
+#include <algorithm>
+#include <chrono>
+#include <queue>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double micros_since(Clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+// Level deltas one apply_batch can publish before the worker drains them
+constexpr size_t kDeltaRing = 1 << 16;
+
+// One instrument: its slice of the partition and what its replay produced
+struct InstrumentTask {
+    uint32_t instrument_id = 0;
+    size_t first = 0;     // Into the partition's record positions
+    size_t count = 0;
+    InstrumentReplay summary;
+    std::vector<ReplayFill> fills;
+    std::vector<ReplayDelta> deltas;
+    std::unique_ptr<OrderBook> book;
+};
+
+// Fill callback target: tags each fill with the batch being applied
+struct FillTap {
+    std::vector<ReplayFill>* out;
+    uint32_t instrument_id;
+    uint64_t sequence;
+
+    static void record(const Fill& fill, void* tap) {
+        auto* self = static_cast<FillTap*>(tap);
+        self->out->push_back(ReplayFill{self->sequence, self->instrument_id, fill});
+    }
+};
+
+// Scratch reused by every task a worker runs, built on that worker
+struct WorkerScratch {
+    std::vector<Command> batch;
+    std::unique_ptr<DeltaFeed> deltas;
+};
+
+void replay_instrument(InstrumentTask& task, const JournalRecord* begin, const size_t* positions,
+                       const ParallelReplayConfig& config, WorkerScratch& scratch) {
+    auto start = Clock::now();
+    OrderBookConfig book_config = config.book_config;
+    book_config.expected_orders = std::min(task.count, config.max_presize);
+    task.book = std::make_unique<OrderBook>(book_config);
+    OrderBook& book = *task.book;
+
+    FillTap tap{&task.fills, task.instrument_id, 0};
+    if (config.collect_fills) {
+        book.set_fill_callback(&FillTap::record, &tap);
+    }
+    if (config.collect_deltas) {
+        book.set_delta_feed(scratch.deltas.get());
+    }
+
+    ReplayStats& stats = task.summary.stats;
+    const size_t* position = positions + task.first;
+    const size_t* last = position + task.count;
+    while (position != last) {
+        size_t n = std::min(config.batch, static_cast<size_t>(last - position));
+        for (size_t i = 0; i < n; ++i) {
+            scratch.batch[i] = begin[position[i]].to_command();
+        }
+        tap.sequence = position[n - 1];
+        position += n;
+        stats.records += n;
+        stats.succeeded += book.apply_batch(scratch.batch.data(), n);
+        if (config.collect_deltas) {
+            LevelDelta delta;
+            while (scratch.deltas->pop(delta)) {
+                task.deltas.push_back(ReplayDelta{tap.sequence, task.instrument_id, delta});
+            }
+        }
+    }
+    book.set_fill_callback(nullptr);
+    book.set_delta_feed(nullptr);
+
+    task.summary.instrument_id = task.instrument_id;
+    task.summary.fills = task.fills.size();
+    task.summary.deltas = task.deltas.size();
+    task.summary.deltas_dropped = config.collect_deltas ? book.deltas_dropped() : 0;
+    task.summary.resting_orders = book.get_order_count();
+    stats.elapsed_us = micros_since(start);
+    if (!config.keep_books) {
+        task.book.reset();
+    }
+}
+
+// k-way merge of the per-instrument streams on (sequence, instrument).
+// A sequence belongs to one instrument, so outputs of one batch stay
+// together and in the order the book produced them.
+template<typename T>
+std::vector<T> merge_streams(std::vector<InstrumentTask>& tasks, std::vector<T> InstrumentTask::*stream) {
+    size_t total = 0;
+    using Head = std::pair<uint64_t, size_t>;   // Sequence of the next item, task
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+    std::vector<size_t> next(tasks.size(), 0);
+    for (size_t t = 0; t < tasks.size(); ++t) {
+        const std::vector<T>& items = tasks[t].*stream;
+        total += items.size();
+        if (!items.empty()) {
+            heads.emplace(items[0].sequence, t);
+        }
+    }
+    std::vector<T> merged;
+    merged.reserve(total);
+    while (!heads.empty()) {
+        size_t t = heads.top().second;
+        heads.pop();
+        std::vector<T>& items = tasks[t].*stream;
+        uint64_t sequence = items[next[t]].sequence;
+        // Everything of this batch at once
+        while (next[t] < items.size() && items[next[t]].sequence == sequence) {
+            merged.push_back(items[next[t]++]);
+        }
+        if (next[t] < items.size()) {
+            heads.emplace(items[next[t]].sequence, t);
+        }
+    }
+    for (InstrumentTask& task : tasks) {
+        std::vector<T>().swap(task.*stream);   // Merged copies only
+    }
+    return merged;
+}
+
+} // namespace
+
+ParallelReplayResult replay_parallel(const JournalRecord* begin, const JournalRecord* end,
+                                     const ParallelReplayConfig& config) {
+    ParallelReplayResult result;
+    auto start = Clock::now();
+    size_t record_count = static_cast<size_t>(end - begin);
+
+    // Partition: instrument -> task, then a counting sort of record
+    // positions so each task reads its records in journal order
+    std::vector<InstrumentTask> tasks;
+    OrderIndex<uint32_t> task_of_instrument(1024);
+    std::vector<uint32_t> task_of_record(record_count);
+    uint32_t last_instrument = 0;
+    uint32_t last_task = ~uint32_t{0};
+    for (size_t i = 0; i < record_count; ++i) {
+        uint32_t instrument = begin[i].instrument_id;
+        if (instrument != last_instrument || last_task == ~uint32_t{0}) {
+            const uint32_t* found = task_of_instrument.find(instrument);
+            if (found) {
+                last_task = *found;
+            } else {
+                last_task = static_cast<uint32_t>(tasks.size());
+                task_of_instrument.insert(instrument, last_task);
+                tasks.emplace_back();
+                tasks.back().instrument_id = instrument;
+            }
+            last_instrument = instrument;
+        }
+        task_of_record[i] = last_task;
+        ++tasks[last_task].count;
+    }
+    std::vector<size_t> cursor(tasks.size());
+    for (size_t t = 0, first = 0; t < tasks.size(); first += tasks[t].count, ++t) {
+        tasks[t].first = first;
+        cursor[t] = first;
+    }
+    std::vector<size_t> positions(record_count);
+    for (size_t i = 0; i < record_count; ++i) {
+        positions[cursor[task_of_record[i]]++] = i;
+    }
+    std::vector<uint32_t>().swap(task_of_record);
+    result.partition_us = micros_since(start);
+
+    // Largest instruments first; the small ones fill in behind them
+    std::vector<size_t> order(tasks.size());
+    for (size_t t = 0; t < tasks.size(); ++t) {
+        order[t] = t;
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&](size_t a, size_t b) { return tasks[a].count > tasks[b].count; });
+
+    size_t threads = config.threads ? config.threads : std::max(1u, std::thread::hardware_concurrency());
+    threads = std::max<size_t>(1, std::min(threads, tasks.size()));
+    ParallelReplayConfig task_config = config;
+    task_config.batch = std::max<size_t>(1, config.batch);
+    {
+        WorkStealingPool pool(threads, config.cpus);
+        std::vector<WorkerScratch> scratch(pool.size());
+        pool.run(order, [&](size_t t, size_t worker) {
+            WorkerScratch& local = scratch[worker];
+            if (local.batch.empty()) {
+                local.batch.resize(task_config.batch);
+                if (task_config.collect_deltas) {
+                    local.deltas = std::make_unique<DeltaFeed>(kDeltaRing);
+                }
+            }
+            tasks[t].summary.worker = worker;
+            replay_instrument(tasks[t], begin, positions.data(), task_config, local);
+        });
+        result.workers = pool.stats();
+    }
+
+    auto merge_start = Clock::now();
+    std::sort(tasks.begin(), tasks.end(),
+              [](const InstrumentTask& a, const InstrumentTask& b) { return a.instrument_id < b.instrument_id; });
+    result.fills = merge_streams(tasks, &InstrumentTask::fills);
+    result.deltas = merge_streams(tasks, &InstrumentTask::deltas);
+    for (InstrumentTask& task : tasks) {
+        result.instruments.push_back(task.summary);
+        result.totals.records += task.summary.stats.records;
+        result.totals.succeeded += task.summary.stats.succeeded;
+        if (config.keep_books) {
+            result.books.push_back(std::move(task.book));
+        }
+    }
+    result.merge_us = micros_since(merge_start);
+    result.totals.elapsed_us = micros_since(start);
+    return result;
+}
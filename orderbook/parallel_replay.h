@@ -0,0 +1,62 @@
+#pragma once
+#include "journal.h"
+#include "work_stealing_pool.h"
+
+// Backtest replay of a multi-instrument journal across cores. The records
+// are partitioned by instrument_id (one counting-sort pass, no copies of
+// the records), each instrument gets its own OrderBook, and the
+// instruments run as independent tasks on a WorkStealingPool. A book is
+// only ever touched by the worker running its task, and that worker
+// applies the instrument's records in journal order, so every book ends
+// exactly where a one-instrument replay_journal() would leave it. Fills and
+// level deltas are collected per instrument and merged at the end.
+
+struct ParallelReplayConfig {
+    size_t threads = 0;             // Workers; 0 = std::thread::hardware_concurrency()
+    std::vector<int> cpus;          // cpus[i] pins worker i; empty leaves them unpinned
+    size_t batch = 64;              // Records per apply_batch within one instrument
+    bool collect_fills = true;
+    bool collect_deltas = false;    // One LevelDelta per level change, can be large
+    bool keep_books = false;        // Hand the final books back in the result
+    OrderBookConfig book_config{};  // tick_size is usually the journal header's
+    size_t max_presize = 1 << 20;   // Cap on expected_orders per book (records otherwise)
+};
+
+// Outputs tagged with the journal position of the last record of the
+// batch that produced them, so the merged streams follow journal order
+struct ReplayFill {
+    uint64_t sequence;        // Offset from the start of the replayed range
+    uint32_t instrument_id;
+    Fill fill;
+};
+
+struct ReplayDelta {
+    uint64_t sequence;
+    uint32_t instrument_id;
+    LevelDelta delta;         // delta.sequence counts per book
+};
+
+struct InstrumentReplay {
+    uint32_t instrument_id = 0;
+    ReplayStats stats;        // elapsed_us is this book's own replay time
+    size_t fills = 0;
+    size_t deltas = 0;
+    size_t deltas_dropped = 0;   // Over the worker's ring in a single batch
+    size_t resting_orders = 0;
+    size_t worker = 0;        // Worker that ran it
+};
+
+struct ParallelReplayResult {
+    std::vector<InstrumentReplay> instruments;   // Ascending instrument_id
+    std::vector<ReplayFill> fills;               // Merged in journal order
+    std::vector<ReplayDelta> deltas;             // Merged in journal order (collect_deltas)
+    std::vector<std::unique_ptr<OrderBook>> books;   // keep_books: one per entry of instruments
+    std::vector<StealStats> workers;
+    ReplayStats totals;       // elapsed_us is wall time, partition and merge included
+    double partition_us = 0.0;
+    double merge_us = 0.0;
+};
+
+// Replay [begin, end) with one book per instrument on config.threads workers
+ParallelReplayResult replay_parallel(const JournalRecord* begin, const JournalRecord* end,
+                                     const ParallelReplayConfig& config = ParallelReplayConfig{});
@@ -0,0 +1,382 @@
+#pragma once
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Hardware performance counters through perf_event_open, for bracketing a
+// benchmark phase or any scope with cycles, instructions and the misses
+// that explain them. Counters are per thread (the one that built the
+// PerfCounters, on any CPU) and user space only, which
+// perf_event_paranoid <= 2 allows without privileges. Events the machine
+// or VM does not expose are left out rather than failing: a guest without
+// a virtual PMU still gets task-clock and page faults.
+//
+// start() and stop() are a few syscalls each (about a microsecond), so
+// bracket a phase or a batch, not a single book operation.
+enum class PerfEvent : unsigned {
+    Cycles,
+    Instructions,
+    L1dMisses,      // L1 data cache read misses
+    LlcMisses,      // Last-level cache read misses
+    BranchMisses,
+    DtlbMisses,     // Data TLB read misses
+    TaskClock,      // ns on CPU (software)
+    PageFaults,     // software
+    Count
+};
+
+constexpr size_t kPerfEventCount = static_cast<size_t>(PerfEvent::Count);
+
+// Counts between one start() and stop(), or the sum of several
+struct PerfSample {
+    std::array<uint64_t, kPerfEventCount> values{};
+    uint32_t valid = 0;   // Bit per PerfEvent that was counted
+
+    bool has(PerfEvent event) const { return valid & (1u << static_cast<unsigned>(event)); }
+    uint64_t operator[](PerfEvent event) const { return values[static_cast<size_t>(event)]; }
+
+    PerfSample& operator+=(const PerfSample& other) {
+        for (size_t i = 0; i < kPerfEventCount; ++i) {
+            values[i] += other.values[i];
+        }
+        valid |= other.valid;
+        return *this;
+    }
+
+    // One line of per-operation figures for the events that were counted
+    void print(std::ostream& out, const char* label, uint64_t operations) const {
+        static constexpr const char* kNames[kPerfEventCount] = {
+            "cycles", "instructions", "L1d-miss", "LLC-miss", "br-miss", "dTLB-miss", "task-clock-ns", "faults"};
+        out << "  " << label << " counters/op:";
+        if (valid == 0 || operations == 0) {
+            out << " unavailable\n";
+            return;
+        }
+        double ops = static_cast<double>(operations);
+        std::ios::fmtflags flags = out.flags();
+        std::streamsize precision = out.precision();
+        out << std::fixed << std::setprecision(2);
+        for (size_t i = 0; i < kPerfEventCount; ++i) {
+            if (valid & (1u << i)) {
+                out << " " << kNames[i] << "=" << static_cast<double>(values[i]) / ops;
+            }
+            if (i == static_cast<size_t>(PerfEvent::Instructions) && has(PerfEvent::Cycles) &&
+                has(PerfEvent::Instructions) && (*this)[PerfEvent::Cycles] != 0) {
+                out << " IPC=" << static_cast<double>((*this)[PerfEvent::Instructions]) /
+                                      static_cast<double>((*this)[PerfEvent::Cycles]);
+            }
+        }
+        out << "\n";
+        out.flags(flags);
+        out.precision(precision);
+    }
+};
+
+class PerfCounters {
+public:
+    // Opens every event it can in three groups, so the events of a group
+    // count over the same intervals: cycles, instructions and branch misses;
+    // the cache and TLB misses; the software events. A group the PMU can
+    // never schedule (a counter held by the NMI watchdog or the SMT
+    // sibling) still opens, so a calibration start/stop checks that each
+    // group got time and reopens the members of one that did not on their
+    // own. Events that cannot join a group, or run on their own, are scaled
+    // for multiplexing.
+    PerfCounters() {
+        fds_.fill(-1);
+        for (unsigned i = 0; i < kPerfEventCount; ++i) {
+            open(static_cast<PerfEvent>(i));
+        }
+        calibrate();
+    }
+
+    ~PerfCounters() {
+        for (int fd : fds_) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available() const { return opened_ != 0; }
+    bool has(PerfEvent event) const { return opened_ & (1u << static_cast<unsigned>(event)); }
+
+    // "cycles, instructions (No such file or directory)" for what is missing
+    std::string missing() const {
+        static constexpr const char* kNames[kPerfEventCount] = {
+            "cycles", "instructions", "L1d misses", "LLC misses", "branch misses", "dTLB misses",
+            "task clock", "page faults"};
+        std::string out;
+        for (unsigned i = 0; i < kPerfEventCount; ++i) {
+            if (!(opened_ & (1u << i))) {
+                out += out.empty() ? "" : ", ";
+                out += kNames[i];
+            }
+        }
+        if (!out.empty() && first_error_ != 0) {
+            out += " (";
+            out += std::strerror(first_error_);
+            out += ")";
+        }
+        return out;
+    }
+
+    void start() {
+        for (const Group& group : groups_) {
+            if (group.leader >= 0) {
+                ioctl(group.leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+                ioctl(group.leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+            }
+        }
+        for (unsigned i = 0; i < kPerfEventCount; ++i) {
+            if (solo_ & (1u << i)) {
+                ioctl(fds_[i], PERF_EVENT_IOC_RESET, 0);
+                ioctl(fds_[i], PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+    }
+
+    PerfSample stop() {
+        disable();
+        PerfSample sample;
+        for (const Group& group : groups_) {
+            read_group(group, sample);
+        }
+        for (unsigned i = 0; i < kPerfEventCount; ++i) {
+            if (solo_ & (1u << i)) {
+                uint64_t buffer[3];   // value, time_enabled, time_running
+                if (::read(fds_[i], buffer, sizeof(buffer)) == static_cast<ssize_t>(sizeof(buffer))) {
+                    store(sample, static_cast<PerfEvent>(i), buffer[0], buffer[1], buffer[2]);
+                }
+            }
+        }
+        return sample;
+    }
+
+private:
+    enum GroupId : unsigned { kCoreGroup, kMemoryGroup, kSoftwareGroup, kGroupCount };
+
+    struct Group {
+        int leader = -1;
+        std::array<PerfEvent, kPerfEventCount> members{};   // Group read order
+        size_t size = 0;
+    };
+
+    void disable() {
+        for (const Group& group : groups_) {
+            if (group.leader >= 0) {
+                ioctl(group.leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+            }
+        }
+        for (unsigned i = 0; i < kPerfEventCount; ++i) {
+            if (solo_ & (1u << i)) {
+                ioctl(fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+            }
+        }
+    }
+
+    static GroupId group_of(PerfEvent event) {
+        switch (event) {
+        case PerfEvent::L1dMisses:
+        case PerfEvent::LlcMisses:
+        case PerfEvent::DtlbMisses:
+            return kMemoryGroup;
+        case PerfEvent::TaskClock:
+        case PerfEvent::PageFaults:
+            return kSoftwareGroup;
+        default:
+            return kCoreGroup;
+        }
+    }
+
+    static void describe(PerfEvent event, perf_event_attr& attr) {
+        auto cache = [](uint64_t cache_id) {
+            return cache_id | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        };
+        attr.type = PERF_TYPE_HARDWARE;
+        switch (event) {
+        case PerfEvent::Cycles:
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case PerfEvent::Instructions:
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case PerfEvent::L1dMisses:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = cache(PERF_COUNT_HW_CACHE_L1D);
+            break;
+        case PerfEvent::LlcMisses:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = cache(PERF_COUNT_HW_CACHE_LL);
+            break;
+        case PerfEvent::BranchMisses:
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        case PerfEvent::DtlbMisses:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = cache(PERF_COUNT_HW_CACHE_DTLB);
+            break;
+        case PerfEvent::TaskClock:
+            attr.type = PERF_TYPE_SOFTWARE;
+            attr.config = PERF_COUNT_SW_TASK_CLOCK;
+            break;
+        case PerfEvent::PageFaults:
+            attr.type = PERF_TYPE_SOFTWARE;
+            attr.config = PERF_COUNT_SW_PAGE_FAULTS;
+            break;
+        case PerfEvent::Count:
+            break;
+        }
+    }
+
+    static int open_event(perf_event_attr& attr, int group_fd) {
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+    }
+
+    static void init_attr(PerfEvent event, perf_event_attr& attr) {
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        describe(event, attr);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    }
+
+    void open(PerfEvent event) {
+        perf_event_attr attr;
+        init_attr(event, attr);
+        Group& group = groups_[group_of(event)];
+        int fd = -1;
+        if (group.leader < 0) {
+            attr.disabled = 1;
+            attr.read_format |= PERF_FORMAT_GROUP;
+            fd = open_event(attr, -1);
+            if (fd >= 0) {
+                group.leader = fd;
+            }
+        } else {
+            fd = open_event(attr, group.leader);   // Members follow the leader's enable
+        }
+        if (fd >= 0) {
+            group.members[group.size++] = event;
+            fds_[static_cast<size_t>(event)] = fd;
+            opened_ |= 1u << static_cast<unsigned>(event);
+        } else {
+            int error = errno;
+            if (!open_solo(event)) {
+                first_error_ = first_error_ ? first_error_ : error;
+            }
+        }
+    }
+
+    bool open_solo(PerfEvent event) {
+        perf_event_attr attr;
+        init_attr(event, attr);
+        attr.disabled = 1;
+        int fd = open_event(attr, -1);
+        if (fd < 0) {
+            return false;
+        }
+        unsigned bit = 1u << static_cast<unsigned>(event);
+        fds_[static_cast<size_t>(event)] = fd;
+        opened_ |= bit;
+        solo_ |= bit;
+        return true;
+    }
+
+    // One start/stop over a short loop; a group that got no counter time
+    // (it opened but the PMU never schedules it) is broken up so its
+    // events at least multiplex on their own
+    void calibrate() {
+        start();
+        volatile uint64_t spin = 0;
+        for (unsigned i = 0; i < 100000; ++i) {
+            spin = spin + i;
+        }
+        disable();
+        for (Group& group : groups_) {
+            if (group.leader < 0) {
+                continue;
+            }
+            uint64_t buffer[3 + kPerfEventCount];
+            ssize_t n = ::read(group.leader, buffer, sizeof(buffer));
+            if (n >= static_cast<ssize_t>(3 * sizeof(uint64_t)) && buffer[2] == 0) {
+                split(group);
+            }
+        }
+    }
+
+    // Close a group's members (leader last) and reopen each on its own
+    void split(Group& group) {
+        for (size_t k = group.size; k-- > 0;) {
+            size_t i = static_cast<size_t>(group.members[k]);
+            ::close(fds_[i]);
+            fds_[i] = -1;
+            opened_ &= ~(1u << static_cast<unsigned>(i));
+        }
+        for (size_t k = 0; k < group.size; ++k) {
+            open_solo(group.members[k]);
+        }
+        group = Group{};
+    }
+
+    static void read_group(const Group& group, PerfSample& sample) {
+        if (group.leader < 0) {
+            return;
+        }
+        // nr, time_enabled, time_running, then one value per member
+        uint64_t buffer[3 + kPerfEventCount];
+        if (::read(group.leader, buffer, sizeof(buffer)) >= static_cast<ssize_t>(3 * sizeof(uint64_t))) {
+            for (uint64_t k = 0; k < buffer[0] && k < group.size; ++k) {
+                store(sample, group.members[k], buffer[3 + k], buffer[1], buffer[2]);
+            }
+        }
+    }
+
+    // Scales a multiplexed count up to the whole interval; nothing if the
+    // event never got a counter
+    static void store(PerfSample& sample, PerfEvent event, uint64_t value, uint64_t enabled, uint64_t running) {
+        if (running == 0) {
+            return;
+        }
+        if (running < enabled) {
+            value = static_cast<uint64_t>(static_cast<double>(value) * enabled / running);
+        }
+        sample.values[static_cast<size_t>(event)] = value;
+        sample.valid |= 1u << static_cast<unsigned>(event);
+    }
+
+    std::array<int, kPerfEventCount> fds_{};
+    std::array<Group, kGroupCount> groups_{};
+    uint32_t opened_ = 0;
+    uint32_t solo_ = 0;       // Opened outside the group
+    int first_error_ = 0;
+};
+
+// Adds the counts of a scope to a running total (one start/stop per scope)
+class ScopedPerf {
+public:
+    ScopedPerf(PerfCounters& counters, PerfSample& total) : counters_(counters), total_(total) {
+        counters_.start();
+    }
+
+    ~ScopedPerf() { total_ += counters_.stop(); }
+
+    ScopedPerf(const ScopedPerf&) = delete;
+    ScopedPerf& operator=(const ScopedPerf&) = delete;
+
+private:
+    PerfCounters& counters_;
+    PerfSample& total_;
+};
@@ -0,0 +1,344 @@
+// Tick-to-book pipeline: a feed thread replays commands into a Fifo3, a book
+// thread applies them with apply_batch and publishes L2 deltas, and a
+// consumer thread keeps a depth mirror from the deltas. Every message
+// carries TSC stamps from each stage, and the run reports each stage's
+// latency distribution plus the end-to-end one. --perf adds hardware
+// counters per stage: the feed and consumer loops as a whole, and each
+// apply_batch call on the book thread.
+//
+//   pipeline [--journal <file> | --commands <count>] [--rate <msgs/s>]
+//            [--batch <n>] [--capacity <slots>] [--cpus <feed>,<book>,<consumer>] [--perf]
+#include "journal.h"
+#include "latency_histogram.h"
+#include "perf_counters.h"
+#include "tsc_clock.h"
+#include "workload.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <pthread.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Feed -> book. `received` is when the message reached the feed thread (its
+// scheduled time when paced, so a late feed shows up as latency)
+struct StampedCommand {
+    Command command;
+    uint64_t received;
+    uint64_t enqueued;
+};
+
+// Book -> consumer, one per batch that published deltas, pushed after them
+struct BatchStamp {
+    uint32_t last_sequence;   // The batch's end_of_batch delta
+    uint64_t oldest_received;
+    uint64_t dequeued;
+    uint64_t applied;
+};
+
+using CommandQueue = Fifo3<StampedCommand, std::allocator<StampedCommand>, true>;
+using StampQueue = Fifo3<BatchStamp, std::allocator<BatchStamp>, true>;
+
+struct PipelineConfig {
+    size_t batch = 64;
+    size_t capacity = 4096;
+    double rate = 0;   // Messages per second; 0 replays back to back
+    int feed_cpu = -1;
+    int book_cpu = -1;
+    int consumer_cpu = -1;
+    bool perf = false;
+};
+
+void pin_to(int cpu) {
+    if (cpu < 0) {
+        return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+// Per-stage latencies in ns; each histogram is written by one thread
+struct StageLatency {
+    LatencyHistogram feed;        // received -> enqueued, per command
+    LatencyHistogram queue;       // enqueued -> dequeued, per command
+    LatencyHistogram book;        // dequeued -> applied, per batch
+    LatencyHistogram deltas;      // applied -> mirror updated, per batch
+    LatencyHistogram end_to_end;  // oldest received -> mirror updated, per batch
+};
+
+// Per-stage counters with --perf; each sample is written by one thread
+struct StageCounters {
+    PerfSample feed;       // Whole feed loop
+    PerfSample book;       // apply_batch calls only
+    PerfSample consumer;   // Whole consumer loop
+};
+
+class Pipeline {
+public:
+    Pipeline(const PipelineConfig& config, const std::vector<Command>& commands)
+        : config_(config), commands_(commands), queue_(config.capacity),
+          deltas_(1 << 16), stamps_(1 << 16) {
+        OrderBookConfig book_config;
+        book_config.expected_orders = commands.size();
+        book_ = std::make_unique<OrderBook>(book_config);
+        book_->set_delta_feed(&deltas_);
+    }
+
+    void run() {
+        std::thread consumer([this] { consume(); });
+        std::thread book([this] { apply(); });
+        auto start = std::chrono::steady_clock::now();
+        feed();
+        book.join();
+        consumer.join();
+        elapsed_s_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void report(std::ostream& out) const {
+        out << "  " << commands_.size() << " commands in " << elapsed_s_ * 1e3 << " ms ("
+            << commands_.size() / elapsed_s_ / 1e6 << " M/s), " << batches_ << " batches, "
+            << delta_count_ << " deltas (" << book_->deltas_dropped() << " dropped), "
+            << feed_stalls_ << " feed stalls on a full queue\n";
+        latency_.feed.print(out, "feed -> queue");
+        latency_.queue.print(out, "queue wait");
+        latency_.book.print(out, "apply_batch");
+        latency_.deltas.print(out, "deltas -> mirror");
+        latency_.end_to_end.print(out, "end to end");
+        if (config_.perf) {
+            if (!perf_missing_.empty()) {
+                out << "  perf counters unavailable: " << perf_missing_ << "\n";
+            }
+            counters_.feed.print(out, "feed (per command)", commands_.size());
+            counters_.book.print(out, "apply_batch (per command)", commands_.size());
+            counters_.consumer.print(out, "consumer (per delta)", delta_count_);
+        }
+        out << "  mirror: " << bid_mirror_.size() << " bid / " << ask_mirror_.size()
+            << " ask levels, book " << book_->get_order_count() << " orders\n";
+    }
+
+private:
+    uint64_t ns(uint64_t cycles) const { return clock_.to_ns(cycles); }
+
+    void feed() {
+        pin_to(config_.feed_cpu);
+        std::unique_ptr<PerfCounters> perf;
+        if (config_.perf) {
+            perf = std::make_unique<PerfCounters>();   // Opened on the thread it counts
+            perf_missing_ = perf->missing();
+            perf->start();
+        }
+        uint64_t interval = config_.rate > 0
+            ? static_cast<uint64_t>(clock_.cycles_per_ns() * 1e9 / config_.rate) : 0;
+        uint64_t next = tsc::now();
+        for (const Command& command : commands_) {
+            uint64_t received;
+            if (interval) {
+                while (tsc::now() < next) {}
+                received = next;   // Scheduled arrival: a late feed thread counts against the pipeline
+                next += interval;
+            } else {
+                received = tsc::now();
+            }
+            StampedCommand* slot;
+            while (!(slot = queue_.try_reserve())) {
+                ++feed_stalls_;
+            }
+            uint64_t enqueued = tsc::now();
+            new (slot) StampedCommand{command, received, enqueued};
+            queue_.commit();
+            latency_.feed.record(ns(enqueued - received));
+        }
+        if (perf) {
+            counters_.feed = perf->stop();
+        }
+        feed_done_.store(true, std::memory_order_release);
+    }
+
+    void apply() {
+        pin_to(config_.book_cpu);
+        std::unique_ptr<PerfCounters> perf;
+        if (config_.perf) {
+            perf = std::make_unique<PerfCounters>();
+        }
+        std::vector<StampedCommand> batch(config_.batch);
+        std::vector<Command> commands(config_.batch);
+        while (true) {
+            size_t n = queue_.pop_n(batch.data(), batch.size());
+            if (n == 0) {
+                if (feed_done_.load(std::memory_order_acquire) && queue_.empty()) {
+                    break;
+                }
+                continue;
+            }
+            uint64_t dequeued = tsc::now();
+            uint64_t oldest = batch[0].received;
+            for (size_t i = 0; i < n; ++i) {
+                commands[i] = batch[i].command;
+                oldest = std::min(oldest, batch[i].received);
+                latency_.queue.record(ns(dequeued - batch[i].enqueued));
+            }
+            uint32_t sequence = book_->delta_sequence();
+            if (perf) {
+                ScopedPerf scope(*perf, counters_.book);
+                book_->apply_batch(commands.data(), n);
+            } else {
+                book_->apply_batch(commands.data(), n);
+            }
+            uint64_t applied = tsc::now();
+            latency_.book.record(ns(applied - dequeued));
+            ++batches_;
+            if (book_->delta_sequence() != sequence) {
+                BatchStamp stamp{book_->delta_sequence(), oldest, dequeued, applied};
+                while (!stamps_.push(stamp)) {}
+            }
+        }
+        book_done_.store(true, std::memory_order_release);
+    }
+
+    void consume() {
+        pin_to(config_.consumer_cpu);
+        std::unique_ptr<PerfCounters> perf;
+        if (config_.perf) {
+            perf = std::make_unique<PerfCounters>();
+            perf->start();
+        }
+        LevelDelta delta;
+        while (true) {
+            if (!deltas_.pop(delta)) {
+                if (book_done_.load(std::memory_order_acquire) && deltas_.empty()) {
+                    break;
+                }
+                continue;
+            }
+            ++delta_count_;
+            auto& side = delta.is_buy ? bid_mirror_ : ask_mirror_;
+            if (delta.total_quantity) {
+                side[delta.price] = delta.total_quantity;
+            } else {
+                side.erase(delta.price);
+            }
+            if (delta.end_of_batch) {
+                finish_batch(delta.sequence);
+            }
+        }
+        if (perf) {
+            counters_.consumer = perf->stop();
+        }
+    }
+
+    // The mirror is consistent: close the stamps of the batch ending here.
+    // A batch whose last delta was dropped is skipped once a later one passes.
+    void finish_batch(uint32_t sequence) {
+        uint64_t now = tsc::now();
+        while (true) {
+            const BatchStamp* stamp = stamps_.front();
+            if (!stamp) {
+                continue;   // Pushed right after the deltas
+            }
+            if (static_cast<int32_t>(stamp->last_sequence - sequence) > 0) {
+                return;
+            }
+            if (stamp->last_sequence == sequence) {
+                latency_.deltas.record(ns(now - stamp->applied));
+                latency_.end_to_end.record(ns(now - stamp->oldest_received));
+                stamps_.pop();
+                return;
+            }
+            stamps_.pop();
+        }
+    }
+
+    PipelineConfig config_;
+    const TscClock& clock_ = TscClock::instance();
+    const std::vector<Command>& commands_;
+    std::unique_ptr<OrderBook> book_;
+
+    alignas(64) CommandQueue queue_;
+    DeltaFeed deltas_;
+    StampQueue stamps_;
+    alignas(64) std::atomic<bool> feed_done_{false};
+    std::atomic<bool> book_done_{false};
+
+    StageLatency latency_;
+    StageCounters counters_;
+    std::string perf_missing_;
+    uint64_t feed_stalls_ = 0;
+    uint64_t batches_ = 0;
+    uint64_t delta_count_ = 0;
+    std::map<Price, uint64_t> bid_mirror_;
+    std::map<Price, uint64_t> ask_mirror_;
+    double elapsed_s_ = 0;
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    PipelineConfig config;
+    size_t count = 2000000;
+    std::string journal;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--perf") == 0) {
+            config.perf = true;
+        } else if (i + 1 == argc) {
+            break;
+        } else if (std::strcmp(argv[i], "--commands") == 0) {
+            count = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--journal") == 0) {
+            journal = argv[++i];
+        } else if (std::strcmp(argv[i], "--rate") == 0) {
+            config.rate = std::strtod(argv[++i], nullptr);
+        } else if (std::strcmp(argv[i], "--batch") == 0) {
+            config.batch = std::max<size_t>(1, std::strtoull(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--capacity") == 0) {
+            config.capacity = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--cpus") == 0) {
+            char* end = nullptr;
+            config.feed_cpu = static_cast<int>(std::strtol(argv[++i], &end, 10));
+            if (*end == ',') {
+                config.book_cpu = static_cast<int>(std::strtol(end + 1, &end, 10));
+            }
+            if (*end == ',') {
+                config.consumer_cpu = static_cast<int>(std::strtol(end + 1, &end, 10));
+            }
+        }
+    }
+
+    std::vector<Command> commands;
+    try {
+        if (!journal.empty()) {
+            JournalReader reader(journal);
+            commands.reserve(reader.size());
+            for (size_t i = 0; i < reader.size(); ++i) {
+                commands.push_back(reader.records()[i].to_command());
+            }
+        } else {
+            WorkloadConfig workload;
+            workload.long_lifetime = static_cast<double>(count);
+            WorkloadGenerator generator(workload);
+            generator.prefill(count / 10, commands);
+            generator.generate(count, commands);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+
+    std::cout << "=== Tick-to-book pipeline (" << commands.size() << " commands, batch "
+              << config.batch << ", capacity " << config.capacity << ", "
+              << (config.rate > 0 ? std::to_string(static_cast<uint64_t>(config.rate)) + " msgs/s"
+                                  : std::string("full speed"))
+              << ", cpus " << config.feed_cpu << "," << config.book_cpu << ","
+              << config.consumer_cpu << ") ===\n";
+    Pipeline pipeline(config, commands);
+    pipeline.run();
+    pipeline.report(std::cout);
+    return 0;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include "arena.h"
+
+// Owning pointers for objects that live in a pool or an arena, so code
+// outside the book's intrusive structures (messages in flight, staged
+// orders) can hold them without a raw pointer and a manual destroy().
+// std::unique_ptr stores an empty deleter as a base class, so it stays
+// one pointer; a deleter that remembers its pool adds one more pointer.
+
+// Returns the object to the pool it came from: anything with
+// construct(args...) and destroy(T*), such as MemoryPool or a
+// ConcurrentPool::Cache (whose destroy() takes objects from any cache)
+template<typename Pool>
+struct PoolDeleter {
+    Pool* pool = nullptr;
+
+    template<typename T>
+    void operator()(T* ptr) const { pool->destroy(ptr); }
+};
+
+// Stateless variant for a pool found through Instance() (a global or
+// thread_local pool), keeping the owning pointer pointer-sized
+template<typename Pool, Pool& (*Instance)()>
+struct StaticPoolDeleter {
+    template<typename T>
+    void operator()(T* ptr) const { Instance().destroy(ptr); }
+};
+
+// Arena memory is reclaimed by the arena's reset(); only the destructor runs
+struct ArenaDeleter {
+    template<typename T>
+    void operator()(T* ptr) const { ptr->~T(); }
+};
+
+template<typename T, typename Pool>
+using PooledPtr = std::unique_ptr<T, PoolDeleter<Pool>>;
+
+template<typename T>
+using ArenaPtr = std::unique_ptr<T, ArenaDeleter>;
+
+template<typename T, typename Pool, typename... Args>
+PooledPtr<T, Pool> make_pooled(Pool& pool, Args&&... args) {
+    return PooledPtr<T, Pool>(pool.construct(std::forward<Args>(args)...), PoolDeleter<Pool>{&pool});
+}
+
+template<typename T, typename Pool, Pool& (*Instance)(), typename... Args>
+std::unique_ptr<T, StaticPoolDeleter<Pool, Instance>> make_pooled(Args&&... args) {
+    return std::unique_ptr<T, StaticPoolDeleter<Pool, Instance>>(
+        Instance().construct(std::forward<Args>(args)...));
+}
+
+template<typename T, typename... Args>
+ArenaPtr<T> make_in_arena(Arena& arena, Args&&... args) {
+    return ArenaPtr<T>(arena.create<T>(std::forward<Args>(args)...));
+}
+
+static_assert(sizeof(ArenaPtr<int>) == sizeof(int*), "empty deleter adds no space");
+static_assert(sizeof(PooledPtr<int, int>) == 2 * sizeof(int*), "pool deleter holds one pointer");
@@ -0,0 +1,99 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Direct-indexed price ladder: a contiguous array of price levels indexed by
+// tick offset from a movable anchor. An occupancy bitmap (one bit per level)
+// lets best-price and next-level searches run as word-wide bit scans instead
+// of tree walks. Covers [anchor, anchor + size()) ticks.
+template<typename Level>
+class PriceLadder {
+public:
+    using Price = int64_t;
+
+    // Size is rounded up to a multiple of 64 levels; 0 disables the ladder
+    void init(size_t num_levels) {
+        size_t words = (num_levels + 63) / 64;
+        levels_.assign(words * 64, Level{});
+        occupancy_.assign(words, 0);
+        occupied_ = 0;
+    }
+
+    bool enabled() const { return !levels_.empty(); }
+    size_t size() const { return levels_.size(); }
+    bool empty() const { return occupied_ == 0; }
+    Price anchor() const { return anchor_; }
+
+    // Anchor may only move while no level is occupied
+    void set_anchor(Price anchor) { anchor_ = anchor; }
+
+    bool contains(Price price) const {
+        return static_cast<uint64_t>(price - anchor_) < levels_.size();
+    }
+
+    Level& at(Price price) { return levels_[index(price)]; }
+    const Level& at(Price price) const { return levels_[index(price)]; }
+
+    void prefetch(Price price) const {
+        __builtin_prefetch(&levels_[index(price)]);
+    }
+
+    bool is_occupied(Price price) const {
+        size_t i = index(price);
+        return (occupancy_[i >> 6] >> (i & 63)) & 1;
+    }
+
+    void set_occupied(Price price) {
+        size_t i = index(price);
+        occupancy_[i >> 6] |= uint64_t{1} << (i & 63);
+        ++occupied_;
+    }
+
+    void clear_occupied(Price price) {
+        size_t i = index(price);
+        occupancy_[i >> 6] &= ~(uint64_t{1} << (i & 63));
+        --occupied_;
+    }
+
+    // Highest occupied price <= from (from must be inside the window)
+    bool highest_at_or_below(Price from, Price& out) const {
+        size_t i = index(from);
+        size_t w = i >> 6;
+        uint64_t word = occupancy_[w] & (~uint64_t{0} >> (63 - (i & 63)));
+        while (true) {
+            if (word) {
+                out = anchor_ + static_cast<Price>(w * 64 + 63 - __builtin_clzll(word));
+                return true;
+            }
+            if (w == 0) return false;
+            word = occupancy_[--w];
+        }
+    }
+
+    // Lowest occupied price >= from (from must be inside the window)
+    bool lowest_at_or_above(Price from, Price& out) const {
+        size_t i = index(from);
+        size_t w = i >> 6;
+        uint64_t word = occupancy_[w] & (~uint64_t{0} << (i & 63));
+        while (true) {
+            if (word) {
+                out = anchor_ + static_cast<Price>(w * 64 + __builtin_ctzll(word));
+                return true;
+            }
+            if (++w == occupancy_.size()) return false;
+            word = occupancy_[w];
+        }
+    }
+
+    Price lowest_price() const { return anchor_; }
+    Price highest_price() const { return anchor_ + static_cast<Price>(levels_.size()) - 1; }
+
+private:
+    size_t index(Price price) const { return static_cast<size_t>(price - anchor_); }
+
+    std::vector<Level> levels_;
+    std::vector<uint64_t> occupancy_;
+    Price anchor_ = 0;
+    size_t occupied_ = 0;
+};
@@ -0,0 +1,44 @@
+#pragma once
+#include "concurrent_pool.h"
+#include "intrusive_ptr.h"
+#include "order_book.h"
+
+// Immutable top-N view shared by reference instead of copied per reader.
+// The book thread takes a SnapshotRef from a SnapshotPool and hands copies
+// to readers (through their queues); each copy costs one relaxed increment,
+// and the last reader to drop its copy returns the object to the pool from
+// whatever thread it runs on. The next take() on the book thread reuses it.
+template<size_t N>
+struct SharedSnapshot
+    : PooledRefCounted<SharedSnapshot<N>, SharedReturnPool<SharedSnapshot<N>, 256>> {
+    BookSnapshot<N> view;
+};
+
+template<size_t N>
+using SnapshotRef = IntrusivePtr<const SharedSnapshot<N>>;
+
+template<size_t N>
+class SnapshotPool {
+public:
+    // Book thread only. The same snapshot while the book's version is
+    // unchanged, otherwise a fresh one from the pool.
+    SnapshotRef<N> take(const OrderBook& book) {
+        if (!current_ || current_->view.version != book.version()) {
+            IntrusivePtr<SharedSnapshot<N>> fresh = make_pooled_intrusive<SharedSnapshot<N>>(pool_);
+            book.get_snapshot(fresh->view);
+            current_ = std::move(fresh);
+        }
+        return current_;
+    }
+
+    // Book thread only
+    PoolStats stats() const { return pool_.stats(); }
+
+    // Let go of the current snapshot; readers keep their copies
+    void release() { current_.reset(); }
+
+private:
+    // Declared first: destroyed after current_ returns its object
+    SharedReturnPool<SharedSnapshot<N>, 256> pool_;
+    SnapshotRef<N> current_;
+};
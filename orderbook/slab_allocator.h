@@ -0,0 +1,367 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <vector>
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Thread-local size-class allocator for small node-sized blocks (map nodes,
+// queue rings, pool blocks of short-lived containers).
+//
+// Requests round up to one of 40 size classes (16-byte steps to 128, then
+// four per doubling up to 32 KiB). Each thread owns a SlabHeap with one
+// free list and one partly carved slab per class, so a hit is a pop or
+// a bump with no atomics. Slabs are 256 KiB, aligned to their size, and
+// start with a header naming their owner heap and class; a block freed by
+// another thread is pushed onto the owner's lock-free remote list, which
+// the owner takes whole when its own list and slab run dry. Blocks above
+// the largest class, or aligned to more than 4 KiB, go to the heap.
+// Frees are sized (like std::allocator and std::pmr): pass the same bytes
+// and alignment as the allocation.
+//
+// Slabs are cut from 4 MiB segments mapped lazily and bound (MPOL_PREFERRED)
+// to the NUMA node the heap's thread was on when it mapped them, so pages
+// are local to the owner even when another thread touches them first.
+// Memory stays with its class and heap and is never returned to the OS; a
+// heap whose thread exits is parked and adopted by the next new thread.
+class SlabHeap {
+public:
+    static constexpr size_t kSlabBytes = size_t{256} << 10;
+    static constexpr size_t kSegmentBytes = size_t{4} << 20;
+    static constexpr size_t kMaxBlock = size_t{32} << 10;
+    static constexpr size_t kMaxAlign = 4096;
+    static constexpr size_t kClassCount = 40;
+
+    struct ClassStats {
+        size_t block_size = 0;
+        uint64_t allocations = 0;
+        uint64_t frees = 0;          // Local frees plus collected remote ones
+        uint64_t remote_frees = 0;   // Freed by another thread
+        size_t slabs = 0;
+    };
+    struct Stats {
+        std::array<ClassStats, kClassCount> classes{};
+        uint64_t large_allocations = 0;
+        uint64_t large_frees = 0;
+        size_t mapped_bytes = 0;
+        int numa_node = -1;          // Node the last segment was bound to (-1: unbound)
+
+        uint64_t live_blocks() const {
+            uint64_t live = 0;
+            for (const ClassStats& c : classes) {
+                live += c.allocations - c.frees;
+            }
+            return live;
+        }
+    };
+
+    // Block size of each class
+    static constexpr size_t class_size(size_t index) {
+        if (index < 8) {
+            return (index + 1) * 16;
+        }
+        size_t k = 7 + (index - 8) / 4;   // Class lies in (2^k, 2^(k+1)]
+        return (size_t{1} << k) + ((index - 8) % 4 + 1) * (size_t{1} << (k - 2));
+    }
+
+    // Smallest class holding `bytes` at `alignment`, or kClassCount for the heap
+    static size_t class_of(size_t bytes, size_t alignment) {
+        if (alignment > kMaxAlign) {
+            return kClassCount;
+        }
+        if (bytes < alignment) {
+            bytes = alignment;
+        }
+        size_t index = class_for_size(bytes);
+        while (index < kClassCount && natural_alignment(class_size(index)) < alignment) {
+            ++index;
+        }
+        return index;
+    }
+
+    // The calling thread's heap, created (or adopted) on first use
+    static SlabHeap& local() {
+        SlabHeap* heap = tls_heap_;
+        return heap ? *heap : attach();
+    }
+
+    void* allocate(size_t bytes, size_t alignment) {
+        size_t index = class_of(bytes, alignment);
+        if (index == kClassCount) {
+            ++stats_.large_allocations;
+            return ::operator new(bytes, std::align_val_t(std::max(alignment, kMinAlign)));
+        }
+        SizeClass& c = classes_[index];
+        ++c.stats.allocations;
+        if (FreeBlock* block = c.free) {
+            c.free = block->next;
+            return block;
+        }
+        return refill(index);
+    }
+
+    // `p` may come from any thread's heap
+    static void deallocate(void* p, size_t bytes, size_t alignment) {
+        size_t index = class_of(bytes, alignment);
+        if (index == kClassCount) {
+            ++local().stats_.large_frees;
+            ::operator delete(p, std::align_val_t(std::max(alignment, kMinAlign)));
+            return;
+        }
+        Slab* slab = slab_of(p);
+        SlabHeap* owner = slab->owner;
+        auto* block = static_cast<FreeBlock*>(p);
+        if (owner == tls_heap_) {
+            SizeClass& c = owner->classes_[slab->size_class];
+            ++c.stats.frees;
+            block->next = c.free;
+            c.free = block;
+            return;
+        }
+        FreeBlock* head = owner->remote_.load(std::memory_order_relaxed);
+        do {
+            block->next = head;
+        } while (!owner->remote_.compare_exchange_weak(head, block, std::memory_order_release,
+                                                       std::memory_order_relaxed));
+    }
+
+    Stats stats() const {
+        Stats out = stats_;
+        for (size_t i = 0; i < kClassCount; ++i) {
+            out.classes[i] = classes_[i].stats;
+            out.classes[i].block_size = class_size(i);
+        }
+        return out;
+    }
+
+    SlabHeap(const SlabHeap&) = delete;
+    SlabHeap& operator=(const SlabHeap&) = delete;
+
+private:
+    static constexpr size_t kMinAlign = alignof(std::max_align_t);
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+    struct Slab {
+        SlabHeap* owner;
+        uint32_t size_class;
+    };
+    struct SizeClass {
+        FreeBlock* free = nullptr;
+        char* carve = nullptr;       // Unused tail of the current slab
+        char* carve_end = nullptr;
+        ClassStats stats;
+    };
+
+    SlabHeap() = default;
+
+    // Parks the thread's heap for reuse when the thread exits
+    struct ThreadExit {
+        ~ThreadExit() {
+            if (tls_heap_) {
+                std::lock_guard<std::mutex> lock(registry().mutex);
+                registry().parked.push_back(tls_heap_);
+                tls_heap_ = nullptr;
+            }
+        }
+    };
+    // Heaps outlive their threads (remote frees may still arrive), so the
+    // registry is never destroyed
+    struct Registry {
+        std::mutex mutex;
+        std::vector<SlabHeap*> parked;
+    };
+    static Registry& registry() {
+        static Registry* registry = new Registry;
+        return *registry;
+    }
+
+    static SlabHeap& attach() {
+        static thread_local ThreadExit exit_guard;
+        (void)exit_guard;
+        SlabHeap* heap = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(registry().mutex);
+            if (!registry().parked.empty()) {
+                heap = registry().parked.back();
+                registry().parked.pop_back();
+            }
+        }
+        if (!heap) {
+            heap = new SlabHeap;
+        }
+        tls_heap_ = heap;
+        return *heap;
+    }
+
+    static size_t natural_alignment(size_t size) { return size & (~size + 1); }
+
+    static size_t class_for_size(size_t bytes) {
+        if (bytes <= 128) {
+            return bytes == 0 ? 0 : (bytes - 1) / 16;
+        }
+        if (bytes > kMaxBlock) {
+            return kClassCount;
+        }
+        size_t k = 63 - static_cast<size_t>(__builtin_clzll(bytes - 1));   // 2^k < bytes <= 2^(k+1)
+        size_t step = size_t{1} << (k - 2);
+        size_t j = (bytes - (size_t{1} << k) + step - 1) / step;
+        return 8 + (k - 7) * 4 + (j - 1);
+    }
+
+    static Slab* slab_of(void* p) {
+        return reinterpret_cast<Slab*>(reinterpret_cast<uintptr_t>(p) & ~(kSlabBytes - 1));
+    }
+
+    void* refill(size_t index) {
+        SizeClass& c = classes_[index];
+        size_t size = class_size(index);
+        if (c.carve_end - c.carve >= static_cast<ptrdiff_t>(size)) {
+            void* block = c.carve;
+            c.carve += size;
+            return block;
+        }
+        if (collect_remote()) {
+            if (FreeBlock* block = c.free) {
+                c.free = block->next;
+                return block;
+            }
+        }
+        char* slab = new_slab(index);
+        size_t offset = (sizeof(Slab) + std::min(natural_alignment(size), kMaxAlign) - 1) &
+                        ~(std::min(natural_alignment(size), kMaxAlign) - 1);
+        c.carve = slab + offset + size;
+        c.carve_end = slab + kSlabBytes;
+        return slab + offset;
+    }
+
+    // Move blocks other threads freed back onto their class lists
+    bool collect_remote() {
+        if (!remote_.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        FreeBlock* block = remote_.exchange(nullptr, std::memory_order_acquire);
+        while (block) {
+            FreeBlock* next = block->next;
+            SizeClass& c = classes_[slab_of(block)->size_class];
+            ++c.stats.frees;
+            ++c.stats.remote_frees;
+            block->next = c.free;
+            c.free = block;
+            block = next;
+        }
+        return true;
+    }
+
+    char* new_slab(size_t index) {
+        if (segment_ == segment_end_) {
+            map_segment();
+        }
+        char* slab = segment_;
+        segment_ += kSlabBytes;
+        new (slab) Slab{this, static_cast<uint32_t>(index)};
+        ++classes_[index].stats.slabs;
+        return slab;
+    }
+
+    void map_segment() {
+        // Over-map and trim so the segment (and every slab in it) is aligned
+        size_t span = kSegmentBytes * 2;
+        void* raw = mmap(nullptr, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        uintptr_t start = (reinterpret_cast<uintptr_t>(raw) + kSegmentBytes - 1) & ~(kSegmentBytes - 1);
+        size_t head = start - reinterpret_cast<uintptr_t>(raw);
+        if (head) {
+            munmap(raw, head);
+        }
+        if (span - head > kSegmentBytes) {
+            munmap(reinterpret_cast<void*>(start + kSegmentBytes), span - head - kSegmentBytes);
+        }
+        segment_ = reinterpret_cast<char*>(start);
+        segment_end_ = segment_ + kSegmentBytes;
+        stats_.mapped_bytes += kSegmentBytes;
+        bind_local(segment_);
+    }
+
+    void bind_local(char* segment) {
+        unsigned cpu = 0, node = 0;
+        if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0 || node >= 64) {
+            return;
+        }
+        unsigned long mask = 1ul << node;
+        if (syscall(SYS_mbind, segment, kSegmentBytes, MPOL_PREFERRED, &mask, 64, 0) == 0) {
+            stats_.numa_node = static_cast<int>(node);
+        }
+    }
+
+    std::array<SizeClass, kClassCount> classes_{};
+    char* segment_ = nullptr;        // Unused slabs of the current segment
+    char* segment_end_ = nullptr;
+    Stats stats_;
+    alignas(64) std::atomic<FreeBlock*> remote_{nullptr};
+
+    static inline thread_local SlabHeap* tls_heap_ = nullptr;
+};
+
+static_assert(SlabHeap::class_size(SlabHeap::kClassCount - 1) == SlabHeap::kMaxBlock,
+              "largest class must be kMaxBlock");
+
+// Allocator-traits front end, e.g. Fifo3<T, SlabAllocator<T>> or
+// std::map<K, V, Compare, SlabAllocator<std::pair<const K, V>>>. Stateless:
+// any instance frees what any other allocated.
+template<typename T>
+struct SlabAllocator {
+    using value_type = T;
+    using is_always_equal = std::true_type;
+
+    SlabAllocator() = default;
+    template<typename U>
+    SlabAllocator(const SlabAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        if (n > std::numeric_limits<size_t>::max() / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        return static_cast<T*>(SlabHeap::local().allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, size_t n) { SlabHeap::deallocate(p, n * sizeof(T), alignof(T)); }
+
+    template<typename U>
+    bool operator==(const SlabAllocator<U>&) const { return true; }
+    template<typename U>
+    bool operator!=(const SlabAllocator<U>&) const { return false; }
+};
+
+// std::pmr front end, e.g. for OrderBookConfig::memory_resource
+class SlabResource : public std::pmr::memory_resource {
+public:
+    static SlabResource* instance() {
+        static SlabResource resource;
+        return &resource;
+    }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        return SlabHeap::local().allocate(bytes, alignment);
+    }
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        SlabHeap::deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return dynamic_cast<const SlabResource*>(&other) != nullptr;
+    }
+};
@@ -0,0 +1,84 @@
+#pragma once
+#include "order_book.h"
+#include <atomic>
+#include <cassert>
+#include <cstring>
+
+// Single-writer / multi-reader top-N view. The book thread publishes into
+// it (attach() hooks OrderBook's publish callback, so that happens once per
+// command or batch that changed the top N); any number of reader threads
+// copy it out without locks. The writer never waits: it bumps the sequence
+// to odd, stores, and bumps it back to even. Readers retry while a write is
+// in flight or the sequence moved under them. The payload is held in
+// relaxed atomic words so concurrent copies are well-defined.
+template<size_t N>
+class SnapshotSeqlock {
+public:
+    SnapshotSeqlock() = default;
+    SnapshotSeqlock(const SnapshotSeqlock&) = delete;
+    SnapshotSeqlock& operator=(const SnapshotSeqlock&) = delete;
+
+    // Publish after every top-N change of book. The book's own cache must
+    // cover N levels, or changes below its cached depth go unpublished.
+    void attach(OrderBook& book) {
+        assert(N <= book.cached_depth() && "seqlock depth exceeds the book's cached depth");
+        book.set_publish_callback(&SnapshotSeqlock::publish, this);
+        publish(book, this);
+    }
+
+    // Writer side, on the book thread only
+    void store(const BookSnapshot<N>& snapshot) {
+        uint64_t words[kWords] = {};
+        std::memcpy(words, &snapshot, sizeof(snapshot));
+
+        uint64_t seq = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < kWords; ++i) {
+            payload_[i].store(words[i], std::memory_order_relaxed);
+        }
+        sequence_.store(seq + 2, std::memory_order_release);
+    }
+
+    static void publish(const OrderBook& book, void* self) {
+        BookSnapshot<N> snapshot;
+        book.get_snapshot(snapshot);
+        static_cast<SnapshotSeqlock*>(self)->store(snapshot);
+    }
+
+    // One attempt; false if it raced a write (out may then hold a torn copy)
+    bool try_load(BookSnapshot<N>& out) const {
+        uint64_t before = sequence_.load(std::memory_order_acquire);
+        if (before & 1) {
+            return false;
+        }
+        uint64_t words[kWords];
+        for (size_t i = 0; i < kWords; ++i) {
+            words[i] = payload_[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence_.load(std::memory_order_relaxed) != before) {
+            return false;
+        }
+        std::memcpy(&out, words, sizeof(out));
+        return true;
+    }
+
+    // Spin until a consistent copy is taken
+    void load(BookSnapshot<N>& out) const {
+        while (!try_load(out)) {
+            __builtin_ia32_pause();
+        }
+    }
+
+    // Completed publications so far
+    uint64_t publications() const { return sequence_.load(std::memory_order_acquire) / 2; }
+
+private:
+    static_assert(std::is_trivially_copyable<BookSnapshot<N>>::value,
+                  "snapshot is copied word by word");
+    static constexpr size_t kWords = (sizeof(BookSnapshot<N>) + 7) / 8;
+
+    alignas(64) std::atomic<uint64_t> sequence_{0};
+    alignas(64) std::atomic<uint64_t> payload_[kWords] = {};
+};
@@ -0,0 +1,98 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <x86intrin.h>
+
+// Time-stamp-counter reads. A TSC read is a few cycles, against tens of ns
+// for a clock_gettime() vDSO call. With an invariant TSC (constant_tsc and
+// nonstop_tsc in /proc/cpuinfo, true of current x86-64 servers) it ticks at
+// a fixed rate on every core regardless of frequency scaling, so a single
+// calibration (TscClock) turns cycles into nanoseconds.
+namespace tsc {
+
+// Unordered read: the CPU may move it across neighbouring instructions
+inline uint64_t now() { return __rdtsc(); }
+
+// Benchmark fences. start() reads only after earlier instructions have
+// completed and before the timed code begins; stop() waits for the timed
+// code to complete and keeps later instructions from starting early.
+inline uint64_t start() {
+    _mm_lfence();
+    uint64_t cycles = __rdtsc();
+    _mm_lfence();
+    return cycles;
+}
+
+inline uint64_t stop() {
+    unsigned aux;
+    uint64_t cycles = __rdtscp(&aux);
+    _mm_lfence();
+    return cycles;
+}
+
+}  // namespace tsc
+
+// Cycle <-> nanosecond conversion calibrated against steady_clock. now_ns()
+// is on the steady_clock epoch, so it mixes with std::chrono timestamps.
+class TscClock {
+public:
+    // Process-wide clock, calibrated on first use (about 10 ms)
+    static const TscClock& instance() {
+        static const TscClock clock;
+        return clock;
+    }
+
+    explicit TscClock(std::chrono::nanoseconds calibration = std::chrono::milliseconds(10)) {
+        using Clock = std::chrono::steady_clock;
+        Clock::time_point begin = Clock::now();
+        uint64_t begin_cycles = tsc::start();
+        Clock::time_point end;
+        do {
+            end = Clock::now();
+        } while (end - begin < calibration);
+        uint64_t end_cycles = tsc::stop();
+
+        uint64_t elapsed_ns = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+        uint64_t cycles = end_cycles - begin_cycles;
+        scale_ = static_cast<uint64_t>(
+            (static_cast<unsigned __int128>(elapsed_ns) << kShift) / (cycles ? cycles : 1));
+        base_cycles_ = begin_cycles;
+        base_ns_ = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(begin.time_since_epoch()).count());
+    }
+
+    // Multiply and shift; exact to well under 1 ns per second of cycles
+    uint64_t to_ns(uint64_t cycles) const {
+        return static_cast<uint64_t>((static_cast<unsigned __int128>(cycles) * scale_) >> kShift);
+    }
+
+    uint64_t now_ns() const { return base_ns_ + to_ns(tsc::now() - base_cycles_); }
+
+    double cycles_per_ns() const {
+        return static_cast<double>(uint64_t{1} << kShift) / static_cast<double>(scale_);
+    }
+
+private:
+    static constexpr unsigned kShift = 32;
+
+    uint64_t scale_;        // Nanoseconds per cycle, fixed point with kShift fraction bits
+    uint64_t base_cycles_;
+    uint64_t base_ns_;
+};
+
+// Cached timestamp for stamping events: refresh() once per loop iteration or
+// batch, and every now_ns() in between is a plain load of the same value
+class CoarseClock {
+public:
+    explicit CoarseClock(const TscClock& clock = TscClock::instance()) : clock_(clock) {
+        refresh();
+    }
+
+    uint64_t refresh() { return now_ns_ = clock_.now_ns(); }
+    uint64_t now_ns() const { return now_ns_; }
+
+private:
+    const TscClock& clock_;
+    uint64_t now_ns_ = 0;
+};
@@ -0,0 +1,252 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Chase-Lev work-stealing deque of task indices (Le et al., "Correct and
+// Efficient Work-Stealing for Weak Memory Models", 2013). The owner pushes
+// and takes at the bottom (LIFO); other threads steal from the top. Fixed
+// capacity: push() fails when full instead of growing.
+class StealingDeque {
+public:
+    static constexpr size_t kEmpty = ~size_t{0};
+
+    explicit StealingDeque(size_t capacity = 1024) {
+        size_t rounded = 1;
+        while (rounded < capacity) {
+            rounded <<= 1;
+        }
+        slots_ = std::make_unique<std::atomic<size_t>[]>(rounded);
+        mask_ = static_cast<int64_t>(rounded - 1);
+    }
+
+    // Owner only
+    bool push(size_t task) {
+        int64_t bottom = bottom_.load(std::memory_order_relaxed);
+        int64_t top = top_.load(std::memory_order_acquire);
+        if (bottom - top > mask_) {
+            return false;
+        }
+        slots_[bottom & mask_].store(task, std::memory_order_relaxed);
+        bottom_.store(bottom + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Owner only; kEmpty when nothing is left
+    size_t take() {
+        int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+        bottom_.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = top_.load(std::memory_order_relaxed);
+        if (top > bottom) {
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+            return kEmpty;
+        }
+        size_t task = slots_[bottom & mask_].load(std::memory_order_relaxed);
+        if (top == bottom) {
+            // Last task: race a thief for it
+            if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                              std::memory_order_relaxed)) {
+                task = kEmpty;
+            }
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return task;
+    }
+
+    // Any thread; kEmpty when empty or when another thread won the race
+    size_t steal() {
+        int64_t top = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t bottom = bottom_.load(std::memory_order_acquire);
+        if (top >= bottom) {
+            return kEmpty;
+        }
+        size_t task = slots_[top & mask_].load(std::memory_order_relaxed);
+        if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                          std::memory_order_relaxed)) {
+            return kEmpty;
+        }
+        return task;
+    }
+
+    bool empty() const {
+        return top_.load(std::memory_order_acquire) >= bottom_.load(std::memory_order_acquire);
+    }
+
+private:
+    alignas(64) std::atomic<int64_t> top_{0};
+    alignas(64) std::atomic<int64_t> bottom_{0};
+    std::unique_ptr<std::atomic<size_t>[]> slots_;
+    int64_t mask_ = 0;
+};
+
+// Per-worker counts for the last run()
+struct StealStats {
+    uint64_t tasks = 0;     // Tasks this worker ran
+    uint64_t stolen = 0;    // Of those, taken from another worker's deque
+};
+
+// Fixed set of worker threads, each with a StealingDeque, for batches of
+// independent tasks known up front (one per instrument in a replay). run()
+// deals the tasks round-robin over the deques, wakes the workers, and
+// returns when every task has run; a worker whose deque is empty steals
+// from the others, so a few long tasks do not leave cores idle.
+class WorkStealingPool {
+public:
+    // cpus[i] pins worker i (cpu < 0 or a short list leaves it unpinned)
+    explicit WorkStealingPool(size_t threads, const std::vector<int>& cpus = {})
+        : stats_(threads ? threads : 1) {
+        size_t count = threads ? threads : 1;
+        for (size_t i = 0; i < count; ++i) {
+            workers_.push_back(std::make_unique<Worker>());
+        }
+        for (size_t i = 0; i < count; ++i) {
+            int cpu = i < cpus.size() ? cpus[i] : -1;
+            workers_[i]->thread = std::thread([this, i, cpu] { worker_loop(i, cpu); });
+        }
+    }
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        start_cv_.notify_all();
+        for (auto& worker : workers_) {
+            worker->thread.join();
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    size_t size() const { return workers_.size(); }
+
+    // Run fn(task, worker) on the workers for every task in `order` and
+    // wait for all of them. Earlier entries start first, so put the longest
+    // tasks first and let the short ones fill the gaps (they are what
+    // thieves pick up). Not reentrant: one caller at a time.
+    template<typename Fn>
+    void run(const std::vector<size_t>& order, Fn&& fn) {
+        size_t per_worker = order.size() / workers_.size() + 1;
+        for (auto& worker : workers_) {
+            worker->deque = std::make_unique<StealingDeque>(per_worker);
+        }
+        // Owners take last-in first: deal in reverse so the front of
+        // `order` ends up at each deque's bottom
+        for (size_t i = order.size(); i-- > 0;) {
+            workers_[i % workers_.size()]->deque->push(order[i]);
+        }
+        for (auto& stats : stats_) {
+            stats = StealStats{};
+        }
+        job_ = &invoke<std::remove_reference_t<Fn>>;
+        job_context_ = &fn;
+        remaining_.store(order.size(), std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            active_ = workers_.size();
+            ++generation_;
+        }
+        start_cv_.notify_all();
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_cv_.wait(lock, [this] { return active_ == 0; });
+    }
+
+    const std::vector<StealStats>& stats() const { return stats_; }
+
+private:
+    struct Worker {
+        std::unique_ptr<StealingDeque> deque;   // Rebuilt by each run()
+        std::thread thread;
+    };
+
+    using Job = void (*)(void* context, size_t task, size_t worker);
+
+    template<typename Fn>
+    static void invoke(void* context, size_t task, size_t worker) {
+        (*static_cast<Fn*>(context))(task, worker);
+    }
+
+    static void pin(int cpu) {
+#ifdef __linux__
+        if (cpu < 0) {
+            return;
+        }
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+        (void)cpu;
+#endif
+    }
+
+    void worker_loop(size_t index, int cpu) {
+        pin(cpu);
+        uint64_t seen = 0;
+        uint64_t victim_state = index * 0x9E3779B97F4A7C15ull + 1;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                start_cv_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+                if (stopping_) {
+                    return;
+                }
+                seen = generation_;
+            }
+            StealStats& stats = stats_[index];
+            StealingDeque& own = *workers_[index]->deque;
+            while (remaining_.load(std::memory_order_acquire) != 0) {
+                size_t task = own.take();
+                bool stolen = false;
+                if (task == StealingDeque::kEmpty && workers_.size() > 1) {
+                    // xorshift pick of a victim other than ourselves
+                    victim_state ^= victim_state << 13;
+                    victim_state ^= victim_state >> 7;
+                    victim_state ^= victim_state << 17;
+                    size_t victim = victim_state % (workers_.size() - 1);
+                    victim += victim >= index;
+                    task = workers_[victim]->deque->steal();
+                    stolen = true;
+                }
+                if (task == StealingDeque::kEmpty) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                job_(job_context_, task, index);
+                ++stats.tasks;
+                stats.stolen += stolen;
+                remaining_.fetch_sub(1, std::memory_order_acq_rel);
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--active_ == 0) {
+                done_cv_.notify_one();
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<StealStats> stats_;
+    Job job_ = nullptr;
+    void* job_context_ = nullptr;
+    alignas(64) std::atomic<size_t> remaining_{0};
+
+    std::mutex mutex_;
+    std::condition_variable start_cv_;
+    std::condition_variable done_cv_;
+    uint64_t generation_ = 0;
+    size_t active_ = 0;
+    bool stopping_ = false;
+};
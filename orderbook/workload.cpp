@@ -0,0 +1,111 @@
+#include "workload.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// std::push_heap / pop_heap build max-heaps; invert for earliest expiry on top
+struct LaterExpiry {
+    template<typename T>
+    bool operator()(const T& a, const T& b) const { return a.expiry > b.expiry; }
+};
+
+}  // namespace
+
+WorkloadGenerator::WorkloadGenerator(const WorkloadConfig& config)
+    : config_(config), rng_(config.seed),
+      qty_dist_(config.min_quantity, std::max(config.min_quantity, config.max_quantity)),
+      mid_(config.start_mid) {
+    offset_cdf_.reserve(config_.max_offset + 1);
+    double total = 0.0;
+    for (size_t k = 0; k <= config_.max_offset; ++k) {
+        total += 1.0 / std::pow(static_cast<double>(k + 1), config_.zipf_exponent);
+        offset_cdf_.push_back(total);
+    }
+    for (double& c : offset_cdf_) {
+        c /= total;
+    }
+}
+
+Command WorkloadGenerator::next() {
+    ++event_;
+    if (unit_(rng_) < config_.mid_step_probability) {
+        mid_ += unit_(rng_) < 0.5 ? -1 : 1;
+    }
+
+    const WorkloadMix& mix = config_.mix;
+    double total = mix.add + mix.cancel + mix.amend + mix.aggressive;
+    double r = unit_(rng_) * total;
+    if (r < mix.cancel && !live_.empty()) {
+        return make_cancel();
+    }
+    r -= mix.cancel;
+    if (r < mix.amend && !live_.empty()) {
+        return make_amend();
+    }
+    r -= mix.amend;
+    return make_add(r >= 0.0 && r < mix.aggressive, false);
+}
+
+void WorkloadGenerator::prefill(size_t count, std::vector<Command>& out) {
+    out.reserve(out.size() + count);
+    for (size_t i = 0; i < count; ++i) {
+        ++event_;
+        out.push_back(make_add(false, true));
+    }
+}
+
+void WorkloadGenerator::generate(size_t count, std::vector<Command>& out) {
+    out.reserve(out.size() + count);
+    for (size_t i = 0; i < count; ++i) {
+        out.push_back(next());
+    }
+}
+
+Command WorkloadGenerator::make_add(bool aggressive, bool long_lived) {
+    bool is_buy = unit_(rng_) < 0.5;
+    Price price;
+    if (aggressive) {
+        // Through the opposite touch by 0-2 ticks
+        Price through = static_cast<Price>(unit_(rng_) * 3.0);
+        price = is_buy ? mid_ + 1 + through : mid_ - 1 - through;
+    } else {
+        price = passive_price(is_buy);
+    }
+
+    Order order(next_id_++, is_buy, price, qty_dist_(rng_), event_);
+    // Aggressive remainders rest too; they get a short life like any other order
+    live_.push_back(LiveOrder{event_ + lifetime(long_lived), order.order_id, price, is_buy});
+    std::push_heap(live_.begin(), live_.end(), LaterExpiry{});
+    return Command::add(order);
+}
+
+Command WorkloadGenerator::make_cancel() {
+    std::pop_heap(live_.begin(), live_.end(), LaterExpiry{});
+    uint64_t order_id = live_.back().order_id;
+    live_.pop_back();
+    return Command::cancel(order_id, event_);
+}
+
+Command WorkloadGenerator::make_amend() {
+    // Any live order; price is not part of the heap key so it can change in place
+    LiveOrder& target = live_[static_cast<size_t>(unit_(rng_) * live_.size()) % live_.size()];
+    if (unit_(rng_) < 0.2) {
+        target.price = passive_price(target.is_buy);
+    }
+    return Command::amend(target.order_id, target.price, qty_dist_(rng_), event_);
+}
+
+Price WorkloadGenerator::passive_price(bool is_buy) {
+    double u = unit_(rng_);
+    size_t k = static_cast<size_t>(
+        std::lower_bound(offset_cdf_.begin(), offset_cdf_.end(), u) - offset_cdf_.begin());
+    Price offset = static_cast<Price>(std::min(k, config_.max_offset));
+    return is_buy ? mid_ - 1 - offset : mid_ + 1 + offset;
+}
+
+uint64_t WorkloadGenerator::lifetime(bool long_lived) {
+    bool short_lived = !long_lived && unit_(rng_) < config_.short_lived_fraction;
+    double mean = short_lived ? config_.short_lifetime : config_.long_lifetime;
+    return 1 + static_cast<uint64_t>(-std::log(1.0 - unit_(rng_)) * mean);
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include "order_book.h"
+#include <random>
+#include <vector>
+
+// Synthetic order flow for benchmarks. Shapes real flow roughly:
+// - passive prices cluster at the touch with a Zipf-like tail
+//   (P(k ticks away) ~ 1 / (k + 1)^zipf_exponent)
+// - a configurable add / cancel / amend / aggressive mix
+// - each resting order gets a lifetime (in events) from a two-class
+//   exponential mix, so many orders are short-lived and cancels target
+//   the oldest-expiring order first
+// The mid price random-walks so the touch moves over the run.
+struct WorkloadMix {
+    double add = 0.40;
+    double cancel = 0.45;
+    double amend = 0.10;
+    double aggressive = 0.05;   // Adds priced through the touch
+};
+
+struct WorkloadConfig {
+    uint64_t seed = 42;
+    WorkloadMix mix{};
+    Price start_mid = 10000;            // Ticks
+    size_t max_offset = 200;            // Deepest passive level, ticks from the touch
+    double zipf_exponent = 1.2;
+    double short_lived_fraction = 0.6;  // Orders drawn from the short lifetime class
+    double short_lifetime = 20.0;       // Mean lifetime, events
+    double long_lifetime = 50000.0;
+    uint64_t min_quantity = 1;
+    uint64_t max_quantity = 500;
+    double mid_step_probability = 0.01; // Per event, mid moves one tick
+};
+
+class WorkloadGenerator {
+public:
+    explicit WorkloadGenerator(const WorkloadConfig& config = WorkloadConfig{});
+
+    // Next command in the stream
+    Command next();
+
+    // `count` passive adds with long lifetimes, used to build resting depth
+    void prefill(size_t count, std::vector<Command>& out);
+
+    // Append `count` commands from the configured mix
+    void generate(size_t count, std::vector<Command>& out);
+
+    // Orders the generator believes are resting (fills are not tracked)
+    size_t live_orders() const { return live_.size(); }
+    Price mid() const { return mid_; }
+
+private:
+    struct LiveOrder {
+        uint64_t expiry;     // Event index at which the order gets cancelled
+        uint64_t order_id;
+        Price price;
+        bool is_buy;
+    };
+
+    Command make_add(bool aggressive, bool long_lived);
+    Command make_cancel();
+    Command make_amend();
+    Price passive_price(bool is_buy);
+    uint64_t lifetime(bool long_lived);
+
+    WorkloadConfig config_;
+    std::mt19937_64 rng_;
+    std::uniform_real_distribution<double> unit_{0.0, 1.0};
+    std::uniform_int_distribution<uint64_t> qty_dist_;
+    std::vector<double> offset_cdf_;   // Cumulative Zipf weights over [0, max_offset]
+
+    // Min-heap on expiry; indexed directly for random amend targets
+    std::vector<LiveOrder> live_;
+    uint64_t next_id_ = 1;
+    uint64_t event_ = 0;
+    Price mid_;
+};